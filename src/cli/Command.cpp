@@ -34,6 +34,7 @@
 #include "Merge.h"
 #include "Remove.h"
 #include "Show.h"
+#include "Tune.h"
 
 QMap<QString, Command*> commands;
 
@@ -73,6 +74,7 @@ void populateCommands()
         commands.insert(QString("merge"), new Merge());
         commands.insert(QString("rm"), new Remove());
         commands.insert(QString("show"), new Show());
+        commands.insert(QString("tune"), new Tune());
     }
 }
 
@@ -0,0 +1,154 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <stdio.h>
+
+#include "Tune.h"
+
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QThread>
+
+#include "crypto/kdf/Argon2Tuner.h"
+
+Tune::Tune()
+{
+    name = QString("tune");
+    description = QObject::tr("Recommend Argon2 parameters for this computer.");
+}
+
+Tune::~Tune()
+{
+}
+
+int Tune::execute(const QStringList& arguments)
+{
+    QTextStream outputTextStream(stdout, QIODevice::WriteOnly);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(this->description);
+    QCommandLineOption target(QStringList() << "t"
+                                            << "target",
+                              QObject::tr("Target unlock time in milliseconds (default: 1000)"),
+                              QObject::tr("msec"));
+    parser.addOption(target);
+    QCommandLineOption minMemory(QStringList() << "min-memory",
+                                 QObject::tr("Smallest memory size to try in MiB (default: 16)"),
+                                 QObject::tr("MiB"));
+    parser.addOption(minMemory);
+    QCommandLineOption maxMemory(QStringList() << "max-memory",
+                                 QObject::tr("Largest memory size to try in MiB (default: 1024)"),
+                                 QObject::tr("MiB"));
+    parser.addOption(maxMemory);
+    QCommandLineOption maxParallelism(QStringList() << "max-parallelism",
+                                      QObject::tr("Largest number of lanes to try (default: number of CPU threads)"),
+                                      QObject::tr("threads"));
+    parser.addOption(maxParallelism);
+    QCommandLineOption memoryBudget(QStringList() << "memory-budget",
+                                    QObject::tr("Most memory the recommendation may use in MiB (default: no limit)"),
+                                    QObject::tr("MiB"));
+    parser.addOption(memoryBudget);
+
+    parser.process(arguments);
+
+    const QStringList args = parser.positionalArguments();
+    if (!args.isEmpty()) {
+        outputTextStream << parser.helpText().replace("keepassxc-cli", "keepassxc-cli tune");
+        return EXIT_FAILURE;
+    }
+
+    int targetMsec = 1000;
+    if (parser.isSet(target)) {
+        targetMsec = parser.value(target).toInt();
+        if (targetMsec <= 0) {
+            qCritical("Invalid target time %s.", qPrintable(parser.value(target)));
+            return EXIT_FAILURE;
+        }
+    }
+
+    quint64 minMemoryMiB = 16;
+    if (parser.isSet(minMemory)) {
+        minMemoryMiB = parser.value(minMemory).toULongLong();
+        if (minMemoryMiB == 0) {
+            qCritical("Invalid memory size %s.", qPrintable(parser.value(minMemory)));
+            return EXIT_FAILURE;
+        }
+    }
+
+    quint64 maxMemoryMiB = qMax(Q_UINT64_C(1024), minMemoryMiB);
+    if (parser.isSet(maxMemory)) {
+        maxMemoryMiB = parser.value(maxMemory).toULongLong();
+        if (maxMemoryMiB < minMemoryMiB) {
+            qCritical("Invalid memory size %s.", qPrintable(parser.value(maxMemory)));
+            return EXIT_FAILURE;
+        }
+    }
+
+    quint32 lanes = static_cast<quint32>(qMax(1, QThread::idealThreadCount()));
+    if (parser.isSet(maxParallelism)) {
+        lanes = parser.value(maxParallelism).toUInt();
+        if (lanes == 0) {
+            qCritical("Invalid parallelism %s.", qPrintable(parser.value(maxParallelism)));
+            return EXIT_FAILURE;
+        }
+    }
+
+    quint64 memoryBudgetMiB = 0;
+    if (parser.isSet(memoryBudget)) {
+        memoryBudgetMiB = parser.value(memoryBudget).toULongLong();
+        if (memoryBudgetMiB == 0) {
+            qCritical("Invalid memory budget %s.", qPrintable(parser.value(memoryBudget)));
+            return EXIT_FAILURE;
+        }
+    }
+
+    Argon2Tuner tuner(targetMsec);
+    tuner.setMemoryRange(minMemoryMiB * 1024, maxMemoryMiB * 1024);
+    tuner.setMaxParallelism(lanes);
+    tuner.setMemoryBudget(memoryBudgetMiB * 1024);
+
+    outputTextStream << QObject::tr("Memory (MiB)\tParallelism\tIterations\tTime (ms)\tPeak RSS (MiB)\tUsed (MiB)")
+                     << endl;
+    tuner.setProgressCallback([&outputTextStream](const Argon2Tuner::Measurement& measurement) {
+        outputTextStream << measurement.parameters.memory / 1024 << "\t\t" << measurement.parameters.parallelism
+                         << "\t\t" << measurement.parameters.iterations << "\t\t" << qRound(measurement.msec)
+                         << "\t\t";
+        if (measurement.peakRss < 0) {
+            outputTextStream << "-";
+        } else {
+            outputTextStream << measurement.peakRss / 1024;
+        }
+        outputTextStream << "\t\t" << measurement.memoryUsed() / 1024 << endl;
+    });
+
+    if (!tuner.tune()) {
+        qCritical("No Argon2 parameters meet a target time of %d ms within the memory budget.", targetMsec);
+        return EXIT_FAILURE;
+    }
+
+    const Argon2Tuner::Measurement recommendation = tuner.recommendation();
+    outputTextStream << endl
+                     << QObject::tr("Recommended parameters for a %1 ms unlock time:").arg(targetMsec) << endl
+                     << QObject::tr("Memory: %1 MiB").arg(recommendation.parameters.memory / 1024) << endl
+                     << QObject::tr("Parallelism: %1").arg(recommendation.parameters.parallelism) << endl
+                     << QObject::tr("Iterations: %1").arg(recommendation.parameters.iterations) << endl
+                     << QObject::tr("Measured time: %1 ms").arg(qRound(recommendation.msec)) << endl
+                     << QObject::tr("Memory used: %1 MiB").arg(recommendation.memoryUsed() / 1024) << endl;
+
+    return EXIT_SUCCESS;
+}
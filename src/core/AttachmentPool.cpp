@@ -0,0 +1,266 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AttachmentPool.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+
+#include "core/Endian.h"
+#include "crypto/Random.h"
+#include "crypto/SymmetricCipher.h"
+
+AttachmentPool::AttachmentPool()
+    : m_totalSize(0)
+    , m_spilledSize(0)
+    , m_spillOffset(0)
+{
+}
+
+AttachmentPool::~AttachmentPool()
+{
+}
+
+AttachmentPool* AttachmentPool::instance()
+{
+    static AttachmentPool pool;
+    return &pool;
+}
+
+/**
+ * Add a reference to the given content, storing it if it is new.
+ *
+ * @return id of the content
+ */
+QByteArray AttachmentPool::add(const QByteArray& data)
+{
+    QMutexLocker locker(&m_mutex);
+    return insert(data, false);
+}
+
+/**
+ * Like add(), but new content is written to the spill file instead of
+ * being kept in memory. Content that is pooled already stays where it is.
+ * If the spill file cannot be written the content is kept in memory.
+ *
+ * @return id of the content
+ */
+QByteArray AttachmentPool::addSpilled(const QByteArray& data)
+{
+    QMutexLocker locker(&m_mutex);
+    return insert(data, true);
+}
+
+void AttachmentPool::retain(const QByteArray& id)
+{
+    QMutexLocker locker(&m_mutex);
+
+    auto it = m_blobs.find(id);
+    Q_ASSERT(it != m_blobs.end());
+    if (it != m_blobs.end()) {
+        ++it->refCount;
+    }
+}
+
+void AttachmentPool::release(const QByteArray& id)
+{
+    QMutexLocker locker(&m_mutex);
+
+    auto it = m_blobs.find(id);
+    Q_ASSERT(it != m_blobs.end());
+    if (it == m_blobs.end() || --it->refCount > 0) {
+        return;
+    }
+
+    if (it->spillOffset >= 0) {
+        m_spilledSize -= it->size;
+    } else {
+        m_ids.remove(it->data.constData());
+        m_totalSize -= it->size;
+    }
+    m_blobs.erase(it);
+
+    if (m_spillFile && m_spilledSize == 0) {
+        // nothing refers to the spill file anymore, start over with a fresh key
+        // so the offsets, which are used as nonces, can be reused
+        m_spillFile->resize(0);
+        m_spillKey.clear();
+        m_spillOffset = 0;
+    }
+}
+
+/**
+ * Content of the attachment, spilled content is read back from disk.
+ *
+ * @param ok set to false if the attachment is unknown or its spilled
+ *           content can't be read back, the returned data is empty then
+ */
+QByteArray AttachmentPool::data(const QByteArray& id, bool* ok) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    QByteArray data;
+    bool found = false;
+    const auto it = m_blobs.constFind(id);
+    if (it != m_blobs.constEnd()) {
+        if (it->spillOffset >= 0) {
+            found = readSpilled(*it, data);
+        } else {
+            data = it->data;
+            found = true;
+        }
+    }
+
+    if (ok) {
+        *ok = found;
+    }
+    return data;
+}
+
+int AttachmentPool::dataSize(const QByteArray& id) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_blobs.value(id).size;
+}
+
+bool AttachmentPool::isSpilled(const QByteArray& id) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    const auto it = m_blobs.constFind(id);
+    return it != m_blobs.constEnd() && it->spillOffset >= 0;
+}
+
+/**
+ * Number of distinct attachments in the pool.
+ */
+int AttachmentPool::count() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_blobs.size();
+}
+
+/**
+ * Memory taken by the attachment contents in bytes.
+ */
+qint64 AttachmentPool::totalSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_totalSize;
+}
+
+/**
+ * Size of the attachment contents that are spilled to disk in bytes.
+ */
+qint64 AttachmentPool::spilledSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_spilledSize;
+}
+
+QByteArray AttachmentPool::insert(const QByteArray& data, bool spillData)
+{
+    QByteArray id = m_ids.value(data.constData());
+    if (id.isEmpty() || m_blobs.value(id).size != data.size()) {
+        id = QCryptographicHash::hash(data, QCryptographicHash::Sha256);
+    }
+
+    auto it = m_blobs.find(id);
+    if (it != m_blobs.end()) {
+        ++it->refCount;
+        return id;
+    }
+
+    Blob blob;
+    blob.data = data;
+    blob.refCount = 1;
+    blob.size = data.size();
+
+    if (spillData && !data.isEmpty() && spill(blob)) {
+        m_spilledSize += blob.size;
+    } else {
+        if (!data.isEmpty()) {
+            m_ids.insert(data.constData(), id);
+        }
+        m_totalSize += blob.size;
+    }
+    m_blobs.insert(id, blob);
+
+    return id;
+}
+
+/**
+ * Append the content of the blob to the spill file and drop it from memory.
+ */
+bool AttachmentPool::spill(Blob& blob)
+{
+    if (!m_spillFile) {
+        const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        if (cacheDir.isEmpty() || !QDir().mkpath(cacheDir)) {
+            return false;
+        }
+
+        QScopedPointer<QTemporaryFile> file(new QTemporaryFile(cacheDir + "/attachments-XXXXXX"));
+        if (!file->open()) {
+            return false;
+        }
+        m_spillFile.reset(file.take());
+    }
+
+    if (m_spillKey.isEmpty()) {
+        m_spillKey = randomGen()->randomArray(32);
+    }
+
+    const qint64 offset = m_spillOffset;
+    QByteArray encrypted = blob.data;
+    SymmetricCipher cipher(SymmetricCipher::ChaCha20, SymmetricCipher::Stream, SymmetricCipher::Encrypt);
+    if (!cipher.init(m_spillKey, Endian::sizedIntToBytes<qint64>(offset, QSysInfo::LittleEndian))
+        || !cipher.processInPlace(encrypted)) {
+        return false;
+    }
+
+    // the nonce is used up even if the write fails, part of the data may be on disk
+    m_spillOffset = offset + encrypted.size();
+    if (!m_spillFile->seek(offset) || m_spillFile->write(encrypted) != encrypted.size() || !m_spillFile->flush()) {
+        return false;
+    }
+
+    blob.data.clear();
+    blob.spillOffset = offset;
+    return true;
+}
+
+bool AttachmentPool::readSpilled(const Blob& blob, QByteArray& data) const
+{
+    if (!m_spillFile->seek(blob.spillOffset)) {
+        return false;
+    }
+
+    QByteArray content = m_spillFile->read(blob.size);
+    SymmetricCipher cipher(SymmetricCipher::ChaCha20, SymmetricCipher::Stream, SymmetricCipher::Decrypt);
+    if (content.size() != blob.size
+        || !cipher.init(m_spillKey, Endian::sizedIntToBytes<qint64>(blob.spillOffset, QSysInfo::LittleEndian))
+        || !cipher.processInPlace(content)) {
+        return false;
+    }
+
+    data = content;
+    return true;
+}
@@ -0,0 +1,86 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_ATTACHMENTPOOL_H
+#define KEEPASSX_ATTACHMENTPOOL_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QScopedPointer>
+
+class QTemporaryFile;
+
+/**
+ * Content addressed store for entry attachments.
+ *
+ * Every distinct attachment is kept once, identified by the SHA-256 hash of
+ * its content, and reference counted by the entries and history items that
+ * use it. Attachments are shared across all databases of the process since
+ * history items and clones are not always part of a database.
+ *
+ * Large attachments can be spilled to an encrypted temporary file in the
+ * cache directory, they are then only read back when their data is requested.
+ */
+class AttachmentPool
+{
+public:
+    ~AttachmentPool();
+    static AttachmentPool* instance();
+
+    QByteArray add(const QByteArray& data);
+    QByteArray addSpilled(const QByteArray& data);
+    void retain(const QByteArray& id);
+    void release(const QByteArray& id);
+
+    QByteArray data(const QByteArray& id, bool* ok = nullptr) const;
+    int dataSize(const QByteArray& id) const;
+    bool isSpilled(const QByteArray& id) const;
+    int count() const;
+    qint64 totalSize() const;
+    qint64 spilledSize() const;
+
+private:
+    AttachmentPool();
+
+    struct Blob
+    {
+        QByteArray data;
+        int refCount = 0;
+        int size = 0;
+        qint64 spillOffset = -1; // -1 if the data is kept in memory
+    };
+
+    QByteArray insert(const QByteArray& data, bool spillData);
+    bool spill(Blob& blob);
+    bool readSpilled(const Blob& blob, QByteArray& data) const;
+
+    mutable QMutex m_mutex;
+    QHash<QByteArray, Blob> m_blobs;
+    // avoids rehashing data that is shared with a pooled blob already
+    QHash<const char*, QByteArray> m_ids;
+    qint64 m_totalSize;
+    qint64 m_spilledSize;
+    QScopedPointer<QTemporaryFile> m_spillFile;
+    QByteArray m_spillKey;
+    // offset of the next blob, offsets are the nonces and never reused under one key
+    qint64 m_spillOffset;
+
+    Q_DISABLE_COPY(AttachmentPool)
+};
+
+#endif // KEEPASSX_ATTACHMENTPOOL_H
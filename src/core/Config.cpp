@@ -126,9 +126,17 @@ void Config::init(const QString& fileName)
     m_defaults.insert("OpenPreviousDatabasesOnStartup", true);
     m_defaults.insert("AutoSaveAfterEveryChange", true);
     m_defaults.insert("AutoReloadOnChange", true);
+    m_defaults.insert("UseThreeWayMerge", true);
+    m_defaults.insert("UseReferenceIndex", true);
     m_defaults.insert("AutoSaveOnExit", false);
+    m_defaults.insert("AutoSaveDelay", 1000);
+    m_defaults.insert("AutoSaveMaxPerMinute", 12);
     m_defaults.insert("BackupBeforeSave", false);
     m_defaults.insert("UseAtomicSaves", true);
+    m_defaults.insert("UseBackgroundSaves", false);
+    m_defaults.insert("UsePipelinedReader", false);
+    m_defaults.insert("UsePipelinedWriter", false);
+    m_defaults.insert("LazyLoadAttachments", false);
     m_defaults.insert("SearchLimitGroup", false);
     m_defaults.insert("MinimizeOnCopy", false);
     m_defaults.insert("UseGroupIconOnEntryCreation", false);
@@ -23,12 +23,19 @@
 #include <QSaveFile>
 #include <QTemporaryFile>
 #include <QTextStream>
+#include <QThread>
 #include <QTimer>
 #include <QXmlStreamReader>
+#include <QtConcurrent>
 
 #include "cli/Utils.h"
+#include "core/Config.h"
+#include "core/EntrySearchIndex.h"
 #include "core/Group.h"
 #include "core/Metadata.h"
+#include "crypto/CryptoHash.h"
+#include "crypto/MemoryCipher.h"
+#include "crypto/Random.h"
 #include "crypto/kdf/AesKdf.h"
 #include "format/KeePass2.h"
 #include "format/KeePass2Reader.h"
@@ -38,6 +45,35 @@
 
 QHash<QUuid, Database*> Database::m_uuidMap;
 
+namespace
+{
+    /**
+     * Restore the state of a cloned tree that cloning doesn't preserve:
+     * the location changed times and the last top visible entries.
+     */
+    void copyTreeState(const Group* source, Group* target, Database* targetDb)
+    {
+        if (source->lastTopVisibleEntry()) {
+            target->setLastTopVisibleEntry(targetDb->resolveEntry(source->lastTopVisibleEntry()->uuid()));
+        }
+        target->setTimeInfo(source->timeInfo());
+
+        const QList<Entry*> sourceEntries = source->entries();
+        const QList<Entry*> targetEntries = target->entries();
+        Q_ASSERT(sourceEntries.size() == targetEntries.size());
+        for (int i = 0; i < sourceEntries.size(); ++i) {
+            targetEntries[i]->setTimeInfo(sourceEntries[i]->timeInfo());
+        }
+
+        const QList<Group*> sourceChildren = source->children();
+        const QList<Group*> targetChildren = target->children();
+        Q_ASSERT(sourceChildren.size() == targetChildren.size());
+        for (int i = 0; i < sourceChildren.size(); ++i) {
+            copyTreeState(sourceChildren[i], targetChildren[i], targetDb);
+        }
+    }
+} // namespace
+
 Database::Database()
     : m_metadata(new Metadata(this))
     , m_timer(new QTimer(this))
@@ -62,12 +98,23 @@ Database::Database()
     connect(m_metadata, SIGNAL(modified()), this, SIGNAL(modifiedImmediate()));
     connect(m_metadata, SIGNAL(nameTextChanged()), this, SIGNAL(nameTextChanged()));
     connect(this, SIGNAL(modifiedImmediate()), this, SLOT(startModifiedTimer()));
+    connect(this, SIGNAL(modifiedImmediate()), this, SLOT(invalidateReferenceIndex()));
+    connect(this, SIGNAL(modifiedImmediate()), this, SLOT(increaseModificationCounter()));
     connect(m_timer, SIGNAL(timeout()), SIGNAL(modified()));
+    connect(&m_saveWatcher, SIGNAL(finished()), SLOT(backgroundSaveFinished()));
+    connect(&m_mergeBaseWatcher, SIGNAL(finished()), SLOT(mergeBaseFinished()));
 }
 
 Database::~Database()
 {
+    // the snapshots of a running save and merge base build are owned by this database
+    m_saveWatcher.waitForFinished();
+    m_mergeBaseWatcher.waitForFinished();
+
     m_uuidMap.remove(m_uuid);
+
+    // the cache is shared by all databases, it may hold values of this one
+    MemoryCipher::clearCache();
 }
 
 Group* Database::rootGroup()
@@ -84,6 +131,13 @@ void Database::setRootGroup(Group* group)
 {
     Q_ASSERT(group);
 
+    // lookup tables only cover the tree below the current root group
+    m_entryIndex.clear();
+    m_groupIndex.clear();
+    m_referenceIndex.clear();
+    m_searchIndex.reset();
+    ++m_modificationCounter;
+
     m_rootGroup = group;
     m_rootGroup->setParent(this);
 }
@@ -100,112 +154,245 @@ const Metadata* Database::metadata() const
 
 Entry* Database::resolveEntry(const QUuid& uuid)
 {
-    return findEntryRecursive(uuid, m_rootGroup);
+    return m_entryIndex.value(uuid, nullptr);
 }
 
 Entry* Database::resolveEntry(const QString& text, EntryReferenceType referenceType)
 {
-    return findEntryRecursive(text, referenceType, m_rootGroup);
+    Q_ASSERT_X(referenceType != EntryReferenceType::Unknown,
+               "Database::resolveEntry",
+               "Can't search entry with \"referenceType\" parameter equal to \"Unknown\"");
+
+    switch (referenceType) {
+    case EntryReferenceType::Unknown:
+        return nullptr;
+    case EntryReferenceType::QUuid:
+        return resolveEntry(QUuid::fromRfc4122(QByteArray::fromHex(text.toLatin1())));
+    default:
+        break;
+    }
+
+    if (!m_referenceIndexEnabled) {
+        return findReferencedEntry(text, referenceType);
+    }
+    return referenceIndex(referenceType).value(referenceKey(text, referenceType), nullptr);
+}
+
+bool Database::isReferenceIndexEnabled() const
+{
+    return m_referenceIndexEnabled;
 }
 
-Entry* Database::findEntryRecursive(const QUuid& uuid, Group* group)
+/**
+ * Toggle the lookup tables used to resolve {REF:...} placeholders. Without
+ * them every reference is resolved by going through all entries, which is
+ * slow for databases with many references but keeps no extra data in memory.
+ */
+void Database::setReferenceIndexEnabled(bool enabled)
 {
-    const QList<Entry*> entryList = group->entries();
+    m_referenceIndexEnabled = enabled;
+    m_referenceIndex.clear();
+}
+
+/**
+ * Return the lookup table used to resolve {REF:...} placeholders for the given field.
+ *
+ * The table maps a field value to the first entry (in tree order) having that value.
+ * Each table is only built once a reference to its field is resolved, so the tables for
+ * passwords and custom attributes, which decrypt every protected value, are only built
+ * for databases actually using such references. Any modification of the database
+ * throws all tables away, so they are only rebuilt when references are resolved again.
+ */
+const QHash<QString, Entry*>& Database::referenceIndex(EntryReferenceType referenceType)
+{
+    const int key = static_cast<int>(referenceType);
+    auto it = m_referenceIndex.find(key);
+    if (it != m_referenceIndex.end()) {
+        return it.value();
+    }
+
+    QHash<QString, Entry*> index;
+    const QList<Entry*> entryList = m_rootGroup->entriesRecursive(false);
     for (Entry* entry : entryList) {
-        if (entry->uuid() == uuid) {
-            return entry;
+        const QStringList values = referenceValues(entry, referenceType);
+        for (const QString& value : values) {
+            const QString valueKey = referenceKey(value, referenceType);
+            if (!index.contains(valueKey)) {
+                index.insert(valueKey, entry);
+            }
         }
     }
 
-    const QList<Group*> children = group->children();
-    for (Group* child : children) {
-        Entry* result = findEntryRecursive(uuid, child);
-        if (result) {
-            return result;
+    return m_referenceIndex.insert(key, index).value();
+}
+
+/**
+ * Resolve a reference without a lookup table, returns the first entry in tree order.
+ */
+Entry* Database::findReferencedEntry(const QString& text, EntryReferenceType referenceType) const
+{
+    const QList<Entry*> entryList = m_rootGroup->entriesRecursive(false);
+    for (Entry* entry : entryList) {
+        if (referenceValues(entry, referenceType).contains(text)) {
+            return entry;
         }
     }
 
     return nullptr;
 }
 
-Entry* Database::findEntryRecursive(const QString& text, EntryReferenceType referenceType, Group* group)
+/**
+ * Values of an entry a reference of the given type can match. Protected values
+ * are decrypted without going through the cache of decrypted values.
+ */
+QStringList Database::referenceValues(const Entry* entry, EntryReferenceType referenceType)
 {
-    Q_ASSERT_X(referenceType != EntryReferenceType::Unknown,
-               "Database::findEntryRecursive",
-               "Can't search entry with \"referenceType\" parameter equal to \"Unknown\"");
-
-    bool found = false;
-    const QList<Entry*> entryList = group->entries();
-    for (Entry* entry : entryList) {
-        switch (referenceType) {
-        case EntryReferenceType::Unknown:
-            return nullptr;
-        case EntryReferenceType::Title:
-            found = entry->title() == text;
-            break;
-        case EntryReferenceType::UserName:
-            found = entry->username() == text;
-            break;
-        case EntryReferenceType::Password:
-            found = entry->password() == text;
-            break;
-        case EntryReferenceType::Url:
-            found = entry->url() == text;
-            break;
-        case EntryReferenceType::Notes:
-            found = entry->notes() == text;
-            break;
-        case EntryReferenceType::QUuid:
-            found = entry->uuid() == QUuid::fromRfc4122(QByteArray::fromHex(text.toLatin1()));
-            break;
-        case EntryReferenceType::CustomAttributes:
-            found = entry->attributes()->containsValue(text);
-            break;
+    const EntryAttributes* attributes = entry->attributes();
+    switch (referenceType) {
+    case EntryReferenceType::Title:
+        return QStringList(attributes->uncachedValue(EntryAttributes::TitleKey));
+    case EntryReferenceType::UserName:
+        return QStringList(attributes->uncachedValue(EntryAttributes::UserNameKey));
+    case EntryReferenceType::Password:
+        return QStringList(attributes->uncachedValue(EntryAttributes::PasswordKey));
+    case EntryReferenceType::Url:
+        return QStringList(attributes->uncachedValue(EntryAttributes::URLKey));
+    case EntryReferenceType::Notes:
+        return QStringList(attributes->uncachedValue(EntryAttributes::NotesKey));
+    case EntryReferenceType::CustomAttributes: {
+        QStringList values;
+        const QList<QString> keys = attributes->keys();
+        for (const QString& attributeKey : keys) {
+            values.append(attributes->uncachedValue(attributeKey));
         }
+        return values;
+    }
+    default:
+        return QStringList();
+    }
+}
 
-        if (found) {
-            return entry;
-        }
+/**
+ * Key of a value in the lookup tables. Passwords and custom attributes, which
+ * may be protected, are only kept as a digest so the tables hold no plain text.
+ * The digest is keyed with a random key of this database, so it can't be
+ * matched against precomputed digests of common passwords.
+ */
+QString Database::referenceKey(const QString& value, EntryReferenceType referenceType)
+{
+    if (referenceType != EntryReferenceType::Password && referenceType != EntryReferenceType::CustomAttributes) {
+        return value;
+    }
+    if (m_referenceKey.isEmpty()) {
+        m_referenceKey = randomGen()->randomArray(32);
     }
+    return QString::fromLatin1(CryptoHash::hmac(value.toUtf8(), m_referenceKey, CryptoHash::Sha256).toBase64());
+}
+
+void Database::invalidateReferenceIndex()
+{
+    m_referenceIndex.clear();
+}
 
-    const QList<Group*> children = group->children();
-    for (Group* child : children) {
-        Entry* result = findEntryRecursive(text, referenceType, child);
-        if (result) {
-            return result;
+/**
+ * Number of modifications of the database so far. Values derived from the
+ * content of the database, like resolved placeholders, can be cached
+ * as long as the counter doesn't change.
+ */
+quint64 Database::modificationCounter() const
+{
+    return m_modificationCounter;
+}
+
+void Database::increaseModificationCounter()
+{
+    ++m_modificationCounter;
+}
+
+Group* Database::resolveGroup(const QUuid& uuid)
+{
+    return m_groupIndex.value(uuid, nullptr);
+}
+
+/**
+ * Returns the search index of this database, it is built on first use.
+ * The index is not thread-safe, only use it on the thread of the database.
+ */
+EntrySearchIndex* Database::searchIndex() const
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+
+    if (!m_searchIndex) {
+        m_searchIndex.reset(new EntrySearchIndex());
+        // the index follows entry signals, they are only delivered on the thread it belongs to
+        m_searchIndex->moveToThread(thread());
+        const QList<Entry*> entryList = m_rootGroup->entriesRecursive(false);
+        for (Entry* entry : entryList) {
+            m_searchIndex->addEntry(entry);
         }
     }
 
-    return nullptr;
+    return m_searchIndex.data();
 }
 
-Group* Database::resolveGroup(const QUuid& uuid)
+/**
+ * Add an entry to the uuid and search indexes.
+ * Called by Group and Entry whenever an entry becomes part of this database
+ * or changes its uuid while being part of it.
+ */
+void Database::registerEntry(Entry* entry)
 {
-    return findGroupRecursive(uuid, m_rootGroup);
+    if (!entry->uuid().isNull()) {
+        m_entryIndex.insert(entry->uuid(), entry);
+    }
+
+    if (m_searchIndex) {
+        m_searchIndex->addEntry(entry);
+    }
 }
 
-Group* Database::findGroupRecursive(const QUuid& uuid, Group* group)
+/**
+ * Remove an entry from the uuid and search indexes.
+ * The uuid index is only updated if it still maps the uuid to this very entry,
+ * an entry with the same uuid might have replaced it already (e.g. on merge).
+ */
+void Database::unregisterEntry(Entry* entry)
 {
-    if (group->uuid() == uuid) {
-        return group;
+    auto it = m_entryIndex.find(entry->uuid());
+    if (it != m_entryIndex.end() && it.value() == entry) {
+        m_entryIndex.erase(it);
     }
 
-    const QList<Group*> children = group->children();
-    for (Group* child : children) {
-        Group* result = findGroupRecursive(uuid, child);
-        if (result) {
-            return result;
-        }
+    if (m_searchIndex) {
+        m_searchIndex->removeEntry(entry);
+    }
+}
+
+void Database::registerGroup(Group* group)
+{
+    if (!group->uuid().isNull()) {
+        m_groupIndex.insert(group->uuid(), group);
     }
+}
 
-    return nullptr;
+void Database::unregisterGroup(Group* group)
+{
+    auto it = m_groupIndex.find(group->uuid());
+    if (it != m_groupIndex.end() && it.value() == group) {
+        m_groupIndex.erase(it);
+    }
 }
 
-QList<DeletedObject> Database::deletedObjects()
+QList<DeletedObject> Database::deletedObjects() const
 {
     return m_deletedObjects;
 }
 
+void Database::setDeletedObjects(const QList<DeletedObject>& delObjs)
+{
+    m_deletedObjects = delObjs;
+}
+
 void Database::addDeletedObject(const DeletedObject& delObj)
 {
     Q_ASSERT(delObj.deletionTime.timeSpec() == Qt::UTC);
@@ -296,6 +483,27 @@ bool Database::setKey(const CompositeKey& key, bool updateChangedTime, bool upda
     return true;
 }
 
+/**
+ * Set the key together with its already transformed master key, e.g. to
+ * skip the key derivation if the key and KDF parameters are known to be unchanged.
+ *
+ * @param key composite key
+ * @param transformedMasterKey result of transforming key with the current KDF
+ */
+void Database::setTransformedKey(const CompositeKey& key, const QByteArray& transformedMasterKey)
+{
+    Q_ASSERT(!transformedMasterKey.isEmpty());
+
+    QByteArray oldTransformedMasterKey = m_data.transformedMasterKey;
+    m_data.key = key;
+    m_data.transformedMasterKey = transformedMasterKey;
+    m_data.hasKey = true;
+
+    if (oldTransformedMasterKey != m_data.transformedMasterKey) {
+        emit modifiedImmediate();
+    }
+}
+
 bool Database::hasKey() const
 {
     return m_data.hasKey;
@@ -384,9 +592,15 @@ void Database::emptyRecycleBin()
     }
 }
 
-void Database::merge(const Database* other)
+/**
+ * Merge other into this database. If base is given, it is the common
+ * ancestor of both databases and the merge is three-way.
+ */
+Merger::ChangeList Database::merge(const Database* other, const MergeBase* base)
 {
-    m_rootGroup->merge(other->rootGroup());
+    Merger merger(other, this);
+    merger.setBase(base);
+    const Merger::ChangeList changes = merger.merge();
 
     for (const QUuid& customIconId : other->metadata()->customIcons().keys()) {
         QImage customIcon = other->metadata()->customIcon(customIconId);
@@ -397,6 +611,62 @@ void Database::merge(const Database* other)
     }
 
     emit modified();
+
+    return changes;
+}
+
+/**
+ * Returns the state of the database when it was last read from or written
+ * to its file, or nullptr if the merge base is not enabled. Waits for the
+ * initial merge base if it is still being built.
+ */
+const MergeBase* Database::mergeBase()
+{
+    mergeBaseFinished();
+    return m_mergeBase.data();
+}
+
+/**
+ * Keep a merge base to merge changes of the database file three-way. The
+ * base is taken from the current state and updated whenever the database
+ * is saved.
+ *
+ * Hashing every field takes a while for large databases, so the initial
+ * base is built from a snapshot on the thread pool.
+ */
+void Database::setMergeBaseEnabled(bool enabled)
+{
+    m_mergeBaseEnabled = enabled;
+    if (!enabled) {
+        // the result of a running build is dropped once it has finished
+        m_mergeBase.reset();
+        return;
+    }
+    if (m_mergeBase || m_mergeBaseSnapshot) {
+        return;
+    }
+
+    m_mergeBaseSnapshot.reset(createSnapshot());
+    const Database* snapshot = m_mergeBaseSnapshot.data();
+    m_mergeBaseWatcher.setFuture(
+        QtConcurrent::run([snapshot]() { return QSharedPointer<MergeBase>(new MergeBase(snapshot)); }));
+}
+
+/**
+ * Install the initial merge base, unless the database has been saved and
+ * got a newer one meanwhile. Blocks until the build has finished.
+ */
+void Database::mergeBaseFinished()
+{
+    if (!m_mergeBaseSnapshot) {
+        return;
+    }
+
+    m_mergeBaseWatcher.waitForFinished();
+    if (m_mergeBaseEnabled && !m_mergeBase) {
+        m_mergeBase = m_mergeBaseWatcher.result();
+    }
+    m_mergeBaseSnapshot.reset();
 }
 
 void Database::setEmitModified(bool value)
@@ -504,13 +774,186 @@ Database* Database::unlockFromStdin(QString databaseFilename, QString keyFilenam
  * @return error string, if any
  */
 QString Database::saveToFile(QString filePath, bool atomic, bool backup)
+{
+    // never write the same file from two threads
+    m_saveQueued = false;
+    m_saveWatcher.waitForFinished();
+
+    const QString error = writeToFile(filePath, atomic, backup, config()->get("UsePipelinedWriter").toBool());
+    if (error.isEmpty()) {
+        // the merge base of the background save that was waited for is older than this one
+        ++m_saveSequence;
+        if (m_mergeBaseEnabled) {
+            mergeBaseFinished();
+            // only the items modified since the last save are hashed again
+            m_mergeBase.reset(new MergeBase(this, m_mergeBase.data()));
+        }
+    }
+    return error;
+}
+
+/**
+ * Save the database to a file without blocking the calling thread.
+ *
+ * A snapshot of the database is written on a worker thread, so the database
+ * can be modified while it is being saved. saveFinished() is emitted once the
+ * file has been written. If a save is already running, the database is saved
+ * again after it has finished.
+ *
+ * Databases that need to be changed by the writer itself (challenge-response
+ * keys, implicit upgrade to KDBX 4) can't be saved in the background.
+ *
+ * @param filePath Absolute path of the file to save
+ * @param atomic Use atomic file transactions
+ * @param backup Backup the existing database file, if exists
+ * @return true if the save has been started or queued
+ */
+bool Database::saveToFileInBackground(QString filePath, bool atomic, bool backup)
+{
+    if (!m_data.challengeResponseKey.isEmpty()) {
+        return false;
+    }
+    if (m_data.kdf->uuid() == KeePass2::KDF_AES_KDBX3 && KeePass2Writer().implicitUpgradeNeeded(this)) {
+        return false;
+    }
+
+    m_queuedSave.filePath = filePath;
+    m_queuedSave.atomic = atomic;
+    m_queuedSave.backup = backup;
+    m_saveQueued = true;
+
+    if (!isSaving()) {
+        startBackgroundSave();
+    }
+
+    return true;
+}
+
+bool Database::isSaving() const
+{
+    return m_saveWatcher.isRunning();
+}
+
+void Database::startBackgroundSave()
+{
+    Q_ASSERT(m_saveQueued);
+    Q_ASSERT(!isSaving());
+
+    m_saveQueued = false;
+    m_runningSave = m_queuedSave;
+    m_runningSave.modificationCounter = m_modificationCounter;
+    m_runningSave.saveSequence = m_saveSequence;
+    m_runningSave.kdf = m_data.kdf;
+    m_runningSave.transformedMasterKey = m_data.transformedMasterKey;
+    m_saveSnapshot.reset(createSnapshot());
+
+    // the config must not be accessed from the worker thread
+    const bool pipelined = config()->get("UsePipelinedWriter").toBool();
+    Database* snapshot = m_saveSnapshot.data();
+    const SaveRequest request = m_runningSave;
+    const bool buildMergeBase = m_mergeBaseEnabled;
+
+    m_saveWatcher.setFuture(QtConcurrent::run([snapshot, request, pipelined, buildMergeBase]() {
+        SaveResult result;
+        result.error = snapshot->writeToFile(request.filePath, request.atomic, request.backup, pipelined);
+        if (result.error.isEmpty() && buildMergeBase) {
+            result.mergeBase.reset(new MergeBase(snapshot));
+        }
+        return result;
+    }));
+}
+
+void Database::backgroundSaveFinished()
+{
+    const SaveResult result = m_saveWatcher.result();
+    const QString error = result.error;
+    const SaveRequest finishedSave = m_runningSave;
+
+    // The writer derives the key with a new KDF seed on the snapshot. Take
+    // it over unless the key has been changed meanwhile, so this database
+    // matches the file again, e.g. for the key cache of a later reload.
+    if (error.isEmpty() && m_data.kdf == finishedSave.kdf
+        && m_data.transformedMasterKey == finishedSave.transformedMasterKey) {
+        m_data.kdf = m_saveSnapshot->m_data.kdf;
+        m_data.transformedMasterKey = m_saveSnapshot->m_data.transformedMasterKey;
+    }
+    m_runningSave.kdf.reset();
+    m_runningSave.transformedMasterKey.clear();
+
+    // a synchronous save after this one was started has installed a newer base
+    if (result.mergeBase && m_mergeBaseEnabled && finishedSave.saveSequence == m_saveSequence) {
+        m_mergeBase = result.mergeBase;
+    }
+    m_saveSnapshot.reset();
+
+    // start the next save first so receivers see that one is still pending
+    if (m_saveQueued) {
+        startBackgroundSave();
+    }
+
+    emit saveFinished(finishedSave.filePath, error, finishedSave.modificationCounter);
+}
+
+/**
+ * Create a detached copy of the database that can be written on another
+ * thread while this database is being modified.
+ *
+ * Attribute and attachment values are implicitly shared with this database,
+ * so only the object tree itself is copied.
+ */
+Database* Database::createSnapshot() const
+{
+    auto* snapshot = new Database();
+    snapshot->m_data = m_data;
+    // the writer randomizes the KDF seed
+    snapshot->m_data.kdf = m_data.kdf->clone();
+    snapshot->m_deletedObjects = m_deletedObjects;
+
+    Group* defaultRoot = snapshot->rootGroup();
+    snapshot->setRootGroup(m_rootGroup->clone(Entry::CloneIncludeHistory, Group::CloneIncludeEntries));
+    delete defaultRoot;
+    copyTreeState(m_rootGroup, snapshot->rootGroup(), snapshot);
+
+    auto snapshotGroup = [snapshot](const Group* group) -> Group* {
+        return group ? snapshot->resolveGroup(group->uuid()) : nullptr;
+    };
+
+    Metadata* metadata = snapshot->metadata();
+    metadata->setUpdateDatetime(false);
+    metadata->copyAttributesFrom(m_metadata);
+    for (const QUuid& uuid : m_metadata->customIconsOrder()) {
+        metadata->addCustomIcon(uuid, m_metadata->customIcon(uuid));
+    }
+    metadata->customData()->copyDataFrom(m_metadata->customData());
+    metadata->setRecycleBin(snapshotGroup(m_metadata->recycleBin()));
+    metadata->setRecycleBinChanged(m_metadata->recycleBinChanged());
+    metadata->setEntryTemplatesGroup(snapshotGroup(m_metadata->entryTemplatesGroup()));
+    metadata->setEntryTemplatesGroupChanged(m_metadata->entryTemplatesGroupChanged());
+    metadata->setLastSelectedGroup(snapshotGroup(m_metadata->lastSelectedGroup()));
+    metadata->setLastTopVisibleGroup(snapshotGroup(m_metadata->lastTopVisibleGroup()));
+    metadata->setMasterKeyChanged(m_metadata->masterKeyChanged());
+    metadata->setSettingsChanged(m_metadata->settingsChanged());
+
+    return snapshot;
+}
+
+/**
+ * Save the database to a file on the calling thread.
+ *
+ * @param filePath Absolute path of the file to save
+ * @param atomic Use atomic file transactions
+ * @param backup Backup the existing database file, if exists
+ * @param pipelined Use the pipelined KDBX writer
+ * @return error string, if any
+ */
+QString Database::writeToFile(QString filePath, bool atomic, bool backup, bool pipelined)
 {
     QString error;
     if (atomic) {
         QSaveFile saveFile(filePath);
         if (saveFile.open(QIODevice::WriteOnly)) {
             // write the database to the file
-            error = writeDatabase(&saveFile);
+            error = writeDatabase(&saveFile, pipelined);
             if (!error.isEmpty()) {
                 return error;
             }
@@ -529,7 +972,7 @@ QString Database::saveToFile(QString filePath, bool atomic, bool backup)
         QTemporaryFile tempFile;
         if (tempFile.open()) {
             // write the database to the file
-            error = writeDatabase(&tempFile);
+            error = writeDatabase(&tempFile, pipelined);
             if (!error.isEmpty()) {
                 return error;
             }
@@ -562,9 +1005,10 @@ QString Database::saveToFile(QString filePath, bool atomic, bool backup)
     return error;
 }
 
-QString Database::writeDatabase(QIODevice* device)
+QString Database::writeDatabase(QIODevice* device, bool pipelined)
 {
     KeePass2Writer writer;
+    writer.setPipelined(pipelined);
     setEmitModified(false);
     writer.writeDatabase(device, this);
     setEmitModified(true);
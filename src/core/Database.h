@@ -20,13 +20,17 @@
 #define KEEPASSX_DATABASE_H
 
 #include <QDateTime>
+#include <QFutureWatcher>
 #include <QHash>
 #include <QObject>
+#include <QScopedPointer>
 
+#include "core/Merger.h"
 #include "crypto/kdf/Kdf.h"
 #include "keys/CompositeKey.h"
 
 class Entry;
+class EntrySearchIndex;
 enum class EntryReferenceType;
 class Group;
 class Metadata;
@@ -84,8 +88,13 @@ public:
     const Metadata* metadata() const;
     Entry* resolveEntry(const QUuid& uuid);
     Entry* resolveEntry(const QString& text, EntryReferenceType referenceType);
+    bool isReferenceIndexEnabled() const;
+    void setReferenceIndexEnabled(bool enabled);
     Group* resolveGroup(const QUuid& uuid);
-    QList<DeletedObject> deletedObjects();
+    EntrySearchIndex* searchIndex() const;
+    quint64 modificationCounter() const;
+    QList<DeletedObject> deletedObjects() const;
+    void setDeletedObjects(const QList<DeletedObject>& delObjs);
     void addDeletedObject(const DeletedObject& delObj);
     void addDeletedObject(const QUuid& uuid);
 
@@ -101,6 +110,7 @@ public:
     void setCompressionAlgo(Database::CompressionAlgorithm algo);
     void setKdf(QSharedPointer<Kdf> kdf);
     bool setKey(const CompositeKey& key, bool updateChangedTime = true, bool updateTransformSalt = false);
+    void setTransformedKey(const CompositeKey& key, const QByteArray& transformedMasterKey);
     bool hasKey() const;
     bool verifyKey(const CompositeKey& key) const;
     QVariantMap& publicCustomData();
@@ -110,8 +120,12 @@ public:
     void recycleGroup(Group* group);
     void emptyRecycleBin();
     void setEmitModified(bool value);
-    void merge(const Database* other);
+    Merger::ChangeList merge(const Database* other, const MergeBase* base = nullptr);
+    const MergeBase* mergeBase();
+    void setMergeBaseEnabled(bool enabled);
     QString saveToFile(QString filePath, bool atomic = true, bool backup = false);
+    bool saveToFileInBackground(QString filePath, bool atomic = true, bool backup = false);
+    bool isSaving() const;
 
     /**
      * Returns a unique id that is only valid as long as the Database exists.
@@ -134,17 +148,51 @@ signals:
     void nameTextChanged();
     void modified();
     void modifiedImmediate();
+    void saveFinished(const QString& filePath, const QString& errorMessage, quint64 modificationCounter);
 
 private slots:
     void startModifiedTimer();
+    void invalidateReferenceIndex();
+    void increaseModificationCounter();
+    void backgroundSaveFinished();
+    void mergeBaseFinished();
 
 private:
-    Entry* findEntryRecursive(const QUuid& uuid, Group* group);
-    Entry* findEntryRecursive(const QString& text, EntryReferenceType referenceType, Group* group);
-    Group* findGroupRecursive(const QUuid& uuid, Group* group);
+    const QHash<QString, Entry*>& referenceIndex(EntryReferenceType referenceType);
+    Entry* findReferencedEntry(const QString& text, EntryReferenceType referenceType) const;
+    static QStringList referenceValues(const Entry* entry, EntryReferenceType referenceType);
+    QString referenceKey(const QString& value, EntryReferenceType referenceType);
+
+    void registerEntry(Entry* entry);
+    void unregisterEntry(Entry* entry);
+    void registerGroup(Group* group);
+    void unregisterGroup(Group* group);
+
+    struct SaveRequest
+    {
+        QString filePath;
+        bool atomic;
+        bool backup;
+        quint64 modificationCounter;
+        // number of synchronous saves before this one was started
+        quint64 saveSequence;
+        // key state of this database when the save was started
+        QSharedPointer<Kdf> kdf;
+        QByteArray transformedMasterKey;
+    };
+
+    struct SaveResult
+    {
+        QString error;
+        // merge base of the written state, built on the worker thread
+        QSharedPointer<MergeBase> mergeBase;
+    };
 
     void createRecycleBin();
-    QString writeDatabase(QIODevice* device);
+    Database* createSnapshot() const;
+    void startBackgroundSave();
+    QString writeToFile(QString filePath, bool atomic, bool backup, bool pipelined);
+    QString writeDatabase(QIODevice* device, bool pipelined);
     bool backupDatabase(QString filePath);
 
     Metadata* const m_metadata;
@@ -154,8 +202,34 @@ private:
     DatabaseData m_data;
     bool m_emitModified;
 
+    QHash<QUuid, Entry*> m_entryIndex;
+    QHash<QUuid, Group*> m_groupIndex;
+    QHash<int, QHash<QString, Entry*>> m_referenceIndex;
+    bool m_referenceIndexEnabled = true;
+    // random key of the value digests in the reference index
+    QByteArray m_referenceKey;
+    mutable QScopedPointer<EntrySearchIndex> m_searchIndex;
+    quint64 m_modificationCounter = 0;
+
+    QFutureWatcher<SaveResult> m_saveWatcher;
+    QScopedPointer<Database> m_saveSnapshot;
+    SaveRequest m_runningSave;
+    SaveRequest m_queuedSave;
+    bool m_saveQueued = false;
+    quint64 m_saveSequence = 0;
+
+    // state of the database when it was last read or written
+    QSharedPointer<MergeBase> m_mergeBase;
+    bool m_mergeBaseEnabled = false;
+    // the initial merge base is built on a snapshot on the thread pool
+    QFutureWatcher<QSharedPointer<MergeBase>> m_mergeBaseWatcher;
+    QScopedPointer<Database> m_mergeBaseSnapshot;
+
     QUuid m_uuid;
     static QHash<QUuid, Database*> m_uuidMap;
+
+    friend class Entry;
+    friend class Group;
 };
 
 #endif // KEEPASSX_DATABASE_H
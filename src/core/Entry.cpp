@@ -34,6 +34,13 @@ const int Entry::ResolveMaximumDepth = 10;
 const QString Entry::AutoTypeSequenceUsername = "{USERNAME}{ENTER}";
 const QString Entry::AutoTypeSequencePassword = "{PASSWORD}{ENTER}";
 
+namespace
+{
+    // placeholders resolving to values that change over time, like {TOTP}, are never cached
+    QAtomicInt volatilePlaceholderCount;
+    const int MaxCachedPlaceholders = 64;
+} // namespace
+
 Entry::Entry()
     : m_attributes(new EntryAttributes(this))
     , m_attachments(new EntryAttachments(this))
@@ -390,7 +397,17 @@ QSharedPointer<Totp::Settings> Entry::totpSettings() const
 void Entry::setUuid(const QUuid& uuid)
 {
     Q_ASSERT(!uuid.isNull());
+
+    Database* db = m_group ? m_group->database() : nullptr;
+    if (db) {
+        db->unregisterEntry(this);
+    }
+
     set(m_uuid, uuid);
+
+    if (db) {
+        db->registerEntry(this);
+    }
 }
 
 void Entry::setIcon(int iconNumber)
@@ -568,7 +585,8 @@ void Entry::truncateHistory()
     int histMaxSize = db->metadata()->historyMaxSize();
     if (histMaxSize > -1) {
         int size = 0;
-        QSet<QByteArray> foundAttachments = attachments()->values();
+        // attachments shared with the entry or a newer history item are counted once
+        QSet<QByteArray> foundAttachments = attachments()->contentIds();
 
         QMutableListIterator<Entry*> i(m_history);
         i.toBack();
@@ -580,13 +598,12 @@ void Entry::truncateHistory()
             if (size <= histMaxSize) {
                 size += historyItem->attributes()->attributesSize();
                 size += historyItem->autoTypeAssociations()->associationsSize();
-                size += historyItem->attachments()->attachmentsSize();
+                size += historyItem->attachments()->attachmentsSize(foundAttachments);
                 size += historyItem->customData()->dataSize();
                 const QStringList tags = historyItem->tags().split(delimiter, QString::SkipEmptyParts);
                 for (const QString& tag : tags) {
                     size += tag.toUtf8().size();
                 }
-                foundAttachments += historyItem->attachments()->values();
             }
 
             if (size > histMaxSize) {
@@ -697,19 +714,21 @@ void Entry::updateModifiedSinceBegin()
 
 QString Entry::resolveMultiplePlaceholdersRecursive(const QString& str, int maxDepth) const
 {
+    if (!str.contains(QLatin1Char('{'))) {
+        return str;
+    }
+
     if (maxDepth <= 0) {
         qWarning() << QString("Maximum depth of replacement has been reached. Entry uuid: %1").arg(uuid().toString());
         return str;
     }
 
     QString result = str;
-    QRegExp placeholderRegEx("(\\{[^\\}]+\\})", Qt::CaseInsensitive, QRegExp::RegExp2);
-    placeholderRegEx.setMinimal(true);
-    int pos = 0;
-    while ((pos = placeholderRegEx.indexIn(str, pos)) != -1) {
-        const QString found = placeholderRegEx.cap(1);
+    static const QRegularExpression placeholderRegEx("(\\{[^\\}]+\\})");
+    QRegularExpressionMatchIterator i = placeholderRegEx.globalMatch(str);
+    while (i.hasNext()) {
+        const QString found = i.next().captured(1);
         result.replace(found, resolvePlaceholderRecursive(found, maxDepth - 1));
-        pos += placeholderRegEx.matchedLength();
     }
 
     if (result != str) {
@@ -771,6 +790,7 @@ QString Entry::resolvePlaceholderRecursive(const QString& placeholder, int maxDe
     }
     case PlaceholderType::Totp:
         // totp can't have placeholder inside
+        volatilePlaceholderCount.ref();
         return totp();
     case PlaceholderType::CustomAttribute: {
         const QString key = placeholder.mid(3, placeholder.length() - 4); // {S:attr} => mid(3, len - 4)
@@ -877,6 +897,10 @@ void Entry::setGroup(Group* group)
     m_group = group;
     group->addEntry(this);
 
+    // cached values were resolved against the old database
+    m_resolvedPlaceholders.clear();
+    m_resolvedMultiplePlaceholders.clear();
+
     QObject::setParent(group);
 
     if (m_updateTimeinfo) {
@@ -907,12 +931,69 @@ QString Entry::maskPasswordPlaceholders(const QString& str) const
 
 QString Entry::resolveMultiplePlaceholders(const QString& str) const
 {
-    return resolveMultiplePlaceholdersRecursive(str, ResolveMaximumDepth);
+    if (!str.contains(QLatin1Char('{'))) {
+        return str;
+    }
+
+    if (!placeholderCacheValid()) {
+        return resolveMultiplePlaceholdersRecursive(str, ResolveMaximumDepth);
+    }
+
+    auto it = m_resolvedMultiplePlaceholders.constFind(str);
+    if (it != m_resolvedMultiplePlaceholders.constEnd()) {
+        return it.value();
+    }
+
+    const int volatileCount = volatilePlaceholderCount.load();
+    const QString result = resolveMultiplePlaceholdersRecursive(str, ResolveMaximumDepth);
+    if (volatileCount == volatilePlaceholderCount.load()) {
+        m_resolvedMultiplePlaceholders.insert(str, result);
+    }
+    return result;
 }
 
 QString Entry::resolvePlaceholder(const QString& placeholder) const
 {
-    return resolvePlaceholderRecursive(placeholder, ResolveMaximumDepth);
+    if (!placeholder.contains(QLatin1Char('{'))) {
+        return placeholder;
+    }
+
+    if (!placeholderCacheValid()) {
+        return resolvePlaceholderRecursive(placeholder, ResolveMaximumDepth);
+    }
+
+    auto it = m_resolvedPlaceholders.constFind(placeholder);
+    if (it != m_resolvedPlaceholders.constEnd()) {
+        return it.value();
+    }
+
+    const int volatileCount = volatilePlaceholderCount.load();
+    const QString result = resolvePlaceholderRecursive(placeholder, ResolveMaximumDepth);
+    if (volatileCount == volatilePlaceholderCount.load()) {
+        m_resolvedPlaceholders.insert(placeholder, result);
+    }
+    return result;
+}
+
+/**
+ * Drop the resolved placeholders if the database has been modified since they were cached.
+ * Entries outside of a database don't cache anything.
+ */
+bool Entry::placeholderCacheValid() const
+{
+    const Database* db = database();
+    if (!db) {
+        return false;
+    }
+
+    if (m_placeholderCacheGeneration != db->modificationCounter()
+        || m_resolvedPlaceholders.size() + m_resolvedMultiplePlaceholders.size() > MaxCachedPlaceholders) {
+        m_resolvedPlaceholders.clear();
+        m_resolvedMultiplePlaceholders.clear();
+        m_placeholderCacheGeneration = db->modificationCounter();
+    }
+
+    return true;
 }
 
 QString Entry::resolveUrlPlaceholder(const QString& str, Entry::PlaceholderType placeholderType) const
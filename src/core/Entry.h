@@ -20,6 +20,7 @@
 #define KEEPASSX_ENTRY_H
 
 #include <QColor>
+#include <QHash>
 #include <QImage>
 #include <QMap>
 #include <QPixmap>
@@ -222,6 +223,7 @@ private slots:
     void updateTotp();
 
 private:
+    bool placeholderCacheValid() const;
     QString resolveMultiplePlaceholdersRecursive(const QString& str, int maxDepth) const;
     QString resolvePlaceholderRecursive(const QString& placeholder, int maxDepth) const;
     QString resolveReferencePlaceholderRecursive(const QString& placeholder, int maxDepth) const;
@@ -244,6 +246,11 @@ private:
     bool m_modifiedSinceBegin;
     QPointer<Group> m_group;
     bool m_updateTimeinfo;
+
+    // resolved placeholders, valid for one modification counter value of the database
+    mutable QHash<QString, QString> m_resolvedPlaceholders;
+    mutable QHash<QString, QString> m_resolvedMultiplePlaceholders;
+    mutable quint64 m_placeholderCacheGeneration = 0;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(Entry::CloneFlags)
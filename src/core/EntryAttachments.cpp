@@ -20,11 +20,21 @@
 #include <QSet>
 #include <QStringList>
 
+#include "core/AttachmentPool.h"
+#include "core/Global.h"
+
 EntryAttachments::EntryAttachments(QObject* parent)
     : QObject(parent)
 {
 }
 
+EntryAttachments::~EntryAttachments()
+{
+    for (const QByteArray& id : asConst(m_attachments)) {
+        AttachmentPool::instance()->release(id);
+    }
+}
+
 QList<QString> EntryAttachments::keys() const
 {
     return m_attachments.keys();
@@ -37,15 +47,74 @@ bool EntryAttachments::hasKey(const QString& key) const
 
 QSet<QByteArray> EntryAttachments::values() const
 {
-    return m_attachments.values().toSet();
+    QSet<QByteArray> values;
+    for (const QByteArray& id : m_attachments) {
+        values.insert(AttachmentPool::instance()->data(id));
+    }
+    return values;
+}
+
+/**
+ * Content of the attachment.
+ *
+ * @param ok set to false if there is no such attachment or its content
+ *           can't be read back from the spill file
+ */
+QByteArray EntryAttachments::value(const QString& key, bool* ok) const
+{
+    auto it = m_attachments.constFind(key);
+    if (it == m_attachments.constEnd()) {
+        if (ok) {
+            *ok = false;
+        }
+        return QByteArray();
+    }
+    return AttachmentPool::instance()->data(it.value(), ok);
 }
 
-QByteArray EntryAttachments::value(const QString& key) const
+/**
+ * Id of the attachment content in the AttachmentPool, equal content has equal ids.
+ */
+QByteArray EntryAttachments::contentId(const QString& key) const
 {
     return m_attachments.value(key);
 }
 
+QSet<QByteArray> EntryAttachments::contentIds() const
+{
+    return m_attachments.values().toSet();
+}
+
 void EntryAttachments::set(const QString& key, const QByteArray& value)
+{
+    setContent(key, AttachmentPool::instance()->add(value));
+}
+
+/**
+ * Set the attachment to content that is in the AttachmentPool already.
+ */
+void EntryAttachments::setContentId(const QString& key, const QByteArray& id)
+{
+    AttachmentPool::instance()->retain(id);
+    setContent(key, id);
+}
+
+/**
+ * Size of the attachment content, the content itself is not loaded.
+ */
+int EntryAttachments::size(const QString& key) const
+{
+    auto it = m_attachments.constFind(key);
+    if (it == m_attachments.constEnd()) {
+        return 0;
+    }
+    return AttachmentPool::instance()->dataSize(it.value());
+}
+
+/**
+ * Takes over a reference to the pooled content id.
+ */
+void EntryAttachments::setContent(const QString& key, const QByteArray& id)
 {
     bool emitModified = false;
     bool addAttachment = !m_attachments.contains(key);
@@ -54,9 +123,16 @@ void EntryAttachments::set(const QString& key, const QByteArray& value)
         emit aboutToBeAdded(key);
     }
 
-    if (addAttachment || m_attachments.value(key) != value) {
-        m_attachments.insert(key, value);
+    AttachmentPool* pool = AttachmentPool::instance();
+    if (addAttachment) {
+        m_attachments.insert(key, id);
         emitModified = true;
+    } else if (m_attachments.value(key) != id) {
+        pool->release(m_attachments.value(key));
+        m_attachments.insert(key, id);
+        emitModified = true;
+    } else {
+        pool->release(id);
     }
 
     if (addAttachment) {
@@ -79,7 +155,7 @@ void EntryAttachments::remove(const QString& key)
 
     emit aboutToBeRemoved(key);
 
-    m_attachments.remove(key);
+    AttachmentPool::instance()->release(m_attachments.take(key));
 
     emit removed(key);
     emit modified();
@@ -101,7 +177,7 @@ void EntryAttachments::remove(const QStringList& keys)
 
         isModified = true;
         emit aboutToBeRemoved(key);
-        m_attachments.remove(key);
+        AttachmentPool::instance()->release(m_attachments.take(key));
         emit removed(key);
     }
 
@@ -123,6 +199,9 @@ void EntryAttachments::clear()
 
     emit aboutToBeReset();
 
+    for (const QByteArray& id : asConst(m_attachments)) {
+        AttachmentPool::instance()->release(id);
+    }
     m_attachments.clear();
 
     emit reset();
@@ -134,6 +213,13 @@ void EntryAttachments::copyDataFrom(const EntryAttachments* other)
     if (*this != *other) {
         emit aboutToBeReset();
 
+        AttachmentPool* pool = AttachmentPool::instance();
+        for (const QByteArray& id : asConst(other->m_attachments)) {
+            pool->retain(id);
+        }
+        for (const QByteArray& id : asConst(m_attachments)) {
+            pool->release(id);
+        }
         m_attachments = other->m_attachments;
 
         emit reset();
@@ -155,7 +241,24 @@ int EntryAttachments::attachmentsSize() const
 {
     int size = 0;
     for (auto it = m_attachments.constBegin(); it != m_attachments.constEnd(); ++it) {
-        size += it.key().toUtf8().size() + it.value().size();
+        size += it.key().toUtf8().size() + AttachmentPool::instance()->dataSize(it.value());
+    }
+    return size;
+}
+
+/**
+ * Size of the attachments, counting the content of ids in countedIds only
+ * for the keys. Ids of the counted content are added to countedIds.
+ */
+int EntryAttachments::attachmentsSize(QSet<QByteArray>& countedIds) const
+{
+    int size = 0;
+    for (auto it = m_attachments.constBegin(); it != m_attachments.constEnd(); ++it) {
+        size += it.key().toUtf8().size();
+        if (!countedIds.contains(it.value())) {
+            size += AttachmentPool::instance()->dataSize(it.value());
+            countedIds.insert(it.value());
+        }
     }
     return size;
 }
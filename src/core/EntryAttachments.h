@@ -29,11 +29,16 @@ class EntryAttachments : public QObject
 
 public:
     explicit EntryAttachments(QObject* parent = nullptr);
+    ~EntryAttachments();
     QList<QString> keys() const;
     bool hasKey(const QString& key) const;
     QSet<QByteArray> values() const;
-    QByteArray value(const QString& key) const;
+    QByteArray value(const QString& key, bool* ok = nullptr) const;
+    QByteArray contentId(const QString& key) const;
+    QSet<QByteArray> contentIds() const;
+    int size(const QString& key) const;
     void set(const QString& key, const QByteArray& value);
+    void setContentId(const QString& key, const QByteArray& id);
     void remove(const QString& key);
     void remove(const QStringList& keys);
     bool isEmpty() const;
@@ -42,6 +47,7 @@ public:
     bool operator==(const EntryAttachments& other) const;
     bool operator!=(const EntryAttachments& other) const;
     int attachmentsSize() const;
+    int attachmentsSize(QSet<QByteArray>& countedIds) const;
 
 signals:
     void modified();
@@ -54,6 +60,9 @@ signals:
     void reset();
 
 private:
+    void setContent(const QString& key, const QByteArray& id);
+
+    // maps each key to the id of its content in the AttachmentPool
     QMap<QString, QByteArray> m_attachments;
 };
 
@@ -18,6 +18,8 @@
 
 #include "EntryAttributes.h"
 
+#include "crypto/MemoryCipher.h"
+
 const QString EntryAttributes::TitleKey = "Title";
 const QString EntryAttributes::UserNameKey = "UserName";
 const QString EntryAttributes::PasswordKey = "Password";
@@ -62,6 +64,25 @@ QList<QString> EntryAttributes::customKeys() const
 
 QString EntryAttributes::value(const QString& key) const
 {
+    auto it = m_encryptedAttributes.constFind(key);
+    if (it != m_encryptedAttributes.constEnd()) {
+        return MemoryCipher::decrypt(it.value());
+    }
+
+    return m_attributes.value(key);
+}
+
+/**
+ * Same as value(), but a protected value is not kept in the cache of
+ * decrypted values. Use it when going through all entries of a database.
+ */
+QString EntryAttributes::uncachedValue(const QString& key) const
+{
+    auto it = m_encryptedAttributes.constFind(key);
+    if (it != m_encryptedAttributes.constEnd()) {
+        return MemoryCipher::decryptUncached(it.value());
+    }
+
     return m_attributes.value(key);
 }
 
@@ -72,7 +93,12 @@ bool EntryAttributes::contains(const QString& key) const
 
 bool EntryAttributes::containsValue(const QString& value) const
 {
-    return m_attributes.values().contains(value);
+    for (auto it = m_attributes.constBegin(); it != m_attributes.constEnd(); ++it) {
+        if (this->value(it.key()) == value) {
+            return true;
+        }
+    }
+    return false;
 }
 
 bool EntryAttributes::isProtected(const QString& key) const
@@ -96,25 +122,23 @@ void EntryAttributes::set(const QString& key, const QString& value, bool protect
     bool emitModified = false;
 
     bool addAttribute = !m_attributes.contains(key);
-    bool changeValue = !addAttribute && (m_attributes.value(key) != value);
+    bool changeValue = !addAttribute && (this->value(key) != value);
+    bool changeProtection = protect != m_protectedAttributes.contains(key);
     bool defaultAttribute = isDefaultAttribute(key);
 
     if (addAttribute && !defaultAttribute) {
         emit aboutToBeAdded(key);
     }
 
-    if (addAttribute || changeValue) {
-        m_attributes.insert(key, value);
+    if (addAttribute || changeValue || changeProtection) {
+        store(key, value, protect);
         emitModified = true;
     }
 
     if (protect) {
-        if (!m_protectedAttributes.contains(key)) {
-            emitModified = true;
-        }
         m_protectedAttributes.insert(key);
-    } else if (m_protectedAttributes.remove(key)) {
-        emitModified = true;
+    } else {
+        m_protectedAttributes.remove(key);
     }
 
     if (emitModified) {
@@ -143,6 +167,7 @@ void EntryAttributes::remove(const QString& key)
 
     m_attributes.remove(key);
     m_protectedAttributes.remove(key);
+    m_encryptedAttributes.remove(key);
 
     emit removed(key);
     emit modified();
@@ -163,17 +188,18 @@ void EntryAttributes::rename(const QString& oldKey, const QString& newKey)
         return;
     }
 
-    QString data = value(oldKey);
     bool protect = isProtected(oldKey);
 
     emit aboutToRename(oldKey, newKey);
 
-    m_attributes.remove(oldKey);
-    m_attributes.insert(newKey, data);
+    m_attributes.insert(newKey, m_attributes.take(oldKey));
     if (protect) {
         m_protectedAttributes.remove(oldKey);
         m_protectedAttributes.insert(newKey);
     }
+    if (m_encryptedAttributes.contains(oldKey)) {
+        m_encryptedAttributes.insert(newKey, m_encryptedAttributes.take(oldKey));
+    }
 
     emit modified();
     emit renamed(oldKey, newKey);
@@ -193,16 +219,21 @@ void EntryAttributes::copyCustomKeysFrom(const EntryAttributes* other)
         if (!isDefaultAttribute(key)) {
             m_attributes.remove(key);
             m_protectedAttributes.remove(key);
+            m_encryptedAttributes.remove(key);
         }
     }
 
     const QList<QString> otherKeyList = other->keys();
     for (const QString& key : otherKeyList) {
         if (!isDefaultAttribute(key)) {
-            m_attributes.insert(key, other->value(key));
+            // encrypted values are shared as they are
+            m_attributes.insert(key, other->m_attributes.value(key));
             if (other->isProtected(key)) {
                 m_protectedAttributes.insert(key);
             }
+            if (other->m_encryptedAttributes.contains(key)) {
+                m_encryptedAttributes.insert(key, other->m_encryptedAttributes.value(key));
+            }
         }
     }
 
@@ -238,6 +269,7 @@ void EntryAttributes::copyDataFrom(const EntryAttributes* other)
 
         m_attributes = other->m_attributes;
         m_protectedAttributes = other->m_protectedAttributes;
+        m_encryptedAttributes = other->m_encryptedAttributes;
 
         emit reset();
         emit modified();
@@ -246,12 +278,35 @@ void EntryAttributes::copyDataFrom(const EntryAttributes* other)
 
 bool EntryAttributes::operator==(const EntryAttributes& other) const
 {
-    return (m_attributes == other.m_attributes && m_protectedAttributes == other.m_protectedAttributes);
+    if (m_protectedAttributes != other.m_protectedAttributes) {
+        return false;
+    }
+
+    if (m_attributes == other.m_attributes && m_encryptedAttributes == other.m_encryptedAttributes) {
+        return true;
+    }
+
+    // the same value is encrypted differently each time, compare the plain text
+    if (m_attributes.keys() != other.m_attributes.keys()) {
+        return false;
+    }
+
+    for (auto it = m_attributes.constBegin(); it != m_attributes.constEnd(); ++it) {
+        const QByteArray encrypted = m_encryptedAttributes.value(it.key());
+        if (!encrypted.isEmpty() && encrypted == other.m_encryptedAttributes.value(it.key())) {
+            continue;
+        }
+        if (value(it.key()) != other.value(it.key())) {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 bool EntryAttributes::operator!=(const EntryAttributes& other) const
 {
-    return (m_attributes != other.m_attributes || m_protectedAttributes != other.m_protectedAttributes);
+    return !(*this == other);
 }
 
 QRegularExpressionMatch EntryAttributes::matchReference(const QString& text)
@@ -269,6 +324,7 @@ void EntryAttributes::clear()
 
     m_attributes.clear();
     m_protectedAttributes.clear();
+    m_encryptedAttributes.clear();
 
     for (const QString& key : DefaultAttributes) {
         m_attributes.insert(key, "");
@@ -282,7 +338,12 @@ int EntryAttributes::attributesSize() const
 {
     int size = 0;
     for (auto it = m_attributes.constBegin(); it != m_attributes.constEnd(); ++it) {
-        size += it.key().toUtf8().size() + it.value().toUtf8().size();
+        auto encrypted = m_encryptedAttributes.constFind(it.key());
+        if (encrypted != m_encryptedAttributes.constEnd()) {
+            size += it.key().toUtf8().size() + MemoryCipher::plainTextSize(encrypted.value());
+        } else {
+            size += it.key().toUtf8().size() + it.value().toUtf8().size();
+        }
     }
     return size;
 }
@@ -291,3 +352,18 @@ bool EntryAttributes::isDefaultAttribute(const QString& key)
 {
     return DefaultAttributes.contains(key);
 }
+
+void EntryAttributes::store(const QString& key, const QString& value, bool protect)
+{
+    if (protect && MemoryCipher::isEnabled()) {
+        const QByteArray encrypted = MemoryCipher::encrypt(value);
+        if (!encrypted.isEmpty()) {
+            m_attributes.insert(key, QString());
+            m_encryptedAttributes.insert(key, encrypted);
+            return;
+        }
+    }
+
+    m_attributes.insert(key, value);
+    m_encryptedAttributes.remove(key);
+}
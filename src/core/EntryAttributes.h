@@ -35,6 +35,7 @@ public:
     bool hasKey(const QString& key) const;
     QList<QString> customKeys() const;
     QString value(const QString& key) const;
+    QString uncachedValue(const QString& key) const;
     bool contains(const QString& key) const;
     bool containsValue(const QString& value) const;
     bool isProtected(const QString& key) const;
@@ -79,8 +80,12 @@ signals:
     void reset();
 
 private:
+    void store(const QString& key, const QString& value, bool protect);
+
     QMap<QString, QString> m_attributes;
     QSet<QString> m_protectedAttributes;
+    // values of protected attributes encrypted with MemoryCipher, m_attributes holds an empty placeholder
+    QMap<QString, QByteArray> m_encryptedAttributes;
 };
 
 #endif // KEEPASSX_ENTRYATTRIBUTES_H
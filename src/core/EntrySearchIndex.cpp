@@ -0,0 +1,225 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EntrySearchIndex.h"
+
+#include "core/Entry.h"
+#include "core/Global.h"
+
+namespace
+{
+    inline quint64 trigramKey(const QString& str, int pos)
+    {
+        return (static_cast<quint64>(str.at(pos).unicode()) << 32)
+               | (static_cast<quint64>(str.at(pos + 1).unicode()) << 16) | str.at(pos + 2).unicode();
+    }
+
+    QVector<quint32> intersect(const QVector<quint32>& first, const QVector<quint32>& second)
+    {
+        QVector<quint32> result;
+        auto i = first.constBegin();
+        auto j = second.constBegin();
+        while (i != first.constEnd() && j != second.constEnd()) {
+            if (*i < *j) {
+                ++i;
+            } else if (*j < *i) {
+                ++j;
+            } else {
+                result.append(*i);
+                ++i;
+                ++j;
+            }
+        }
+        return result;
+    }
+} // namespace
+
+EntrySearchIndex::EntrySearchIndex(QObject* parent)
+    : QObject(parent)
+    , m_removedCount(0)
+{
+}
+
+/**
+ * Case fold a string the same way QString::contains() does for
+ * case insensitive comparisons, i.e. per code point without changing
+ * the length of the string.
+ */
+QString EntrySearchIndex::foldCase(const QString& str)
+{
+    QString result = str;
+    QChar* data = result.data();
+    const int size = result.size();
+
+    for (int i = 0; i < size; ++i) {
+        if (data[i].isHighSurrogate() && i + 1 < size && data[i + 1].isLowSurrogate()) {
+            const uint ucs4 = QChar::toCaseFolded(QChar::surrogateToUcs4(data[i], data[i + 1]));
+            data[i] = QChar(QChar::highSurrogate(ucs4));
+            data[i + 1] = QChar(QChar::lowSurrogate(ucs4));
+            ++i;
+        } else {
+            data[i] = data[i].toCaseFolded();
+        }
+    }
+
+    return result;
+}
+
+void EntrySearchIndex::addEntry(Entry* entry)
+{
+    if (m_ids.contains(entry) || m_dirtyEntries.contains(entry)) {
+        return;
+    }
+
+    connect(entry, SIGNAL(modified()), this, SLOT(entryModified()), Qt::UniqueConnection);
+    m_dirtyEntries.insert(entry);
+}
+
+void EntrySearchIndex::removeEntry(Entry* entry)
+{
+    disconnect(entry, nullptr, this, nullptr);
+    invalidateEntry(entry);
+    m_dirtyEntries.remove(entry);
+}
+
+/**
+ * Collect the entries that may contain all of the given words.
+ *
+ * @param words the words of the search term
+ * @param result the candidate entries, only valid if true is returned
+ * @return false if the words are too short to narrow down the search
+ */
+bool EntrySearchIndex::candidates(const QStringList& words, QSet<const Entry*>& result)
+{
+    flush();
+
+    bool filtered = false;
+    QVector<quint32> ids;
+    for (const QString& word : words) {
+        const QString folded = foldCase(word);
+        for (int i = 0; i + 2 < folded.size(); ++i) {
+            const QVector<quint32> postings = m_postings.value(trigramKey(folded, i));
+            ids = filtered ? intersect(ids, postings) : postings;
+            filtered = true;
+            if (ids.isEmpty()) {
+                break;
+            }
+        }
+
+        if (filtered && ids.isEmpty()) {
+            break;
+        }
+    }
+
+    if (!filtered) {
+        return false;
+    }
+
+    result = m_dynamicEntries;
+    for (quint32 id : asConst(ids)) {
+        const Entry* entry = m_entries.at(static_cast<int>(id));
+        if (entry) {
+            result.insert(entry);
+        }
+    }
+
+    return true;
+}
+
+void EntrySearchIndex::entryModified()
+{
+    Entry* entry = qobject_cast<Entry*>(sender());
+    if (entry && !m_dirtyEntries.contains(entry)) {
+        invalidateEntry(entry);
+        m_dirtyEntries.insert(entry);
+    }
+}
+
+void EntrySearchIndex::indexEntry(Entry* entry)
+{
+    const quint32 id = static_cast<quint32>(m_entries.size());
+    m_entries.append(entry);
+    m_ids.insert(entry, id);
+
+    const QStringList fields = {entry->title(), entry->username(), entry->url(), entry->notes()};
+
+    for (const QString& field : fields) {
+        if (field.contains(QLatin1Char('{'))) {
+            // the searchable value depends on placeholder resolution
+            m_dynamicEntries.insert(entry);
+            return;
+        }
+    }
+
+    QSet<quint64> trigrams;
+    for (const QString& field : fields) {
+        const QString folded = foldCase(field);
+        for (int i = 0; i + 2 < folded.size(); ++i) {
+            trigrams.insert(trigramKey(folded, i));
+        }
+    }
+
+    // ids are handed out in ascending order so the posting lists stay sorted
+    for (quint64 trigram : asConst(trigrams)) {
+        m_postings[trigram].append(id);
+    }
+}
+
+void EntrySearchIndex::invalidateEntry(Entry* entry)
+{
+    auto it = m_ids.find(entry);
+    if (it != m_ids.end()) {
+        m_entries[static_cast<int>(it.value())] = nullptr;
+        m_ids.erase(it);
+        ++m_removedCount;
+    }
+    m_dynamicEntries.remove(entry);
+}
+
+void EntrySearchIndex::flush()
+{
+    if (m_removedCount > 1000 && m_removedCount > m_entries.size() / 2) {
+        rebuild();
+        return;
+    }
+
+    for (Entry* entry : asConst(m_dirtyEntries)) {
+        indexEntry(entry);
+    }
+    m_dirtyEntries.clear();
+}
+
+void EntrySearchIndex::rebuild()
+{
+    QList<Entry*> entries = m_dirtyEntries.toList();
+    for (Entry* entry : asConst(m_entries)) {
+        if (entry) {
+            entries.append(entry);
+        }
+    }
+
+    m_entries.clear();
+    m_ids.clear();
+    m_postings.clear();
+    m_dynamicEntries.clear();
+    m_dirtyEntries.clear();
+    m_removedCount = 0;
+
+    for (Entry* entry : asConst(entries)) {
+        indexEntry(entry);
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSXC_ENTRYSEARCHINDEX_H
+#define KEEPASSXC_ENTRYSEARCHINDEX_H
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+class Entry;
+
+/**
+ * Trigram index over the searchable fields (title, username, url and notes)
+ * of all entries of a database.
+ *
+ * The index only narrows down the set of entries that can possibly match a
+ * search term; EntrySearcher still verifies every candidate with the regular
+ * substring match. Entries whose fields contain placeholders are always
+ * returned as candidates since their resolved values depend on other entries.
+ *
+ * Changed entries are re-indexed lazily on the next query.
+ */
+class EntrySearchIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EntrySearchIndex(QObject* parent = nullptr);
+
+    void addEntry(Entry* entry);
+    void removeEntry(Entry* entry);
+    bool candidates(const QStringList& words, QSet<const Entry*>& result);
+
+    static QString foldCase(const QString& str);
+
+private slots:
+    void entryModified();
+
+private:
+    void indexEntry(Entry* entry);
+    void invalidateEntry(Entry* entry);
+    void flush();
+    void rebuild();
+
+    QVector<Entry*> m_entries;
+    QHash<const Entry*, quint32> m_ids;
+    QHash<quint64, QVector<quint32>> m_postings;
+    QSet<const Entry*> m_dynamicEntries;
+    QSet<Entry*> m_dirtyEntries;
+    int m_removedCount;
+};
+
+#endif // KEEPASSXC_ENTRYSEARCHINDEX_H
@@ -18,34 +18,185 @@
 
 #include "EntrySearcher.h"
 
+#include <QtConcurrent>
+
+#include "core/EntrySearchIndex.h"
+#include "core/Global.h"
 #include "core/Group.h"
 
+const int EntrySearcher::ChunkSize = 1000;
+
+EntrySearcher::EntrySearcher(SearchMode mode)
+    : m_mode(mode)
+{
+}
+
 QList<Entry*> EntrySearcher::search(const QString& searchTerm, const Group* group, Qt::CaseSensitivity caseSensitivity)
 {
     if (!group->resolveSearchingEnabled()) {
         return QList<Entry*>();
     }
 
-    return searchEntries(searchTerm, group, caseSensitivity);
+    const QStringList wordList = splitSearchTerm(searchTerm);
+    loadCandidates(wordList, group);
+
+    QList<Entry*> searchResult;
+    if (m_mode == ParallelSearch) {
+        searchResult = searchEntriesParallel(wordList, group, caseSensitivity);
+    } else {
+        searchResult = searchEntries(wordList, group, caseSensitivity);
+    }
+    m_candidates.clear();
+    return searchResult;
+}
+
+/**
+ * Split a search into batches that can be matched with BatchMatcher on any thread.
+ *
+ * Placeholders are resolved here since that may touch other entries and lazily
+ * built lookup tables of the database.
+ */
+QList<EntrySearcher::Batch> EntrySearcher::prepareBatches(const QString& searchTerm,
+                                                          const Group* group,
+                                                          Qt::CaseSensitivity caseSensitivity,
+                                                          int batchSize)
+{
+    QList<Batch> batches;
+    if (!group->resolveSearchingEnabled()) {
+        return batches;
+    }
+
+    const QStringList wordList = splitSearchTerm(searchTerm);
+    loadCandidates(wordList, group);
+
+    QList<Entry*> entries;
+    QVector<MatchState> states;
+    collectEntries(wordList, group, caseSensitivity, entries, states);
+    m_candidates.clear();
+
+    return makeBatches(entries, states, batchSize);
+}
+
+/**
+ * Same as prepareBatches(), but only the entries found by a previous search are checked.
+ *
+ * @param previousResult result of a search in the same group with the same case sensitivity
+ *                       for a term refined by searchTerm, see refinesSearch()
+ */
+QList<EntrySearcher::Batch> EntrySearcher::prepareBatches(const QString& searchTerm,
+                                                          const QList<Entry*>& previousResult,
+                                                          const Group* group,
+                                                          Qt::CaseSensitivity caseSensitivity,
+                                                          int batchSize)
+{
+    const QStringList wordList = splitSearchTerm(searchTerm);
+    loadCandidates(wordList, group);
+
+    QList<Entry*> entries;
+    QVector<MatchState> states;
+    for (Entry* entry : previousResult) {
+        const MatchState state = groupPathState(wordList, entry, group, caseSensitivity);
+        if (state == Matched || (state == Unchecked && (!m_useCandidates || m_candidates.contains(entry)))) {
+            entries.append(entry);
+            states.append(state);
+        }
+    }
+    m_candidates.clear();
+
+    return makeBatches(entries, states, batchSize);
+}
+
+/**
+ * Check whether every entry matching searchTerm also matches previousTerm,
+ * i.e. every word of the previous term is part of a word of the new one.
+ */
+bool EntrySearcher::refinesSearch(const QString& searchTerm,
+                                  const QString& previousTerm,
+                                  Qt::CaseSensitivity caseSensitivity)
+{
+    const QStringList wordList = splitSearchTerm(searchTerm);
+    for (const QString& previousWord : splitSearchTerm(previousTerm)) {
+        bool refined = false;
+        for (const QString& word : wordList) {
+            if (word.contains(previousWord, caseSensitivity)) {
+                refined = true;
+                break;
+            }
+        }
+
+        if (!refined) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+QList<EntrySearcher::Batch>
+EntrySearcher::makeBatches(const QList<Entry*>& entries, const QVector<MatchState>& states, int batchSize)
+{
+    QList<Batch> batches;
+    for (int i = 0; i < entries.size(); i += batchSize) {
+        const int end = qMin(i + batchSize, entries.size());
+        Batch batch;
+        batch.reserve(end - i);
+
+        for (int j = i; j < end; ++j) {
+            Entry* entry = entries.at(j);
+            Candidate candidate;
+            candidate.entry = entry;
+            candidate.matched = states.at(j) == Matched;
+            if (candidate.matched) {
+                batch.append(candidate);
+                continue;
+            }
+
+            if (hasPlaceholders(entry)) {
+                candidate.fields << entry->resolvePlaceholder(entry->title())
+                                 << entry->resolvePlaceholder(entry->username())
+                                 << entry->resolvePlaceholder(entry->url())
+                                 << entry->resolvePlaceholder(entry->notes());
+            } else {
+                candidate.fields << entry->title() << entry->username() << entry->url() << entry->notes();
+            }
+            batch.append(candidate);
+        }
+
+        batches.append(batch);
+    }
+
+    return batches;
+}
+
+/**
+ * Narrow down the entries to check using the search index of the database.
+ */
+void EntrySearcher::loadCandidates(const QStringList& wordList, const Group* group)
+{
+    m_candidates.clear();
+    m_useCandidates = false;
+    if (group->database()) {
+        m_useCandidates = group->database()->searchIndex()->candidates(wordList, m_candidates);
+    }
 }
 
 QList<Entry*>
-EntrySearcher::searchEntries(const QString& searchTerm, const Group* group, Qt::CaseSensitivity caseSensitivity)
+EntrySearcher::searchEntries(const QStringList& wordList, const Group* group, Qt::CaseSensitivity caseSensitivity)
 {
     QList<Entry*> searchResult;
 
     const QList<Entry*> entryList = group->entries();
     for (Entry* entry : entryList) {
-        searchResult.append(matchEntry(searchTerm, entry, caseSensitivity));
+        searchResult.append(matchEntry(wordList, entry, caseSensitivity));
     }
 
     const QList<Group*> children = group->children();
     for (Group* childGroup : children) {
         if (childGroup->searchingEnabled() != Group::Disable) {
-            if (matchGroup(searchTerm, childGroup, caseSensitivity)) {
+            if (matchGroup(wordList, childGroup, caseSensitivity)) {
                 searchResult.append(childGroup->entriesRecursive());
             } else {
-                searchResult.append(searchEntries(searchTerm, childGroup, caseSensitivity));
+                searchResult.append(searchEntries(wordList, childGroup, caseSensitivity));
             }
         }
     }
@@ -53,9 +204,125 @@ EntrySearcher::searchEntries(const QString& searchTerm, const Group* group, Qt::
     return searchResult;
 }
 
-QList<Entry*> EntrySearcher::matchEntry(const QString& searchTerm, Entry* entry, Qt::CaseSensitivity caseSensitivity)
+/**
+ * Same as searchEntries(), but the entries are matched in chunks on the global thread pool.
+ *
+ * Resolving placeholders may touch other entries and lazily built lookup tables of the
+ * database, so entries containing placeholders are matched on the calling thread.
+ */
+QList<Entry*> EntrySearcher::searchEntriesParallel(const QStringList& wordList,
+                                                   const Group* group,
+                                                   Qt::CaseSensitivity caseSensitivity)
 {
-    const QStringList wordList = searchTerm.split(QRegExp("\\s"), QString::SkipEmptyParts);
+    QList<Entry*> entries;
+    QVector<MatchState> states;
+    collectEntries(wordList, group, caseSensitivity, entries, states);
+
+    QVector<QPair<int, int>> chunks;
+    for (int i = 0; i < entries.size(); i += ChunkSize) {
+        chunks.append(qMakePair(i, qMin(i + ChunkSize, entries.size())));
+    }
+
+    // every chunk writes to its own range of states, detach before sharing the buffer
+    MatchState* stateData = states.data();
+    const QList<Entry*>& entryList = entries;
+    auto matchChunk = [&](const QPair<int, int>& chunk) {
+        for (int i = chunk.first; i < chunk.second; ++i) {
+            if (stateData[i] != Unchecked) {
+                continue;
+            }
+
+            const Entry* entry = entryList.at(i);
+            if (hasPlaceholders(entry)) {
+                stateData[i] = Deferred;
+            } else {
+                stateData[i] = matchPlainEntry(wordList, entry, caseSensitivity) ? Matched : NotMatched;
+            }
+        }
+    };
+
+    if (chunks.size() > 1) {
+        QtConcurrent::blockingMap(chunks, matchChunk);
+    } else if (!chunks.isEmpty()) {
+        matchChunk(chunks.first());
+    }
+
+    QList<Entry*> searchResult;
+    for (int i = 0; i < entries.size(); ++i) {
+        if (states.at(i) == Deferred) {
+            states[i] = matchEntry(wordList, entries.at(i), caseSensitivity).isEmpty() ? NotMatched : Matched;
+        }
+        if (states.at(i) == Matched) {
+            searchResult.append(entries.at(i));
+        }
+    }
+
+    return searchResult;
+}
+
+/**
+ * Flatten the entries to search in tree order. Entries of groups matching
+ * the search term are marked as matched right away.
+ */
+void EntrySearcher::collectEntries(const QStringList& wordList,
+                                   const Group* group,
+                                   Qt::CaseSensitivity caseSensitivity,
+                                   QList<Entry*>& entries,
+                                   QVector<MatchState>& states)
+{
+    for (Entry* entry : group->entries()) {
+        if (!m_useCandidates || m_candidates.contains(entry)) {
+            entries.append(entry);
+            states.append(Unchecked);
+        }
+    }
+
+    for (Group* childGroup : group->children()) {
+        if (childGroup->searchingEnabled() != Group::Disable) {
+            if (matchGroup(wordList, childGroup, caseSensitivity)) {
+                const QList<Entry*> groupEntries = childGroup->entriesRecursive();
+                entries.append(groupEntries);
+                states += QVector<MatchState>(groupEntries.size(), Matched);
+            } else {
+                collectEntries(wordList, childGroup, caseSensitivity, entries, states);
+            }
+        }
+    }
+}
+
+/**
+ * Decide how collectEntries() would treat an entry based on the groups between
+ * the searched group and the entry: Matched if one of them matches the search term,
+ * NotMatched if searching is disabled on the way and Unchecked otherwise.
+ */
+EntrySearcher::MatchState EntrySearcher::groupPathState(const QStringList& wordList,
+                                                        const Entry* entry,
+                                                        const Group* group,
+                                                        Qt::CaseSensitivity caseSensitivity)
+{
+    QList<const Group*> path;
+    for (const Group* parent = entry->group(); parent && parent != group; parent = parent->parentGroup()) {
+        path.prepend(parent);
+    }
+
+    for (const Group* pathGroup : asConst(path)) {
+        if (pathGroup->searchingEnabled() == Group::Disable) {
+            return NotMatched;
+        }
+        if (matchGroup(wordList, pathGroup, caseSensitivity)) {
+            return Matched;
+        }
+    }
+
+    return Unchecked;
+}
+
+QList<Entry*> EntrySearcher::matchEntry(const QStringList& wordList, Entry* entry, Qt::CaseSensitivity caseSensitivity)
+{
+    if (m_useCandidates && !m_candidates.contains(entry)) {
+        return QList<Entry*>();
+    }
+
     for (const QString& word : wordList) {
         if (!wordMatch(word, entry, caseSensitivity)) {
             return QList<Entry*>();
@@ -73,9 +340,8 @@ bool EntrySearcher::wordMatch(const QString& word, Entry* entry, Qt::CaseSensiti
            || entry->resolvePlaceholder(entry->notes()).contains(word, caseSensitivity);
 }
 
-bool EntrySearcher::matchGroup(const QString& searchTerm, const Group* group, Qt::CaseSensitivity caseSensitivity)
+bool EntrySearcher::matchGroup(const QStringList& wordList, const Group* group, Qt::CaseSensitivity caseSensitivity)
 {
-    const QStringList wordList = searchTerm.split(QRegExp("\\s"), QString::SkipEmptyParts);
     for (const QString& word : wordList) {
         if (!wordMatch(word, group, caseSensitivity)) {
             return false;
@@ -89,3 +355,68 @@ bool EntrySearcher::wordMatch(const QString& word, const Group* group, Qt::CaseS
 {
     return group->name().contains(word, caseSensitivity) || group->notes().contains(word, caseSensitivity);
 }
+
+bool EntrySearcher::hasPlaceholders(const Entry* entry)
+{
+    const QLatin1Char brace('{');
+    return entry->title().contains(brace) || entry->username().contains(brace) || entry->url().contains(brace)
+           || entry->notes().contains(brace);
+}
+
+/**
+ * Match an entry without placeholders, the fields are compared as they are.
+ * This is safe to call from any thread as long as the entry isn't modified.
+ */
+bool EntrySearcher::matchPlainEntry(const QStringList& wordList,
+                                    const Entry* entry,
+                                    Qt::CaseSensitivity caseSensitivity)
+{
+    const QStringList fields = {entry->title(), entry->username(), entry->url(), entry->notes()};
+    return matchFields(wordList, fields, caseSensitivity);
+}
+
+/**
+ * Every word has to be contained in at least one of the fields.
+ */
+bool EntrySearcher::matchFields(const QStringList& wordList,
+                                const QStringList& fields,
+                                Qt::CaseSensitivity caseSensitivity)
+{
+    for (const QString& word : wordList) {
+        bool found = false;
+        for (const QString& field : fields) {
+            if (field.contains(word, caseSensitivity)) {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+QStringList EntrySearcher::splitSearchTerm(const QString& searchTerm)
+{
+    return searchTerm.split(QRegExp("\\s"), QString::SkipEmptyParts);
+}
+
+EntrySearcher::BatchMatcher::BatchMatcher(const QString& searchTerm, Qt::CaseSensitivity caseSensitivity)
+    : m_wordList(splitSearchTerm(searchTerm))
+    , m_caseSensitivity(caseSensitivity)
+{
+}
+
+QList<Entry*> EntrySearcher::BatchMatcher::operator()(const Batch& batch) const
+{
+    QList<Entry*> result;
+    for (const Candidate& candidate : batch) {
+        if (candidate.matched || matchFields(m_wordList, candidate.fields, m_caseSensitivity)) {
+            result.append(candidate.entry);
+        }
+    }
+    return result;
+}
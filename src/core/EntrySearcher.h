@@ -19,7 +19,9 @@
 #ifndef KEEPASSX_ENTRYSEARCHER_H
 #define KEEPASSX_ENTRYSEARCHER_H
 
-#include <QString>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
 
 class Group;
 class Entry;
@@ -27,14 +29,94 @@ class Entry;
 class EntrySearcher
 {
 public:
+    enum SearchMode
+    {
+        SerialSearch,
+        ParallelSearch // match entries on the global thread pool
+    };
+
+    /**
+     * An entry together with a copy of its searchable fields.
+     */
+    struct Candidate
+    {
+        Entry* entry;
+        bool matched; // matched through its group already
+        QStringList fields;
+    };
+    typedef QVector<Candidate> Batch;
+
+    /**
+     * Matches a batch of candidates against the search term. The entries
+     * themselves are never accessed, so batches can be matched on any thread.
+     */
+    class BatchMatcher
+    {
+    public:
+        typedef QList<Entry*> result_type;
+
+        BatchMatcher(const QString& searchTerm, Qt::CaseSensitivity caseSensitivity);
+        QList<Entry*> operator()(const Batch& batch) const;
+
+    private:
+        QStringList m_wordList;
+        Qt::CaseSensitivity m_caseSensitivity;
+    };
+
+    explicit EntrySearcher(SearchMode mode = SerialSearch);
+
     QList<Entry*> search(const QString& searchTerm, const Group* group, Qt::CaseSensitivity caseSensitivity);
+    QList<Batch> prepareBatches(const QString& searchTerm,
+                                const Group* group,
+                                Qt::CaseSensitivity caseSensitivity,
+                                int batchSize = ChunkSize);
+    QList<Batch> prepareBatches(const QString& searchTerm,
+                                const QList<Entry*>& previousResult,
+                                const Group* group,
+                                Qt::CaseSensitivity caseSensitivity,
+                                int batchSize = ChunkSize);
+
+    static bool
+    refinesSearch(const QString& searchTerm, const QString& previousTerm, Qt::CaseSensitivity caseSensitivity);
 
 private:
-    QList<Entry*> searchEntries(const QString& searchTerm, const Group* group, Qt::CaseSensitivity caseSensitivity);
-    QList<Entry*> matchEntry(const QString& searchTerm, Entry* entry, Qt::CaseSensitivity caseSensitivity);
+    enum MatchState : char
+    {
+        Unchecked,
+        Deferred,
+        Matched,
+        NotMatched
+    };
+
+    void loadCandidates(const QStringList& wordList, const Group* group);
+    QList<Entry*> searchEntries(const QStringList& wordList, const Group* group, Qt::CaseSensitivity caseSensitivity);
+    QList<Entry*>
+    searchEntriesParallel(const QStringList& wordList, const Group* group, Qt::CaseSensitivity caseSensitivity);
+    void collectEntries(const QStringList& wordList,
+                        const Group* group,
+                        Qt::CaseSensitivity caseSensitivity,
+                        QList<Entry*>& entries,
+                        QVector<MatchState>& states);
+    MatchState groupPathState(const QStringList& wordList,
+                              const Entry* entry,
+                              const Group* group,
+                              Qt::CaseSensitivity caseSensitivity);
+    QList<Entry*> matchEntry(const QStringList& wordList, Entry* entry, Qt::CaseSensitivity caseSensitivity);
     bool wordMatch(const QString& word, Entry* entry, Qt::CaseSensitivity caseSensitivity);
-    bool matchGroup(const QString& searchTerm, const Group* group, Qt::CaseSensitivity caseSensitivity);
+    bool matchGroup(const QStringList& wordList, const Group* group, Qt::CaseSensitivity caseSensitivity);
     bool wordMatch(const QString& word, const Group* group, Qt::CaseSensitivity caseSensitivity);
+
+    static bool hasPlaceholders(const Entry* entry);
+    static bool matchPlainEntry(const QStringList& wordList, const Entry* entry, Qt::CaseSensitivity caseSensitivity);
+    static bool matchFields(const QStringList& wordList, const QStringList& fields, Qt::CaseSensitivity caseSensitivity);
+    static QStringList splitSearchTerm(const QString& searchTerm);
+    static QList<Batch> makeBatches(const QList<Entry*>& entries, const QVector<MatchState>& states, int batchSize);
+
+    static const int ChunkSize;
+
+    SearchMode m_mode;
+    QSet<const Entry*> m_candidates;
+    bool m_useCandidates = false;
 };
 
 #endif // KEEPASSX_ENTRYSEARCHER_H
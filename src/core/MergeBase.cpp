@@ -0,0 +1,551 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MergeBase.h"
+
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "core/Database.h"
+#include "core/Entry.h"
+#include "core/Global.h"
+#include "core/Group.h"
+#include "crypto/Random.h"
+
+namespace
+{
+    /**
+     * Incremental SipHash-2-4, a keyed 64 bit pseudorandom function.
+     */
+    class SipHasher
+    {
+    public:
+        explicit SipHasher(const quint64* key)
+            : m_v0(Q_UINT64_C(0x736f6d6570736575) ^ key[0])
+            , m_v1(Q_UINT64_C(0x646f72616e646f6d) ^ key[1])
+            , m_v2(Q_UINT64_C(0x6c7967656e657261) ^ key[0])
+            , m_v3(Q_UINT64_C(0x7465646279746573) ^ key[1])
+            , m_tail(0)
+            , m_tailSize(0)
+            , m_length(0)
+        {
+        }
+
+        void add(const void* data, int size)
+        {
+            const uchar* bytes = static_cast<const uchar*>(data);
+            m_length += static_cast<quint64>(size);
+
+            while (size > 0 && m_tailSize > 0) {
+                addByte(*bytes++);
+                --size;
+            }
+            while (size >= 8) {
+                compress(qFromLittleEndian<quint64>(bytes));
+                bytes += 8;
+                size -= 8;
+            }
+            while (size > 0) {
+                addByte(*bytes++);
+                --size;
+            }
+        }
+
+        void add(qint64 value)
+        {
+            add(&value, sizeof(value));
+        }
+
+        void add(const QString& str)
+        {
+            add(static_cast<qint64>(str.size()));
+            add(str.constData(), str.size() * static_cast<int>(sizeof(QChar)));
+        }
+
+        void add(const QByteArray& data)
+        {
+            add(static_cast<qint64>(data.size()));
+            add(data.constData(), data.size());
+        }
+
+        quint64 result()
+        {
+            compress((m_length << 56) | m_tail);
+            m_v2 ^= 0xff;
+            round();
+            round();
+            round();
+            round();
+            return m_v0 ^ m_v1 ^ m_v2 ^ m_v3;
+        }
+
+    private:
+        static quint64 rotate(quint64 x, int bits)
+        {
+            return (x << bits) | (x >> (64 - bits));
+        }
+
+        void addByte(uchar byte)
+        {
+            m_tail |= static_cast<quint64>(byte) << (8 * m_tailSize);
+            if (++m_tailSize == 8) {
+                compress(m_tail);
+                m_tail = 0;
+                m_tailSize = 0;
+            }
+        }
+
+        void compress(quint64 block)
+        {
+            m_v3 ^= block;
+            round();
+            round();
+            m_v0 ^= block;
+        }
+
+        void round()
+        {
+            m_v0 += m_v1;
+            m_v1 = rotate(m_v1, 13);
+            m_v1 ^= m_v0;
+            m_v0 = rotate(m_v0, 32);
+            m_v2 += m_v3;
+            m_v3 = rotate(m_v3, 16);
+            m_v3 ^= m_v2;
+            m_v0 += m_v3;
+            m_v3 = rotate(m_v3, 21);
+            m_v3 ^= m_v0;
+            m_v2 += m_v1;
+            m_v1 = rotate(m_v1, 17);
+            m_v1 ^= m_v2;
+            m_v2 = rotate(m_v2, 32);
+        }
+
+        quint64 m_v0;
+        quint64 m_v1;
+        quint64 m_v2;
+        quint64 m_v3;
+        quint64 m_tail;
+        int m_tailSize;
+        quint64 m_length;
+    };
+
+    qint64 msecs(const QDateTime& dateTime)
+    {
+        return dateTime.isValid() ? dateTime.toMSecsSinceEpoch() : std::numeric_limits<qint64>::min();
+    }
+
+    // the KDBX format only stores whole seconds
+    bool isSameSecond(qint64 lhs, qint64 rhs)
+    {
+        return lhs == rhs
+               || (lhs != std::numeric_limits<qint64>::min() && rhs != std::numeric_limits<qint64>::min()
+                   && lhs / 1000 == rhs / 1000);
+    }
+
+    bool fieldLessThan(const MergeBase::Field& lhs, const MergeBase::Field& rhs)
+    {
+        return lhs.id < rhs.id;
+    }
+} // namespace
+
+/**
+ * Take a snapshot of a database.
+ *
+ * @param previous older snapshot of the same database, the digests of items whose
+ *                 modification time didn't change are taken over instead of hashing
+ *                 their fields again; the snapshot keeps its key then
+ */
+MergeBase::MergeBase(const Database* db, const MergeBase* previous)
+{
+    if (previous) {
+        memcpy(m_key, previous->m_key, sizeof(m_key));
+    } else {
+        const QByteArray key = randomGen()->randomArray(sizeof(m_key));
+        memcpy(m_key, key.constData(), sizeof(m_key));
+    }
+
+    for (const Group* group : db->rootGroup()->groupsRecursive(true)) {
+        const TimeInfo groupTimeInfo = group->timeInfo();
+        const Group* parent = group->parentGroup();
+        const QUuid parentUuid = parent ? parent->uuid() : QUuid();
+        const qint64 groupModified = msecs(groupTimeInfo.lastModificationTime());
+        const qint64 groupMoved = msecs(groupTimeInfo.locationChanged());
+        if (!copyItem(m_groups,
+                      previous ? previous->m_groups : m_groups,
+                      previous,
+                      group->uuid(),
+                      parentUuid,
+                      groupModified,
+                      groupMoved)) {
+            addItem(m_groups, group->uuid(), parentUuid, fields(group), groupModified, groupMoved);
+        }
+
+        for (const Entry* entry : group->entries()) {
+            const TimeInfo entryTimeInfo = entry->timeInfo();
+            const qint64 entryModified = msecs(entryTimeInfo.lastModificationTime());
+            const qint64 entryMoved = msecs(entryTimeInfo.locationChanged());
+            if (!copyItem(m_entries,
+                          previous ? previous->m_entries : m_entries,
+                          previous,
+                          entry->uuid(),
+                          group->uuid(),
+                          entryModified,
+                          entryMoved)) {
+                addItem(m_entries, entry->uuid(), group->uuid(), fields(entry), entryModified, entryMoved);
+            }
+        }
+    }
+
+    m_digests.squeeze();
+}
+
+bool MergeBase::containsEntry(const QUuid& uuid) const
+{
+    return m_entries.contains(uuid);
+}
+
+bool MergeBase::containsGroup(const QUuid& uuid) const
+{
+    return m_groups.contains(uuid);
+}
+
+QList<QUuid> MergeBase::entryUuids() const
+{
+    return m_entries.keys();
+}
+
+QList<QUuid> MergeBase::groupUuids() const
+{
+    return m_groups.keys();
+}
+
+QUuid MergeBase::entryParent(const QUuid& uuid) const
+{
+    auto it = m_entries.constFind(uuid);
+    return it != m_entries.constEnd() ? it.value().parent : QUuid();
+}
+
+QUuid MergeBase::groupParent(const QUuid& uuid) const
+{
+    auto it = m_groups.constFind(uuid);
+    return it != m_groups.constEnd() ? it.value().parent : QUuid();
+}
+
+/**
+ * Returns true if the entry has neither been modified nor moved since the
+ * snapshot was taken.
+ */
+bool MergeBase::isUnchanged(const Entry* entry) const
+{
+    auto it = m_entries.constFind(entry->uuid());
+    if (it == m_entries.constEnd() || !entry->group() || entry->group()->uuid() != it.value().parent) {
+        return false;
+    }
+
+    return isSameSecond(msecs(entry->timeInfo().locationChanged()), it.value().locationChanged)
+           && hasSameContent(entry);
+}
+
+bool MergeBase::isUnchanged(const Group* group) const
+{
+    auto it = m_groups.constFind(group->uuid());
+    const Group* parent = group->parentGroup();
+    if (it == m_groups.constEnd() || (parent ? parent->uuid() : QUuid()) != it.value().parent) {
+        return false;
+    }
+
+    return isSameSecond(msecs(group->timeInfo().locationChanged()), it.value().locationChanged)
+           && hasSameContent(group);
+}
+
+/**
+ * Returns true if the fields of the entry are the same as in the snapshot.
+ *
+ * Only entries whose modification time matches the snapshot to the second
+ * are compared field by field, everything else is known to be modified.
+ */
+bool MergeBase::hasSameContent(const Entry* entry) const
+{
+    auto it = m_entries.constFind(entry->uuid());
+    if (it == m_entries.constEnd()) {
+        return false;
+    }
+
+    const qint64 lastModificationTime = msecs(entry->timeInfo().lastModificationTime());
+    if (lastModificationTime == it.value().lastModificationTime) {
+        return true;
+    }
+
+    return isSameSecond(lastModificationTime, it.value().lastModificationTime) && matches(it.value(), fields(entry));
+}
+
+bool MergeBase::hasSameContent(const Group* group) const
+{
+    auto it = m_groups.constFind(group->uuid());
+    if (it == m_groups.constEnd()) {
+        return false;
+    }
+
+    const qint64 lastModificationTime = msecs(group->timeInfo().lastModificationTime());
+    if (lastModificationTime == it.value().lastModificationTime) {
+        return true;
+    }
+
+    return isSameSecond(lastModificationTime, it.value().lastModificationTime) && matches(it.value(), fields(group));
+}
+
+/**
+ * Returns the fields of the entry, digested with the key of this snapshot
+ * and sorted by id.
+ */
+MergeBase::FieldList MergeBase::fields(const Entry* entry) const
+{
+    FieldList result;
+
+    const EntryAttributes* attributes = entry->attributes();
+    const EntryAttachments* attachments = entry->attachments();
+    const QList<QString> attributeKeys = attributes->keys();
+    const QList<QString> attachmentKeys = attachments->keys();
+    result.reserve(attributeKeys.size() + attachmentKeys.size() + 7);
+
+    for (const QString& key : attributeKeys) {
+        Field field = makeField(Attribute, key);
+        SipHasher hasher(m_key);
+        hasher.add(static_cast<qint64>(attributes->isProtected(key)));
+        hasher.add(attributes->uncachedValue(key));
+        field.digest = hasher.result();
+        result.append(field);
+    }
+
+    for (const QString& key : attachmentKeys) {
+        Field field = makeField(Attachment, key);
+        SipHasher hasher(m_key);
+        hasher.add(attachments->contentId(key));
+        field.digest = hasher.result();
+        result.append(field);
+    }
+
+    Field icon = makeField(Icon, QString());
+    SipHasher iconHasher(m_key);
+    iconHasher.add(static_cast<qint64>(entry->iconNumber()));
+    iconHasher.add(entry->iconUuid().toRfc4122());
+    icon.digest = iconHasher.result();
+    result.append(icon);
+
+    Field colors = makeField(Colors, QString());
+    SipHasher colorsHasher(m_key);
+    colorsHasher.add(entry->foregroundColor().isValid() ? entry->foregroundColor().name() : QString());
+    colorsHasher.add(entry->backgroundColor().isValid() ? entry->backgroundColor().name() : QString());
+    colors.digest = colorsHasher.result();
+    result.append(colors);
+
+    Field overrideUrl = makeField(OverrideUrl, QString());
+    SipHasher overrideUrlHasher(m_key);
+    overrideUrlHasher.add(entry->overrideUrl());
+    overrideUrl.digest = overrideUrlHasher.result();
+    result.append(overrideUrl);
+
+    Field tags = makeField(Tags, QString());
+    SipHasher tagsHasher(m_key);
+    tagsHasher.add(entry->tags());
+    tags.digest = tagsHasher.result();
+    result.append(tags);
+
+    Field autoType = makeField(AutoType, QString());
+    SipHasher autoTypeHasher(m_key);
+    autoTypeHasher.add(static_cast<qint64>(entry->autoTypeEnabled()));
+    autoTypeHasher.add(static_cast<qint64>(entry->autoTypeObfuscation()));
+    autoTypeHasher.add(entry->defaultAutoTypeSequence());
+    for (const AutoTypeAssociations::Association& association : entry->autoTypeAssociations()->getAll()) {
+        autoTypeHasher.add(association.window);
+        autoTypeHasher.add(association.sequence);
+    }
+    autoType.digest = autoTypeHasher.result();
+    result.append(autoType);
+
+    Field expiry = makeField(Expiry, QString());
+    SipHasher expiryHasher(m_key);
+    expiryHasher.add(static_cast<qint64>(entry->timeInfo().expires()));
+    expiryHasher.add(msecs(entry->timeInfo().expiryTime()));
+    expiry.digest = expiryHasher.result();
+    result.append(expiry);
+
+    Field customData = makeField(CustomData, QString());
+    SipHasher customDataHasher(m_key);
+    QList<QString> customDataKeys = entry->customData()->keys();
+    std::sort(customDataKeys.begin(), customDataKeys.end());
+    for (const QString& key : asConst(customDataKeys)) {
+        customDataHasher.add(key);
+        customDataHasher.add(entry->customData()->value(key));
+    }
+    customData.digest = customDataHasher.result();
+    result.append(customData);
+
+    std::sort(result.begin(), result.end(), fieldLessThan);
+    return result;
+}
+
+/**
+ * Returns the fields of the group a merge takes over, digested with the key
+ * of this snapshot and sorted by id.
+ */
+MergeBase::FieldList MergeBase::fields(const Group* group) const
+{
+    FieldList result;
+    result.reserve(4);
+
+    Field name = makeField(Name, QString());
+    SipHasher nameHasher(m_key);
+    nameHasher.add(group->name());
+    name.digest = nameHasher.result();
+    result.append(name);
+
+    Field notes = makeField(Notes, QString());
+    SipHasher notesHasher(m_key);
+    notesHasher.add(group->notes());
+    notes.digest = notesHasher.result();
+    result.append(notes);
+
+    Field icon = makeField(Icon, QString());
+    SipHasher iconHasher(m_key);
+    iconHasher.add(static_cast<qint64>(group->iconNumber()));
+    iconHasher.add(group->iconUuid().toRfc4122());
+    icon.digest = iconHasher.result();
+    result.append(icon);
+
+    Field expiry = makeField(Expiry, QString());
+    SipHasher expiryHasher(m_key);
+    expiryHasher.add(static_cast<qint64>(group->timeInfo().expires()));
+    expiryHasher.add(msecs(group->timeInfo().expiryTime()));
+    expiry.digest = expiryHasher.result();
+    result.append(expiry);
+
+    std::sort(result.begin(), result.end(), fieldLessThan);
+    return result;
+}
+
+/**
+ * Returns the field digests of the entry as they were when the snapshot
+ * was taken.
+ */
+QVector<MergeBase::Digest> MergeBase::digests(const Entry* entry) const
+{
+    auto it = m_entries.constFind(entry->uuid());
+    if (it == m_entries.constEnd()) {
+        return QVector<Digest>();
+    }
+    return m_digests.mid(it.value().firstDigest, it.value().digestCount);
+}
+
+QVector<MergeBase::Digest> MergeBase::digests(const Group* group) const
+{
+    auto it = m_groups.constFind(group->uuid());
+    if (it == m_groups.constEnd()) {
+        return QVector<Digest>();
+    }
+    return m_digests.mid(it.value().firstDigest, it.value().digestCount);
+}
+
+void MergeBase::addItem(QHash<QUuid, ItemState>& items,
+                        const QUuid& uuid,
+                        const QUuid& parent,
+                        const FieldList& fields,
+                        qint64 lastModificationTime,
+                        qint64 locationChanged)
+{
+    ItemState state;
+    state.parent = parent;
+    state.lastModificationTime = lastModificationTime;
+    state.locationChanged = locationChanged;
+    state.firstDigest = m_digests.size();
+    state.digestCount = fields.size();
+
+    for (const Field& field : fields) {
+        Digest digest;
+        digest.id = field.id;
+        digest.digest = field.digest;
+        m_digests.append(digest);
+    }
+
+    items.insert(uuid, state);
+}
+
+/**
+ * Take over the digests of an item from the previous snapshot if the item
+ * hasn't been modified since. The location is not part of the digests.
+ *
+ * @return false if the fields of the item have to be hashed
+ */
+bool MergeBase::copyItem(QHash<QUuid, ItemState>& items,
+                         const QHash<QUuid, ItemState>& previousItems,
+                         const MergeBase* previous,
+                         const QUuid& uuid,
+                         const QUuid& parent,
+                         qint64 lastModificationTime,
+                         qint64 locationChanged)
+{
+    if (!previous) {
+        return false;
+    }
+
+    auto it = previousItems.constFind(uuid);
+    if (it == previousItems.constEnd() || it.value().lastModificationTime != lastModificationTime) {
+        return false;
+    }
+
+    ItemState state = it.value();
+    state.parent = parent;
+    state.locationChanged = locationChanged;
+    state.firstDigest = m_digests.size();
+    m_digests += previous->m_digests.mid(it.value().firstDigest, it.value().digestCount);
+
+    items.insert(uuid, state);
+    return true;
+}
+
+bool MergeBase::matches(const ItemState& state, const FieldList& fields) const
+{
+    if (fields.size() != state.digestCount) {
+        return false;
+    }
+
+    for (int i = 0; i < fields.size(); ++i) {
+        const Digest& digest = m_digests.at(state.firstDigest + i);
+        if (fields.at(i).id != digest.id || fields.at(i).digest != digest.digest) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+MergeBase::Field MergeBase::makeField(FieldKind kind, const QString& key) const
+{
+    SipHasher hasher(m_key);
+    hasher.add(static_cast<qint64>(kind));
+    hasher.add(key);
+
+    Field field;
+    field.kind = kind;
+    field.key = key;
+    field.id = hasher.result();
+    field.digest = 0;
+    return field;
+}
@@ -0,0 +1,128 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_MERGEBASE_H
+#define KEEPASSX_MERGEBASE_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QUuid>
+#include <QVector>
+
+class Database;
+class Entry;
+class Group;
+
+/**
+ * Snapshot of the last synced state of a database, the common ancestor of
+ * a three-way merge.
+ *
+ * For every entry and group the snapshot keeps the parent group, the
+ * timestamps and a 64 bit digest of each field. The digests are keyed with
+ * a random per-snapshot key, so the snapshot is compact and reveals nothing
+ * about the contents of the database.
+ */
+class MergeBase
+{
+public:
+    enum FieldKind
+    {
+        Attribute,
+        Attachment,
+        Icon,
+        Colors,
+        OverrideUrl,
+        Tags,
+        AutoType,
+        Expiry,
+        CustomData,
+        Name,
+        Notes
+    };
+
+    struct Field
+    {
+        FieldKind kind;
+        QString key; // attribute or attachment name
+        quint64 id;
+        quint64 digest;
+    };
+
+    typedef QVector<Field> FieldList;
+
+    struct Digest
+    {
+        quint64 id;
+        quint64 digest;
+    };
+
+    explicit MergeBase(const Database* db, const MergeBase* previous = nullptr);
+
+    bool containsEntry(const QUuid& uuid) const;
+    bool containsGroup(const QUuid& uuid) const;
+    QList<QUuid> entryUuids() const;
+    QList<QUuid> groupUuids() const;
+    QUuid entryParent(const QUuid& uuid) const;
+    QUuid groupParent(const QUuid& uuid) const;
+
+    bool isUnchanged(const Entry* entry) const;
+    bool isUnchanged(const Group* group) const;
+    bool hasSameContent(const Entry* entry) const;
+    bool hasSameContent(const Group* group) const;
+
+    FieldList fields(const Entry* entry) const;
+    FieldList fields(const Group* group) const;
+    QVector<Digest> digests(const Entry* entry) const;
+    QVector<Digest> digests(const Group* group) const;
+
+private:
+    struct ItemState
+    {
+        QUuid parent;
+        qint64 lastModificationTime;
+        qint64 locationChanged;
+        int firstDigest;
+        int digestCount;
+    };
+
+    void addItem(QHash<QUuid, ItemState>& items,
+                 const QUuid& uuid,
+                 const QUuid& parent,
+                 const FieldList& fields,
+                 qint64 lastModificationTime,
+                 qint64 locationChanged);
+    bool copyItem(QHash<QUuid, ItemState>& items,
+                  const QHash<QUuid, ItemState>& previousItems,
+                  const MergeBase* previous,
+                  const QUuid& uuid,
+                  const QUuid& parent,
+                  qint64 lastModificationTime,
+                  qint64 locationChanged);
+    bool matches(const ItemState& state, const FieldList& fields) const;
+    Field makeField(FieldKind kind, const QString& key) const;
+
+    quint64 m_key[2];
+    QHash<QUuid, ItemState> m_entries;
+    QHash<QUuid, ItemState> m_groups;
+    QVector<Digest> m_digests;
+};
+
+Q_DECLARE_TYPEINFO(MergeBase::Field, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(MergeBase::Digest, Q_PRIMITIVE_TYPE);
+
+#endif // KEEPASSX_MERGEBASE_H
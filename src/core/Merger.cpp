@@ -0,0 +1,779 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Merger.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "core/Database.h"
+#include "core/Entry.h"
+#include "core/Global.h"
+#include "core/Group.h"
+#include "core/Metadata.h"
+
+namespace
+{
+    int groupDepth(const Group* group)
+    {
+        int depth = 0;
+        while ((group = group->parentGroup())) {
+            ++depth;
+        }
+        return depth;
+    }
+
+    // an item modified or moved at or after its deletion is kept
+    bool isDeletedAfter(const TimeInfo& timeInfo, const QDateTime& deletionTime)
+    {
+        return timeInfo.lastModificationTime() < deletionTime && timeInfo.locationChanged() < deletionTime;
+    }
+} // namespace
+
+Merger::Merger(const Database* sourceDb, Database* targetDb)
+    : m_sourceDb(sourceDb)
+    , m_targetDb(targetDb)
+    , m_sourceGroup(sourceDb->rootGroup())
+    , m_targetGroup(targetDb->rootGroup())
+    , m_base(nullptr)
+{
+}
+
+/**
+ * Merge a group tree without its database, deleted objects are not processed.
+ */
+Merger::Merger(const Group* sourceGroup, Group* targetGroup)
+    : m_sourceDb(nullptr)
+    , m_targetDb(nullptr)
+    , m_sourceGroup(sourceGroup)
+    , m_targetGroup(targetGroup)
+    , m_base(nullptr)
+{
+}
+
+/**
+ * Set the common ancestor of the source and the target, the state both
+ * were in when they were last synced. The base must outlive the merge.
+ */
+void Merger::setBase(const MergeBase* base)
+{
+    m_base = base;
+}
+
+/**
+ * Merge the source into the target and return the changes made to the target.
+ */
+Merger::ChangeList Merger::merge()
+{
+    m_changes.clear();
+    m_replacedEntries.clear();
+    m_sourceUuids.clear();
+
+    Group* targetRoot = m_targetGroup;
+    while (targetRoot->parentGroup()) {
+        targetRoot = targetRoot->parentGroup();
+    }
+
+    m_targetEntries.clear();
+    for (Entry* entry : targetRoot->entriesRecursive(false)) {
+        m_targetEntries.insert(entry->uuid(), entry);
+    }
+    m_targetGroups.clear();
+    for (Group* group : targetRoot->groupsRecursive(true)) {
+        m_targetGroups.insert(group->uuid(), group);
+    }
+
+    m_targetDeletions.clear();
+    if (m_sourceDb) {
+        for (const DeletedObject& object : m_targetDb->deletedObjects()) {
+            auto it = m_targetDeletions.find(object.uuid);
+            if (it == m_targetDeletions.end()) {
+                m_targetDeletions.insert(object.uuid, object.deletionTime);
+            } else if (it.value() < object.deletionTime) {
+                it.value() = object.deletionTime;
+            }
+        }
+    }
+
+    mergeGroup(m_targetGroup, m_sourceGroup);
+
+    if (m_base && m_sourceDb) {
+        mergeBaseDeletions();
+    }
+
+    // Erasing an entry records it as deleted, the replaced entries live on
+    // in their newer version though. Restore the deleted objects afterwards.
+    Database* db = m_targetGroup->database();
+    QList<DeletedObject> deletedObjects;
+    if (db) {
+        deletedObjects = db->deletedObjects();
+    }
+
+    qDeleteAll(m_replacedEntries);
+    m_replacedEntries.clear();
+
+    if (m_sourceDb) {
+        mergeDeletedObjects(deletedObjects);
+    }
+
+    if (db) {
+        db->setDeletedObjects(deletedObjects);
+    }
+
+    return m_changes;
+}
+
+QString Merger::describe(const Change& change)
+{
+    switch (change.type) {
+    case Added:
+        return change.isGroup ? tr("Added group \"%1\"").arg(change.name) : tr("Added entry \"%1\"").arg(change.name);
+    case Updated:
+        return change.isGroup ? tr("Updated group \"%1\"").arg(change.name)
+                              : tr("Updated entry \"%1\"").arg(change.name);
+    case Moved:
+        return change.isGroup ? tr("Moved group \"%1\"").arg(change.name) : tr("Moved entry \"%1\"").arg(change.name);
+    case Conflict:
+        return change.isGroup ? tr("Conflicting group \"%1\"").arg(change.name)
+                              : tr("Conflicting entry \"%1\"").arg(change.name);
+    case Deleted:
+        return change.isGroup ? tr("Deleted group \"%1\"").arg(change.name)
+                              : tr("Deleted entry \"%1\"").arg(change.name);
+    default:
+        Q_ASSERT(false);
+        return QString();
+    }
+}
+
+void Merger::mergeGroup(Group* targetGroup, const Group* sourceGroup)
+{
+    m_sourceUuids.insert(sourceGroup->uuid());
+
+    for (const Entry* entry : sourceGroup->entries()) {
+        mergeEntry(targetGroup, entry);
+    }
+
+    for (const Group* group : sourceGroup->children()) {
+        Group* existingGroup = m_targetGroups.value(group->uuid());
+
+        if (!existingGroup) {
+            const bool deletedSinceBase =
+                m_base && m_base->containsGroup(group->uuid()) && isUnchangedSinceBase(group);
+            if (deletedSinceBase || isDeletedInTarget(group)) {
+                mergeDeletedGroup(group);
+                continue;
+            }
+
+            Group* newGroup = group->clone(Entry::CloneNoFlags, Group::CloneNoFlags);
+            newGroup->setParent(targetGroup);
+            m_targetGroups.insert(newGroup->uuid(), newGroup);
+            addChange(Added, newGroup);
+            mergeGroup(newGroup, group);
+        } else if (m_base && m_base->containsGroup(group->uuid())) {
+            const Group* existingParent = existingGroup->parentGroup();
+            if (existingParent != targetGroup
+                && isMovedInSource(m_base->groupParent(group->uuid()),
+                                   sourceGroup->uuid(),
+                                   existingParent ? existingParent->uuid() : QUuid(),
+                                   group->timeInfo(),
+                                   existingGroup->timeInfo())) {
+                existingGroup->setParent(targetGroup);
+                addChange(Moved, existingGroup);
+            }
+            mergeGroupFields(existingGroup, group);
+            mergeGroup(existingGroup, group);
+        } else {
+            bool locationChanged = existingGroup->timeInfo().locationChanged() < group->timeInfo().locationChanged();
+            if (locationChanged && existingGroup->parentGroup() != targetGroup) {
+                existingGroup->setParent(targetGroup);
+                addChange(Moved, existingGroup);
+            }
+            resolveGroupConflict(existingGroup, group);
+            mergeGroup(existingGroup, group);
+        }
+    }
+}
+
+/**
+ * Merge the contents of a group the target deleted after its last
+ * modification. Items that still exist elsewhere in the target are
+ * resolved in place, the others stay deleted.
+ */
+void Merger::mergeDeletedGroup(const Group* sourceGroup)
+{
+    m_sourceUuids.insert(sourceGroup->uuid());
+
+    for (const Entry* entry : sourceGroup->entries()) {
+        m_sourceUuids.insert(entry->uuid());
+        Entry* existingEntry = m_targetEntries.value(entry->uuid());
+        if (existingEntry) {
+            mergeEntry(existingEntry->group(), entry);
+        }
+    }
+
+    for (const Group* group : sourceGroup->children()) {
+        Group* existingGroup = m_targetGroups.value(group->uuid());
+        if (existingGroup) {
+            if (m_base && m_base->containsGroup(group->uuid())) {
+                mergeGroupFields(existingGroup, group);
+            } else {
+                resolveGroupConflict(existingGroup, group);
+            }
+            mergeGroup(existingGroup, group);
+        } else {
+            mergeDeletedGroup(group);
+        }
+    }
+}
+
+void Merger::mergeEntry(Group* targetGroup, const Entry* sourceEntry)
+{
+    m_sourceUuids.insert(sourceEntry->uuid());
+
+    // an entry the source did not touch since the base is up to date in the target
+    const bool inBase = m_base && m_base->containsEntry(sourceEntry->uuid());
+    if (inBase && m_base->isUnchanged(sourceEntry)) {
+        return;
+    }
+
+    Entry* existingEntry = m_targetEntries.value(sourceEntry->uuid());
+
+    if (!existingEntry) {
+        // the target deleted the entry, only bring it back if the source modified it
+        const bool deleted = inBase ? m_base->hasSameContent(sourceEntry)
+                                    : isDeletedInTarget(sourceEntry->uuid(), sourceEntry->timeInfo());
+        if (deleted) {
+            return;
+        }
+
+        // This entry does not exist at all. Create it.
+        Entry* newEntry = sourceEntry->clone(Entry::CloneIncludeHistory);
+        newEntry->setGroup(targetGroup);
+        m_targetEntries.insert(newEntry->uuid(), newEntry);
+        addChange(Added, newEntry);
+        return;
+    }
+
+    if (inBase) {
+        const Group* existingGroup = existingEntry->group();
+        if (existingGroup != targetGroup
+            && isMovedInSource(m_base->entryParent(sourceEntry->uuid()),
+                               sourceEntry->group()->uuid(),
+                               existingGroup->uuid(),
+                               sourceEntry->timeInfo(),
+                               existingEntry->timeInfo())) {
+            existingEntry->setGroup(targetGroup);
+            addChange(Moved, existingEntry);
+        }
+        mergeEntryFields(targetGroup, existingEntry, sourceEntry);
+        return;
+    }
+
+    // Entry is already present in the database. Update it.
+    bool locationChanged = existingEntry->timeInfo().locationChanged() < sourceEntry->timeInfo().locationChanged();
+    if (locationChanged && existingEntry->group() != targetGroup) {
+        existingEntry->setGroup(targetGroup);
+        addChange(Moved, existingEntry);
+    }
+    resolveEntryConflict(targetGroup, existingEntry, sourceEntry);
+}
+
+void Merger::resolveEntryConflict(Group* targetGroup, Entry* existingEntry, const Entry* otherEntry)
+{
+    const QDateTime timeExisting = existingEntry->timeInfo().lastModificationTime();
+    const QDateTime timeOther = otherEntry->timeInfo().lastModificationTime();
+
+    Entry* clonedEntry;
+
+    switch (targetGroup->mergeMode()) {
+    case Group::KeepBoth:
+        // if one entry is newer, create a clone and add it to the group
+        if (timeExisting > timeOther) {
+            clonedEntry = otherEntry->clone(Entry::CloneNewUuid | Entry::CloneIncludeHistory);
+            clonedEntry->setGroup(targetGroup);
+            markOlderEntry(clonedEntry);
+            addChange(Conflict, existingEntry);
+        } else if (timeExisting < timeOther) {
+            clonedEntry = otherEntry->clone(Entry::CloneNewUuid | Entry::CloneIncludeHistory);
+            clonedEntry->setGroup(targetGroup);
+            markOlderEntry(existingEntry);
+            addChange(Conflict, existingEntry);
+        }
+        break;
+    case Group::KeepNewer:
+        if (timeExisting < timeOther) {
+            // only if other entry is newer, replace existing one
+            clonedEntry = otherEntry->clone(Entry::CloneIncludeHistory);
+            clonedEntry->setGroup(existingEntry->group());
+            m_replacedEntries.append(existingEntry);
+            m_targetEntries.insert(clonedEntry->uuid(), clonedEntry);
+            addChange(Updated, clonedEntry);
+        }
+        break;
+    case Group::KeepExisting:
+        if (timeExisting < timeOther) {
+            addChange(Conflict, existingEntry);
+        }
+        break;
+    default:
+        // do nothing
+        break;
+    }
+}
+
+void Merger::resolveGroupConflict(Group* existingGroup, const Group* otherGroup)
+{
+    const QDateTime timeExisting = existingGroup->timeInfo().lastModificationTime();
+    const QDateTime timeOther = otherGroup->timeInfo().lastModificationTime();
+
+    // only if the other group is newer, update the existing one.
+    if (timeExisting < timeOther) {
+        const bool changed = existingGroup->name() != otherGroup->name()
+                             || existingGroup->notes() != otherGroup->notes()
+                             || existingGroup->iconNumber() != otherGroup->iconNumber()
+                             || existingGroup->iconUuid() != otherGroup->iconUuid()
+                             || existingGroup->timeInfo().expiryTime() != otherGroup->timeInfo().expiryTime();
+
+        existingGroup->setName(otherGroup->name());
+        existingGroup->setNotes(otherGroup->notes());
+        if (otherGroup->iconNumber() == 0) {
+            existingGroup->setIcon(otherGroup->iconUuid());
+        } else {
+            existingGroup->setIcon(otherGroup->iconNumber());
+        }
+        existingGroup->setExpiryTime(otherGroup->timeInfo().expiryTime());
+        if (changed) {
+            addChange(Updated, existingGroup);
+        }
+    }
+}
+
+/**
+ * Three-way merge of an entry both sides know from the base. Fields only
+ * the source changed are taken over, fields changed on both sides are
+ * resolved according to the merge mode.
+ */
+void Merger::mergeEntryFields(Group* targetGroup, Entry* existingEntry, const Entry* otherEntry)
+{
+    const Group::MergeMode mergeMode = targetGroup->mergeMode();
+    if (mergeMode == Group::KeepExisting) {
+        resolveEntryConflict(targetGroup, existingEntry, otherEntry);
+        return;
+    }
+
+    if (m_base->hasSameContent(otherEntry)) {
+        return;
+    }
+
+    if (m_base->hasSameContent(existingEntry)) {
+        // only the source changed the entry, take it over including its history
+        Entry* clonedEntry = otherEntry->clone(Entry::CloneIncludeHistory);
+        clonedEntry->setGroup(existingEntry->group());
+        m_replacedEntries.append(existingEntry);
+        m_targetEntries.insert(clonedEntry->uuid(), clonedEntry);
+        addChange(Updated, clonedEntry);
+        return;
+    }
+
+    const bool otherIsNewer =
+        existingEntry->timeInfo().lastModificationTime() < otherEntry->timeInfo().lastModificationTime();
+    MergeBase::FieldList changes;
+    const bool conflict = diffFields(m_base->digests(existingEntry),
+                                     m_base->fields(otherEntry),
+                                     m_base->fields(existingEntry),
+                                     otherIsNewer,
+                                     changes);
+
+    if (conflict && mergeMode == Group::KeepBoth) {
+        resolveEntryConflict(targetGroup, existingEntry, otherEntry);
+        return;
+    }
+
+    if (!changes.isEmpty()) {
+        existingEntry->beginUpdate();
+        for (const MergeBase::Field& field : asConst(changes)) {
+            copyField(existingEntry, otherEntry, field);
+        }
+        existingEntry->endUpdate();
+    }
+
+    if (conflict) {
+        addChange(Conflict, existingEntry);
+    } else if (!changes.isEmpty()) {
+        addChange(Updated, existingEntry);
+    }
+}
+
+/**
+ * Three-way merge of the properties of a group both sides know from the
+ * base, the newer group wins fields changed on both sides.
+ */
+void Merger::mergeGroupFields(Group* existingGroup, const Group* otherGroup)
+{
+    if (m_base->hasSameContent(otherGroup)) {
+        return;
+    }
+
+    const bool otherIsNewer =
+        existingGroup->timeInfo().lastModificationTime() < otherGroup->timeInfo().lastModificationTime();
+    MergeBase::FieldList changes;
+    const bool conflict = diffFields(m_base->digests(existingGroup),
+                                     m_base->fields(otherGroup),
+                                     m_base->fields(existingGroup),
+                                     otherIsNewer,
+                                     changes);
+
+    for (const MergeBase::Field& field : asConst(changes)) {
+        copyField(existingGroup, otherGroup, field);
+    }
+
+    if (conflict) {
+        addChange(Conflict, existingGroup);
+    } else if (!changes.isEmpty()) {
+        addChange(Updated, existingGroup);
+    }
+}
+
+/**
+ * Compare the fields of the source and the target against the base and
+ * collect the fields to copy from the source in changes. Fields changed on
+ * both sides are only copied if sourceWins is set.
+ *
+ * Returns true if a field has been changed differently on both sides.
+ */
+bool Merger::diffFields(const QVector<MergeBase::Digest>& baseDigests,
+                        const MergeBase::FieldList& sourceFields,
+                        const MergeBase::FieldList& targetFields,
+                        bool sourceWins,
+                        MergeBase::FieldList& changes) const
+{
+    bool conflict = false;
+    int b = 0;
+    int s = 0;
+    int t = 0;
+
+    // all lists are sorted by id, walk them in parallel
+    while (b < baseDigests.size() || s < sourceFields.size() || t < targetFields.size()) {
+        quint64 id = std::numeric_limits<quint64>::max();
+        if (b < baseDigests.size()) {
+            id = qMin(id, baseDigests.at(b).id);
+        }
+        if (s < sourceFields.size()) {
+            id = qMin(id, sourceFields.at(s).id);
+        }
+        if (t < targetFields.size()) {
+            id = qMin(id, targetFields.at(t).id);
+        }
+
+        const bool inBase = b < baseDigests.size() && baseDigests.at(b).id == id;
+        const bool inSource = s < sourceFields.size() && sourceFields.at(s).id == id;
+        const bool inTarget = t < targetFields.size() && targetFields.at(t).id == id;
+        const quint64 baseDigest = inBase ? baseDigests.at(b++).digest : 0;
+        const MergeBase::Field* sourceField = inSource ? &sourceFields.at(s++) : nullptr;
+        const MergeBase::Field* targetField = inTarget ? &targetFields.at(t++) : nullptr;
+
+        const bool sourceChanged = inSource != inBase || (inSource && sourceField->digest != baseDigest);
+        const bool targetChanged = inTarget != inBase || (inTarget && targetField->digest != baseDigest);
+        const bool sameValue = inSource == inTarget && (!inSource || sourceField->digest == targetField->digest);
+        if (!sourceChanged || sameValue) {
+            continue;
+        }
+
+        if (targetChanged) {
+            conflict = true;
+            if (!sourceWins) {
+                continue;
+            }
+        }
+        changes.append(inSource ? *sourceField : *targetField);
+    }
+
+    return conflict;
+}
+
+/**
+ * Copy a field from otherEntry, fields otherEntry does not have are removed.
+ */
+void Merger::copyField(Entry* entry, const Entry* otherEntry, const MergeBase::Field& field)
+{
+    switch (field.kind) {
+    case MergeBase::Attribute:
+        if (otherEntry->attributes()->contains(field.key)) {
+            entry->attributes()->set(field.key,
+                                     otherEntry->attributes()->value(field.key),
+                                     otherEntry->attributes()->isProtected(field.key));
+        } else if (entry->attributes()->contains(field.key)) {
+            entry->attributes()->remove(field.key);
+        }
+        break;
+    case MergeBase::Attachment:
+        if (otherEntry->attachments()->hasKey(field.key)) {
+            // share the pooled content, spilled content is not read back
+            entry->attachments()->setContentId(field.key, otherEntry->attachments()->contentId(field.key));
+        } else if (entry->attachments()->hasKey(field.key)) {
+            entry->attachments()->remove(field.key);
+        }
+        break;
+    case MergeBase::Icon:
+        if (otherEntry->iconNumber() == 0 && !otherEntry->iconUuid().isNull()) {
+            entry->setIcon(otherEntry->iconUuid());
+        } else {
+            entry->setIcon(otherEntry->iconNumber());
+        }
+        break;
+    case MergeBase::Colors:
+        entry->setForegroundColor(otherEntry->foregroundColor());
+        entry->setBackgroundColor(otherEntry->backgroundColor());
+        break;
+    case MergeBase::OverrideUrl:
+        entry->setOverrideUrl(otherEntry->overrideUrl());
+        break;
+    case MergeBase::Tags:
+        entry->setTags(otherEntry->tags());
+        break;
+    case MergeBase::AutoType:
+        entry->setAutoTypeEnabled(otherEntry->autoTypeEnabled());
+        entry->setAutoTypeObfuscation(otherEntry->autoTypeObfuscation());
+        entry->setDefaultAutoTypeSequence(otherEntry->defaultAutoTypeSequence());
+        entry->autoTypeAssociations()->copyDataFrom(otherEntry->autoTypeAssociations());
+        break;
+    case MergeBase::Expiry:
+        entry->setExpires(otherEntry->timeInfo().expires());
+        entry->setExpiryTime(otherEntry->timeInfo().expiryTime());
+        break;
+    case MergeBase::CustomData:
+        entry->customData()->copyDataFrom(otherEntry->customData());
+        break;
+    default:
+        Q_ASSERT(false);
+        break;
+    }
+}
+
+void Merger::copyField(Group* group, const Group* otherGroup, const MergeBase::Field& field)
+{
+    switch (field.kind) {
+    case MergeBase::Name:
+        group->setName(otherGroup->name());
+        break;
+    case MergeBase::Notes:
+        group->setNotes(otherGroup->notes());
+        break;
+    case MergeBase::Icon:
+        if (otherGroup->iconNumber() == 0 && !otherGroup->iconUuid().isNull()) {
+            group->setIcon(otherGroup->iconUuid());
+        } else {
+            group->setIcon(otherGroup->iconNumber());
+        }
+        break;
+    case MergeBase::Expiry:
+        group->setExpires(otherGroup->timeInfo().expires());
+        group->setExpiryTime(otherGroup->timeInfo().expiryTime());
+        break;
+    default:
+        Q_ASSERT(false);
+        break;
+    }
+}
+
+/**
+ * An item is moved to the location it has in the source if the source moved
+ * it since the base, and the target did not move it or moved it earlier.
+ */
+bool Merger::isMovedInSource(const QUuid& baseParent,
+                             const QUuid& sourceParent,
+                             const QUuid& targetParent,
+                             const TimeInfo& sourceTimeInfo,
+                             const TimeInfo& targetTimeInfo) const
+{
+    if (sourceParent == baseParent) {
+        return false;
+    }
+    return targetParent == baseParent || targetTimeInfo.locationChanged() < sourceTimeInfo.locationChanged();
+}
+
+/**
+ * Returns true if the group and all of its contents are unchanged since the
+ * base, so a deletion in the target can safely be kept.
+ */
+bool Merger::isUnchangedSinceBase(const Group* sourceGroup) const
+{
+    for (const Group* group : sourceGroup->groupsRecursive(true)) {
+        if (!m_base->containsGroup(group->uuid()) || !m_base->hasSameContent(group)) {
+            return false;
+        }
+        for (const Entry* entry : group->entries()) {
+            if (!m_base->containsEntry(entry->uuid()) || !m_base->hasSameContent(entry)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Erase the items the source deleted since the base, unless the target
+ * modified them in the meantime.
+ */
+void Merger::mergeBaseDeletions()
+{
+    QList<Entry*> entries;
+    for (const QUuid& uuid : m_base->entryUuids()) {
+        Entry* entry = m_sourceUuids.contains(uuid) ? nullptr : m_targetEntries.value(uuid);
+        if (entry && m_base->hasSameContent(entry)) {
+            m_targetEntries.remove(uuid);
+            entries.append(entry);
+        }
+    }
+
+    QList<Group*> groups;
+    for (const QUuid& uuid : m_base->groupUuids()) {
+        Group* group = m_sourceUuids.contains(uuid) ? nullptr : m_targetGroups.value(uuid);
+        if (group && group != m_targetGroup && m_base->hasSameContent(group)) {
+            m_targetGroups.remove(uuid);
+            groups.append(group);
+        }
+    }
+
+    eraseItems(entries, groups);
+}
+
+void Merger::markOlderEntry(Entry* entry)
+{
+    entry->attributes()->set(
+        "merged", tr("older entry merged from database \"%1\"").arg(entry->group()->database()->metadata()->name()));
+}
+
+bool Merger::isDeletedInTarget(const QUuid& uuid, const TimeInfo& timeInfo) const
+{
+    auto it = m_targetDeletions.constFind(uuid);
+    return it != m_targetDeletions.constEnd() && isDeletedAfter(timeInfo, it.value());
+}
+
+/**
+ * A group deleted in the target is only brought back if it or any of its
+ * contents has been modified after the deletion.
+ */
+bool Merger::isDeletedInTarget(const Group* sourceGroup) const
+{
+    auto it = m_targetDeletions.constFind(sourceGroup->uuid());
+    if (it == m_targetDeletions.constEnd()) {
+        return false;
+    }
+
+    const QDateTime deletionTime = it.value();
+    for (const Group* group : sourceGroup->groupsRecursive(true)) {
+        if (!isDeletedAfter(group->timeInfo(), deletionTime)) {
+            return false;
+        }
+        for (const Entry* entry : group->entries()) {
+            if (!isDeletedAfter(entry->timeInfo(), deletionTime)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Erase the items the source deleted after their last modification in the
+ * target and add the deleted objects of the source to deletedObjects.
+ */
+void Merger::mergeDeletedObjects(QList<DeletedObject>& deletedObjects)
+{
+    const QList<DeletedObject> sourceDeletions = m_sourceDb->deletedObjects();
+
+    QList<Entry*> entries;
+    QList<Group*> groups;
+    for (const DeletedObject& object : sourceDeletions) {
+        if (m_sourceUuids.contains(object.uuid)) {
+            continue;
+        }
+
+        Entry* entry = m_targetEntries.value(object.uuid);
+        if (entry) {
+            if (isDeletedAfter(entry->timeInfo(), object.deletionTime)) {
+                m_targetEntries.remove(object.uuid);
+                entries.append(entry);
+            }
+            continue;
+        }
+
+        Group* group = m_targetGroups.value(object.uuid);
+        if (group && group != m_targetGroup && isDeletedAfter(group->timeInfo(), object.deletionTime)) {
+            m_targetGroups.remove(object.uuid);
+            groups.append(group);
+        }
+    }
+
+    eraseItems(entries, groups);
+
+    QHash<QUuid, int> indexes;
+    for (int i = 0; i < deletedObjects.size(); ++i) {
+        indexes.insert(deletedObjects.at(i).uuid, i);
+    }
+    for (const DeletedObject& object : sourceDeletions) {
+        auto it = indexes.constFind(object.uuid);
+        if (it == indexes.constEnd()) {
+            indexes.insert(object.uuid, deletedObjects.size());
+            deletedObjects.append(object);
+        } else if (deletedObjects.at(it.value()).deletionTime < object.deletionTime) {
+            deletedObjects[it.value()].deletionTime = object.deletionTime;
+        }
+    }
+}
+
+void Merger::eraseItems(const QList<Entry*>& entries, QList<Group*> groups)
+{
+    for (Entry* entry : entries) {
+        addChange(Deleted, entry);
+        delete entry;
+    }
+
+    // erase subgroups first, groups that still have contents are kept
+    std::stable_sort(groups.begin(), groups.end(), [](const Group* lhs, const Group* rhs) {
+        return groupDepth(lhs) > groupDepth(rhs);
+    });
+    for (Group* group : asConst(groups)) {
+        if (group->entries().isEmpty() && group->children().isEmpty()) {
+            addChange(Deleted, group);
+            delete group;
+        }
+    }
+}
+
+void Merger::addChange(ChangeType type, const Entry* entry)
+{
+    Change change;
+    change.type = type;
+    change.isGroup = false;
+    change.uuid = entry->uuid();
+    change.name = entry->title();
+    m_changes.append(change);
+}
+
+void Merger::addChange(ChangeType type, const Group* group)
+{
+    Change change;
+    change.type = type;
+    change.isGroup = true;
+    change.uuid = group->uuid();
+    change.name = group->name();
+    m_changes.append(change);
+}
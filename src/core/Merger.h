@@ -0,0 +1,134 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_MERGER_H
+#define KEEPASSX_MERGER_H
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QUuid>
+
+#include "core/MergeBase.h"
+
+class Database;
+class Entry;
+class Group;
+class TimeInfo;
+struct DeletedObject;
+
+/**
+ * Merges a source group tree into a target group tree.
+ *
+ * The entries and groups of the target tree are looked up by uuid in maps
+ * built once before the source tree is walked, so a merge takes linear time
+ * in the size of both trees. Entries are resolved according to the merge
+ * mode of the target group they end up in.
+ *
+ * When merging databases the deleted objects are merged as well: items the
+ * source deleted after their last modification or move in the target are
+ * removed and items the target deleted are not brought back, unless they
+ * have been modified or moved after the deletion.
+ *
+ * Given a MergeBase with the common ancestor of both trees, the merge is
+ * three-way: items unchanged in the source are skipped, changes are detected
+ * per field and only fields changed on both sides are conflicts.
+ */
+class Merger
+{
+    Q_DECLARE_TR_FUNCTIONS(Merger)
+
+public:
+    enum ChangeType
+    {
+        Added,
+        Updated,
+        Moved,
+        Conflict,
+        Deleted
+    };
+
+    struct Change
+    {
+        ChangeType type;
+        bool isGroup;
+        QUuid uuid;
+        QString name;
+    };
+
+    typedef QList<Change> ChangeList;
+
+    Merger(const Database* sourceDb, Database* targetDb);
+    Merger(const Group* sourceGroup, Group* targetGroup);
+
+    void setBase(const MergeBase* base);
+    ChangeList merge();
+
+    static QString describe(const Change& change);
+
+private:
+    void mergeGroup(Group* targetGroup, const Group* sourceGroup);
+    void mergeDeletedGroup(const Group* sourceGroup);
+    void mergeEntry(Group* targetGroup, const Entry* sourceEntry);
+    void resolveEntryConflict(Group* targetGroup, Entry* existingEntry, const Entry* otherEntry);
+    void resolveGroupConflict(Group* existingGroup, const Group* otherGroup);
+    void mergeEntryFields(Group* targetGroup, Entry* existingEntry, const Entry* otherEntry);
+    void mergeGroupFields(Group* existingGroup, const Group* otherGroup);
+    bool diffFields(const QVector<MergeBase::Digest>& baseDigests,
+                    const MergeBase::FieldList& sourceFields,
+                    const MergeBase::FieldList& targetFields,
+                    bool sourceWins,
+                    MergeBase::FieldList& changes) const;
+    void copyField(Entry* entry, const Entry* otherEntry, const MergeBase::Field& field);
+    void copyField(Group* group, const Group* otherGroup, const MergeBase::Field& field);
+    bool isMovedInSource(const QUuid& baseParent,
+                         const QUuid& sourceParent,
+                         const QUuid& targetParent,
+                         const TimeInfo& sourceTimeInfo,
+                         const TimeInfo& targetTimeInfo) const;
+    bool isUnchangedSinceBase(const Group* sourceGroup) const;
+    void mergeBaseDeletions();
+    void eraseItems(const QList<Entry*>& entries, QList<Group*> groups);
+    void markOlderEntry(Entry* entry);
+    bool isDeletedInTarget(const QUuid& uuid, const TimeInfo& timeInfo) const;
+    bool isDeletedInTarget(const Group* sourceGroup) const;
+    void mergeDeletedObjects(QList<DeletedObject>& deletedObjects);
+    void addChange(ChangeType type, const Entry* entry);
+    void addChange(ChangeType type, const Group* group);
+
+    const Database* m_sourceDb;
+    Database* m_targetDb;
+    const Group* m_sourceGroup;
+    Group* m_targetGroup;
+    const MergeBase* m_base;
+
+    QHash<QUuid, Entry*> m_targetEntries;
+    QHash<QUuid, Group*> m_targetGroups;
+    QHash<QUuid, QDateTime> m_targetDeletions;
+    QSet<QUuid> m_sourceUuids;
+
+    // entries replaced by a newer version, erased once the source tree is merged
+    QList<Entry*> m_replacedEntries;
+
+    ChangeList m_changes;
+};
+
+Q_DECLARE_TYPEINFO(Merger::Change, Q_MOVABLE_TYPE);
+
+#endif // KEEPASSX_MERGER_H
@@ -0,0 +1,174 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SaveScheduler.h"
+
+#include <QTimer>
+
+SaveScheduler::SaveScheduler(QObject* parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+    , m_delay(0)
+    , m_maxSaves(0)
+    , m_interval(60000)
+    , m_pending(false)
+    , m_saving(false)
+    , m_savesRequested(0)
+    , m_savesCoalesced(0)
+    , m_savesPerformed(0)
+    , m_bytesWritten(0)
+{
+    m_timer->setSingleShot(true);
+    connect(m_timer, SIGNAL(timeout()), SLOT(timeout()));
+    m_clock.start();
+}
+
+/**
+ * Set the window in milliseconds in which save requests are merged.
+ */
+void SaveScheduler::setDelay(int delay)
+{
+    m_delay = qMax(0, delay);
+}
+
+int SaveScheduler::delay() const
+{
+    return m_delay;
+}
+
+/**
+ * Limit the number of saves started within interval milliseconds.
+ *
+ * @param maxSaves maximum number of saves, 0 disables the limit
+ * @param interval length of the budget interval in milliseconds
+ */
+void SaveScheduler::setBudget(int maxSaves, int interval)
+{
+    Q_ASSERT(interval > 0);
+
+    m_maxSaves = qMax(0, maxSaves);
+    m_interval = interval;
+}
+
+int SaveScheduler::maxSaves() const
+{
+    return m_maxSaves;
+}
+
+void SaveScheduler::requestSave()
+{
+    ++m_savesRequested;
+
+    if (m_pending) {
+        ++m_savesCoalesced;
+        return;
+    }
+
+    m_pending = true;
+    // a request arriving during a save is scheduled once the save has finished
+    if (!m_saving) {
+        schedule(m_delay);
+    }
+}
+
+/**
+ * Drop the pending request, e.g. because the database has been saved
+ * by other means in the meantime.
+ */
+void SaveScheduler::cancel()
+{
+    m_pending = false;
+    m_timer->stop();
+}
+
+void SaveScheduler::saveFinished(qint64 bytesWritten)
+{
+    Q_ASSERT(m_saving);
+
+    m_saving = false;
+    if (bytesWritten > 0) {
+        m_bytesWritten += static_cast<quint64>(bytesWritten);
+    }
+
+    if (m_pending) {
+        schedule(m_delay);
+    }
+}
+
+bool SaveScheduler::isPending() const
+{
+    return m_pending;
+}
+
+bool SaveScheduler::isSaving() const
+{
+    return m_saving;
+}
+
+quint64 SaveScheduler::savesRequested() const
+{
+    return m_savesRequested;
+}
+
+/**
+ * Number of requests that were merged into an already pending save.
+ */
+quint64 SaveScheduler::savesCoalesced() const
+{
+    return m_savesCoalesced;
+}
+
+quint64 SaveScheduler::savesPerformed() const
+{
+    return m_savesPerformed;
+}
+
+quint64 SaveScheduler::bytesWritten() const
+{
+    return m_bytesWritten;
+}
+
+void SaveScheduler::timeout()
+{
+    if (!m_pending || m_saving) {
+        return;
+    }
+
+    if (m_maxSaves > 0) {
+        const qint64 now = m_clock.elapsed();
+        while (!m_saveTimes.isEmpty() && now - m_saveTimes.head() >= m_interval) {
+            m_saveTimes.dequeue();
+        }
+
+        if (m_saveTimes.size() >= m_maxSaves) {
+            // budget exhausted, retry as soon as the oldest save leaves the interval
+            schedule(static_cast<int>(m_saveTimes.head() + m_interval - now));
+            return;
+        }
+        m_saveTimes.enqueue(now);
+    }
+
+    m_pending = false;
+    m_saving = true;
+    ++m_savesPerformed;
+    emit saveDue();
+}
+
+void SaveScheduler::schedule(int delay)
+{
+    m_timer->start(qMax(0, delay));
+}
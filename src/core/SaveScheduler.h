@@ -0,0 +1,86 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_SAVESCHEDULER_H
+#define KEEPASSX_SAVESCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QQueue>
+
+class QTimer;
+
+/**
+ * Coalesces save requests of a database.
+ *
+ * Requests arriving within the delay window are merged into a single save,
+ * at most one save is running at any time and no more than the configured
+ * number of saves is started per budget interval. Requests that exceed the
+ * budget are deferred, never dropped.
+ *
+ * saveDue() is emitted when a save should be performed, the receiver has to
+ * report its completion with saveFinished().
+ */
+class SaveScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SaveScheduler(QObject* parent = nullptr);
+
+    void setDelay(int delay);
+    int delay() const;
+    void setBudget(int maxSaves, int interval = 60000);
+    int maxSaves() const;
+
+    void requestSave();
+    void cancel();
+    void saveFinished(qint64 bytesWritten);
+
+    bool isPending() const;
+    bool isSaving() const;
+
+    quint64 savesRequested() const;
+    quint64 savesCoalesced() const;
+    quint64 savesPerformed() const;
+    quint64 bytesWritten() const;
+
+signals:
+    void saveDue();
+
+private slots:
+    void timeout();
+
+private:
+    void schedule(int delay);
+
+    QTimer* m_timer;
+    QElapsedTimer m_clock;
+    QQueue<qint64> m_saveTimes;
+    int m_delay;
+    int m_maxSaves;
+    int m_interval;
+    bool m_pending;
+    bool m_saving;
+
+    quint64 m_savesRequested;
+    quint64 m_savesCoalesced;
+    quint64 m_savesPerformed;
+    quint64 m_bytesWritten;
+};
+
+#endif // KEEPASSX_SAVESCHEDULER_H
@@ -25,9 +25,14 @@
 #include "crypto/CryptoHash.h"
 #include "crypto/SymmetricCipher.h"
 
+#ifdef WITH_XC_CRYPTO_SODIUM
+#include <sodium.h>
+#endif
+
 bool Crypto::m_initalized(false);
 QString Crypto::m_errorStr;
 QString Crypto::m_backendVersion;
+Crypto::Backend Crypto::m_backend(Crypto::Gcrypt);
 
 Crypto::Crypto()
 {
@@ -47,6 +52,9 @@ bool Crypto::init()
         return false;
     }
 
+    // prefer the fastest backend, it falls back to libgcrypt for unsupported algorithms
+    m_backend = backends().last();
+
     // has to be set before testing Crypto classes
     m_initalized = true;
 
@@ -70,7 +78,55 @@ QString Crypto::errorString()
 
 QString Crypto::backendVersion()
 {
-    return QString("libgcrypt ").append(m_backendVersion);
+    QString version = QString("libgcrypt ").append(m_backendVersion);
+#ifdef WITH_XC_CRYPTO_SODIUM
+    version.append(", libsodium ").append(QString::fromLatin1(sodium_version_string()));
+#endif
+    return version;
+}
+
+/**
+ * The backends compiled in, libgcrypt is always available.
+ */
+QList<Crypto::Backend> Crypto::backends()
+{
+    QList<Backend> backends;
+    backends << Gcrypt;
+#ifdef WITH_XC_CRYPTO_SODIUM
+    backends << Sodium;
+#endif
+    return backends;
+}
+
+Crypto::Backend Crypto::backend()
+{
+    return m_backend;
+}
+
+/**
+ * Select the backend used by ciphers and hashes created from now on.
+ * Algorithms the backend does not implement are still served by libgcrypt.
+ */
+bool Crypto::setBackend(Backend backend)
+{
+    if (!backends().contains(backend)) {
+        return false;
+    }
+
+    m_backend = backend;
+    return true;
+}
+
+QString Crypto::backendName(Backend backend)
+{
+    switch (backend) {
+    case Gcrypt:
+        return "libgcrypt";
+    case Sodium:
+        return "libsodium";
+    default:
+        return QString();
+    }
 }
 
 bool Crypto::backendSelfTest()
@@ -110,14 +166,33 @@ bool Crypto::checkAlgorithms()
         qWarning("Crypto::checkAlgorithms: %s", qPrintable(m_errorStr));
         return false;
     }
+#ifdef WITH_XC_CRYPTO_SODIUM
+    if (sodium_init() < 0) {
+        m_errorStr = "libsodium could not be initialized.";
+        qWarning("Crypto::checkAlgorithms: %s", qPrintable(m_errorStr));
+        return false;
+    }
+#endif
 
     return true;
 }
 
 bool Crypto::selfTest()
 {
-    return testSha256() && testSha512() && testAes256Cbc() && testAes256Ecb() && testTwofish() && testSalsa20()
-           && testChaCha20();
+    const Backend selected = m_backend;
+
+    for (Backend backend : backends()) {
+        m_backend = backend;
+        if (!testSha256() || !testSha512() || !testAes256Cbc() || !testAes256Ecb() || !testTwofish()
+            || !testSalsa20() || !testChaCha20()) {
+            m_errorStr = QString("%1: %2").arg(backendName(backend), m_errorStr);
+            m_backend = selected;
+            return false;
+        }
+    }
+
+    m_backend = selected;
+    return true;
 }
 
 void Crypto::raiseError(const QString& str)
@@ -18,16 +18,27 @@
 #ifndef KEEPASSX_CRYPTO_H
 #define KEEPASSX_CRYPTO_H
 
+#include <QList>
 #include <QString>
 
 class Crypto
 {
 public:
+    enum Backend
+    {
+        Gcrypt,
+        Sodium
+    };
+
     static bool init();
     static bool initalized();
     static bool backendSelfTest();
     static QString errorString();
     static QString backendVersion();
+    static QList<Backend> backends();
+    static Backend backend();
+    static bool setBackend(Backend backend);
+    static QString backendName(Backend backend);
 
 private:
     Crypto();
@@ -45,6 +56,7 @@ private:
     static bool m_initalized;
     static QString m_errorStr;
     static QString m_backendVersion;
+    static Backend m_backend;
 };
 
 #endif // KEEPASSX_CRYPTO_H
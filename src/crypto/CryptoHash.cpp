@@ -17,100 +17,56 @@
 
 #include "CryptoHash.h"
 
-#include <gcrypt.h>
-
+#include "config-keepassx.h"
 #include "crypto/Crypto.h"
-
-class CryptoHashPrivate
-{
-public:
-    gcry_md_hd_t ctx;
-    int hashLen;
-};
+#include "crypto/CryptoHashGcrypt.h"
+#ifdef WITH_XC_CRYPTO_SODIUM
+#include "crypto/CryptoHashSodium.h"
+#endif
 
 CryptoHash::CryptoHash(Algorithm algo, bool hmac)
-    : d_ptr(new CryptoHashPrivate())
+    : m_backend(createBackend(algo, hmac))
 {
-    Q_D(CryptoHash);
-
     Q_ASSERT(Crypto::initalized());
-
-    int algoGcrypt = -1;
-    unsigned int flagsGcrypt = GCRY_MD_FLAG_SECURE;
-
-    switch (algo) {
-    case CryptoHash::Sha256:
-        algoGcrypt = GCRY_MD_SHA256;
-        break;
-
-    case CryptoHash::Sha512:
-        algoGcrypt = GCRY_MD_SHA512;
-        break;
-
-    default:
-        Q_ASSERT(false);
-        break;
-    }
-
-    if (hmac) {
-        flagsGcrypt |= GCRY_MD_FLAG_HMAC;
-    }
-
-    gcry_error_t error = gcry_md_open(&d->ctx, algoGcrypt, flagsGcrypt);
-    if (error != GPG_ERR_NO_ERROR) {
-        qWarning("Gcrypt error (ctor): %s", gcry_strerror(error));
-        qWarning("Gcrypt error (ctor): %s", gcry_strsource(error));
-    }
-    Q_ASSERT(error == 0); // TODO: error handling
-
-    d->hashLen = gcry_md_get_algo_dlen(algoGcrypt);
 }
 
 CryptoHash::~CryptoHash()
 {
-    Q_D(CryptoHash);
+}
 
-    gcry_md_close(d->ctx);
+CryptoHashBackend* CryptoHash::createBackend(Algorithm algo, bool hmac)
+{
+#ifdef WITH_XC_CRYPTO_SODIUM
+    if (Crypto::backend() == Crypto::Sodium) {
+        return new CryptoHashSodium(algo, hmac);
+    }
+#endif
 
-    delete d_ptr;
+    return new CryptoHashGcrypt(algo, hmac);
 }
 
 void CryptoHash::addData(const QByteArray& data)
 {
-    Q_D(CryptoHash);
-
     if (data.isEmpty()) {
         return;
     }
 
-    gcry_md_write(d->ctx, data.constData(), static_cast<size_t>(data.size()));
+    m_backend->addData(data);
 }
 
 void CryptoHash::setKey(const QByteArray& data)
 {
-    Q_D(CryptoHash);
-
-    gcry_error_t error = gcry_md_setkey(d->ctx, data.constData(), static_cast<size_t>(data.size()));
-    if (error) {
-        qWarning("Gcrypt error (setKey): %s", gcry_strerror(error));
-        qWarning("Gcrypt error (setKey): %s", gcry_strsource(error));
-    }
-    Q_ASSERT(error == 0);
+    m_backend->setKey(data);
 }
 
 void CryptoHash::reset()
 {
-    Q_D(CryptoHash);
-
-    gcry_md_reset(d->ctx);
+    m_backend->reset();
 }
 
 QByteArray CryptoHash::result() const
 {
-    Q_D(const CryptoHash);
-
-    const auto result = reinterpret_cast<const char*>(gcry_md_read(d->ctx, 0));
-    return QByteArray(result, d->hashLen);
+    return m_backend->result();
 }
 
 QByteArray CryptoHash::hash(const QByteArray& data, Algorithm algo)
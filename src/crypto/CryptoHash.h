@@ -19,8 +19,9 @@
 #define KEEPASSX_CRYPTOHASH_H
 
 #include <QByteArray>
+#include <QScopedPointer>
 
-class CryptoHashPrivate;
+class CryptoHashBackend;
 
 class CryptoHash
 {
@@ -42,9 +43,11 @@ public:
     static QByteArray hmac(const QByteArray& data, const QByteArray& key, Algorithm algo);
 
 private:
-    CryptoHashPrivate* const d_ptr;
+    static CryptoHashBackend* createBackend(Algorithm algo, bool hmac);
 
-    Q_DECLARE_PRIVATE(CryptoHash)
+    const QScopedPointer<CryptoHashBackend> m_backend;
+
+    Q_DISABLE_COPY(CryptoHash)
 };
 
 #endif // KEEPASSX_CRYPTOHASH_H
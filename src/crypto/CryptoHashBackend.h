@@ -0,0 +1,35 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_CRYPTOHASHBACKEND_H
+#define KEEPASSX_CRYPTOHASHBACKEND_H
+
+#include <QByteArray>
+
+class CryptoHashBackend
+{
+public:
+    virtual ~CryptoHashBackend()
+    {
+    }
+    virtual void addData(const QByteArray& data) = 0;
+    virtual void setKey(const QByteArray& key) = 0;
+    virtual void reset() = 0;
+    virtual QByteArray result() const = 0;
+};
+
+#endif // KEEPASSX_CRYPTOHASHBACKEND_H
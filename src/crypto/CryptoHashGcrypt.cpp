@@ -0,0 +1,84 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CryptoHashGcrypt.h"
+
+CryptoHashGcrypt::CryptoHashGcrypt(CryptoHash::Algorithm algo, bool hmac)
+    : m_ctx(nullptr)
+    , m_hashLen(0)
+{
+    int algoGcrypt = -1;
+    unsigned int flagsGcrypt = GCRY_MD_FLAG_SECURE;
+
+    switch (algo) {
+    case CryptoHash::Sha256:
+        algoGcrypt = GCRY_MD_SHA256;
+        break;
+
+    case CryptoHash::Sha512:
+        algoGcrypt = GCRY_MD_SHA512;
+        break;
+
+    default:
+        Q_ASSERT(false);
+        break;
+    }
+
+    if (hmac) {
+        flagsGcrypt |= GCRY_MD_FLAG_HMAC;
+    }
+
+    gcry_error_t error = gcry_md_open(&m_ctx, algoGcrypt, flagsGcrypt);
+    if (error != GPG_ERR_NO_ERROR) {
+        qWarning("Gcrypt error (ctor): %s", gcry_strerror(error));
+        qWarning("Gcrypt error (ctor): %s", gcry_strsource(error));
+    }
+    Q_ASSERT(error == 0); // TODO: error handling
+
+    m_hashLen = gcry_md_get_algo_dlen(algoGcrypt);
+}
+
+CryptoHashGcrypt::~CryptoHashGcrypt()
+{
+    gcry_md_close(m_ctx);
+}
+
+void CryptoHashGcrypt::addData(const QByteArray& data)
+{
+    gcry_md_write(m_ctx, data.constData(), static_cast<size_t>(data.size()));
+}
+
+void CryptoHashGcrypt::setKey(const QByteArray& key)
+{
+    gcry_error_t error = gcry_md_setkey(m_ctx, key.constData(), static_cast<size_t>(key.size()));
+    if (error) {
+        qWarning("Gcrypt error (setKey): %s", gcry_strerror(error));
+        qWarning("Gcrypt error (setKey): %s", gcry_strsource(error));
+    }
+    Q_ASSERT(error == 0);
+}
+
+void CryptoHashGcrypt::reset()
+{
+    gcry_md_reset(m_ctx);
+}
+
+QByteArray CryptoHashGcrypt::result() const
+{
+    const auto result = reinterpret_cast<const char*>(gcry_md_read(m_ctx, 0));
+    return QByteArray(result, m_hashLen);
+}
@@ -0,0 +1,42 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_CRYPTOHASHGCRYPT_H
+#define KEEPASSX_CRYPTOHASHGCRYPT_H
+
+#include <gcrypt.h>
+
+#include "crypto/CryptoHash.h"
+#include "crypto/CryptoHashBackend.h"
+
+class CryptoHashGcrypt : public CryptoHashBackend
+{
+public:
+    CryptoHashGcrypt(CryptoHash::Algorithm algo, bool hmac);
+    ~CryptoHashGcrypt();
+
+    void addData(const QByteArray& data);
+    void setKey(const QByteArray& key);
+    void reset();
+    QByteArray result() const;
+
+private:
+    gcry_md_hd_t m_ctx;
+    int m_hashLen;
+};
+
+#endif // KEEPASSX_CRYPTOHASHGCRYPT_H
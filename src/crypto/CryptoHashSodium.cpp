@@ -0,0 +1,119 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CryptoHashSodium.h"
+
+CryptoHashSodium::CryptoHashSodium(CryptoHash::Algorithm algo, bool hmac)
+    : m_algo(algo)
+    , m_hmac(hmac)
+{
+    Q_ASSERT(algo == CryptoHash::Sha256 || algo == CryptoHash::Sha512);
+
+    reset();
+}
+
+CryptoHashSodium::~CryptoHashSodium()
+{
+    sodium_memzero(m_key.data(), static_cast<size_t>(m_key.size()));
+    sodium_memzero(&m_sha256, sizeof(m_sha256));
+    sodium_memzero(&m_sha512, sizeof(m_sha512));
+    sodium_memzero(&m_hmacSha256, sizeof(m_hmacSha256));
+    sodium_memzero(&m_hmacSha512, sizeof(m_hmacSha512));
+}
+
+void CryptoHashSodium::addData(const QByteArray& data)
+{
+    const auto in = reinterpret_cast<const unsigned char*>(data.constData());
+    const auto inLen = static_cast<unsigned long long>(data.size());
+
+    if (m_algo == CryptoHash::Sha256) {
+        if (m_hmac) {
+            crypto_auth_hmacsha256_update(&m_hmacSha256, in, inLen);
+        } else {
+            crypto_hash_sha256_update(&m_sha256, in, inLen);
+        }
+    } else {
+        if (m_hmac) {
+            crypto_auth_hmacsha512_update(&m_hmacSha512, in, inLen);
+        } else {
+            crypto_hash_sha512_update(&m_sha512, in, inLen);
+        }
+    }
+}
+
+void CryptoHashSodium::setKey(const QByteArray& key)
+{
+    Q_ASSERT(m_hmac);
+
+    sodium_memzero(m_key.data(), static_cast<size_t>(m_key.size()));
+    m_key = key;
+    reset();
+}
+
+void CryptoHashSodium::reset()
+{
+    const auto key = reinterpret_cast<const unsigned char*>(m_key.constData());
+    const auto keyLen = static_cast<size_t>(m_key.size());
+
+    if (m_algo == CryptoHash::Sha256) {
+        if (m_hmac) {
+            crypto_auth_hmacsha256_init(&m_hmacSha256, key, keyLen);
+        } else {
+            crypto_hash_sha256_init(&m_sha256);
+        }
+    } else {
+        if (m_hmac) {
+            crypto_auth_hmacsha512_init(&m_hmacSha512, key, keyLen);
+        } else {
+            crypto_hash_sha512_init(&m_sha512);
+        }
+    }
+}
+
+QByteArray CryptoHashSodium::result() const
+{
+    // finalize a copy of the state, the hash may be continued afterwards
+    QByteArray result;
+
+    if (m_algo == CryptoHash::Sha256) {
+        result.resize(crypto_hash_sha256_BYTES);
+        auto out = reinterpret_cast<unsigned char*>(result.data());
+        if (m_hmac) {
+            crypto_auth_hmacsha256_state state = m_hmacSha256;
+            crypto_auth_hmacsha256_final(&state, out);
+            sodium_memzero(&state, sizeof(state));
+        } else {
+            crypto_hash_sha256_state state = m_sha256;
+            crypto_hash_sha256_final(&state, out);
+            sodium_memzero(&state, sizeof(state));
+        }
+    } else {
+        result.resize(crypto_hash_sha512_BYTES);
+        auto out = reinterpret_cast<unsigned char*>(result.data());
+        if (m_hmac) {
+            crypto_auth_hmacsha512_state state = m_hmacSha512;
+            crypto_auth_hmacsha512_final(&state, out);
+            sodium_memzero(&state, sizeof(state));
+        } else {
+            crypto_hash_sha512_state state = m_sha512;
+            crypto_hash_sha512_final(&state, out);
+            sodium_memzero(&state, sizeof(state));
+        }
+    }
+
+    return result;
+}
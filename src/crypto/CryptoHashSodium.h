@@ -0,0 +1,51 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_CRYPTOHASHSODIUM_H
+#define KEEPASSX_CRYPTOHASHSODIUM_H
+
+#include <sodium.h>
+
+#include "crypto/CryptoHash.h"
+#include "crypto/CryptoHashBackend.h"
+
+/**
+ * SHA-256 and SHA-512 (and their HMAC variants) implemented with libsodium.
+ */
+class CryptoHashSodium : public CryptoHashBackend
+{
+public:
+    CryptoHashSodium(CryptoHash::Algorithm algo, bool hmac);
+    ~CryptoHashSodium();
+
+    void addData(const QByteArray& data);
+    void setKey(const QByteArray& key);
+    void reset();
+    QByteArray result() const;
+
+private:
+    const CryptoHash::Algorithm m_algo;
+    const bool m_hmac;
+    QByteArray m_key;
+
+    crypto_hash_sha256_state m_sha256;
+    crypto_hash_sha512_state m_sha512;
+    crypto_auth_hmacsha256_state m_hmacSha256;
+    crypto_auth_hmacsha512_state m_hmacSha512;
+};
+
+#endif // KEEPASSX_CRYPTOHASHSODIUM_H
@@ -0,0 +1,183 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MemoryCipher.h"
+
+#include <QAtomicInteger>
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <cstring>
+
+#include "crypto/Crypto.h"
+#include "crypto/Random.h"
+#include "crypto/SymmetricCipher.h"
+
+namespace
+{
+    const int NonceSize = 8;
+    const int KeySize = 32;
+
+    QAtomicInteger<quint64> g_nonceCounter;
+    QAtomicInt g_enabled(1);
+
+    QMutex g_mutex;
+    QByteArray g_sessionKey;
+    QCache<quint64, QString> g_cache(256);
+
+    // caller has to hold g_mutex
+    const QByteArray& sessionKey()
+    {
+        if (g_sessionKey.isEmpty()) {
+            g_sessionKey = randomGen()->randomArray(KeySize);
+        }
+        return g_sessionKey;
+    }
+
+    quint64 nonceValue(const QByteArray& cipherText)
+    {
+        quint64 nonce;
+        std::memcpy(&nonce, cipherText.constData(), NonceSize);
+        return nonce;
+    }
+
+    bool applyKeyStream(QByteArray& data, const QByteArray& nonce)
+    {
+        QByteArray key;
+        {
+            QMutexLocker locker(&g_mutex);
+            key = sessionKey();
+        }
+
+        SymmetricCipher cipher(SymmetricCipher::ChaCha20, SymmetricCipher::Stream, SymmetricCipher::Encrypt);
+        return cipher.init(key, nonce) && cipher.processInPlace(data);
+    }
+
+    void wipe(QByteArray& data)
+    {
+        // data() detaches, so only our own copy is overwritten
+        std::memset(data.data(), 0, static_cast<size_t>(data.size()));
+    }
+
+    QString decryptValue(const QByteArray& cipherText, bool useCache)
+    {
+        if (cipherText.size() < NonceSize) {
+            return QString();
+        }
+
+        const quint64 nonce = nonceValue(cipherText);
+        if (useCache) {
+            QMutexLocker locker(&g_mutex);
+            const QString* cached = g_cache.object(nonce);
+            if (cached) {
+                return *cached;
+            }
+        }
+
+        QByteArray data = cipherText.mid(NonceSize);
+        if (!applyKeyStream(data, cipherText.left(NonceSize))) {
+            wipe(data);
+            return QString();
+        }
+
+        const QString plainText = QString::fromUtf8(data);
+        wipe(data);
+
+        if (useCache) {
+            QMutexLocker locker(&g_mutex);
+            g_cache.insert(nonce, new QString(plainText));
+        }
+        return plainText;
+    }
+} // namespace
+
+bool MemoryCipher::isEnabled()
+{
+    return g_enabled.load() && Crypto::initalized();
+}
+
+/**
+ * Toggle encryption of new values, already encrypted values stay readable.
+ */
+void MemoryCipher::setEnabled(bool enabled)
+{
+    g_enabled.store(enabled ? 1 : 0);
+}
+
+/**
+ * Encrypt a value, the result starts with the nonce followed by the
+ * UTF-8 encoded cipher text.
+ *
+ * @return the encrypted value or an empty array on failure
+ */
+QByteArray MemoryCipher::encrypt(const QString& plainText)
+{
+    Q_ASSERT(isEnabled());
+
+    const quint64 nonce = g_nonceCounter.fetchAndAddRelaxed(1) + 1;
+    QByteArray nonceData(reinterpret_cast<const char*>(&nonce), NonceSize);
+
+    QByteArray data = plainText.toUtf8();
+    if (!applyKeyStream(data, nonceData)) {
+        wipe(data);
+        return QByteArray();
+    }
+
+    return nonceData.append(data);
+}
+
+QString MemoryCipher::decrypt(const QByteArray& cipherText)
+{
+    return decryptValue(cipherText, true);
+}
+
+/**
+ * Decrypt a value without looking it up in or adding it to the cache.
+ * Meant for passes over all values, like saving a database, which would
+ * otherwise leave plain text of values nobody looked at in the cache.
+ */
+QString MemoryCipher::decryptUncached(const QByteArray& cipherText)
+{
+    return decryptValue(cipherText, false);
+}
+
+/**
+ * Size of the UTF-8 encoded plain text, without decrypting it.
+ */
+int MemoryCipher::plainTextSize(const QByteArray& cipherText)
+{
+    return qMax(0, cipherText.size() - NonceSize);
+}
+
+/**
+ * Set the number of decrypted values kept in the cache, 0 disables it.
+ */
+void MemoryCipher::setCacheSize(int size)
+{
+    QMutexLocker locker(&g_mutex);
+    g_cache.setMaxCost(qMax(0, size));
+}
+
+/**
+ * Drop all decrypted values, e.g. when a database is locked or closed.
+ */
+void MemoryCipher::clearCache()
+{
+    QMutexLocker locker(&g_mutex);
+    g_cache.clear();
+}
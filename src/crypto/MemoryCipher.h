@@ -0,0 +1,51 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_MEMORYCIPHER_H
+#define KEEPASSX_MEMORYCIPHER_H
+
+#include <QByteArray>
+#include <QString>
+
+/**
+ * Encrypts sensitive values kept in memory, e.g. protected entry attributes,
+ * with ChaCha20 under a random per-session key.
+ *
+ * Every encrypted value carries a unique 64 bit nonce. Recently decrypted
+ * values are kept in a small LRU cache so repeated lookups stay cheap.
+ * Encryption is only available once Crypto::init() succeeded, values are
+ * passed through unencrypted before that or while it is disabled.
+ */
+class MemoryCipher
+{
+public:
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+
+    static QByteArray encrypt(const QString& plainText);
+    static QString decrypt(const QByteArray& cipherText);
+    static QString decryptUncached(const QByteArray& cipherText);
+    static int plainTextSize(const QByteArray& cipherText);
+
+    static void setCacheSize(int size);
+    static void clearCache();
+
+private:
+    MemoryCipher();
+};
+
+#endif // KEEPASSX_MEMORYCIPHER_H
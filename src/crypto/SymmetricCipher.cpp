@@ -18,7 +18,11 @@
 #include "SymmetricCipher.h"
 
 #include "config-keepassx.h"
+#include "crypto/Crypto.h"
 #include "crypto/SymmetricCipherGcrypt.h"
+#ifdef WITH_XC_CRYPTO_SODIUM
+#include "crypto/SymmetricCipherSodium.h"
+#endif
 
 #include <QDebug>
 
@@ -58,6 +62,12 @@ bool SymmetricCipher::isInitalized() const
 
 SymmetricCipherBackend* SymmetricCipher::createBackend(Algorithm algo, Mode mode, Direction direction)
 {
+#ifdef WITH_XC_CRYPTO_SODIUM
+    if (Crypto::backend() == Crypto::Sodium && SymmetricCipherSodium::isSupported(algo, mode)) {
+        return new SymmetricCipherSodium(algo);
+    }
+#endif
+
     switch (algo) {
     case Aes128:
     case Aes256:
@@ -71,6 +71,11 @@ public:
         return m_backend->processInPlace(data);
     }
 
+    Q_REQUIRED_RESULT inline bool processInPlace(char* data, int size)
+    {
+        return m_backend->processInPlace(data, size);
+    }
+
     Q_REQUIRED_RESULT inline bool processInPlace(QByteArray& data, quint64 rounds)
     {
         Q_ASSERT(rounds > 0);
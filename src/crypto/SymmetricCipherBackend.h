@@ -32,6 +32,7 @@ public:
 
     virtual QByteArray process(const QByteArray& data, bool* ok) = 0;
     Q_REQUIRED_RESULT virtual bool processInPlace(QByteArray& data) = 0;
+    Q_REQUIRED_RESULT virtual bool processInPlace(char* data, int size) = 0;
     Q_REQUIRED_RESULT virtual bool processInPlace(QByteArray& data, quint64 rounds) = 0;
 
     virtual bool reset() = 0;
@@ -164,15 +164,20 @@ QByteArray SymmetricCipherGcrypt::process(const QByteArray& data, bool* ok)
 }
 
 bool SymmetricCipherGcrypt::processInPlace(QByteArray& data)
+{
+    return processInPlace(data.data(), data.size());
+}
+
+bool SymmetricCipherGcrypt::processInPlace(char* data, int size)
 {
     // TODO: check block size
 
     gcry_error_t error;
 
     if (m_direction == SymmetricCipher::Decrypt) {
-        error = gcry_cipher_decrypt(m_ctx, data.data(), data.size(), nullptr, 0);
+        error = gcry_cipher_decrypt(m_ctx, data, static_cast<size_t>(size), nullptr, 0);
     } else {
-        error = gcry_cipher_encrypt(m_ctx, data.data(), data.size(), nullptr, 0);
+        error = gcry_cipher_encrypt(m_ctx, data, static_cast<size_t>(size), nullptr, 0);
     }
 
     if (error != 0) {
@@ -0,0 +1,200 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SymmetricCipherSodium.h"
+
+#include <sodium.h>
+
+#include "crypto/Crypto.h"
+
+SymmetricCipherSodium::SymmetricCipherSodium(SymmetricCipher::Algorithm algo)
+    : m_algo(algo)
+    , m_counter(0)
+    , m_keystreamPos(KeystreamBlockSize)
+{
+    Q_ASSERT(isSupported(algo, SymmetricCipher::Stream));
+}
+
+SymmetricCipherSodium::~SymmetricCipherSodium()
+{
+    sodium_memzero(m_key.data(), static_cast<size_t>(m_key.size()));
+    clearKeystream();
+}
+
+bool SymmetricCipherSodium::isSupported(SymmetricCipher::Algorithm algo, SymmetricCipher::Mode mode)
+{
+    return mode == SymmetricCipher::Stream && (algo == SymmetricCipher::Salsa20 || algo == SymmetricCipher::ChaCha20);
+}
+
+bool SymmetricCipherSodium::init()
+{
+    Q_ASSERT(Crypto::initalized());
+
+    m_counter = 0;
+    clearKeystream();
+    return true;
+}
+
+bool SymmetricCipherSodium::setKey(const QByteArray& key)
+{
+    // both crypto_stream_salsa20_KEYBYTES and crypto_stream_chacha20_KEYBYTES
+    if (key.size() != keySize()) {
+        m_errorString = QString("libsodium/Invalid key length %1").arg(key.size());
+        return false;
+    }
+
+    sodium_memzero(m_key.data(), static_cast<size_t>(m_key.size()));
+    m_key = key;
+    return true;
+}
+
+bool SymmetricCipherSodium::setIv(const QByteArray& iv)
+{
+    const auto ivSize = static_cast<size_t>(iv.size());
+    bool valid;
+    if (m_algo == SymmetricCipher::Salsa20) {
+        valid = ivSize == crypto_stream_salsa20_NONCEBYTES;
+    } else {
+        valid = ivSize == crypto_stream_chacha20_NONCEBYTES || ivSize == crypto_stream_chacha20_ietf_NONCEBYTES;
+    }
+
+    if (!valid) {
+        m_errorString = QString("libsodium/Invalid IV length %1").arg(iv.size());
+        return false;
+    }
+
+    m_iv = iv;
+    return reset();
+}
+
+QByteArray SymmetricCipherSodium::process(const QByteArray& data, bool* ok)
+{
+    QByteArray result = data;
+    *ok = processInPlace(result);
+    return result;
+}
+
+bool SymmetricCipherSodium::processInPlace(QByteArray& data)
+{
+    return processInPlace(data.data(), data.size());
+}
+
+bool SymmetricCipherSodium::processInPlace(char* data, int size)
+{
+    auto bytes = reinterpret_cast<unsigned char*>(data);
+    auto remaining = static_cast<quint64>(qMax(0, size));
+
+    // use up the key stream block left over from the previous call
+    while (remaining > 0 && m_keystreamPos < KeystreamBlockSize) {
+        *bytes++ ^= m_keystream[m_keystreamPos++];
+        --remaining;
+    }
+
+    const quint64 wholeBlocks = remaining - remaining % KeystreamBlockSize;
+    if (wholeBlocks > 0) {
+        if (!xorBlocks(bytes, wholeBlocks)) {
+            return false;
+        }
+        bytes += wholeBlocks;
+        remaining -= wholeBlocks;
+    }
+
+    if (remaining > 0) {
+        sodium_memzero(m_keystream, KeystreamBlockSize);
+        if (!xorBlocks(m_keystream, KeystreamBlockSize)) {
+            return false;
+        }
+        for (quint64 i = 0; i < remaining; ++i) {
+            bytes[i] ^= m_keystream[i];
+        }
+        m_keystreamPos = static_cast<int>(remaining);
+    }
+
+    return true;
+}
+
+bool SymmetricCipherSodium::processInPlace(QByteArray& data, quint64 rounds)
+{
+    for (quint64 i = 0; i != rounds; ++i) {
+        if (!processInPlace(data.data(), data.size())) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Xor size bytes of data with the key stream starting at the current block.
+ */
+bool SymmetricCipherSodium::xorBlocks(unsigned char* data, quint64 size)
+{
+    const auto key = reinterpret_cast<const unsigned char*>(m_key.constData());
+    const auto nonce = reinterpret_cast<const unsigned char*>(m_iv.constData());
+    const quint64 blocks = (size + KeystreamBlockSize - 1) / KeystreamBlockSize;
+    int error;
+
+    if (m_algo == SymmetricCipher::Salsa20) {
+        error = crypto_stream_salsa20_xor_ic(data, data, size, nonce, m_counter, key);
+    } else if (static_cast<size_t>(m_iv.size()) == crypto_stream_chacha20_ietf_NONCEBYTES) {
+        // the block counter of RFC 7539 is only 32 bits wide
+        if (m_counter + blocks > Q_UINT64_C(0x100000000)) {
+            m_errorString = "libsodium/ChaCha20 block counter exhausted";
+            return false;
+        }
+        error = crypto_stream_chacha20_ietf_xor_ic(data, data, size, nonce, static_cast<quint32>(m_counter), key);
+    } else {
+        error = crypto_stream_chacha20_xor_ic(data, data, size, nonce, m_counter, key);
+    }
+
+    if (error != 0) {
+        m_errorString = "libsodium/Stream cipher failure";
+        return false;
+    }
+
+    m_counter += blocks;
+    return true;
+}
+
+void SymmetricCipherSodium::clearKeystream()
+{
+    sodium_memzero(m_keystream, KeystreamBlockSize);
+    m_keystreamPos = KeystreamBlockSize;
+}
+
+bool SymmetricCipherSodium::reset()
+{
+    m_counter = 0;
+    clearKeystream();
+    return true;
+}
+
+int SymmetricCipherSodium::keySize() const
+{
+    return 32;
+}
+
+int SymmetricCipherSodium::blockSize() const
+{
+    // stream ciphers process data byte by byte, like libgcrypt reports them
+    return 1;
+}
+
+QString SymmetricCipherSodium::errorString() const
+{
+    return m_errorString;
+}
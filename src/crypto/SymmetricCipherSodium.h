@@ -0,0 +1,68 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_SYMMETRICCIPHERSODIUM_H
+#define KEEPASSX_SYMMETRICCIPHERSODIUM_H
+
+#include "crypto/SymmetricCipher.h"
+#include "crypto/SymmetricCipherBackend.h"
+
+/**
+ * Salsa20 and ChaCha20 stream ciphers implemented with libsodium.
+ *
+ * ChaCha20 accepts both the original 64 bit nonce and the 96 bit nonce
+ * of RFC 7539. Encryption and decryption are the same operation.
+ */
+class SymmetricCipherSodium : public SymmetricCipherBackend
+{
+public:
+    explicit SymmetricCipherSodium(SymmetricCipher::Algorithm algo);
+    ~SymmetricCipherSodium();
+
+    static bool isSupported(SymmetricCipher::Algorithm algo, SymmetricCipher::Mode mode);
+
+    bool init();
+    bool setKey(const QByteArray& key);
+    bool setIv(const QByteArray& iv);
+
+    QByteArray process(const QByteArray& data, bool* ok);
+    Q_REQUIRED_RESULT bool processInPlace(QByteArray& data);
+    Q_REQUIRED_RESULT bool processInPlace(char* data, int size);
+    Q_REQUIRED_RESULT bool processInPlace(QByteArray& data, quint64 rounds);
+
+    bool reset();
+    int keySize() const;
+    int blockSize() const;
+
+    QString errorString() const;
+
+private:
+    static const int KeystreamBlockSize = 64;
+
+    bool xorBlocks(unsigned char* data, quint64 size);
+    void clearKeystream();
+
+    const SymmetricCipher::Algorithm m_algo;
+    QByteArray m_key;
+    QByteArray m_iv;
+    quint64 m_counter;
+    unsigned char m_keystream[KeystreamBlockSize];
+    int m_keystreamPos;
+    QString m_errorString;
+};
+
+#endif // KEEPASSX_SYMMETRICCIPHERSODIUM_H
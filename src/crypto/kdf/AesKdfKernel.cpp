@@ -0,0 +1,137 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AesKdfKernel.h"
+
+#include <QtGlobal>
+
+#if defined(Q_PROCESSOR_X86_64) && defined(Q_CC_GNU)
+#define WITH_AESNI_KERNEL
+#include <cpuid.h>
+#include <wmmintrin.h>
+#endif
+
+#ifdef WITH_AESNI_KERNEL
+#define AESNI_TARGET __attribute__((target("aes,sse2")))
+
+namespace
+{
+    AESNI_TARGET inline __m128i expandKey(__m128i key, __m128i assist)
+    {
+        key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+        key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+        key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+        return _mm_xor_si128(key, assist);
+    }
+
+    // the round constant of aeskeygenassist has to be an immediate
+#define AESNI_EXPAND_EVEN(prev2, prev1, rcon)                                                                         \
+    expandKey(prev2, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(prev1, rcon), 0xff))
+#define AESNI_EXPAND_ODD(prev2, prev1) expandKey(prev2, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(prev1, 0x00), 0xaa))
+
+    AESNI_TARGET void expandKey256(const char* seed, __m128i* keys)
+    {
+        keys[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(seed));
+        keys[1] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(seed + 16));
+        keys[2] = AESNI_EXPAND_EVEN(keys[0], keys[1], 0x01);
+        keys[3] = AESNI_EXPAND_ODD(keys[1], keys[2]);
+        keys[4] = AESNI_EXPAND_EVEN(keys[2], keys[3], 0x02);
+        keys[5] = AESNI_EXPAND_ODD(keys[3], keys[4]);
+        keys[6] = AESNI_EXPAND_EVEN(keys[4], keys[5], 0x04);
+        keys[7] = AESNI_EXPAND_ODD(keys[5], keys[6]);
+        keys[8] = AESNI_EXPAND_EVEN(keys[6], keys[7], 0x08);
+        keys[9] = AESNI_EXPAND_ODD(keys[7], keys[8]);
+        keys[10] = AESNI_EXPAND_EVEN(keys[8], keys[9], 0x10);
+        keys[11] = AESNI_EXPAND_ODD(keys[9], keys[10]);
+        keys[12] = AESNI_EXPAND_EVEN(keys[10], keys[11], 0x20);
+        keys[13] = AESNI_EXPAND_ODD(keys[11], keys[12]);
+        keys[14] = AESNI_EXPAND_EVEN(keys[12], keys[13], 0x40);
+    }
+
+#undef AESNI_EXPAND_EVEN
+#undef AESNI_EXPAND_ODD
+
+    AESNI_TARGET void encryptRounds(const char* seed, char* data, quint64 rounds)
+    {
+        __m128i keys[15];
+        expandKey256(seed, keys);
+
+        // independent halves, each instruction of one half overlaps with the other
+        __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+
+        for (quint64 i = 0; i < rounds; ++i) {
+            left = _mm_xor_si128(left, keys[0]);
+            right = _mm_xor_si128(right, keys[0]);
+            for (int j = 1; j < 14; ++j) {
+                left = _mm_aesenc_si128(left, keys[j]);
+                right = _mm_aesenc_si128(right, keys[j]);
+            }
+            left = _mm_aesenclast_si128(left, keys[14]);
+            right = _mm_aesenclast_si128(right, keys[14]);
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data), left);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + 16), right);
+
+        // don't leave the key schedule on the stack
+        volatile char* schedule = reinterpret_cast<volatile char*>(keys);
+        for (size_t i = 0; i < sizeof(keys); ++i) {
+            schedule[i] = 0;
+        }
+    }
+} // namespace
+#endif
+
+/**
+ * @return true if the CPU supports the accelerated kernel
+ */
+bool AesKdfKernel::isSupported()
+{
+#ifdef WITH_AESNI_KERNEL
+    static const bool supported = [] {
+        unsigned int eax, ebx, ecx, edx;
+        return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_AES);
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Encrypt both halves of data rounds times with AES-256.
+ *
+ * @param seed 32 byte AES key
+ * @param data 32 byte key to transform in place
+ * @param rounds number of encryption rounds
+ * @return false if the kernel isn't supported or the sizes are invalid
+ */
+bool AesKdfKernel::transform(const QByteArray& seed, QByteArray& data, quint64 rounds)
+{
+    if (!isSupported() || seed.size() != 32 || data.size() != 32) {
+        return false;
+    }
+
+#ifdef WITH_AESNI_KERNEL
+    encryptRounds(seed.constData(), data.data(), rounds);
+    return true;
+#else
+    Q_UNUSED(rounds);
+    return false;
+#endif
+}
@@ -0,0 +1,37 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSXC_AESKDFKERNEL_H
+#define KEEPASSXC_AESKDFKERNEL_H
+
+#include <QByteArray>
+
+/**
+ * Hardware accelerated AES-KDF rounds.
+ *
+ * The kernel encrypts both 16 byte halves of the key with AES-256 in
+ * ECB mode on a single core. The expanded key schedule stays in
+ * registers and the two halves are interleaved to hide the latency
+ * of the AES instructions.
+ */
+namespace AesKdfKernel
+{
+    bool isSupported();
+    bool transform(const QByteArray& seed, QByteArray& data, quint64 rounds) Q_REQUIRED_RESULT;
+} // namespace AesKdfKernel
+
+#endif // KEEPASSXC_AESKDFKERNEL_H
@@ -0,0 +1,289 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Argon2Tuner.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+
+#include "crypto/kdf/Argon2Kdf.h"
+
+#ifdef Q_OS_LINUX
+#include <QFile>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+    struct MemoryUsage
+    {
+        qint64 rss = -1; // KiB
+        qint64 peakRss = -1; // KiB
+    };
+
+    /**
+     * Current and peak resident set size of the process.
+     */
+    MemoryUsage memoryUsage()
+    {
+        MemoryUsage usage;
+#ifdef Q_OS_LINUX
+        QFile status("/proc/self/status");
+        if (status.open(QIODevice::ReadOnly)) {
+            const QList<QByteArray> lines = status.readAll().split('\n');
+            for (const QByteArray& line : lines) {
+                const QList<QByteArray> fields = line.simplified().split(' ');
+                if (fields.size() < 2) {
+                    continue;
+                }
+                if (fields.at(0) == "VmRSS:") {
+                    usage.rss = fields.at(1).toLongLong();
+                } else if (fields.at(0) == "VmHWM:") {
+                    usage.peakRss = fields.at(1).toLongLong();
+                }
+            }
+        }
+#elif defined(Q_OS_UNIX)
+        struct rusage resourceUsage;
+        if (getrusage(RUSAGE_SELF, &resourceUsage) == 0) {
+#ifdef Q_OS_MACOS
+            usage.peakRss = resourceUsage.ru_maxrss / 1024;
+#else
+            usage.peakRss = resourceUsage.ru_maxrss;
+#endif
+        }
+#endif
+        return usage;
+    }
+
+    /**
+     * Reset the peak resident set size to the current one, so the peak of
+     * the next run can be told apart from earlier runs.
+     */
+    bool resetPeakRss()
+    {
+#ifdef Q_OS_LINUX
+        QFile clearRefs("/proc/self/clear_refs");
+        return clearRefs.open(QIODevice::WriteOnly | QIODevice::Unbuffered) && clearRefs.write("5") == 1;
+#else
+        return false;
+#endif
+    }
+} // namespace
+
+/**
+ * Memory the run needed in KiB: the growth of the resident set if it has
+ * been measured, the Argon2 memory size otherwise.
+ */
+quint64 Argon2Tuner::Measurement::memoryUsed() const
+{
+    if (startRss >= 0 && peakRss >= startRss) {
+        return static_cast<quint64>(peakRss - startRss);
+    }
+    return parameters.memory;
+}
+
+/**
+ * @param targetMsec unlock time the recommendation must not exceed
+ */
+Argon2Tuner::Argon2Tuner(int targetMsec)
+    : m_targetMsec(qMax(1, targetMsec))
+    , m_minMemory(16 * 1024)
+    , m_maxMemory(1024 * 1024)
+    , m_maxParallelism(static_cast<quint32>(qMax(1, QThread::idealThreadCount())))
+    , m_memoryBudget(0)
+{
+}
+
+/**
+ * Set the memory sizes to sweep in KiB, the sweep doubles the size
+ * starting at minMemory.
+ */
+void Argon2Tuner::setMemoryRange(quint64 minMemory, quint64 maxMemory)
+{
+    m_minMemory = qMax(Q_UINT64_C(8), minMemory);
+    m_maxMemory = qMax(m_minMemory, maxMemory);
+}
+
+void Argon2Tuner::setMaxParallelism(quint32 parallelism)
+{
+    m_maxParallelism = qMax(1u, parallelism);
+}
+
+/**
+ * Set the memory in KiB a recommended parameter set may use, 0 for no limit.
+ */
+void Argon2Tuner::setMemoryBudget(quint64 budget)
+{
+    m_memoryBudget = budget;
+}
+
+/**
+ * Called after every measurement, e.g. to report progress.
+ * The callback is invoked on the thread running tune().
+ */
+void Argon2Tuner::setProgressCallback(std::function<void(const Measurement&)> callback)
+{
+    m_progressCallback = callback;
+}
+
+/**
+ * Run the benchmark, this takes several times the target unlock time.
+ *
+ * @return true if a recommendation was found
+ */
+bool Argon2Tuner::tune()
+{
+    m_measurements.clear();
+    m_recommendation = Measurement();
+
+    Parameters best;
+    double bestMsec = 0;
+    for (quint32 lanes : laneCounts()) {
+        for (quint64 memory = m_minMemory; memory <= m_maxMemory; memory *= 2) {
+            Parameters parameters;
+            parameters.memory = qMax(memory, Q_UINT64_C(8) * lanes);
+            parameters.parallelism = lanes;
+            parameters.iterations = 1;
+            if (m_memoryBudget > 0 && parameters.memory > m_memoryBudget) {
+                break;
+            }
+
+            Measurement measurement;
+            if (!measure(parameters, measurement)) {
+                return false;
+            }
+            if (measurement.msec > m_targetMsec) {
+                // larger memory sizes with this lane count are even slower
+                break;
+            }
+            if (m_memoryBudget > 0 && measurement.memoryUsed() > m_memoryBudget) {
+                // larger memory sizes with this lane count need even more
+                break;
+            }
+
+            parameters.iterations = qMax(1, static_cast<int>(m_targetMsec / qMax(measurement.msec, 0.001)));
+            const double estimatedMsec = measurement.msec * parameters.iterations;
+
+            // memory hardness matters most, small sizes also profit from CPU caches
+            bool better;
+            if (parameters.memory != best.memory) {
+                better = parameters.memory > best.memory;
+            } else if (parameters.iterations != best.iterations) {
+                better = parameters.iterations > best.iterations;
+            } else {
+                better = estimatedMsec < bestMsec;
+            }
+
+            if (better) {
+                best = parameters;
+                bestMsec = estimatedMsec;
+            }
+        }
+    }
+
+    if (best.iterations < 1) {
+        return false;
+    }
+
+    // the estimate ignores fixed costs, measure and adjust the real thing
+    Measurement measurement;
+    for (int attempt = 0; attempt < 8; ++attempt) {
+        if (!measure(best, measurement)) {
+            return false;
+        }
+        if (measurement.msec <= m_targetMsec || best.iterations == 1) {
+            break;
+        }
+
+        int iterations = static_cast<int>(best.iterations * m_targetMsec / measurement.msec);
+        best.iterations = qBound(1, iterations, best.iterations - 1);
+    }
+
+    m_recommendation = measurement;
+    return true;
+}
+
+/**
+ * @return verified parameters of the last tune() call
+ */
+Argon2Tuner::Measurement Argon2Tuner::recommendation() const
+{
+    return m_recommendation;
+}
+
+/**
+ * @return all measurements of the last tune() call in the order they were taken
+ */
+QList<Argon2Tuner::Measurement> Argon2Tuner::measurements() const
+{
+    return m_measurements;
+}
+
+bool Argon2Tuner::measure(const Parameters& parameters, Measurement& measurement)
+{
+    Argon2Kdf kdf;
+    if (!kdf.setMemory(parameters.memory) || !kdf.setParallelism(parameters.parallelism)
+        || !kdf.setRounds(parameters.iterations)) {
+        return false;
+    }
+
+    QByteArray key(32, '\x7E');
+    QByteArray result;
+
+    // Without a reset the peak covers the whole life of the process, it
+    // only belongs to this run if the run raised it.
+    const bool peakReset = resetPeakRss();
+    const MemoryUsage before = memoryUsage();
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!kdf.transform(key, result)) {
+        return false;
+    }
+    const double msec = timer.nsecsElapsed() / 1000000.0;
+
+    const MemoryUsage after = memoryUsage();
+
+    measurement = Measurement();
+    measurement.parameters = parameters;
+    measurement.msec = msec;
+    measurement.startRss = before.rss;
+    if (peakReset || after.peakRss > before.peakRss) {
+        measurement.peakRss = after.peakRss;
+    }
+    m_measurements.append(measurement);
+
+    if (m_progressCallback) {
+        m_progressCallback(measurement);
+    }
+    return true;
+}
+
+/**
+ * Lane counts to sweep: powers of two up to and including the maximum.
+ */
+QList<quint32> Argon2Tuner::laneCounts() const
+{
+    QList<quint32> lanes;
+    for (quint32 count = 1; count < m_maxParallelism; count *= 2) {
+        lanes.append(count);
+    }
+    lanes.append(m_maxParallelism);
+    return lanes;
+}
@@ -0,0 +1,84 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSXC_ARGON2TUNER_H
+#define KEEPASSXC_ARGON2TUNER_H
+
+#include <QList>
+
+#include <functional>
+
+/**
+ * Recommends Argon2 parameters for the current machine.
+ *
+ * The tuner sweeps memory sizes and lane counts, measures the wall time
+ * of a single iteration for each combination and derives the number of
+ * iterations that fits into the target unlock time. The strongest
+ * combination, i.e. the largest memory size and then the most iterations,
+ * is measured again with its real iteration count and adjusted until it
+ * meets the target.
+ *
+ * Each run also records the peak resident set size of the process while
+ * it was running. Parameter sets whose run needed more memory than the
+ * memory budget are never recommended.
+ */
+class Argon2Tuner
+{
+public:
+    struct Parameters
+    {
+        quint64 memory = 0; // KiB
+        quint32 parallelism = 0;
+        int iterations = 0;
+    };
+
+    struct Measurement
+    {
+        Parameters parameters;
+        double msec = -1;
+        qint64 startRss = -1; // KiB before the run, -1 if unknown
+        qint64 peakRss = -1; // KiB at the peak of the run, -1 if unknown
+
+        quint64 memoryUsed() const;
+    };
+
+    explicit Argon2Tuner(int targetMsec = 1000);
+
+    void setMemoryRange(quint64 minMemory, quint64 maxMemory);
+    void setMaxParallelism(quint32 parallelism);
+    void setMemoryBudget(quint64 budget);
+    void setProgressCallback(std::function<void(const Measurement&)> callback);
+
+    bool tune();
+    Measurement recommendation() const;
+    QList<Measurement> measurements() const;
+
+private:
+    bool measure(const Parameters& parameters, Measurement& measurement);
+    QList<quint32> laneCounts() const;
+
+    int m_targetMsec;
+    quint64 m_minMemory;
+    quint64 m_maxMemory;
+    quint32 m_maxParallelism;
+    quint64 m_memoryBudget;
+    std::function<void(const Measurement&)> m_progressCallback;
+    QList<Measurement> m_measurements;
+    Measurement m_recommendation;
+};
+
+#endif // KEEPASSXC_ARGON2TUNER_H
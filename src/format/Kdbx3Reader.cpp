@@ -48,7 +48,7 @@ Database* Kdbx3Reader::readDatabaseImpl(QIODevice* device,
         return nullptr;
     }
 
-    if (!m_db->setKey(key, false)) {
+    if (!setDatabaseKey(key)) {
         raiseError(tr("Unable to calculate master key"));
         return nullptr;
     }
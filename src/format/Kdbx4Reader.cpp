@@ -19,15 +19,22 @@
 
 #include <QBuffer>
 
+#include "core/AttachmentPool.h"
 #include "core/Endian.h"
 #include "core/Group.h"
 #include "crypto/CryptoHash.h"
 #include "format/KdbxXmlReader.h"
 #include "format/KeePass2RandomStream.h"
 #include "streams/HmacBlockStream.h"
+#include "streams/PipelineStream.h"
 #include "streams/QtIOCompressor"
 #include "streams/SymmetricCipherStream.h"
 
+Kdbx4Reader::~Kdbx4Reader()
+{
+    releaseBinaryContentIds();
+}
+
 Database* Kdbx4Reader::readDatabaseImpl(QIODevice* device,
                                         const QByteArray& headerData,
                                         const CompositeKey& key,
@@ -36,6 +43,7 @@ Database* Kdbx4Reader::readDatabaseImpl(QIODevice* device,
     Q_ASSERT(m_kdbxVersion == KeePass2::FILE_VERSION_4);
 
     m_binaryPoolInverse.clear();
+    releaseBinaryContentIds();
 
     if (hasError()) {
         return nullptr;
@@ -47,7 +55,7 @@ Database* Kdbx4Reader::readDatabaseImpl(QIODevice* device,
         return nullptr;
     }
 
-    if (!m_db->setKey(key, false, false)) {
+    if (!setDatabaseKey(key)) {
         raiseError(tr("Unable to calculate master key"));
         return nullptr;
     }
@@ -80,13 +88,22 @@ Database* Kdbx4Reader::readDatabaseImpl(QIODevice* device,
         return nullptr;
     }
 
+    // In pipelined mode every stage reads ahead on its own thread:
+    // HMAC verification, decryption, decompression and the XML parser
+    // (on the calling thread) work on different parts of the payload.
+    QScopedPointer<PipelineStream> hmacPipeline;
+    QIODevice* cipherDevice = openPipelineStage(&hmacStream, hmacPipeline);
+    if (!cipherDevice) {
+        return nullptr;
+    }
+
     SymmetricCipher::Algorithm cipher = SymmetricCipher::cipherToAlgorithm(m_db->cipher());
     if (cipher == SymmetricCipher::InvalidAlgorithm) {
         raiseError(tr("Unknown cipher"));
         return nullptr;
     }
     SymmetricCipherStream cipherStream(
-        &hmacStream, cipher, SymmetricCipher::algorithmMode(cipher), SymmetricCipher::Decrypt);
+        cipherDevice, cipher, SymmetricCipher::algorithmMode(cipher), SymmetricCipher::Decrypt);
     if (!cipherStream.init(finalKey, m_encryptionIV)) {
         raiseError(cipherStream.errorString());
         return nullptr;
@@ -96,19 +113,26 @@ Database* Kdbx4Reader::readDatabaseImpl(QIODevice* device,
         return nullptr;
     }
 
-    QIODevice* xmlDevice = nullptr;
+    QScopedPointer<PipelineStream> cipherPipeline;
+    QIODevice* xmlDevice = openPipelineStage(&cipherStream, cipherPipeline);
+    if (!xmlDevice) {
+        return nullptr;
+    }
+
     QScopedPointer<QtIOCompressor> ioCompressor;
+    QScopedPointer<PipelineStream> compressorPipeline;
 
-    if (m_db->compressionAlgo() == Database::CompressionNone) {
-        xmlDevice = &cipherStream;
-    } else {
-        ioCompressor.reset(new QtIOCompressor(&cipherStream));
+    if (m_db->compressionAlgo() != Database::CompressionNone) {
+        ioCompressor.reset(new QtIOCompressor(xmlDevice));
         ioCompressor->setStreamFormat(QtIOCompressor::GzipFormat);
         if (!ioCompressor->open(QIODevice::ReadOnly)) {
             raiseError(ioCompressor->errorString());
             return nullptr;
         }
-        xmlDevice = ioCompressor.data();
+        xmlDevice = openPipelineStage(ioCompressor.data(), compressorPipeline);
+        if (!xmlDevice) {
+            return nullptr;
+        }
     }
 
     while (readInnerHeaderField(xmlDevice) && !hasError()) {
@@ -135,6 +159,7 @@ Database* Kdbx4Reader::readDatabaseImpl(QIODevice* device,
     Q_ASSERT(xmlDevice);
 
     KdbxXmlReader xmlReader(KeePass2::FILE_VERSION_4, binaryPool());
+    xmlReader.setBinaryContentIds(binaryContentIds());
     xmlReader.readDatabase(xmlDevice, m_db.data(), &randomStream);
 
     if (xmlReader.hasError()) {
@@ -148,6 +173,28 @@ Database* Kdbx4Reader::readDatabaseImpl(QIODevice* device,
     return m_db.take();
 }
 
+/**
+ * Put a pipeline stage on top of a stream if the reader is pipelined.
+ *
+ * @param device opened stream of the previous stage
+ * @param pipeline receives the pipeline stream
+ * @return device to read the stage output from, nullptr on failure
+ */
+QIODevice* Kdbx4Reader::openPipelineStage(QIODevice* device, QScopedPointer<PipelineStream>& pipeline)
+{
+    if (!pipelined()) {
+        return device;
+    }
+
+    pipeline.reset(new PipelineStream(device));
+    if (!pipeline->open(QIODevice::ReadOnly)) {
+        raiseError(pipeline->errorString());
+        return nullptr;
+    }
+
+    return pipeline.data();
+}
+
 bool Kdbx4Reader::readHeaderField(StoreDataStream& device)
 {
     QByteArray fieldIDArray = device.read(1);
@@ -256,6 +303,10 @@ bool Kdbx4Reader::readInnerHeaderField(QIODevice* device)
         return false;
     }
 
+    if (fieldID == KeePass2::InnerHeaderFieldID::Binary) {
+        return readInnerHeaderBinary(device, fieldLen);
+    }
+
     QByteArray fieldData;
     if (fieldLen != 0) {
         fieldData = device->read(fieldLen);
@@ -277,24 +328,72 @@ bool Kdbx4Reader::readInnerHeaderField(QIODevice* device)
         setProtectedStreamKey(fieldData);
         break;
 
-    case KeePass2::InnerHeaderFieldID::Binary: {
-        if (fieldLen < 1) {
-            raiseError(tr("Invalid inner header binary size"));
-            return false;
-        }
-        auto data = fieldData.mid(1);
-        if (m_binaryPoolInverse.contains(data)) {
-            qWarning("Skipping duplicate binary record");
-            break;
-        }
-        m_binaryPoolInverse.insert(data, QString::number(m_binaryPoolInverse.size()));
+    case KeePass2::InnerHeaderFieldID::Binary:
+        // handled by readInnerHeaderBinary()
         break;
     }
+
+    return true;
+}
+
+/**
+ * Read the value of a binary inner header field.
+ *
+ * The flags byte is read separately, so the binary data ends up in the pool
+ * without being copied out of the field data.
+ *
+ * @param device input device
+ * @param fieldLen length of the field including the flags byte
+ * @return true if the binary was read successfully
+ */
+bool Kdbx4Reader::readInnerHeaderBinary(QIODevice* device, quint32 fieldLen)
+{
+    if (fieldLen < 1) {
+        raiseError(tr("Invalid inner header binary size"));
+        return false;
     }
 
+    char flags;
+    if (!device->getChar(&flags)) {
+        raiseError(tr("Invalid header data length"));
+        return false;
+    }
+
+    const QByteArray data = device->read(fieldLen - 1);
+    if (static_cast<quint32>(data.size()) != fieldLen - 1) {
+        raiseError(tr("Invalid header data length"));
+        return false;
+    }
+
+    const QString key = QString::number(m_binaryPoolInverse.size() + m_binaryContentIds.size());
+
+    if (lazyAttachments()) {
+        const QByteArray id = AttachmentPool::instance()->addSpilled(data);
+        if (m_binaryContentIds.contains(id)) {
+            AttachmentPool::instance()->release(id);
+            qWarning("Skipping duplicate binary record");
+            return true;
+        }
+        m_binaryContentIds.insert(id, key);
+        return true;
+    }
+
+    if (m_binaryPoolInverse.contains(data)) {
+        qWarning("Skipping duplicate binary record");
+        return true;
+    }
+    m_binaryPoolInverse.insert(data, key);
     return true;
 }
 
+void Kdbx4Reader::releaseBinaryContentIds()
+{
+    for (auto it = m_binaryContentIds.cbegin(); it != m_binaryContentIds.cend(); ++it) {
+        AttachmentPool::instance()->release(it.key());
+    }
+    m_binaryContentIds.clear();
+}
+
 /**
  * Helper method for reading a serialized variant map.
  *
@@ -439,6 +538,20 @@ QHash<QString, QByteArray> Kdbx4Reader::binaryPool() const
     return binaryPool;
 }
 
+/**
+ * Binaries that were spilled to the AttachmentPool in lazy mode.
+ *
+ * @return mapping from attachment keys to AttachmentPool content ids
+ */
+QHash<QString, QByteArray> Kdbx4Reader::binaryContentIds() const
+{
+    QHash<QString, QByteArray> contentIds;
+    for (auto it = m_binaryContentIds.cbegin(); it != m_binaryContentIds.cend(); ++it) {
+        contentIds.insert(it.value(), it.key());
+    }
+    return contentIds;
+}
+
 /**
  * @return mapping from binary data to attachment keys
  */
@@ -20,8 +20,11 @@
 
 #include "format/KdbxReader.h"
 
+#include <QScopedPointer>
 #include <QVariantMap>
 
+class PipelineStream;
+
 /**
  * KDBX4 reader implementation.
  */
@@ -30,21 +33,29 @@ class Kdbx4Reader : public KdbxReader
     Q_DECLARE_TR_FUNCTIONS(Kdbx4Reader)
 
 public:
+    ~Kdbx4Reader() override;
+
     Database* readDatabaseImpl(QIODevice* device,
                                const QByteArray& headerData,
                                const CompositeKey& key,
                                bool keepDatabase) override;
     QHash<QByteArray, QString> binaryPoolInverse() const;
     QHash<QString, QByteArray> binaryPool() const;
+    QHash<QString, QByteArray> binaryContentIds() const;
 
 protected:
     bool readHeaderField(StoreDataStream& headerStream) override;
 
 private:
     bool readInnerHeaderField(QIODevice* device);
+    bool readInnerHeaderBinary(QIODevice* device, quint32 fieldLen);
     QVariantMap readVariantMap(QIODevice* device);
+    QIODevice* openPipelineStage(QIODevice* device, QScopedPointer<PipelineStream>& pipeline);
+    void releaseBinaryContentIds();
 
     QHash<QByteArray, QString> m_binaryPoolInverse;
+    // AttachmentPool ids of the spilled binaries, the reader holds a reference to each
+    QHash<QByteArray, QString> m_binaryContentIds;
 };
 
 #endif // KEEPASSX_KDBX4READER_H
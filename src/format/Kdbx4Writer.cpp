@@ -28,6 +28,7 @@
 #include "format/KdbxXmlWriter.h"
 #include "format/KeePass2RandomStream.h"
 #include "streams/HmacBlockStream.h"
+#include "streams/PipelineStream.h"
 #include "streams/QtIOCompressor"
 #include "streams/SymmetricCipherStream.h"
 
@@ -115,7 +116,9 @@ bool Kdbx4Writer::writeDatabase(QIODevice* device, Database* db)
     CHECK_RETURN_FALSE(writeData(device, headerHmac));
 
     QScopedPointer<HmacBlockStream> hmacBlockStream;
+    QScopedPointer<PipelineStream> hmacPipeline;
     QScopedPointer<SymmetricCipherStream> cipherStream;
+    QScopedPointer<PipelineStream> cipherPipeline;
 
     hmacBlockStream.reset(new HmacBlockStream(device, hmacKey));
     if (!hmacBlockStream->open(QIODevice::WriteOnly)) {
@@ -123,8 +126,16 @@ bool Kdbx4Writer::writeDatabase(QIODevice* device, Database* db)
         return false;
     }
 
+    // In pipelined mode every stage writes behind on its own thread: the XML
+    // writer (on the calling thread), compression, encryption and the block
+    // HMACs work on different parts of the payload.
+    QIODevice* cipherOutput = openPipelineStage(hmacBlockStream.data(), hmacPipeline);
+    if (!cipherOutput) {
+        return false;
+    }
+
     cipherStream.reset(new SymmetricCipherStream(
-        hmacBlockStream.data(), algo, SymmetricCipher::algorithmMode(algo), SymmetricCipher::Encrypt));
+        cipherOutput, algo, SymmetricCipher::algorithmMode(algo), SymmetricCipher::Encrypt));
 
     if (!cipherStream->init(finalKey, encryptionIV)) {
         raiseError(cipherStream->errorString());
@@ -135,19 +146,25 @@ bool Kdbx4Writer::writeDatabase(QIODevice* device, Database* db)
         return false;
     }
 
-    QIODevice* outputDevice = nullptr;
+    QIODevice* outputDevice = openPipelineStage(cipherStream.data(), cipherPipeline);
+    if (!outputDevice) {
+        return false;
+    }
+
     QScopedPointer<QtIOCompressor> ioCompressor;
+    QScopedPointer<PipelineStream> compressorPipeline;
 
-    if (db->compressionAlgo() == Database::CompressionNone) {
-        outputDevice = cipherStream.data();
-    } else {
-        ioCompressor.reset(new QtIOCompressor(cipherStream.data()));
+    if (db->compressionAlgo() != Database::CompressionNone) {
+        ioCompressor.reset(new QtIOCompressor(outputDevice));
         ioCompressor->setStreamFormat(QtIOCompressor::GzipFormat);
         if (!ioCompressor->open(QIODevice::WriteOnly)) {
             raiseError(ioCompressor->errorString());
             return false;
         }
-        outputDevice = ioCompressor.data();
+        outputDevice = openPipelineStage(ioCompressor.data(), compressorPipeline);
+        if (!outputDevice) {
+            return false;
+        }
     }
 
     Q_ASSERT(outputDevice);
@@ -160,7 +177,7 @@ bool Kdbx4Writer::writeDatabase(QIODevice* device, Database* db)
         writeInnerHeaderField(outputDevice, KeePass2::InnerHeaderFieldID::InnerRandomStreamKey, protectedStreamKey));
 
     // Write attachments to the inner header
-    writeAttachments(outputDevice, db);
+    CHECK_RETURN_FALSE(writeAttachments(outputDevice, db));
 
     CHECK_RETURN_FALSE(writeInnerHeaderField(outputDevice, KeePass2::InnerHeaderFieldID::End, QByteArray()));
 
@@ -175,13 +192,21 @@ bool Kdbx4Writer::writeDatabase(QIODevice* device, Database* db)
 
     // Explicitly close/reset streams so they are flushed and we can detect
     // errors. QIODevice::close() resets errorString() etc.
-    if (ioCompressor) {
+    // Each pipeline stage is drained before the stream below it is flushed,
+    // a failing stage is followed by the lower ones to report the root cause.
+    bool pipelineOk = finishPipelineStage(compressorPipeline.data());
+    if (pipelineOk && ioCompressor) {
         ioCompressor->close();
     }
-    if (!cipherStream->reset()) {
+    pipelineOk = finishPipelineStage(cipherPipeline.data()) && pipelineOk;
+    if (pipelineOk && !cipherStream->reset()) {
         raiseError(cipherStream->errorString());
         return false;
     }
+    pipelineOk = finishPipelineStage(hmacPipeline.data()) && pipelineOk;
+    if (!pipelineOk) {
+        return false;
+    }
     if (!hmacBlockStream->reset()) {
         raiseError(hmacBlockStream->errorString());
         return false;
@@ -195,6 +220,44 @@ bool Kdbx4Writer::writeDatabase(QIODevice* device, Database* db)
     return true;
 }
 
+/**
+ * Put a pipeline stage on top of a stream if the writer is pipelined.
+ *
+ * @param device opened stream of the next stage
+ * @param pipeline receives the pipeline stream
+ * @return device to write the stage input to, nullptr on failure
+ */
+QIODevice* Kdbx4Writer::openPipelineStage(QIODevice* device, QScopedPointer<PipelineStream>& pipeline)
+{
+    if (!pipelined()) {
+        return device;
+    }
+
+    pipeline.reset(new PipelineStream(device));
+    if (!pipeline->open(QIODevice::WriteOnly)) {
+        raiseError(pipeline->errorString());
+        return nullptr;
+    }
+
+    return pipeline.data();
+}
+
+/**
+ * Wait until a pipeline stage has handed all data to the next stage.
+ *
+ * @param pipeline pipeline stream, may be nullptr
+ * @return true on success
+ */
+bool Kdbx4Writer::finishPipelineStage(PipelineStream* pipeline)
+{
+    if (pipeline && !pipeline->reset()) {
+        raiseError(pipeline->errorString());
+        return false;
+    }
+
+    return true;
+}
+
 /**
  * Write KDBX4 inner header field.
  *
@@ -215,7 +278,7 @@ bool Kdbx4Writer::writeInnerHeaderField(QIODevice* device, KeePass2::InnerHeader
     return true;
 }
 
-void Kdbx4Writer::writeAttachments(QIODevice* device, Database* db)
+bool Kdbx4Writer::writeAttachments(QIODevice* device, Database* db)
 {
     const QList<Entry*> allEntries = db->rootGroup()->entriesRecursive(true);
     QSet<QByteArray> writtenAttachments;
@@ -223,17 +286,27 @@ void Kdbx4Writer::writeAttachments(QIODevice* device, Database* db)
     for (Entry* entry : allEntries) {
         const QList<QString> attachmentKeys = entry->attachments()->keys();
         for (const QString& key : attachmentKeys) {
-            QByteArray data("\x01");
-            data.append(entry->attachments()->value(key));
-
-            if (writtenAttachments.contains(data)) {
+            // equal content has equal ids, no need to compare the data itself
+            const QByteArray id = entry->attachments()->contentId(key);
+            if (writtenAttachments.contains(id)) {
                 continue;
             }
 
-            writeInnerHeaderField(device, KeePass2::InnerHeaderFieldID::Binary, data);
-            writtenAttachments.insert(data);
+            bool ok;
+            const QByteArray content = entry->attachments()->value(key, &ok);
+            if (!ok) {
+                raiseError(tr("Unable to read attachment \"%1\" from the cache file.").arg(key));
+                return false;
+            }
+
+            QByteArray data("\x01");
+            data.append(content);
+            CHECK_RETURN_FALSE(writeInnerHeaderField(device, KeePass2::InnerHeaderFieldID::Binary, data));
+            writtenAttachments.insert(id);
         }
     }
+
+    return true;
 }
 
 /**
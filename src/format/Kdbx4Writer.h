@@ -20,6 +20,10 @@
 
 #include "KdbxWriter.h"
 
+#include <QScopedPointer>
+
+class PipelineStream;
+
 /**
  * KDBX4 writer implementation.
  */
@@ -31,8 +35,10 @@ public:
     bool writeDatabase(QIODevice* device, Database* db) override;
 
 private:
+    QIODevice* openPipelineStage(QIODevice* device, QScopedPointer<PipelineStream>& pipeline);
+    bool finishPipelineStage(PipelineStream* pipeline);
     bool writeInnerHeaderField(QIODevice* device, KeePass2::InnerHeaderFieldID fieldId, const QByteArray& data);
-    void writeAttachments(QIODevice* device, Database* db);
+    bool writeAttachments(QIODevice* device, Database* db);
     static bool serializeVariantMap(const QVariantMap& map, QByteArray& outputBytes);
 };
 
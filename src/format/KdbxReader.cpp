@@ -115,6 +115,65 @@ void KdbxReader::setSaveXml(bool save)
     m_saveXml = save;
 }
 
+bool KdbxReader::pipelined() const
+{
+    return m_pipelined;
+}
+
+/**
+ * Decrypt, decompress and parse the payload on separate threads.
+ * Only supported by the KDBX 4 reader, other readers ignore this.
+ *
+ * @param pipelined whether to use a reader thread per stage
+ */
+void KdbxReader::setPipelined(bool pipelined)
+{
+    m_pipelined = pipelined;
+}
+
+bool KdbxReader::lazyAttachments() const
+{
+    return m_lazyAttachments;
+}
+
+/**
+ * Move attachments to the encrypted spill file of the AttachmentPool while
+ * reading instead of keeping them in memory, they are read back on access.
+ * Only supported by the KDBX 4 reader, other readers ignore this.
+ *
+ * @param lazy whether to spill attachments
+ */
+void KdbxReader::setLazyAttachments(bool lazy)
+{
+    m_lazyAttachments = lazy;
+}
+
+/**
+ * Reuse the transformed master key of an already opened database if
+ * the file is protected by the same key and the same KDF parameters
+ * and seed, e.g. when reloading a database that changed on disk.
+ * This skips the expensive key derivation.
+ *
+ * @param db opened database, nullptr to always transform the key
+ */
+void KdbxReader::setKeyCache(const Database* db)
+{
+    if (!db || !db->hasKey() || db->transformedMasterKey().isEmpty()) {
+        m_cachedKdfUuid = QUuid();
+        m_cachedKdfParameters.clear();
+        m_cachedRawKey.clear();
+        m_cachedChallengeResponseKeys.clear();
+        m_cachedTransformedKey.clear();
+        return;
+    }
+
+    m_cachedKdfUuid = db->kdf()->uuid();
+    m_cachedKdfParameters = db->kdf()->writeParameters();
+    m_cachedRawKey = db->key().rawKey();
+    m_cachedChallengeResponseKeys = db->key().challengeResponseKeys();
+    m_cachedTransformedKey = db->transformedMasterKey();
+}
+
 QByteArray KdbxReader::xmlData() const
 {
     return m_xmlData;
@@ -263,6 +322,26 @@ void KdbxReader::setInnerRandomStreamID(const QByteArray& data)
     m_irsAlgo = irsAlgo;
 }
 
+/**
+ * Set the key of the database being read, the key is only transformed
+ * if the key cache doesn't match the key and the KDF read from the header.
+ *
+ * @param key database encryption composite key
+ * @return true on success
+ */
+bool KdbxReader::setDatabaseKey(const CompositeKey& key)
+{
+    // challenge-response components can only be compared by identity
+    if (!m_cachedTransformedKey.isEmpty() && m_db->kdf()->uuid() == m_cachedKdfUuid
+        && m_db->kdf()->writeParameters() == m_cachedKdfParameters
+        && key.challengeResponseKeys() == m_cachedChallengeResponseKeys && key.rawKey() == m_cachedRawKey) {
+        m_db->setTransformedKey(key, m_cachedTransformedKey);
+        return true;
+    }
+
+    return m_db->setKey(key, false, false);
+}
+
 /**
  * Raise an error. Use in case of an unexpected read error.
  *
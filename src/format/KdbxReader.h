@@ -24,6 +24,8 @@
 
 #include <QCoreApplication>
 #include <QPointer>
+#include <QUuid>
+#include <QVariantMap>
 
 class Database;
 class QIODevice;
@@ -47,6 +49,11 @@ public:
 
     bool saveXml() const;
     void setSaveXml(bool save);
+    bool pipelined() const;
+    void setPipelined(bool pipelined);
+    bool lazyAttachments() const;
+    void setLazyAttachments(bool lazy);
+    void setKeyCache(const Database* db);
     QByteArray xmlData() const;
     QByteArray streamKey() const;
     KeePass2::ProtectedStreamAlgo protectedStreamAlgo() const;
@@ -82,6 +89,7 @@ protected:
     virtual void setStreamStartBytes(const QByteArray& data);
     virtual void setInnerRandomStreamID(const QByteArray& data);
 
+    bool setDatabaseKey(const CompositeKey& key);
     void raiseError(const QString& errorMessage);
 
     QScopedPointer<Database> m_db;
@@ -99,6 +107,13 @@ protected:
 
 private:
     bool m_saveXml = false;
+    bool m_pipelined = false;
+    bool m_lazyAttachments = false;
+    QUuid m_cachedKdfUuid;
+    QVariantMap m_cachedKdfParameters;
+    QByteArray m_cachedRawKey;
+    QList<QSharedPointer<ChallengeResponseKey>> m_cachedChallengeResponseKeys;
+    QByteArray m_cachedTransformedKey;
     bool m_error = false;
     QString m_errorStr = "";
 };
@@ -27,6 +27,22 @@ QString KdbxWriter::errorString() const
     return m_errorStr;
 }
 
+bool KdbxWriter::pipelined() const
+{
+    return m_pipelined;
+}
+
+/**
+ * Compress, encrypt and authenticate the payload on separate threads.
+ * Only supported by the KDBX 4 writer, other writers ignore this.
+ *
+ * @param pipelined whether to use a writer thread per stage
+ */
+void KdbxWriter::setPipelined(bool pipelined)
+{
+    m_pipelined = pipelined;
+}
+
 /**
  * Write KDBX magic header numbers to a device.
  *
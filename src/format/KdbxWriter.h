@@ -55,6 +55,9 @@ public:
     bool hasError() const;
     QString errorString() const;
 
+    bool pipelined() const;
+    void setPipelined(bool pipelined);
+
 protected:
     /**
      * Helper method for writing a KDBX header field to a device.
@@ -85,6 +88,7 @@ protected:
 
     bool m_error = false;
     QString m_errorStr = "";
+    bool m_pipelined = false;
 };
 
 #endif // KEEPASSXC_KDBXWRITER_H
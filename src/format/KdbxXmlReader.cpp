@@ -27,9 +27,191 @@
 
 #include <QBuffer>
 #include <QFile>
+#include <QRegularExpression>
+#include <QtEndian>
+
+#include <limits>
 
 #define UUID_LENGTH 16
 
+namespace
+{
+    // 9999-12-31T23:59:59Z in seconds since 0001-01-01, later timestamps are left to QDateTime::addSecs()
+    constexpr qint64 MaxDateTimeSecs = Q_INT64_C(315537897599);
+
+    struct Base64Table
+    {
+        Base64Table()
+        {
+            const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for (int i = 0; i < 256; ++i) {
+                values[i] = -1;
+            }
+            for (int i = 0; i < 64; ++i) {
+                values[static_cast<uchar>(alphabet[i])] = static_cast<qint8>(i);
+            }
+        }
+
+        qint8 values[256];
+    };
+
+    const Base64Table base64Table;
+
+    /**
+     * Decode canonical, padded base64 without allocating.
+     *
+     * @return number of bytes written to out, -1 if data is not valid base64
+     *         or decodes to more than maxSize bytes
+     */
+    int decodeBase64(const char* data, int size, uchar* out, int maxSize)
+    {
+        if (size % 4 != 0) {
+            return -1;
+        }
+
+        int padding = 0;
+        if (size > 0 && data[size - 1] == '=') {
+            padding = data[size - 2] == '=' ? 2 : 1;
+        }
+        if (size / 4 * 3 - padding > maxSize) {
+            return -1;
+        }
+
+        int outSize = 0;
+        for (int i = 0; i < size; i += 4) {
+            const int chars = i + 4 == size ? 4 - padding : 4;
+            quint32 bits = 0;
+            int invalid = 0;
+            for (int j = 0; j < 4; ++j) {
+                const int value = j < chars ? base64Table.values[static_cast<uchar>(data[i + j])] : 0;
+                invalid |= value;
+                bits = (bits << 6) | static_cast<quint32>(value & 0x3F);
+            }
+            if (invalid < 0) {
+                return -1;
+            }
+
+            out[outSize++] = static_cast<uchar>(bits >> 16);
+            if (chars > 2) {
+                out[outSize++] = static_cast<uchar>(bits >> 8);
+            }
+            if (chars > 3) {
+                out[outSize++] = static_cast<uchar>(bits);
+            }
+        }
+
+        return outSize;
+    }
+
+    bool decodeDigits(const char* data, int count, int& value)
+    {
+        value = 0;
+        for (int i = 0; i < count; ++i) {
+            const uint digit = static_cast<uint>(data[i] - '0');
+            if (digit > 9) {
+                return false;
+            }
+            value = value * 10 + static_cast<int>(digit);
+        }
+        return true;
+    }
+
+    /**
+     * Days between 1970-01-01 and the given date of the proleptic Gregorian calendar, year >= 1.
+     */
+    qint64 daysSinceEpoch(int year, int month, int day)
+    {
+        year -= month <= 2 ? 1 : 0;
+        const int era = year / 400;
+        const int yearOfEra = year - era * 400;
+        const int dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+        const int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return static_cast<qint64>(era) * 146097 + dayOfEra - 719468;
+    }
+
+    /**
+     * Decode the UTC timestamp "yyyy-MM-ddTHH:mm:ssZ" written by KDBX 3.
+     */
+    bool decodeIsoDateTime(const char* data, int size, QDateTime& dateTime)
+    {
+        if (size != 20 || data[4] != '-' || data[7] != '-' || data[10] != 'T' || data[13] != ':' || data[16] != ':'
+            || data[19] != 'Z') {
+            return false;
+        }
+
+        int year, month, day, hour, minute, second;
+        if (!decodeDigits(data, 4, year) || !decodeDigits(data + 5, 2, month) || !decodeDigits(data + 8, 2, day)
+            || !decodeDigits(data + 11, 2, hour) || !decodeDigits(data + 14, 2, minute)
+            || !decodeDigits(data + 17, 2, second)) {
+            return false;
+        }
+
+        static const int daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        const bool leapYear = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+        if (year < 1 || month < 1 || month > 12 || day < 1
+            || day > daysInMonth[month - 1] + (month == 2 && leapYear ? 1 : 0) || hour > 23 || minute > 59
+            || second > 59) {
+            // leave everything else, e.g. 24:00:00, to QDateTime
+            return false;
+        }
+
+        const qint64 secs = daysSinceEpoch(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+        dateTime = QDateTime::fromMSecsSinceEpoch(secs * 1000, Qt::UTC);
+        return true;
+    }
+
+    /**
+     * Decode the common timestamp formats straight from the character data.
+     *
+     * @return false if the value has to go through the generic parser
+     */
+    bool decodeDateTime(const char* data, int size, QDateTime& dateTime)
+    {
+        if (size <= 12) {
+            // base64 encoded seconds since 0001-01-01, zero-padded to 8 bytes
+            uchar secsBytes[9] = {};
+            if (decodeBase64(data, size, secsBytes, sizeof(secsBytes)) >= 0) {
+                const qint64 secs = static_cast<qint64>(qFromLittleEndian<quint64>(secsBytes));
+                if (secs < 0 || secs > MaxDateTimeSecs) {
+                    return false;
+                }
+                dateTime = QDateTime::fromMSecsSinceEpoch((secs - KeePass2::DATETIME_EPOCH_OFFSET) * 1000, Qt::UTC);
+                return true;
+            }
+        }
+
+        return decodeIsoDateTime(data, size, dateTime);
+    }
+
+    bool decodeNumber(const char* data, int size, int& number)
+    {
+        int pos = 0;
+        const bool negative = size > 0 && data[0] == '-';
+        if (size > 0 && (data[0] == '-' || data[0] == '+')) {
+            ++pos;
+        }
+        if (pos == size || size - pos > 10) {
+            return false;
+        }
+
+        qint64 value = 0;
+        for (; pos < size; ++pos) {
+            const uint digit = static_cast<uint>(data[pos] - '0');
+            if (digit > 9) {
+                return false;
+            }
+            value = value * 10 + digit;
+        }
+        value = negative ? -value : value;
+        if (value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max()) {
+            return false;
+        }
+
+        number = static_cast<int>(value);
+        return true;
+    }
+} // namespace
+
 /**
  * @param version KDBX version
  */
@@ -87,7 +269,6 @@ void KdbxXmlReader::readDatabase(QIODevice* device, Database* db, KeePass2Random
     m_error = false;
     m_errorStr.clear();
 
-    m_xml.clear();
     m_xml.setDevice(device);
 
     m_db = db;
@@ -102,11 +283,11 @@ void KdbxXmlReader::readDatabase(QIODevice* device, Database* db, KeePass2Random
     bool rootGroupParsed = false;
 
     if (m_xml.hasError()) {
-        raiseError(tr("XML parsing failure: %1").arg(m_xml.error()));
+        raiseError(tr("XML parsing failure: %1").arg(m_xml.errorString()));
         return;
     }
 
-    if (m_xml.readNextStartElement() && m_xml.name() == "KeePassFile") {
+    if (m_xml.readNextStartElement() && m_xml.element() == Element::KeePassFile) {
         rootGroupParsed = parseKeePassFile();
     }
 
@@ -115,6 +296,14 @@ void KdbxXmlReader::readDatabase(QIODevice* device, Database* db, KeePass2Random
         return;
     }
 
+    // only whitespace, comments and processing instructions may follow the root element
+    while (!m_xml.hasError() && m_xml.readNextStartElement()) {
+        m_xml.skipCurrentElement();
+    }
+    if (m_xml.hasError()) {
+        return;
+    }
+
     if (!m_tmpParent->children().isEmpty()) {
         qWarning("KdbxXmlReader::readDatabase: found %d invalid group reference(s)", m_tmpParent->children().size());
     }
@@ -123,7 +312,7 @@ void KdbxXmlReader::readDatabase(QIODevice* device, Database* db, KeePass2Random
         qWarning("KdbxXmlReader::readDatabase: found %d invalid entry reference(s)", m_tmpParent->children().size());
     }
 
-    const QSet<QString> poolKeys = m_binaryPool.keys().toSet();
+    const QSet<QString> poolKeys = m_binaryPool.keys().toSet() + m_binaryContentIds.keys().toSet();
     const QSet<QString> entryKeys = m_binaryMap.keys().toSet();
     const QSet<QString> unmappedKeys = entryKeys - poolKeys;
     const QSet<QString> unusedKeys = poolKeys - entryKeys;
@@ -139,7 +328,12 @@ void KdbxXmlReader::readDatabase(QIODevice* device, Database* db, KeePass2Random
     QHash<QString, QPair<Entry*, QString>>::const_iterator i;
     for (i = m_binaryMap.constBegin(); i != m_binaryMap.constEnd(); ++i) {
         const QPair<Entry*, QString>& target = i.value();
-        target.first->attachments()->set(target.second, m_binaryPool[i.key()]);
+        auto contentId = m_binaryContentIds.constFind(i.key());
+        if (contentId != m_binaryContentIds.constEnd()) {
+            target.first->attachments()->setContentId(target.second, contentId.value());
+        } else {
+            target.first->attachments()->set(target.second, m_binaryPool[i.key()]);
+        }
     }
 
     m_meta->setUpdateDatetime(true);
@@ -170,6 +364,17 @@ void KdbxXmlReader::setStrictMode(bool strictMode)
     m_strictMode = strictMode;
 }
 
+/**
+ * Binaries that are stored in the AttachmentPool already, they take
+ * precedence over the binary pool passed to the constructor.
+ *
+ * @param contentIds mapping from binary keys to AttachmentPool content ids
+ */
+void KdbxXmlReader::setBinaryContentIds(const QHash<QString, QByteArray>& contentIds)
+{
+    m_binaryContentIds = contentIds;
+}
+
 bool KdbxXmlReader::hasError() const
 {
     return m_error || m_xml.hasError();
@@ -207,18 +412,17 @@ QByteArray KdbxXmlReader::headerHash() const
 
 bool KdbxXmlReader::parseKeePassFile()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "KeePassFile");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::KeePassFile);
 
     bool rootElementFound = false;
     bool rootParsedSuccessfully = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Meta") {
+        switch (m_xml.element()) {
+        case Element::Meta:
             parseMeta();
-            continue;
-        }
-
-        if (m_xml.name() == "Root") {
+            break;
+        case Element::Root:
             if (rootElementFound) {
                 rootParsedSuccessfully = false;
                 qWarning("Multiple root elements");
@@ -226,10 +430,11 @@ bool KdbxXmlReader::parseKeePassFile()
                 rootParsedSuccessfully = parseRoot();
                 rootElementFound = true;
             }
-            continue;
+            break;
+        default:
+            skipCurrentElement();
+            break;
         }
-
-        skipCurrentElement();
     }
 
     return rootParsedSuccessfully;
@@ -237,116 +442,157 @@ bool KdbxXmlReader::parseKeePassFile()
 
 void KdbxXmlReader::parseMeta()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Meta");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::Meta);
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Generator") {
+        switch (m_xml.element()) {
+        case Element::Generator:
             m_meta->setGenerator(readString());
-        } else if (m_xml.name() == "HeaderHash") {
+            break;
+        case Element::HeaderHash:
             m_headerHash = readBinary();
-        } else if (m_xml.name() == "DatabaseName") {
+            break;
+        case Element::DatabaseName:
             m_meta->setName(readString());
-        } else if (m_xml.name() == "DatabaseNameChanged") {
+            break;
+        case Element::DatabaseNameChanged:
             m_meta->setNameChanged(readDateTime());
-        } else if (m_xml.name() == "DatabaseDescription") {
+            break;
+        case Element::DatabaseDescription:
             m_meta->setDescription(readString());
-        } else if (m_xml.name() == "DatabaseDescriptionChanged") {
+            break;
+        case Element::DatabaseDescriptionChanged:
             m_meta->setDescriptionChanged(readDateTime());
-        } else if (m_xml.name() == "DefaultUserName") {
+            break;
+        case Element::DefaultUserName:
             m_meta->setDefaultUserName(readString());
-        } else if (m_xml.name() == "DefaultUserNameChanged") {
+            break;
+        case Element::DefaultUserNameChanged:
             m_meta->setDefaultUserNameChanged(readDateTime());
-        } else if (m_xml.name() == "MaintenanceHistoryDays") {
+            break;
+        case Element::MaintenanceHistoryDays:
             m_meta->setMaintenanceHistoryDays(readNumber());
-        } else if (m_xml.name() == "Color") {
+            break;
+        case Element::Color:
             m_meta->setColor(readColor());
-        } else if (m_xml.name() == "MasterKeyChanged") {
+            break;
+        case Element::MasterKeyChanged:
             m_meta->setMasterKeyChanged(readDateTime());
-        } else if (m_xml.name() == "MasterKeyChangeRec") {
+            break;
+        case Element::MasterKeyChangeRec:
             m_meta->setMasterKeyChangeRec(readNumber());
-        } else if (m_xml.name() == "MasterKeyChangeForce") {
+            break;
+        case Element::MasterKeyChangeForce:
             m_meta->setMasterKeyChangeForce(readNumber());
-        } else if (m_xml.name() == "MemoryProtection") {
+            break;
+        case Element::MemoryProtection:
             parseMemoryProtection();
-        } else if (m_xml.name() == "CustomIcons") {
+            break;
+        case Element::CustomIcons:
             parseCustomIcons();
-        } else if (m_xml.name() == "RecycleBinEnabled") {
+            break;
+        case Element::RecycleBinEnabled:
             m_meta->setRecycleBinEnabled(readBool());
-        } else if (m_xml.name() == "RecycleBinUUID") {
+            break;
+        case Element::RecycleBinUUID:
             m_meta->setRecycleBin(getGroup(readUuid()));
-        } else if (m_xml.name() == "RecycleBinChanged") {
+            break;
+        case Element::RecycleBinChanged:
             m_meta->setRecycleBinChanged(readDateTime());
-        } else if (m_xml.name() == "EntryTemplatesGroup") {
+            break;
+        case Element::EntryTemplatesGroup:
             m_meta->setEntryTemplatesGroup(getGroup(readUuid()));
-        } else if (m_xml.name() == "EntryTemplatesGroupChanged") {
+            break;
+        case Element::EntryTemplatesGroupChanged:
             m_meta->setEntryTemplatesGroupChanged(readDateTime());
-        } else if (m_xml.name() == "LastSelectedGroup") {
+            break;
+        case Element::LastSelectedGroup:
             m_meta->setLastSelectedGroup(getGroup(readUuid()));
-        } else if (m_xml.name() == "LastTopVisibleGroup") {
+            break;
+        case Element::LastTopVisibleGroup:
             m_meta->setLastTopVisibleGroup(getGroup(readUuid()));
-        } else if (m_xml.name() == "HistoryMaxItems") {
+            break;
+        case Element::HistoryMaxItems: {
             int value = readNumber();
             if (value >= -1) {
                 m_meta->setHistoryMaxItems(value);
             } else {
                 qWarning("HistoryMaxItems invalid number");
             }
-        } else if (m_xml.name() == "HistoryMaxSize") {
+            break;
+        }
+        case Element::HistoryMaxSize: {
             int value = readNumber();
             if (value >= -1) {
                 m_meta->setHistoryMaxSize(value);
             } else {
                 qWarning("HistoryMaxSize invalid number");
             }
-        } else if (m_xml.name() == "Binaries") {
+            break;
+        }
+        case Element::Binaries:
             parseBinaries();
-        } else if (m_xml.name() == "CustomData") {
+            break;
+        case Element::CustomData:
             parseCustomData(m_meta->customData());
-        } else if (m_xml.name() == "SettingsChanged") {
+            break;
+        case Element::SettingsChanged:
             m_meta->setSettingsChanged(readDateTime());
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 }
 
 void KdbxXmlReader::parseMemoryProtection()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "MemoryProtection");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::MemoryProtection);
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "ProtectTitle") {
+        switch (m_xml.element()) {
+        case Element::ProtectTitle:
             m_meta->setProtectTitle(readBool());
-        } else if (m_xml.name() == "ProtectUserName") {
+            break;
+        case Element::ProtectUserName:
             m_meta->setProtectUsername(readBool());
-        } else if (m_xml.name() == "ProtectPassword") {
+            break;
+        case Element::ProtectPassword:
             m_meta->setProtectPassword(readBool());
-        } else if (m_xml.name() == "ProtectURL") {
+            break;
+        case Element::ProtectURL:
             m_meta->setProtectUrl(readBool());
-        } else if (m_xml.name() == "ProtectNotes") {
+            break;
+        case Element::ProtectNotes:
             m_meta->setProtectNotes(readBool());
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 }
 
 void KdbxXmlReader::parseCustomIcons()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "CustomIcons");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::CustomIcons);
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Icon") {
+        switch (m_xml.element()) {
+        case Element::Icon:
             parseIcon();
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 }
 
 void KdbxXmlReader::parseIcon()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Icon");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::Icon);
 
     QUuid uuid;
     QImage icon;
@@ -354,14 +600,18 @@ void KdbxXmlReader::parseIcon()
     bool iconSet = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "UUID") {
+        switch (m_xml.element()) {
+        case Element::UUID:
             uuid = readUuid();
             uuidSet = !uuid.isNull();
-        } else if (m_xml.name() == "Data") {
+            break;
+        case Element::Data:
             icon.loadFromData(readBinary());
             iconSet = true;
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 
@@ -375,17 +625,16 @@ void KdbxXmlReader::parseIcon()
 
 void KdbxXmlReader::parseBinaries()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Binaries");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::Binaries);
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() != "Binary") {
+        if (m_xml.element() != Element::Binary) {
             skipCurrentElement();
             continue;
         }
 
-        QXmlStreamAttributes attr = m_xml.attributes();
-        QString id = attr.value("ID").toString();
-        QByteArray data = isTrueValue(attr.value("Compressed")) ? readCompressedBinary() : readBinary();
+        QString id = m_xml.attributeValue("ID").toString();
+        QByteArray data = isTrueValue(m_xml.attributeValue("Compressed")) ? readCompressedBinary() : readBinary();
 
         if (m_binaryPool.contains(id)) {
             qWarning("KdbxXmlReader::parseBinaries: overwriting binary item \"%s\"", qPrintable(id));
@@ -397,20 +646,23 @@ void KdbxXmlReader::parseBinaries()
 
 void KdbxXmlReader::parseCustomData(CustomData* customData)
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "CustomData");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::CustomData);
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Item") {
+        switch (m_xml.element()) {
+        case Element::Item:
             parseCustomDataItem(customData);
-            continue;
+            break;
+        default:
+            skipCurrentElement();
+            break;
         }
-        skipCurrentElement();
     }
 }
 
 void KdbxXmlReader::parseCustomDataItem(CustomData* customData)
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Item");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::Item);
 
     QString key;
     QString value;
@@ -418,14 +670,18 @@ void KdbxXmlReader::parseCustomDataItem(CustomData* customData)
     bool valueSet = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Key") {
+        switch (m_xml.element()) {
+        case Element::Key:
             key = readString();
             keySet = true;
-        } else if (m_xml.name() == "Value") {
+            break;
+        case Element::Value:
             value = readString();
             valueSet = true;
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 
@@ -439,13 +695,14 @@ void KdbxXmlReader::parseCustomDataItem(CustomData* customData)
 
 bool KdbxXmlReader::parseRoot()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Root");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::Root);
 
     bool groupElementFound = false;
     bool groupParsedSuccessfully = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Group") {
+        switch (m_xml.element()) {
+        case Element::Group: {
             if (groupElementFound) {
                 groupParsedSuccessfully = false;
                 raiseError(tr("Multiple group elements"));
@@ -461,10 +718,14 @@ bool KdbxXmlReader::parseRoot()
             }
 
             groupElementFound = true;
-        } else if (m_xml.name() == "DeletedObjects") {
+            break;
+        }
+        case Element::DeletedObjects:
             parseDeletedObjects();
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 
@@ -473,14 +734,15 @@ bool KdbxXmlReader::parseRoot()
 
 Group* KdbxXmlReader::parseGroup()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Group");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::Group);
 
     auto group = new Group();
     group->setUpdateTimeinfo(false);
     QList<Group*> children;
     QList<Entry*> entries;
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "UUID") {
+        switch (m_xml.element()) {
+        case Element::UUID: {
             QUuid uuid = readUuid();
             if (uuid.isNull()) {
                 if (m_strictMode) {
@@ -491,17 +753,15 @@ Group* KdbxXmlReader::parseGroup()
             } else {
                 group->setUuid(uuid);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "Name") {
+        case Element::Name:
             group->setName(readString());
-            continue;
-        }
-        if (m_xml.name() == "Notes") {
+            break;
+        case Element::Notes:
             group->setNotes(readString());
-            continue;
-        }
-        if (m_xml.name() == "IconID") {
+            break;
+        case Element::IconID: {
             int iconId = readNumber();
             if (iconId < 0) {
                 if (m_strictMode) {
@@ -514,28 +774,25 @@ Group* KdbxXmlReader::parseGroup()
             }
 
             group->setIcon(iconId);
-            continue;
+            break;
         }
-        if (m_xml.name() == "CustomIconUUID") {
+        case Element::CustomIconUUID: {
             QUuid uuid = readUuid();
             if (!uuid.isNull()) {
                 group->setIcon(uuid);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "Times") {
+        case Element::Times:
             group->setTimeInfo(parseTimes());
-            continue;
-        }
-        if (m_xml.name() == "IsExpanded") {
+            break;
+        case Element::IsExpanded:
             group->setExpanded(readBool());
-            continue;
-        }
-        if (m_xml.name() == "DefaultAutoTypeSequence") {
+            break;
+        case Element::DefaultAutoTypeSequence:
             group->setDefaultAutoTypeSequence(readString());
-            continue;
-        }
-        if (m_xml.name() == "EnableAutoType") {
+            break;
+        case Element::EnableAutoType: {
             QString str = readString();
 
             if (str.compare("null", Qt::CaseInsensitive) == 0) {
@@ -547,9 +804,9 @@ Group* KdbxXmlReader::parseGroup()
             } else {
                 raiseError(tr("Invalid EnableAutoType value"));
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "EnableSearching") {
+        case Element::EnableSearching: {
             QString str = readString();
 
             if (str.compare("null", Qt::CaseInsensitive) == 0) {
@@ -561,32 +818,32 @@ Group* KdbxXmlReader::parseGroup()
             } else {
                 raiseError(tr("Invalid EnableSearching value"));
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "LastTopVisibleEntry") {
+        case Element::LastTopVisibleEntry:
             group->setLastTopVisibleEntry(getEntry(readUuid()));
-            continue;
-        }
-        if (m_xml.name() == "Group") {
+            break;
+        case Element::Group: {
             Group* newGroup = parseGroup();
             if (newGroup) {
                 children.append(newGroup);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "Entry") {
+        case Element::Entry: {
             Entry* newEntry = parseEntry(false);
             if (newEntry) {
                 entries.append(newEntry);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "CustomData") {
+        case Element::CustomData:
             parseCustomData(group->customData());
-            continue;
+            break;
+        default:
+            skipCurrentElement();
+            break;
         }
-
-        skipCurrentElement();
     }
 
     if (group->uuid().isNull() && !m_strictMode) {
@@ -616,25 +873,29 @@ Group* KdbxXmlReader::parseGroup()
 
 void KdbxXmlReader::parseDeletedObjects()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "DeletedObjects");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::DeletedObjects);
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "DeletedObject") {
+        switch (m_xml.element()) {
+        case Element::DeletedObject:
             parseDeletedObject();
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 }
 
 void KdbxXmlReader::parseDeletedObject()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "DeletedObject");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::DeletedObject);
 
     DeletedObject delObj{{}, {}};
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "UUID") {
+        switch (m_xml.element()) {
+        case Element::UUID: {
             QUuid uuid = readUuid();
             if (uuid.isNull()) {
                 if (m_strictMode) {
@@ -644,13 +905,15 @@ void KdbxXmlReader::parseDeletedObject()
                 continue;
             }
             delObj.uuid = uuid;
-            continue;
+            break;
         }
-        if (m_xml.name() == "DeletionTime") {
+        case Element::DeletionTime:
             delObj.deletionTime = readDateTime();
-            continue;
+            break;
+        default:
+            skipCurrentElement();
+            break;
         }
-        skipCurrentElement();
     }
 
     if (!delObj.uuid.isNull() && !delObj.deletionTime.isNull()) {
@@ -665,7 +928,7 @@ void KdbxXmlReader::parseDeletedObject()
 
 Entry* KdbxXmlReader::parseEntry(bool history)
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Entry");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::Entry);
 
     auto entry = new Entry();
     entry->setUpdateTimeinfo(false);
@@ -673,7 +936,8 @@ Entry* KdbxXmlReader::parseEntry(bool history)
     QList<StringPair> binaryRefs;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "UUID") {
+        switch (m_xml.element()) {
+        case Element::UUID: {
             QUuid uuid = readUuid();
             if (uuid.isNull()) {
                 if (m_strictMode) {
@@ -684,9 +948,9 @@ Entry* KdbxXmlReader::parseEntry(bool history)
             } else {
                 entry->setUuid(uuid);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "IconID") {
+        case Element::IconID: {
             int iconId = readNumber();
             if (iconId < 0) {
                 if (m_strictMode) {
@@ -695,63 +959,57 @@ Entry* KdbxXmlReader::parseEntry(bool history)
                 iconId = 0;
             }
             entry->setIcon(iconId);
-            continue;
+            break;
         }
-        if (m_xml.name() == "CustomIconUUID") {
+        case Element::CustomIconUUID: {
             QUuid uuid = readUuid();
             if (!uuid.isNull()) {
                 entry->setIcon(uuid);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "ForegroundColor") {
+        case Element::ForegroundColor:
             entry->setForegroundColor(readColor());
-            continue;
-        }
-        if (m_xml.name() == "BackgroundColor") {
+            break;
+        case Element::BackgroundColor:
             entry->setBackgroundColor(readColor());
-            continue;
-        }
-        if (m_xml.name() == "OverrideURL") {
+            break;
+        case Element::OverrideURL:
             entry->setOverrideUrl(readString());
-            continue;
-        }
-        if (m_xml.name() == "Tags") {
+            break;
+        case Element::Tags:
             entry->setTags(readString());
-            continue;
-        }
-        if (m_xml.name() == "Times") {
+            break;
+        case Element::Times:
             entry->setTimeInfo(parseTimes());
-            continue;
-        }
-        if (m_xml.name() == "String") {
+            break;
+        case Element::String:
             parseEntryString(entry);
-            continue;
-        }
-        if (m_xml.name() == "Binary") {
+            break;
+        case Element::Binary: {
             QPair<QString, QString> ref = parseEntryBinary(entry);
             if (!ref.first.isNull() && !ref.second.isNull()) {
                 binaryRefs.append(ref);
             }
-            continue;
+            break;
         }
-        if (m_xml.name() == "AutoType") {
+        case Element::AutoType:
             parseAutoType(entry);
-            continue;
-        }
-        if (m_xml.name() == "History") {
+            break;
+        case Element::History:
             if (history) {
                 raiseError(tr("History element in history entry"));
             } else {
                 historyItems = parseEntryHistory();
             }
-            continue;
-        }
-        if (m_xml.name() == "CustomData") {
+            break;
+        case Element::CustomData:
             parseCustomData(entry->customData());
-            continue;
+            break;
+        default:
+            skipCurrentElement();
+            break;
         }
-        skipCurrentElement();
     }
 
     if (entry->uuid().isNull() && !m_strictMode) {
@@ -794,7 +1052,7 @@ Entry* KdbxXmlReader::parseEntry(bool history)
 
 void KdbxXmlReader::parseEntryString(Entry* entry)
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "String");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::String);
 
     QString key;
     QString value;
@@ -803,23 +1061,23 @@ void KdbxXmlReader::parseEntryString(Entry* entry)
     bool valueSet = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Key") {
+        switch (m_xml.element()) {
+        case Element::Key:
             key = readString();
             keySet = true;
-            continue;
-        }
-
-        if (m_xml.name() == "Value") {
-            QXmlStreamAttributes attr = m_xml.attributes();
+            break;
+        case Element::Value: {
             bool isProtected;
             bool protectInMemory;
             value = readString(isProtected, protectInMemory);
             protect = isProtected || protectInMemory;
             valueSet = true;
-            continue;
+            break;
+        }
+        default:
+            skipCurrentElement();
+            break;
         }
-
-        skipCurrentElement();
     }
 
     if (keySet && valueSet) {
@@ -837,7 +1095,7 @@ void KdbxXmlReader::parseEntryString(Entry* entry)
 
 QPair<QString, QString> KdbxXmlReader::parseEntryBinary(Entry* entry)
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Binary");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::Binary);
 
     QPair<QString, QString> poolRef;
 
@@ -847,16 +1105,14 @@ QPair<QString, QString> KdbxXmlReader::parseEntryBinary(Entry* entry)
     bool valueSet = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Key") {
+        switch (m_xml.element()) {
+        case Element::Key:
             key = readString();
             keySet = true;
-            continue;
-        }
-        if (m_xml.name() == "Value") {
-            QXmlStreamAttributes attr = m_xml.attributes();
-
-            if (attr.hasAttribute("Ref")) {
-                poolRef = qMakePair(attr.value("Ref").toString(), key);
+            break;
+        case Element::Value: {
+            if (m_xml.hasAttribute("Ref")) {
+                poolRef = qMakePair(m_xml.attributeValue("Ref").toString(), key);
                 m_xml.skipCurrentElement();
             } else {
                 // format compatibility
@@ -864,9 +1120,12 @@ QPair<QString, QString> KdbxXmlReader::parseEntryBinary(Entry* entry)
             }
 
             valueSet = true;
-            continue;
+            break;
+        }
+        default:
+            skipCurrentElement();
+            break;
         }
-        skipCurrentElement();
     }
 
     if (keySet && valueSet) {
@@ -884,40 +1143,50 @@ QPair<QString, QString> KdbxXmlReader::parseEntryBinary(Entry* entry)
 
 void KdbxXmlReader::parseAutoType(Entry* entry)
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "AutoType");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::AutoType);
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Enabled") {
+        switch (m_xml.element()) {
+        case Element::Enabled:
             entry->setAutoTypeEnabled(readBool());
-        } else if (m_xml.name() == "DataTransferObfuscation") {
+            break;
+        case Element::DataTransferObfuscation:
             entry->setAutoTypeObfuscation(readNumber());
-        } else if (m_xml.name() == "DefaultSequence") {
+            break;
+        case Element::DefaultSequence:
             entry->setDefaultAutoTypeSequence(readString());
-        } else if (m_xml.name() == "Association") {
+            break;
+        case Element::Association:
             parseAutoTypeAssoc(entry);
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 }
 
 void KdbxXmlReader::parseAutoTypeAssoc(Entry* entry)
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Association");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::Association);
 
     AutoTypeAssociations::Association assoc;
     bool windowSet = false;
     bool sequenceSet = false;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Window") {
+        switch (m_xml.element()) {
+        case Element::Window:
             assoc.window = readString();
             windowSet = true;
-        } else if (m_xml.name() == "KeystrokeSequence") {
+            break;
+        case Element::KeystrokeSequence:
             assoc.sequence = readString();
             sequenceSet = true;
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 
@@ -930,15 +1199,18 @@ void KdbxXmlReader::parseAutoTypeAssoc(Entry* entry)
 
 QList<Entry*> KdbxXmlReader::parseEntryHistory()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "History");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::History);
 
     QList<Entry*> historyItems;
 
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "Entry") {
+        switch (m_xml.element()) {
+        case Element::Entry:
             historyItems.append(parseEntry(true));
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 
@@ -947,26 +1219,35 @@ QList<Entry*> KdbxXmlReader::parseEntryHistory()
 
 TimeInfo KdbxXmlReader::parseTimes()
 {
-    Q_ASSERT(m_xml.isStartElement() && m_xml.name() == "Times");
+    Q_ASSERT(m_xml.isStartElement() && m_xml.element() == Element::Times);
 
     TimeInfo timeInfo;
     while (!m_xml.hasError() && m_xml.readNextStartElement()) {
-        if (m_xml.name() == "LastModificationTime") {
+        switch (m_xml.element()) {
+        case Element::LastModificationTime:
             timeInfo.setLastModificationTime(readDateTime());
-        } else if (m_xml.name() == "CreationTime") {
+            break;
+        case Element::CreationTime:
             timeInfo.setCreationTime(readDateTime());
-        } else if (m_xml.name() == "LastAccessTime") {
+            break;
+        case Element::LastAccessTime:
             timeInfo.setLastAccessTime(readDateTime());
-        } else if (m_xml.name() == "ExpiryTime") {
+            break;
+        case Element::ExpiryTime:
             timeInfo.setExpiryTime(readDateTime());
-        } else if (m_xml.name() == "Expires") {
+            break;
+        case Element::Expires:
             timeInfo.setExpires(readBool());
-        } else if (m_xml.name() == "UsageCount") {
+            break;
+        case Element::UsageCount:
             timeInfo.setUsageCount(readNumber());
-        } else if (m_xml.name() == "LocationChanged") {
+            break;
+        case Element::LocationChanged:
             timeInfo.setLocationChanged(readDateTime());
-        } else {
+            break;
+        default:
             skipCurrentElement();
+            break;
         }
     }
 
@@ -983,9 +1264,8 @@ QString KdbxXmlReader::readString()
 
 QString KdbxXmlReader::readString(bool& isProtected, bool& protectInMemory)
 {
-    QXmlStreamAttributes attr = m_xml.attributes();
-    isProtected = isTrueValue(attr.value("Protected"));
-    protectInMemory = isTrueValue(attr.value("ProtectInMemory"));
+    isProtected = isTrueValue(m_xml.attributeValue("Protected"));
+    protectInMemory = isTrueValue(m_xml.attributeValue("ProtectInMemory"));
     QString value = m_xml.readElementText();
 
     if (isProtected && !value.isEmpty()) {
@@ -1004,17 +1284,43 @@ QString KdbxXmlReader::readString(bool& isProtected, bool& protectInMemory)
     return value;
 }
 
+/**
+ * Read the character data of the current element without copying it.
+ *
+ * Protected values are decrypted into buffer, data is only valid until
+ * the next read.
+ */
+void KdbxXmlReader::readElementData(const char*& data, int& size, QByteArray& buffer)
+{
+    if (isTrueValue(m_xml.attributeValue("Protected"))) {
+        buffer = readString().toUtf8();
+        data = buffer.constData();
+        size = buffer.size();
+        return;
+    }
+
+    m_xml.readElementData(data, size);
+}
+
 bool KdbxXmlReader::readBool()
 {
-    QString str = readString();
+    QByteArray buffer;
+    const char* data;
+    int size;
+    readElementData(data, size, buffer);
 
-    if (str.compare("true", Qt::CaseInsensitive) == 0) {
+    if (size == 4 && qstrnicmp(data, "true", 4) == 0) {
         return true;
     }
-    if (str.compare("false", Qt::CaseInsensitive) == 0) {
+    if ((size == 5 && qstrnicmp(data, "false", 5) == 0) || size == 0) {
         return false;
     }
-    if (str.length() == 0) {
+
+    const QString str = QString::fromUtf8(data, size);
+    if (str.compare("true", Qt::CaseInsensitive) == 0) {
+        return true;
+    }
+    if (str.compare("false", Qt::CaseInsensitive) == 0) {
         return false;
     }
     raiseError(tr("Invalid bool value"));
@@ -1023,8 +1329,18 @@ bool KdbxXmlReader::readBool()
 
 QDateTime KdbxXmlReader::readDateTime()
 {
+    QByteArray buffer;
+    const char* data;
+    int size;
+    readElementData(data, size, buffer);
+
+    QDateTime dt;
+    if (decodeDateTime(data, size, dt)) {
+        return dt;
+    }
+
     static QRegularExpression b64regex("^(?:[A-Za-z0-9+/]{4})*(?:[A-Za-z0-9+/]{2}==|[A-Za-z0-9+/]{3}=)?$");
-    QString str = readString();
+    QString str = QString::fromUtf8(data, size);
 
     if (b64regex.match(str).hasMatch()) {
         QByteArray secsBytes = QByteArray::fromBase64(str.toUtf8()).leftJustified(8, '\0', true).left(8);
@@ -1032,7 +1348,7 @@ QDateTime KdbxXmlReader::readDateTime()
         return QDateTime(QDate(1, 1, 1), QTime(0, 0, 0, 0), Qt::UTC).addSecs(secs);
     }
 
-    QDateTime dt = QDateTime::fromString(str, Qt::ISODate);
+    dt = QDateTime::fromString(str, Qt::ISODate);
     if (dt.isValid()) {
         return dt;
     }
@@ -1085,8 +1401,19 @@ QColor KdbxXmlReader::readColor()
 
 int KdbxXmlReader::readNumber()
 {
+    QByteArray buffer;
+    const char* data;
+    int size;
+    readElementData(data, size, buffer);
+
+    int result;
+    if (decodeNumber(data, size, result)) {
+        return result;
+    }
+
+    // whitespace and the like
     bool ok;
-    int result = readString().toInt(&ok);
+    result = QString::fromUtf8(data, size).toInt(&ok);
     if (!ok) {
         raiseError(tr("Invalid number value"));
     }
@@ -1095,7 +1422,31 @@ int KdbxXmlReader::readNumber()
 
 QUuid KdbxXmlReader::readUuid()
 {
-    QByteArray uuidBin = readBinary();
+    QByteArray uuidBin;
+    if (isTrueValue(m_xml.attributeValue("Protected"))) {
+        uuidBin = readBinary();
+    } else {
+        const char* data;
+        int size;
+        m_xml.readElementData(data, size);
+
+        uchar bytes[UUID_LENGTH];
+        if (decodeBase64(data, size, bytes, UUID_LENGTH) == UUID_LENGTH) {
+            return QUuid(qFromBigEndian<quint32>(bytes),
+                         qFromBigEndian<quint16>(bytes + 4),
+                         qFromBigEndian<quint16>(bytes + 6),
+                         bytes[8],
+                         bytes[9],
+                         bytes[10],
+                         bytes[11],
+                         bytes[12],
+                         bytes[13],
+                         bytes[14],
+                         bytes[15]);
+        }
+        uuidBin = QByteArray::fromBase64(QByteArray(data, size));
+    }
+
     if (uuidBin.isEmpty()) {
         return QUuid();
     }
@@ -1110,10 +1461,8 @@ QUuid KdbxXmlReader::readUuid()
 
 QByteArray KdbxXmlReader::readBinary()
 {
-    QXmlStreamAttributes attr = m_xml.attributes();
-    bool isProtected = isTrueValue(attr.value("Protected"));
-    QString value = m_xml.readElementText();
-    QByteArray data = QByteArray::fromBase64(value.toLatin1());
+    bool isProtected = isTrueValue(m_xml.attributeValue("Protected"));
+    QByteArray data = QByteArray::fromBase64(m_xml.readElementBytes());
 
     if (isProtected && !data.isEmpty()) {
         bool ok;
@@ -1187,6 +1536,6 @@ Entry* KdbxXmlReader::getEntry(const QUuid& uuid)
 
 void KdbxXmlReader::skipCurrentElement()
 {
-    qWarning("KdbxXmlReader::skipCurrentElement: skip element \"%s\"", qPrintable(m_xml.name().toString()));
+    qWarning("KdbxXmlReader::skipCurrentElement: skip element \"%s\"", qPrintable(m_xml.name()));
     m_xml.skipCurrentElement();
 }
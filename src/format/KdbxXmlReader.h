@@ -22,11 +22,11 @@
 #include "core/Metadata.h"
 #include "core/TimeInfo.h"
 #include "core/Database.h"
+#include "format/KdbxXmlTokenizer.h"
 
 #include <QCoreApplication>
 #include <QPair>
 #include <QString>
-#include <QXmlStreamReader>
 
 class QIODevice;
 class Group;
@@ -56,9 +56,11 @@ public:
 
     bool strictMode() const;
     void setStrictMode(bool strictMode);
+    void setBinaryContentIds(const QHash<QString, QByteArray>& contentIds);
 
 protected:
     typedef QPair<QString, QString> StringPair;
+    typedef KdbxXmlTokenizer::Element Element;
 
     virtual bool parseKeePassFile();
     virtual void parseMeta();
@@ -82,6 +84,7 @@ protected:
 
     virtual QString readString();
     virtual QString readString(bool& isProtected, bool& protectInMemory);
+    virtual void readElementData(const char*& data, int& size, QByteArray& buffer);
     virtual bool readBool();
     virtual QDateTime readDateTime();
     virtual QColor readColor();
@@ -105,13 +108,14 @@ protected:
     QPointer<Database> m_db;
     QPointer<Metadata> m_meta;
     KeePass2RandomStream* m_randomStream = nullptr;
-    QXmlStreamReader m_xml;
+    KdbxXmlTokenizer m_xml;
 
     QScopedPointer<Group> m_tmpParent;
     QHash<QUuid, Group*> m_groups;
     QHash<QUuid, Entry*> m_entries;
 
     QHash<QString, QByteArray> m_binaryPool;
+    QHash<QString, QByteArray> m_binaryContentIds;
     QHash<QString, QPair<Entry*, QString>> m_binaryMap;
     QByteArray m_headerHash;
 
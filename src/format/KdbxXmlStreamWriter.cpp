@@ -0,0 +1,432 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "KdbxXmlStreamWriter.h"
+
+#include <QIODevice>
+
+#include <cstring>
+
+namespace
+{
+    const int ChunkSize = 64 * 1024;
+
+    // a newline followed by the indentation of the deepest level that is written in one go
+    const char Indentation[] = "\n\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+    const int MaxIndentationLevel = sizeof(Indentation) - 2;
+
+    const char Base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    void warnInvalidCodePoint(ushort uc)
+    {
+        qWarning("Stripping invalid XML 1.0 codepoint %x", uc);
+    }
+} // namespace
+
+KdbxXmlStreamWriter::KdbxXmlStreamWriter()
+    : m_device(nullptr)
+    , m_inStartElement(false)
+    , m_inEmptyElement(false)
+    , m_lastWasStartElement(false)
+    , m_wroteSomething(false)
+    , m_base64CarrySize(0)
+    , m_error(false)
+{
+    // keeps the capacity when the buffer is resized to 0 after a flush
+    m_buffer.reserve(ChunkSize + ChunkSize / 4);
+}
+
+void KdbxXmlStreamWriter::setDevice(QIODevice* device)
+{
+    m_device = device;
+    m_buffer.resize(0);
+    m_elements.clear();
+    m_inStartElement = false;
+    m_inEmptyElement = false;
+    m_lastWasStartElement = false;
+    m_wroteSomething = false;
+    m_base64CarrySize = 0;
+    m_error = false;
+}
+
+void KdbxXmlStreamWriter::writeStartDocument()
+{
+    finishStartElement(false);
+    static const char declaration[] = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>";
+    append(declaration, sizeof(declaration) - 1);
+}
+
+/**
+ * Close all open elements and write the remaining output to the device.
+ */
+void KdbxXmlStreamWriter::writeEndDocument()
+{
+    while (!m_elements.isEmpty()) {
+        writeEndElement();
+    }
+    append("\n", 1);
+    flush();
+}
+
+void KdbxXmlStreamWriter::writeStartElement(const char* name)
+{
+    if (!finishStartElement(false)) {
+        indent(m_elements.size());
+    }
+
+    m_elements.append(name);
+    append("<", 1);
+    append(name, static_cast<int>(qstrlen(name)));
+    m_inStartElement = true;
+    m_lastWasStartElement = true;
+}
+
+void KdbxXmlStreamWriter::writeEmptyElement(const char* name)
+{
+    writeStartElement(name);
+    m_inEmptyElement = true;
+}
+
+void KdbxXmlStreamWriter::writeEndElement()
+{
+    if (m_elements.isEmpty()) {
+        return;
+    }
+
+    finishBase64();
+
+    // an element without contents is closed as empty element
+    if (m_inStartElement && !m_inEmptyElement) {
+        append("/>", 2);
+        m_elements.removeLast();
+        m_inStartElement = false;
+        m_lastWasStartElement = false;
+        flushIfFull();
+        return;
+    }
+
+    if (!finishStartElement(false) && !m_lastWasStartElement) {
+        indent(m_elements.size() - 1);
+    }
+    if (m_elements.isEmpty()) {
+        return;
+    }
+
+    const char* name = m_elements.takeLast();
+    append("</", 2);
+    append(name, static_cast<int>(qstrlen(name)));
+    append(">", 1);
+    m_lastWasStartElement = false;
+    flushIfFull();
+}
+
+/**
+ * Write an attribute of the current start element. The value is written as is,
+ * it must not contain any characters that need escaping.
+ */
+void KdbxXmlStreamWriter::writeAttribute(const char* name, const char* value)
+{
+    Q_ASSERT(m_inStartElement);
+
+    append(" ", 1);
+    append(name, static_cast<int>(qstrlen(name)));
+    append("=\"", 2);
+    append(value, static_cast<int>(qstrlen(value)));
+    append("\"", 1);
+}
+
+void KdbxXmlStreamWriter::writeAttribute(const char* name, int value)
+{
+    char number[12];
+    number[formatNumber(value, number)] = '\0';
+    writeAttribute(name, number);
+}
+
+void KdbxXmlStreamWriter::writeCharacters(const QString& text)
+{
+    finishStartElement(true);
+    appendEscaped(text);
+}
+
+/**
+ * Write character data that is known not to need escaping, e.g. numbers.
+ */
+void KdbxXmlStreamWriter::writeAsciiCharacters(const char* data, int size)
+{
+    finishStartElement(true);
+    append(data, size);
+    flushIfFull();
+}
+
+/**
+ * Write data as base64 encoded character data.
+ *
+ * Consecutive calls continue the same base64 text, the padding is written
+ * with the end of the element.
+ */
+void KdbxXmlStreamWriter::writeBase64(const char* data, int size)
+{
+    finishStartElement(true);
+
+    const uchar* in = reinterpret_cast<const uchar*>(data);
+    if (m_base64CarrySize > 0) {
+        while (m_base64CarrySize < 2 && size > 0) {
+            m_base64Carry[m_base64CarrySize++] = *in++;
+            --size;
+        }
+        if (size == 0) {
+            return;
+        }
+
+        const uchar group[3] = {m_base64Carry[0], m_base64Carry[1], *in++};
+        --size;
+        char encoded[4];
+        append(encoded, encodeBase64(group, 3, encoded));
+        m_base64CarrySize = 0;
+    }
+
+    const int groupsSize = size - size % 3;
+    for (int pos = 0; pos < groupsSize; pos += ChunkSize / 4 * 3) {
+        const int sliceSize = qMin(groupsSize - pos, ChunkSize / 4 * 3);
+        const int start = m_buffer.size();
+        m_buffer.resize(start + sliceSize / 3 * 4);
+        encodeBase64(in + pos, sliceSize, m_buffer.data() + start);
+        flushIfFull();
+    }
+
+    m_base64CarrySize = size - groupsSize;
+    for (int i = 0; i < m_base64CarrySize; ++i) {
+        m_base64Carry[i] = in[groupsSize + i];
+    }
+}
+
+/**
+ * Write the buffered output to the device.
+ */
+bool KdbxXmlStreamWriter::flush()
+{
+    if (!m_error && !m_buffer.isEmpty()) {
+        if (!m_device || m_device->write(m_buffer) != m_buffer.size()) {
+            m_error = true;
+        }
+    }
+
+    // output after an error is dropped
+    m_buffer.resize(0);
+    return !m_error;
+}
+
+bool KdbxXmlStreamWriter::hasError() const
+{
+    return m_error;
+}
+
+/**
+ * Base64 encode data including padding.
+ *
+ * @param out buffer for at least (size + 2) / 3 * 4 characters
+ * @return number of characters written
+ */
+int KdbxXmlStreamWriter::encodeBase64(const uchar* data, int size, char* out)
+{
+    char* const begin = out;
+    int i = 0;
+    for (; i + 3 <= size; i += 3) {
+        const quint32 bits = (quint32(data[i]) << 16) | (quint32(data[i + 1]) << 8) | data[i + 2];
+        *out++ = Base64Alphabet[bits >> 18];
+        *out++ = Base64Alphabet[(bits >> 12) & 0x3F];
+        *out++ = Base64Alphabet[(bits >> 6) & 0x3F];
+        *out++ = Base64Alphabet[bits & 0x3F];
+    }
+
+    if (i < size) {
+        const quint32 bits = (quint32(data[i]) << 16) | (i + 1 < size ? quint32(data[i + 1]) << 8 : 0);
+        *out++ = Base64Alphabet[bits >> 18];
+        *out++ = Base64Alphabet[(bits >> 12) & 0x3F];
+        *out++ = i + 1 < size ? Base64Alphabet[(bits >> 6) & 0x3F] : '=';
+        *out++ = '=';
+    }
+
+    return static_cast<int>(out - begin);
+}
+
+/**
+ * Format value as decimal number.
+ *
+ * @param out buffer for at least 11 characters
+ * @return number of characters written
+ */
+int KdbxXmlStreamWriter::formatNumber(int value, char* out)
+{
+    char digits[10];
+    int count = 0;
+    quint32 magnitude = value < 0 ? 0u - static_cast<quint32>(value) : static_cast<quint32>(value);
+    do {
+        digits[count++] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+
+    int size = 0;
+    if (value < 0) {
+        out[size++] = '-';
+    }
+    while (count > 0) {
+        out[size++] = digits[--count];
+    }
+    return size;
+}
+
+/**
+ * Close a pending start tag, mirrors QXmlStreamWriter.
+ *
+ * @param contents whether character data follows
+ * @return whether character data was written since the last tag
+ */
+bool KdbxXmlStreamWriter::finishStartElement(bool contents)
+{
+    const bool hadSomethingWritten = m_wroteSomething;
+    m_wroteSomething = contents;
+    if (!m_inStartElement) {
+        return hadSomethingWritten;
+    }
+
+    if (m_inEmptyElement) {
+        append("/>", 2);
+        m_elements.removeLast();
+        m_lastWasStartElement = false;
+    } else {
+        append(">", 1);
+    }
+    m_inStartElement = false;
+    m_inEmptyElement = false;
+    return hadSomethingWritten;
+}
+
+void KdbxXmlStreamWriter::finishBase64()
+{
+    if (m_base64CarrySize == 0) {
+        return;
+    }
+
+    char encoded[4];
+    append(encoded, encodeBase64(m_base64Carry, m_base64CarrySize, encoded));
+    m_base64CarrySize = 0;
+}
+
+void KdbxXmlStreamWriter::indent(int level)
+{
+    while (level > MaxIndentationLevel) {
+        append(Indentation + 1, MaxIndentationLevel);
+        level -= MaxIndentationLevel;
+    }
+    append(Indentation, level + 1);
+}
+
+void KdbxXmlStreamWriter::append(const char* data, int size)
+{
+    m_buffer.append(data, size);
+}
+
+/**
+ * Append text as escaped UTF-8 and drop code points that are not allowed in XML 1.0.
+ */
+void KdbxXmlStreamWriter::appendEscaped(const QString& text)
+{
+    const ushort* in = text.utf16();
+    const int size = text.size();
+
+    int pos = 0;
+    while (pos < size) {
+        int end = qMin(size, pos + ChunkSize);
+        if (end < size && QChar::isHighSurrogate(in[end - 1])) {
+            // keep surrogate pairs in one slice
+            ++end;
+        }
+
+        // "&quot;" is the longest encoding of a single UTF-16 code unit
+        const int start = m_buffer.size();
+        m_buffer.resize(start + (end - pos) * 6);
+        char* const begin = m_buffer.data() + start;
+        char* out = begin;
+
+        for (; pos < end; ++pos) {
+            const ushort uc = in[pos];
+            if (uc >= 0x20 && uc < 0x7F && uc != '<' && uc != '>' && uc != '&' && uc != '"') {
+                *out++ = static_cast<char>(uc);
+            } else if (uc < 0x80) {
+                switch (uc) {
+                case '<':
+                    std::memcpy(out, "&lt;", 4);
+                    out += 4;
+                    break;
+                case '>':
+                    std::memcpy(out, "&gt;", 4);
+                    out += 4;
+                    break;
+                case '&':
+                    std::memcpy(out, "&amp;", 5);
+                    out += 5;
+                    break;
+                case '"':
+                    std::memcpy(out, "&quot;", 6);
+                    out += 6;
+                    break;
+                case '\t':
+                case '\n':
+                case '\r':
+                    *out++ = static_cast<char>(uc);
+                    break;
+                default:
+                    // control characters
+                    warnInvalidCodePoint(uc);
+                    break;
+                }
+            } else if (uc < 0x800) {
+                if (uc <= 0x9F && uc != 0x85) {
+                    // control characters, valid but discouraged by XML
+                    warnInvalidCodePoint(uc);
+                    continue;
+                }
+                *out++ = static_cast<char>(0xC0 | (uc >> 6));
+                *out++ = static_cast<char>(0x80 | (uc & 0x3F));
+            } else if (QChar::isHighSurrogate(uc) && pos + 1 < end && QChar::isLowSurrogate(in[pos + 1])) {
+                const uint ucs4 = QChar::surrogateToUcs4(uc, in[++pos]);
+                *out++ = static_cast<char>(0xF0 | (ucs4 >> 18));
+                *out++ = static_cast<char>(0x80 | ((ucs4 >> 12) & 0x3F));
+                *out++ = static_cast<char>(0x80 | ((ucs4 >> 6) & 0x3F));
+                *out++ = static_cast<char>(0x80 | (ucs4 & 0x3F));
+            } else if (QChar::isSurrogate(uc) || uc > 0xFFFD) {
+                // single surrogate or noncharacter
+                warnInvalidCodePoint(uc);
+            } else {
+                *out++ = static_cast<char>(0xE0 | (uc >> 12));
+                *out++ = static_cast<char>(0x80 | ((uc >> 6) & 0x3F));
+                *out++ = static_cast<char>(0x80 | (uc & 0x3F));
+            }
+        }
+
+        m_buffer.resize(start + static_cast<int>(out - begin));
+        flushIfFull();
+    }
+}
+
+void KdbxXmlStreamWriter::flushIfFull()
+{
+    if (m_buffer.size() >= ChunkSize) {
+        flush();
+    }
+}
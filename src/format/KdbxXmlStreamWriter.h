@@ -0,0 +1,87 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_KDBXXMLSTREAMWRITER_H
+#define KEEPASSX_KDBXXMLSTREAMWRITER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+class QIODevice;
+
+/**
+ * Streaming writer for the KDBX XML payload.
+ *
+ * Provides the subset of the QXmlStreamWriter interface the KdbxXmlWriter
+ * needs and produces the same output as an auto formatting QXmlStreamWriter
+ * indenting with tabs. Text is escaped and encoded to UTF-8 straight into a
+ * reusable output buffer, which is written to the device in chunks.
+ *
+ * Element and attribute names have to be string literals, they are not
+ * copied. Code points that are not allowed in XML 1.0 are dropped.
+ */
+class KdbxXmlStreamWriter
+{
+public:
+    KdbxXmlStreamWriter();
+
+    void setDevice(QIODevice* device);
+
+    void writeStartDocument();
+    void writeEndDocument();
+    void writeStartElement(const char* name);
+    void writeEmptyElement(const char* name);
+    void writeEndElement();
+    void writeAttribute(const char* name, const char* value);
+    void writeAttribute(const char* name, int value);
+
+    void writeCharacters(const QString& text);
+    void writeAsciiCharacters(const char* data, int size);
+    void writeBase64(const char* data, int size);
+
+    bool flush();
+    bool hasError() const;
+
+    static int encodeBase64(const uchar* data, int size, char* out);
+    static int formatNumber(int value, char* out);
+
+private:
+    bool finishStartElement(bool contents);
+    void finishBase64();
+    void indent(int level);
+    void append(const char* data, int size);
+    void appendEscaped(const QString& text);
+    void flushIfFull();
+
+    QIODevice* m_device;
+    QByteArray m_buffer;
+    QVector<const char*> m_elements;
+
+    bool m_inStartElement;
+    bool m_inEmptyElement;
+    bool m_lastWasStartElement;
+    bool m_wroteSomething;
+
+    // input bytes of an unfinished base64 group
+    uchar m_base64Carry[2];
+    int m_base64CarrySize;
+
+    bool m_error;
+};
+
+#endif // KEEPASSX_KDBXXMLSTREAMWRITER_H
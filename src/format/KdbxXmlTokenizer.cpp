@@ -0,0 +1,1161 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "KdbxXmlTokenizer.h"
+
+#include <QHash>
+#include <QIODevice>
+#include <QXmlStreamReader>
+
+#include <cstring>
+
+namespace
+{
+    const int ChunkSize = 64 * 1024;
+
+    // names of the KdbxXmlTokenizer::Element values, in the order of the enum
+    const char* const ElementNames[] = {
+        "Association",
+        "AutoType",
+        "BackgroundColor",
+        "Binaries",
+        "Binary",
+        "Color",
+        "CreationTime",
+        "CustomData",
+        "CustomIconUUID",
+        "CustomIcons",
+        "Data",
+        "DataTransferObfuscation",
+        "DatabaseDescription",
+        "DatabaseDescriptionChanged",
+        "DatabaseName",
+        "DatabaseNameChanged",
+        "DefaultAutoTypeSequence",
+        "DefaultSequence",
+        "DefaultUserName",
+        "DefaultUserNameChanged",
+        "DeletedObject",
+        "DeletedObjects",
+        "DeletionTime",
+        "EnableAutoType",
+        "EnableSearching",
+        "Enabled",
+        "Entry",
+        "EntryTemplatesGroup",
+        "EntryTemplatesGroupChanged",
+        "Expires",
+        "ExpiryTime",
+        "ForegroundColor",
+        "Generator",
+        "Group",
+        "HeaderHash",
+        "History",
+        "HistoryMaxItems",
+        "HistoryMaxSize",
+        "Icon",
+        "IconID",
+        "IsExpanded",
+        "Item",
+        "KeePassFile",
+        "Key",
+        "KeystrokeSequence",
+        "LastAccessTime",
+        "LastModificationTime",
+        "LastSelectedGroup",
+        "LastTopVisibleEntry",
+        "LastTopVisibleGroup",
+        "LocationChanged",
+        "MaintenanceHistoryDays",
+        "MasterKeyChangeForce",
+        "MasterKeyChangeRec",
+        "MasterKeyChanged",
+        "MemoryProtection",
+        "Meta",
+        "Name",
+        "Notes",
+        "OverrideURL",
+        "ProtectNotes",
+        "ProtectPassword",
+        "ProtectTitle",
+        "ProtectURL",
+        "ProtectUserName",
+        "RecycleBinChanged",
+        "RecycleBinEnabled",
+        "RecycleBinUUID",
+        "Root",
+        "SettingsChanged",
+        "String",
+        "Tags",
+        "Times",
+        "UUID",
+        "UsageCount",
+        "Value",
+        "Window",
+    };
+
+    const int ElementCount = sizeof(ElementNames) / sizeof(ElementNames[0]);
+
+    struct ElementTable
+    {
+        ElementTable()
+        {
+            for (int i = 0; i < ElementCount; ++i) {
+                names[i + 1] = QByteArray::fromRawData(ElementNames[i], static_cast<int>(qstrlen(ElementNames[i])));
+                ids.insert(names[i + 1], static_cast<KdbxXmlTokenizer::Element>(i + 1));
+            }
+        }
+
+        QByteArray names[ElementCount + 1];
+        QHash<QByteArray, KdbxXmlTokenizer::Element> ids;
+    };
+
+    const ElementTable& elementTable()
+    {
+        static const ElementTable table;
+        return table;
+    }
+
+    inline bool isWhitespace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    inline bool isNameEnd(char c)
+    {
+        return isWhitespace(c) || c == '>' || c == '/' || c == '=';
+    }
+
+    /**
+     * Whether a code point matches the Char production of XML 1.0.
+     */
+    inline bool isXmlChar(uint ucs4)
+    {
+        if (ucs4 < 0x20) {
+            return ucs4 == 0x9 || ucs4 == 0xA || ucs4 == 0xD;
+        }
+        return (ucs4 < 0xD800) || (ucs4 >= 0xE000 && ucs4 <= 0xFFFD) || (ucs4 >= 0x10000 && ucs4 <= 0x10FFFF);
+    }
+
+    inline bool isContinuation(uchar c)
+    {
+        return (c & 0xC0) == 0x80;
+    }
+
+    /**
+     * Whether data is well-formed UTF-8 consisting of XML 1.0 characters only.
+     */
+    bool isValidText(const char* text, int size)
+    {
+        const uchar* data = reinterpret_cast<const uchar*>(text);
+        int pos = 0;
+        while (pos < size) {
+            const uchar c = data[pos];
+            if (c >= 0x20 && c < 0x80) {
+                ++pos;
+                continue;
+            }
+            if (c < 0x20) {
+                if (!isXmlChar(c)) {
+                    return false;
+                }
+                ++pos;
+                continue;
+            }
+
+            // overlong forms and surrogates are excluded by the range of the second byte
+            int length;
+            uchar min = 0x80;
+            uchar max = 0xBF;
+            if (c >= 0xC2 && c <= 0xDF) {
+                length = 2;
+            } else if (c >= 0xE0 && c <= 0xEF) {
+                length = 3;
+                min = c == 0xE0 ? 0xA0 : 0x80;
+                max = c == 0xED ? 0x9F : 0xBF;
+            } else if (c >= 0xF0 && c <= 0xF4) {
+                length = 4;
+                min = c == 0xF0 ? 0x90 : 0x80;
+                max = c == 0xF4 ? 0x8F : 0xBF;
+            } else {
+                return false;
+            }
+            if (size - pos < length || data[pos + 1] < min || data[pos + 1] > max) {
+                return false;
+            }
+            for (int i = 2; i < length; ++i) {
+                if (!isContinuation(data[pos + i])) {
+                    return false;
+                }
+            }
+            // U+FFFE and U+FFFF
+            if (c == 0xEF && data[pos + 1] == 0xBF && data[pos + 2] >= 0xBE) {
+                return false;
+            }
+            pos += length;
+        }
+        return true;
+    }
+
+    bool isWhitespaceOnly(const char* data, int size)
+    {
+        for (int i = 0; i < size; ++i) {
+            if (!isWhitespace(data[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void appendUtf8(QByteArray& out, uint ucs4)
+    {
+        if (ucs4 < 0x80) {
+            out.append(static_cast<char>(ucs4));
+        } else if (ucs4 < 0x800) {
+            out.append(static_cast<char>(0xC0 | (ucs4 >> 6)));
+            out.append(static_cast<char>(0x80 | (ucs4 & 0x3F)));
+        } else if (ucs4 < 0x10000) {
+            out.append(static_cast<char>(0xE0 | (ucs4 >> 12)));
+            out.append(static_cast<char>(0x80 | ((ucs4 >> 6) & 0x3F)));
+            out.append(static_cast<char>(0x80 | (ucs4 & 0x3F)));
+        } else {
+            out.append(static_cast<char>(0xF0 | (ucs4 >> 18)));
+            out.append(static_cast<char>(0x80 | ((ucs4 >> 12) & 0x3F)));
+            out.append(static_cast<char>(0x80 | ((ucs4 >> 6) & 0x3F)));
+            out.append(static_cast<char>(0x80 | (ucs4 & 0x3F)));
+        }
+    }
+} // namespace
+
+KdbxXmlTokenizer::KdbxXmlTokenizer()
+{
+    clear();
+}
+
+KdbxXmlTokenizer::~KdbxXmlTokenizer()
+{
+}
+
+void KdbxXmlTokenizer::setDevice(QIODevice* device)
+{
+    clear();
+    m_device = device;
+}
+
+/**
+ * Reset the tokenizer, removing the device and all buffered data.
+ */
+void KdbxXmlTokenizer::clear()
+{
+    m_device = nullptr;
+    m_buffer.clear();
+    m_pos = 0;
+    m_deviceAtEnd = false;
+    m_prologRead = false;
+    m_lineOffset = 0;
+    m_columnOffset = 0;
+
+    m_token = NoToken;
+    m_element = Element::Unknown;
+    m_nameStart = 0;
+    m_nameSize = 0;
+    m_emptyElement = false;
+    m_attributes.clear();
+    m_openElements.clear();
+
+    m_text.clear();
+    // keeps the allocation of m_text when it is resized to 0
+    m_text.reserve(256);
+    m_textStart = 0;
+    m_textSize = 0;
+    m_textCopied = false;
+
+    m_fallback.reset();
+    m_fallbackName.clear();
+
+    m_error = false;
+    m_errorString.clear();
+    m_errorLine = 0;
+    m_errorColumn = 0;
+}
+
+/**
+ * Read until the next start element within the current element.
+ *
+ * @return true if a start element was found, false when the end of
+ *         the current element has been reached or on error
+ */
+bool KdbxXmlTokenizer::readNextStartElement()
+{
+    while (true) {
+        const Token token = readNext(false);
+        if (token == StartElement) {
+            return true;
+        }
+        if (token == EndElement || token == EndDocument || token == Invalid) {
+            return false;
+        }
+    }
+}
+
+bool KdbxXmlTokenizer::isStartElement() const
+{
+    return m_token == StartElement;
+}
+
+/**
+ * Id of the current element, Element::Unknown for names outside the KDBX schema.
+ */
+KdbxXmlTokenizer::Element KdbxXmlTokenizer::element() const
+{
+    return m_element;
+}
+
+QString KdbxXmlTokenizer::name() const
+{
+    if (m_fallback) {
+        return m_fallbackName;
+    }
+    return QString::fromUtf8(m_buffer.constData() + m_nameStart, m_nameSize);
+}
+
+bool KdbxXmlTokenizer::hasAttribute(const char* name) const
+{
+    for (const Attribute& attr : m_attributes) {
+        if (attr.name == QLatin1String(name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Value of an attribute of the current start element, it stays valid
+ * until the next element is read.
+ */
+QStringRef KdbxXmlTokenizer::attributeValue(const char* name) const
+{
+    for (const Attribute& attr : m_attributes) {
+        if (attr.name == QLatin1String(name)) {
+            return QStringRef(&attr.value);
+        }
+    }
+    return QStringRef();
+}
+
+QString KdbxXmlTokenizer::readElementText()
+{
+    if (m_fallback) {
+        const QString text = m_fallback->readElementText();
+        m_token = m_fallback->isEndElement() ? EndElement : Invalid;
+        return text;
+    }
+
+    const char* data;
+    int size;
+    readElementData(data, size);
+    return QString::fromUtf8(data, size);
+}
+
+QByteArray KdbxXmlTokenizer::readElementBytes()
+{
+    const char* data;
+    int size;
+    readElementData(data, size);
+    return QByteArray(data, size);
+}
+
+/**
+ * Read the character data of the current start element as UTF-8.
+ *
+ * The data usually points into the input buffer directly, it is only
+ * valid until the next call of any other method of the tokenizer.
+ */
+void KdbxXmlTokenizer::readElementData(const char*& data, int& size)
+{
+    data = "";
+    size = 0;
+
+    if (m_token != StartElement) {
+        return;
+    }
+
+    m_text.resize(0);
+    m_textStart = 0;
+    m_textSize = 0;
+    m_textCopied = false;
+
+    while (true) {
+        const Token token = readNext(true);
+        if (token == EndElement) {
+            break;
+        }
+        if (token == StartElement) {
+            raiseError(tr("Expected character data."));
+            return;
+        }
+        if (token == EndDocument || token == Invalid) {
+            return;
+        }
+    }
+
+    if (m_textCopied) {
+        data = m_text.constData();
+        size = m_text.size();
+    } else {
+        data = m_buffer.constData() + m_textStart;
+        size = m_textSize;
+    }
+}
+
+void KdbxXmlTokenizer::skipCurrentElement()
+{
+    int depth = 1;
+    while (depth > 0) {
+        const Token token = readNext(false);
+        if (token == EndElement) {
+            --depth;
+        } else if (token == StartElement) {
+            ++depth;
+        } else {
+            return;
+        }
+    }
+}
+
+/**
+ * Whether the document is parsed by QXmlStreamReader instead.
+ */
+bool KdbxXmlTokenizer::usesFallback() const
+{
+    return !m_fallback.isNull();
+}
+
+bool KdbxXmlTokenizer::hasError() const
+{
+    return m_error || (m_fallback && m_fallback->hasError());
+}
+
+QString KdbxXmlTokenizer::errorString() const
+{
+    if (!m_error && m_fallback) {
+        return m_fallback->errorString();
+    }
+    return m_errorString;
+}
+
+qint64 KdbxXmlTokenizer::lineNumber() const
+{
+    if (!m_error && m_fallback) {
+        return m_fallback->lineNumber();
+    }
+    return m_errorLine;
+}
+
+qint64 KdbxXmlTokenizer::columnNumber() const
+{
+    if (!m_error && m_fallback) {
+        return m_fallback->columnNumber();
+    }
+    return m_errorColumn;
+}
+
+KdbxXmlTokenizer::Token KdbxXmlTokenizer::readNext(bool collectText)
+{
+    if (m_fallback) {
+        return readNextFallback(collectText);
+    }
+    if (m_error) {
+        return Invalid;
+    }
+
+    if (m_emptyElement) {
+        // <Name/> is reported as a start and an end element
+        m_emptyElement = false;
+        m_token = EndElement;
+        return m_token;
+    }
+
+    if (!m_prologRead) {
+        m_prologRead = true;
+        if (!readProlog()) {
+            return m_fallback ? readNextFallback(collectText) : Invalid;
+        }
+    }
+
+    // collected text refers to the buffer, it must not move while reading text
+    if (!collectText) {
+        compact();
+    }
+
+    while (true) {
+        if (m_pos >= m_buffer.size() && !fill()) {
+            if (!m_openElements.isEmpty() || m_token == NoToken) {
+                raiseError(tr("Premature end of document."));
+                return Invalid;
+            }
+            m_token = EndDocument;
+            return m_token;
+        }
+
+        if (m_buffer.at(m_pos) != '<') {
+            int end = find('<', m_pos);
+            if (end < 0) {
+                end = m_buffer.size();
+            }
+            if (m_openElements.isEmpty() && !isWhitespaceOnly(m_buffer.constData() + m_pos, end - m_pos)) {
+                raiseError(m_token == NoToken ? tr("Start tag expected.") : tr("Extra content at end of document."));
+                return Invalid;
+            }
+            if (!isValidText(m_buffer.constData() + m_pos, end - m_pos)) {
+                raiseError(tr("Invalid XML character or encoding."));
+                return Invalid;
+            }
+            if (collectText && !appendText(m_pos, end, true)) {
+                return Invalid;
+            }
+            m_pos = end;
+            continue;
+        }
+
+        if (!ensure(2)) {
+            raiseError(tr("Premature end of document."));
+            return Invalid;
+        }
+
+        const char next = m_buffer.at(m_pos + 1);
+        if (next == '/') {
+            if (!readEndTag()) {
+                return Invalid;
+            }
+            m_token = EndElement;
+            return m_token;
+        }
+
+        if (next == '?') {
+            const int end = find("?>", m_pos + 2);
+            if (end < 0) {
+                raiseError(tr("Premature end of document."));
+                return Invalid;
+            }
+            m_pos = end + 2;
+            continue;
+        }
+
+        if (next == '!') {
+            if (ensure(4) && std::memcmp(m_buffer.constData() + m_pos, "<!--", 4) == 0) {
+                const int end = find("-->", m_pos + 4);
+                if (end < 0) {
+                    raiseError(tr("Premature end of document."));
+                    return Invalid;
+                }
+                m_pos = end + 3;
+                continue;
+            }
+            if (ensure(9) && std::memcmp(m_buffer.constData() + m_pos, "<![CDATA[", 9) == 0) {
+                const int end = find("]]>", m_pos + 9);
+                if (end < 0) {
+                    raiseError(tr("Premature end of document."));
+                    return Invalid;
+                }
+                if (m_openElements.isEmpty()) {
+                    raiseError(tr("Extra content at end of document."));
+                    return Invalid;
+                }
+                if (!isValidText(m_buffer.constData() + m_pos + 9, end - m_pos - 9)) {
+                    raiseError(tr("Invalid XML character or encoding."));
+                    return Invalid;
+                }
+                if (collectText && !appendText(m_pos + 9, end, false)) {
+                    return Invalid;
+                }
+                m_pos = end + 3;
+                continue;
+            }
+            raiseError(tr("Unexpected '<!'."));
+            return Invalid;
+        }
+
+        if (m_openElements.isEmpty() && m_token != NoToken) {
+            // a second root element
+            raiseError(tr("Extra content at end of document."));
+            return Invalid;
+        }
+        if (!readStartTag()) {
+            return Invalid;
+        }
+        m_token = StartElement;
+        return m_token;
+    }
+}
+
+KdbxXmlTokenizer::Token KdbxXmlTokenizer::readNextFallback(bool collectText)
+{
+    while (true) {
+        switch (m_fallback->readNext()) {
+        case QXmlStreamReader::StartElement: {
+            m_token = StartElement;
+            m_fallbackName = m_fallback->name().toString();
+            const QByteArray name = m_fallbackName.toUtf8();
+            m_element = lookupElement(name.constData(), name.size());
+            m_attributes.clear();
+            const QXmlStreamAttributes attributes = m_fallback->attributes();
+            for (const QXmlStreamAttribute& attribute : attributes) {
+                m_attributes.append({attribute.name().toString(), attribute.value().toString()});
+            }
+            return m_token;
+        }
+        case QXmlStreamReader::EndElement: {
+            m_token = EndElement;
+            m_fallbackName = m_fallback->name().toString();
+            const QByteArray name = m_fallbackName.toUtf8();
+            m_element = lookupElement(name.constData(), name.size());
+            return m_token;
+        }
+        case QXmlStreamReader::Characters:
+        case QXmlStreamReader::EntityReference:
+            if (collectText) {
+                appendFallbackText();
+            }
+            break;
+        case QXmlStreamReader::EndDocument:
+            m_token = EndDocument;
+            return m_token;
+        case QXmlStreamReader::Invalid:
+            m_token = Invalid;
+            return m_token;
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * Skip the XML declaration and anything in front of the root element.
+ *
+ * @return false if the document is passed to the fallback reader or on error
+ */
+bool KdbxXmlTokenizer::readProlog()
+{
+    ensure(4);
+    const int available = m_buffer.size() - m_pos;
+    const uchar* data = reinterpret_cast<const uchar*>(m_buffer.constData() + m_pos);
+
+    if (available >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF) {
+        m_pos += 3;
+    } else if (available >= 2 && (data[0] == 0 || data[1] == 0 || (data[0] == 0xFE && data[1] == 0xFF)
+                                  || (data[0] == 0xFF && data[1] == 0xFE))) {
+        // UTF-16 or UTF-32
+        startFallback();
+        return false;
+    }
+
+    skipWhitespace();
+    if (ensure(6) && std::memcmp(m_buffer.constData() + m_pos, "<?xml", 5) == 0
+        && isWhitespace(m_buffer.at(m_pos + 5))) {
+        const int end = find("?>", m_pos + 5);
+        if (end < 0) {
+            raiseError(tr("Premature end of document."));
+            return false;
+        }
+
+        const QByteArray declaration = m_buffer.mid(m_pos, end - m_pos);
+        int pos = declaration.indexOf("encoding");
+        if (pos >= 0) {
+            pos = declaration.indexOf('=', pos) + 1;
+            while (pos > 0 && pos < declaration.size() && isWhitespace(declaration.at(pos))) {
+                ++pos;
+            }
+            if (pos > 0 && pos < declaration.size()) {
+                const char quote = declaration.at(pos);
+                const int valueEnd = declaration.indexOf(quote, pos + 1);
+                const QByteArray encoding = declaration.mid(pos + 1, valueEnd - pos - 1).toLower();
+                if (encoding != "utf-8" && encoding != "utf8") {
+                    startFallback();
+                    return false;
+                }
+            }
+        }
+        m_pos = end + 2;
+    }
+
+    while (true) {
+        skipWhitespace();
+        if (ensure(9) && std::memcmp(m_buffer.constData() + m_pos, "<!DOCTYPE", 9) == 0) {
+            // a DTD may declare entities
+            startFallback();
+            return false;
+        }
+        if (ensure(4) && std::memcmp(m_buffer.constData() + m_pos, "<!--", 4) == 0) {
+            const int end = find("-->", m_pos + 4);
+            if (end < 0) {
+                raiseError(tr("Premature end of document."));
+                return false;
+            }
+            m_pos = end + 3;
+            continue;
+        }
+        if (ensure(2) && std::memcmp(m_buffer.constData() + m_pos, "<?", 2) == 0) {
+            const int end = find("?>", m_pos + 2);
+            if (end < 0) {
+                raiseError(tr("Premature end of document."));
+                return false;
+            }
+            m_pos = end + 2;
+            continue;
+        }
+        return true;
+    }
+}
+
+void KdbxXmlTokenizer::startFallback()
+{
+    // nothing has been dropped from the buffer yet
+    m_fallback.reset(new QXmlStreamReader());
+    m_fallback->addData(m_buffer);
+    if (m_device) {
+        m_fallback->addData(m_device->readAll());
+    }
+    m_buffer.clear();
+    m_pos = 0;
+}
+
+/**
+ * Append the next chunk of the device to the buffer.
+ *
+ * @return false at the end of the device
+ */
+bool KdbxXmlTokenizer::fill()
+{
+    if (!m_device || m_deviceAtEnd) {
+        return false;
+    }
+
+    const int oldSize = m_buffer.size();
+    m_buffer.resize(oldSize + ChunkSize);
+    const qint64 bytesRead = m_device->read(m_buffer.data() + oldSize, ChunkSize);
+    if (bytesRead <= 0) {
+        m_buffer.resize(oldSize);
+        m_deviceAtEnd = true;
+        return false;
+    }
+
+    m_buffer.resize(oldSize + static_cast<int>(bytesRead));
+    return true;
+}
+
+/**
+ * Make sure at least size bytes are buffered from the current position.
+ */
+bool KdbxXmlTokenizer::ensure(int size)
+{
+    while (m_buffer.size() - m_pos < size) {
+        if (!fill()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Drop the consumed part of the buffer, keeping track of the line and column.
+ */
+void KdbxXmlTokenizer::compact()
+{
+    if (m_pos < ChunkSize) {
+        return;
+    }
+
+    const char* data = m_buffer.constData();
+    int lastNewline = -1;
+    for (int i = 0; i < m_pos; ++i) {
+        if (data[i] == '\n') {
+            ++m_lineOffset;
+            lastNewline = i;
+        }
+    }
+    m_columnOffset = lastNewline >= 0 ? m_pos - lastNewline - 1 : m_columnOffset + m_pos;
+
+    m_buffer.remove(0, m_pos);
+    m_pos = 0;
+}
+
+int KdbxXmlTokenizer::find(char c, int from)
+{
+    while (true) {
+        const char* data = m_buffer.constData();
+        const void* match = std::memchr(data + from, c, static_cast<size_t>(m_buffer.size() - from));
+        if (match) {
+            return static_cast<int>(static_cast<const char*>(match) - data);
+        }
+        from = m_buffer.size();
+        if (!fill()) {
+            return -1;
+        }
+    }
+}
+
+int KdbxXmlTokenizer::find(const char* str, int from)
+{
+    const int size = static_cast<int>(qstrlen(str));
+    while (true) {
+        const int pos = m_buffer.indexOf(str, from);
+        if (pos >= 0) {
+            return pos;
+        }
+        from = qMax(from, m_buffer.size() - size + 1);
+        if (!fill()) {
+            return -1;
+        }
+    }
+}
+
+bool KdbxXmlTokenizer::readStartTag()
+{
+    ++m_pos;
+
+    int start;
+    int size;
+    if (!readName(start, size)) {
+        return false;
+    }
+
+    m_element = lookupElement(m_buffer.constData() + start, size);
+    m_attributes.clear();
+    if (!readAttributes()) {
+        return false;
+    }
+
+    // the buffer may have grown while reading the attributes
+    m_nameStart = start;
+    m_nameSize = size;
+    if (!m_emptyElement) {
+        OpenElement openElement;
+        openElement.element = m_element;
+        if (m_element == Element::Unknown) {
+            openElement.name = QByteArray(m_buffer.constData() + start, size);
+        }
+        m_openElements.append(openElement);
+    }
+
+    return true;
+}
+
+bool KdbxXmlTokenizer::readEndTag()
+{
+    m_pos += 2;
+
+    int start;
+    int size;
+    if (!readName(start, size)) {
+        return false;
+    }
+
+    skipWhitespace();
+    if (!ensure(1) || m_buffer.at(m_pos) != '>') {
+        raiseError(tr("Expected '>'."));
+        return false;
+    }
+    ++m_pos;
+
+    if (m_openElements.isEmpty()) {
+        raiseError(tr("Unexpected end tag."));
+        return false;
+    }
+
+    const OpenElement& openElement = m_openElements.last();
+    const char* name = m_buffer.constData() + start;
+    const bool matches = openElement.element == Element::Unknown
+                             ? openElement.name == QByteArray::fromRawData(name, size)
+                             : matchesElement(openElement.element, name, size);
+    if (!matches) {
+        raiseError(tr("Opening and ending tag mismatch."));
+        return false;
+    }
+
+    m_element = openElement.element;
+    m_nameStart = start;
+    m_nameSize = size;
+    m_openElements.removeLast();
+    return true;
+}
+
+bool KdbxXmlTokenizer::readName(int& start, int& size)
+{
+    start = m_pos;
+    while (true) {
+        const char* data = m_buffer.constData();
+        const int bufferSize = m_buffer.size();
+        while (m_pos < bufferSize && !isNameEnd(data[m_pos])) {
+            ++m_pos;
+        }
+        if (m_pos < bufferSize) {
+            break;
+        }
+        if (!fill()) {
+            raiseError(tr("Premature end of document."));
+            return false;
+        }
+    }
+
+    size = m_pos - start;
+    if (size == 0) {
+        raiseError(tr("Expected a name."));
+        return false;
+    }
+    return true;
+}
+
+bool KdbxXmlTokenizer::readAttributes()
+{
+    m_emptyElement = false;
+
+    while (true) {
+        skipWhitespace();
+        if (!ensure(1)) {
+            raiseError(tr("Premature end of document."));
+            return false;
+        }
+
+        const char c = m_buffer.at(m_pos);
+        if (c == '>') {
+            ++m_pos;
+            return true;
+        }
+        if (c == '/') {
+            if (!ensure(2) || m_buffer.at(m_pos + 1) != '>') {
+                raiseError(tr("Expected '>'."));
+                return false;
+            }
+            m_pos += 2;
+            m_emptyElement = true;
+            return true;
+        }
+
+        int nameStart;
+        int nameSize;
+        if (!readName(nameStart, nameSize)) {
+            return false;
+        }
+
+        skipWhitespace();
+        if (!ensure(1) || m_buffer.at(m_pos) != '=') {
+            raiseError(tr("Expected '='."));
+            return false;
+        }
+        ++m_pos;
+
+        skipWhitespace();
+        if (!ensure(1)) {
+            raiseError(tr("Premature end of document."));
+            return false;
+        }
+        const char quote = m_buffer.at(m_pos);
+        if (quote != '"' && quote != '\'') {
+            raiseError(tr("Expected a quoted attribute value."));
+            return false;
+        }
+        const int end = find(quote, m_pos + 1);
+        if (end < 0) {
+            raiseError(tr("Premature end of document."));
+            return false;
+        }
+
+        if (!isValidText(m_buffer.constData() + m_pos + 1, end - m_pos - 1)) {
+            raiseError(tr("Invalid XML character or encoding."));
+            return false;
+        }
+        QByteArray value;
+        if (!decodeText(m_pos + 1, end, value)) {
+            return false;
+        }
+        Attribute attribute;
+        attribute.name = QString::fromUtf8(m_buffer.constData() + nameStart, nameSize);
+        attribute.value = QString::fromUtf8(value);
+        m_attributes.append(attribute);
+        m_pos = end + 1;
+    }
+}
+
+void KdbxXmlTokenizer::skipWhitespace()
+{
+    while (true) {
+        const char* data = m_buffer.constData();
+        const int size = m_buffer.size();
+        while (m_pos < size && isWhitespace(data[m_pos])) {
+            ++m_pos;
+        }
+        if (m_pos < size || !fill()) {
+            return;
+        }
+    }
+}
+
+/**
+ * Add a piece of character data to the text of the current element.
+ * Text without entities is referenced in the buffer instead of being copied.
+ * The caller has checked the data with isValidText().
+ *
+ * @param decode whether to resolve entity references and line endings,
+ *               false for CDATA sections
+ */
+bool KdbxXmlTokenizer::appendText(int start, int end, bool decode)
+{
+    if (start == end) {
+        return true;
+    }
+
+    const char* data = m_buffer.constData() + start;
+    const size_t size = static_cast<size_t>(end - start);
+    const bool plain = !decode || (!std::memchr(data, '&', size) && !std::memchr(data, '\r', size));
+
+    if (plain && !m_textCopied && m_textSize == 0) {
+        m_textStart = start;
+        m_textSize = end - start;
+        return true;
+    }
+
+    if (!m_textCopied) {
+        m_text.append(m_buffer.constData() + m_textStart, m_textSize);
+        m_textCopied = true;
+    }
+
+    if (plain) {
+        m_text.append(data, end - start);
+        return true;
+    }
+    return decodeText(start, end, m_text);
+}
+
+/**
+ * Resolve entity references and normalize line endings of a piece of
+ * character data and append it to out.
+ */
+bool KdbxXmlTokenizer::decodeText(int start, int end, QByteArray& out)
+{
+    const char* data = m_buffer.constData();
+    int pos = start;
+    while (pos < end) {
+        const char c = data[pos];
+        if (c == '&') {
+            if (!decodeEntity(pos, end, out)) {
+                return false;
+            }
+            continue;
+        }
+        if (c == '\r') {
+            out.append('\n');
+            ++pos;
+            if (pos < end && data[pos] == '\n') {
+                ++pos;
+            }
+            continue;
+        }
+
+        int runEnd = pos + 1;
+        while (runEnd < end && data[runEnd] != '&' && data[runEnd] != '\r') {
+            ++runEnd;
+        }
+        out.append(data + pos, runEnd - pos);
+        pos = runEnd;
+    }
+    return true;
+}
+
+bool KdbxXmlTokenizer::decodeEntity(int& pos, int end, QByteArray& out)
+{
+    const char* data = m_buffer.constData();
+    int semicolon = pos + 1;
+    while (semicolon < end && data[semicolon] != ';' && semicolon - pos <= 10) {
+        ++semicolon;
+    }
+    if (semicolon >= end || data[semicolon] != ';') {
+        raiseError(tr("Expected ';' after '&'."));
+        return false;
+    }
+
+    const char* name = data + pos + 1;
+    const int size = semicolon - pos - 1;
+    if (size == 2 && name[0] == 'l' && name[1] == 't') {
+        out.append('<');
+    } else if (size == 2 && name[0] == 'g' && name[1] == 't') {
+        out.append('>');
+    } else if (size == 3 && std::memcmp(name, "amp", 3) == 0) {
+        out.append('&');
+    } else if (size == 4 && std::memcmp(name, "quot", 4) == 0) {
+        out.append('"');
+    } else if (size == 4 && std::memcmp(name, "apos", 4) == 0) {
+        out.append('\'');
+    } else if (size > 1 && name[0] == '#') {
+        bool ok;
+        const uint ucs4 = name[1] == 'x' ? QByteArray::fromRawData(name + 2, size - 2).toUInt(&ok, 16)
+                                         : QByteArray::fromRawData(name + 1, size - 1).toUInt(&ok, 10);
+        if (!ok || !isXmlChar(ucs4)) {
+            raiseError(tr("Invalid character reference."));
+            return false;
+        }
+        appendUtf8(out, ucs4);
+    } else {
+        raiseError(tr("Entity '%1' not declared.").arg(QString::fromUtf8(name, size)));
+        return false;
+    }
+
+    pos = semicolon + 1;
+    return true;
+}
+
+void KdbxXmlTokenizer::appendFallbackText()
+{
+    if (!m_textCopied) {
+        m_textCopied = true;
+    }
+    m_text.append(m_fallback->text().toUtf8());
+}
+
+void KdbxXmlTokenizer::raiseError(const QString& message)
+{
+    if (m_error) {
+        return;
+    }
+
+    m_error = true;
+    m_errorString = message;
+    m_token = Invalid;
+
+    const char* data = m_buffer.constData();
+    const int end = qMin(m_pos, m_buffer.size());
+    int lastNewline = -1;
+    m_errorLine = m_lineOffset + 1;
+    for (int i = 0; i < end; ++i) {
+        if (data[i] == '\n') {
+            ++m_errorLine;
+            lastNewline = i;
+        }
+    }
+    m_errorColumn = lastNewline >= 0 ? end - lastNewline - 1 : m_columnOffset + end;
+}
+
+KdbxXmlTokenizer::Element KdbxXmlTokenizer::lookupElement(const char* name, int size)
+{
+    return elementTable().ids.value(QByteArray::fromRawData(name, size), Element::Unknown);
+}
+
+bool KdbxXmlTokenizer::matchesElement(Element element, const char* name, int size)
+{
+    const QByteArray& expected = elementTable().names[static_cast<int>(element)];
+    return expected.size() == size && std::memcmp(expected.constData(), name, static_cast<size_t>(size)) == 0;
+}
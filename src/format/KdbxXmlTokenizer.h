@@ -0,0 +1,229 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_KDBXXMLTOKENIZER_H
+#define KEEPASSX_KDBXXMLTOKENIZER_H
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QScopedPointer>
+#include <QString>
+#include <QVector>
+
+class QIODevice;
+class QXmlStreamReader;
+
+/**
+ * Pull parser for the KDBX XML payload.
+ *
+ * Provides the subset of the QXmlStreamReader interface the KdbxXmlReader
+ * needs. Element names are mapped to the Element ids of the KDBX schema
+ * and character data is decoded straight from the UTF-8 input buffer.
+ *
+ * Documents the tokenizer does not handle itself, i.e. documents with a
+ * DTD or an encoding other than UTF-8, are passed to a QXmlStreamReader.
+ */
+class KdbxXmlTokenizer
+{
+    Q_DECLARE_TR_FUNCTIONS(KdbxXmlTokenizer)
+
+public:
+    enum class Element
+    {
+        Unknown,
+        Association,
+        AutoType,
+        BackgroundColor,
+        Binaries,
+        Binary,
+        Color,
+        CreationTime,
+        CustomData,
+        CustomIconUUID,
+        CustomIcons,
+        Data,
+        DataTransferObfuscation,
+        DatabaseDescription,
+        DatabaseDescriptionChanged,
+        DatabaseName,
+        DatabaseNameChanged,
+        DefaultAutoTypeSequence,
+        DefaultSequence,
+        DefaultUserName,
+        DefaultUserNameChanged,
+        DeletedObject,
+        DeletedObjects,
+        DeletionTime,
+        EnableAutoType,
+        EnableSearching,
+        Enabled,
+        Entry,
+        EntryTemplatesGroup,
+        EntryTemplatesGroupChanged,
+        Expires,
+        ExpiryTime,
+        ForegroundColor,
+        Generator,
+        Group,
+        HeaderHash,
+        History,
+        HistoryMaxItems,
+        HistoryMaxSize,
+        Icon,
+        IconID,
+        IsExpanded,
+        Item,
+        KeePassFile,
+        Key,
+        KeystrokeSequence,
+        LastAccessTime,
+        LastModificationTime,
+        LastSelectedGroup,
+        LastTopVisibleEntry,
+        LastTopVisibleGroup,
+        LocationChanged,
+        MaintenanceHistoryDays,
+        MasterKeyChangeForce,
+        MasterKeyChangeRec,
+        MasterKeyChanged,
+        MemoryProtection,
+        Meta,
+        Name,
+        Notes,
+        OverrideURL,
+        ProtectNotes,
+        ProtectPassword,
+        ProtectTitle,
+        ProtectURL,
+        ProtectUserName,
+        RecycleBinChanged,
+        RecycleBinEnabled,
+        RecycleBinUUID,
+        Root,
+        SettingsChanged,
+        String,
+        Tags,
+        Times,
+        UUID,
+        UsageCount,
+        Value,
+        Window
+    };
+
+    KdbxXmlTokenizer();
+    ~KdbxXmlTokenizer();
+
+    void setDevice(QIODevice* device);
+    void clear();
+
+    bool readNextStartElement();
+    bool isStartElement() const;
+    Element element() const;
+    QString name() const;
+
+    bool hasAttribute(const char* name) const;
+    QStringRef attributeValue(const char* name) const;
+
+    QString readElementText();
+    QByteArray readElementBytes();
+    void readElementData(const char*& data, int& size);
+    void skipCurrentElement();
+
+    bool usesFallback() const;
+    bool hasError() const;
+    QString errorString() const;
+    qint64 lineNumber() const;
+    qint64 columnNumber() const;
+
+private:
+    enum Token
+    {
+        NoToken,
+        StartElement,
+        EndElement,
+        EndDocument,
+        Invalid
+    };
+
+    struct Attribute
+    {
+        QString name;
+        QString value;
+    };
+
+    struct OpenElement
+    {
+        Element element;
+        QByteArray name; // only set for unknown elements
+    };
+
+    Token readNext(bool collectText);
+    Token readNextFallback(bool collectText);
+    bool readProlog();
+    void startFallback();
+    bool fill();
+    bool ensure(int size);
+    void compact();
+    int find(char c, int from);
+    int find(const char* str, int from);
+    bool readStartTag();
+    bool readEndTag();
+    bool readName(int& start, int& size);
+    bool readAttributes();
+    void skipWhitespace();
+    bool appendText(int start, int end, bool decode);
+    bool decodeText(int start, int end, QByteArray& out);
+    bool decodeEntity(int& pos, int end, QByteArray& out);
+    void appendFallbackText();
+    void raiseError(const QString& message);
+
+    static Element lookupElement(const char* name, int size);
+    static bool matchesElement(Element element, const char* name, int size);
+
+    QIODevice* m_device;
+    QByteArray m_buffer;
+    int m_pos;
+    bool m_deviceAtEnd;
+    bool m_prologRead;
+    qint64 m_lineOffset;
+    qint64 m_columnOffset;
+
+    Token m_token;
+    Element m_element;
+    int m_nameStart;
+    int m_nameSize;
+    bool m_emptyElement;
+    QVector<Attribute> m_attributes;
+    QVector<OpenElement> m_openElements;
+
+    // character data of the last readElementData() call if it could not
+    // be taken from the input buffer as is
+    QByteArray m_text;
+    int m_textStart;
+    int m_textSize;
+    bool m_textCopied;
+
+    QScopedPointer<QXmlStreamReader> m_fallback;
+    QString m_fallbackName;
+
+    bool m_error;
+    QString m_errorString;
+    qint64 m_errorLine;
+    qint64 m_errorColumn;
+};
+
+#endif // KEEPASSX_KDBXXMLTOKENIZER_H
@@ -19,12 +19,54 @@
 
 #include <QBuffer>
 #include <QFile>
+#include <QtEndian>
 
-#include "core/Endian.h"
+#include "core/AttachmentPool.h"
 #include "core/Metadata.h"
 #include "format/KeePass2RandomStream.h"
 #include "streams/QtIOCompressor"
 
+namespace
+{
+    /**
+     * Device that writes everything as base64 encoded character data
+     * of the current element.
+     */
+    class Base64Sink : public QIODevice
+    {
+    public:
+        explicit Base64Sink(KdbxXmlStreamWriter* xml)
+            : m_xml(xml)
+        {
+        }
+
+    protected:
+        qint64 readData(char* data, qint64 maxSize) override
+        {
+            Q_UNUSED(data);
+            Q_UNUSED(maxSize);
+            return -1;
+        }
+
+        qint64 writeData(const char* data, qint64 size) override
+        {
+            m_xml->writeBase64(data, static_cast<int>(size));
+            return size;
+        }
+
+    private:
+        KdbxXmlStreamWriter* m_xml;
+    };
+
+    void formatDigits(int value, int count, char* out)
+    {
+        for (int i = count - 1; i >= 0; --i) {
+            out[i] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+    }
+} // namespace
+
 /**
  * @param version KDBX version
  */
@@ -43,14 +85,10 @@ void KdbxXmlWriter::writeDatabase(QIODevice* device,
     m_randomStream = randomStream;
     m_headerHash = headerHash;
 
-    m_xml.setAutoFormatting(true);
-    m_xml.setAutoFormattingIndent(-1); // 1 tab
-    m_xml.setCodec("UTF-8");
-
     generateIdMap();
 
     m_xml.setDevice(device);
-    m_xml.writeStartDocument("1.0", true);
+    m_xml.writeStartDocument();
     m_xml.writeStartElement("KeePassFile");
 
     writeMetadata();
@@ -89,9 +127,9 @@ void KdbxXmlWriter::generateIdMap()
     for (Entry* entry : allEntries) {
         const QList<QString> attachmentKeys = entry->attachments()->keys();
         for (const QString& key : attachmentKeys) {
-            QByteArray data = entry->attachments()->value(key);
-            if (!m_idMap.contains(data)) {
-                m_idMap.insert(data, nextId++);
+            const QByteArray id = entry->attachments()->contentId(key);
+            if (!m_idMap.contains(id)) {
+                m_idMap.insert(id, nextId++);
             }
         }
     }
@@ -183,36 +221,34 @@ void KdbxXmlWriter::writeBinaries()
 {
     m_xml.writeStartElement("Binaries");
 
+    const bool compress = m_db->compressionAlgo() == Database::CompressionGZip;
+    // the compressed data is base64 encoded straight into the output as it is produced
+    Base64Sink sink(&m_xml);
+    sink.open(QIODevice::WriteOnly);
+    QtIOCompressor compressor(&sink);
+    compressor.setStreamFormat(QtIOCompressor::GzipFormat);
+
     QHash<QByteArray, int>::const_iterator i;
     for (i = m_idMap.constBegin(); i != m_idMap.constEnd(); ++i) {
         m_xml.writeStartElement("Binary");
 
-        m_xml.writeAttribute("ID", QString::number(i.value()));
+        m_xml.writeAttribute("ID", i.value());
 
-        QByteArray data;
-        if (m_db->compressionAlgo() == Database::CompressionGZip) {
+        bool ok;
+        const QByteArray content = AttachmentPool::instance()->data(i.key(), &ok);
+        if (!ok) {
+            raiseError(tr("Unable to read attachment content from the cache file."));
+        }
+        if (compress) {
             m_xml.writeAttribute("Compressed", "True");
 
-            QBuffer buffer;
-            buffer.open(QIODevice::ReadWrite);
-
-            QtIOCompressor compressor(&buffer);
-            compressor.setStreamFormat(QtIOCompressor::GzipFormat);
             compressor.open(QIODevice::WriteOnly);
-
-            qint64 bytesWritten = compressor.write(i.key());
-            Q_ASSERT(bytesWritten == i.key().size());
+            qint64 bytesWritten = compressor.write(content);
+            Q_ASSERT(bytesWritten == content.size());
             Q_UNUSED(bytesWritten);
             compressor.close();
-
-            buffer.seek(0);
-            data = buffer.readAll();
-        } else {
-            data = i.key();
-        }
-
-        if (!data.isEmpty()) {
-            m_xml.writeCharacters(QString::fromLatin1(data.toBase64()));
+        } else if (!content.isEmpty()) {
+            m_xml.writeBase64(content.constData(), content.size());
         }
         m_xml.writeEndElement();
     }
@@ -366,27 +402,25 @@ void KdbxXmlWriter::writeEntry(const Entry* entry)
         writeString("Key", key);
 
         m_xml.writeStartElement("Value");
-        QString value;
-
-        if (protect) {
-            if (m_randomStream) {
-                m_xml.writeAttribute("Protected", "True");
-                bool ok;
-                QByteArray rawData = m_randomStream->process(entry->attributes()->value(key).toUtf8(), &ok);
-                if (!ok) {
-                    raiseError(m_randomStream->errorString());
-                }
-                value = QString::fromLatin1(rawData.toBase64());
-            } else {
-                m_xml.writeAttribute("ProtectInMemory", "True");
-                value = entry->attributes()->value(key);
+
+        if (protect && m_randomStream) {
+            m_xml.writeAttribute("Protected", "True");
+            bool ok;
+            QByteArray rawData = m_randomStream->process(entry->attributes()->uncachedValue(key).toUtf8(), &ok);
+            if (!ok) {
+                raiseError(m_randomStream->errorString());
+            }
+            if (!rawData.isEmpty()) {
+                m_xml.writeBase64(rawData.constData(), rawData.size());
             }
         } else {
-            value = entry->attributes()->value(key);
-        }
-
-        if (!value.isEmpty()) {
-            m_xml.writeCharacters(stripInvalidXml10Chars(value));
+            if (protect) {
+                m_xml.writeAttribute("ProtectInMemory", "True");
+            }
+            const QString value = entry->attributes()->uncachedValue(key);
+            if (!value.isEmpty()) {
+                m_xml.writeCharacters(value);
+            }
         }
         m_xml.writeEndElement();
 
@@ -400,7 +434,7 @@ void KdbxXmlWriter::writeEntry(const Entry* entry)
         writeString("Key", key);
 
         m_xml.writeStartElement("Value");
-        m_xml.writeAttribute("Ref", QString::number(m_idMap[entry->attachments()->value(key)]));
+        m_xml.writeAttribute("Ref", m_idMap[entry->attachments()->contentId(key)]);
         m_xml.writeEndElement();
 
         m_xml.writeEndElement();
@@ -458,56 +492,101 @@ void KdbxXmlWriter::writeEntryHistory(const Entry* entry)
     m_xml.writeEndElement();
 }
 
-void KdbxXmlWriter::writeString(const QString& qualifiedName, const QString& string)
+void KdbxXmlWriter::writeString(const char* qualifiedName, const QString& string)
 {
     if (string.isEmpty()) {
         m_xml.writeEmptyElement(qualifiedName);
     } else {
-        m_xml.writeTextElement(qualifiedName, stripInvalidXml10Chars(string));
+        m_xml.writeStartElement(qualifiedName);
+        m_xml.writeCharacters(string);
+        m_xml.writeEndElement();
+    }
+}
+
+/**
+ * Write a value that is known not to need escaping, e.g. a number.
+ */
+void KdbxXmlWriter::writeAsciiString(const char* qualifiedName, const char* data, int size)
+{
+    if (size == 0) {
+        m_xml.writeEmptyElement(qualifiedName);
+    } else {
+        m_xml.writeStartElement(qualifiedName);
+        m_xml.writeAsciiCharacters(data, size);
+        m_xml.writeEndElement();
     }
 }
 
-void KdbxXmlWriter::writeNumber(const QString& qualifiedName, int number)
+void KdbxXmlWriter::writeNumber(const char* qualifiedName, int number)
 {
-    writeString(qualifiedName, QString::number(number));
+    char str[12];
+    writeAsciiString(qualifiedName, str, KdbxXmlStreamWriter::formatNumber(number, str));
 }
 
-void KdbxXmlWriter::writeBool(const QString& qualifiedName, bool b)
+void KdbxXmlWriter::writeBool(const char* qualifiedName, bool b)
 {
     if (b) {
-        writeString(qualifiedName, "True");
+        writeAsciiString(qualifiedName, "True", 4);
     } else {
-        writeString(qualifiedName, "False");
+        writeAsciiString(qualifiedName, "False", 5);
     }
 }
 
-void KdbxXmlWriter::writeDateTime(const QString& qualifiedName, const QDateTime& dateTime)
+void KdbxXmlWriter::writeDateTime(const char* qualifiedName, const QDateTime& dateTime)
 {
     Q_ASSERT(dateTime.isValid());
     Q_ASSERT(dateTime.timeSpec() == Qt::UTC);
 
-    QString dateTimeStr;
-    if (m_kdbxVersion < KeePass2::FILE_VERSION_4) {
-        dateTimeStr = dateTime.toString(Qt::ISODate);
-
-        // Qt < 4.8 doesn't append a 'Z' at the end
-        if (!dateTimeStr.isEmpty() && dateTimeStr[dateTimeStr.size() - 1] != 'Z') {
-            dateTimeStr.append('Z');
+    if (m_kdbxVersion >= KeePass2::FILE_VERSION_4) {
+        qint64 secs = 0;
+        if (dateTime.isValid()) {
+            secs = (dateTime.toMSecsSinceEpoch() + KeePass2::DATETIME_EPOCH_OFFSET * 1000) / 1000;
         }
-    } else {
-        qint64 secs = QDateTime(QDate(1, 1, 1), QTime(0, 0, 0, 0), Qt::UTC).secsTo(dateTime);
-        QByteArray secsBytes = Endian::sizedIntToBytes(secs, KeePass2::BYTEORDER);
-        dateTimeStr = QString::fromLatin1(secsBytes.toBase64());
+        uchar secsBytes[8];
+        qToLittleEndian(secs, secsBytes);
+        char str[12];
+        writeAsciiString(qualifiedName, str, KdbxXmlStreamWriter::encodeBase64(secsBytes, 8, str));
+        return;
+    }
+
+    const QDate date = dateTime.date();
+    if (dateTime.timeSpec() == Qt::UTC && date.year() >= 1 && date.year() <= 9999) {
+        // yyyy-MM-ddTHH:mm:ssZ
+        const QTime time = dateTime.time();
+        char str[20] = {0, 0, 0, 0, '-', 0, 0, '-', 0, 0, 'T', 0, 0, ':', 0, 0, ':', 0, 0, 'Z'};
+        formatDigits(date.year(), 4, str);
+        formatDigits(date.month(), 2, str + 5);
+        formatDigits(date.day(), 2, str + 8);
+        formatDigits(time.hour(), 2, str + 11);
+        formatDigits(time.minute(), 2, str + 14);
+        formatDigits(time.second(), 2, str + 17);
+        writeAsciiString(qualifiedName, str, 20);
+        return;
+    }
+
+    QString dateTimeStr = dateTime.toString(Qt::ISODate);
+    // Qt < 4.8 doesn't append a 'Z' at the end
+    if (!dateTimeStr.isEmpty() && dateTimeStr[dateTimeStr.size() - 1] != 'Z') {
+        dateTimeStr.append('Z');
     }
     writeString(qualifiedName, dateTimeStr);
 }
 
-void KdbxXmlWriter::writeUuid(const QString& qualifiedName, const QUuid& uuid)
+void KdbxXmlWriter::writeUuid(const char* qualifiedName, const QUuid& uuid)
 {
-    writeString(qualifiedName, uuid.toRfc4122().toBase64());
+    uchar uuidBytes[16];
+    qToBigEndian(uuid.data1, uuidBytes);
+    qToBigEndian(uuid.data2, uuidBytes + 4);
+    qToBigEndian(uuid.data3, uuidBytes + 6);
+    for (int i = 0; i < 8; ++i) {
+        uuidBytes[8 + i] = uuid.data4[i];
+    }
+
+    char str[24];
+    writeAsciiString(qualifiedName, str, KdbxXmlStreamWriter::encodeBase64(uuidBytes, 16, str));
 }
 
-void KdbxXmlWriter::writeUuid(const QString& qualifiedName, const Group* group)
+void KdbxXmlWriter::writeUuid(const char* qualifiedName, const Group* group)
 {
     if (group) {
         writeUuid(qualifiedName, group->uuid());
@@ -516,7 +595,7 @@ void KdbxXmlWriter::writeUuid(const QString& qualifiedName, const Group* group)
     }
 }
 
-void KdbxXmlWriter::writeUuid(const QString& qualifiedName, const Entry* entry)
+void KdbxXmlWriter::writeUuid(const char* qualifiedName, const Entry* entry)
 {
     if (entry) {
         writeUuid(qualifiedName, entry->uuid());
@@ -525,70 +604,43 @@ void KdbxXmlWriter::writeUuid(const QString& qualifiedName, const Entry* entry)
     }
 }
 
-void KdbxXmlWriter::writeBinary(const QString& qualifiedName, const QByteArray& ba)
+void KdbxXmlWriter::writeBinary(const char* qualifiedName, const QByteArray& ba)
 {
-    writeString(qualifiedName, QString::fromLatin1(ba.toBase64()));
+    if (ba.isEmpty()) {
+        m_xml.writeEmptyElement(qualifiedName);
+    } else {
+        m_xml.writeStartElement(qualifiedName);
+        m_xml.writeBase64(ba.constData(), ba.size());
+        m_xml.writeEndElement();
+    }
 }
 
-void KdbxXmlWriter::writeColor(const QString& qualifiedName, const QColor& color)
+void KdbxXmlWriter::writeColor(const char* qualifiedName, const QColor& color)
 {
-    QString colorStr;
-
-    if (color.isValid()) {
-        colorStr = QString("#%1%2%3").arg(
-            colorPartToString(color.red()), colorPartToString(color.green()), colorPartToString(color.blue()));
+    if (!color.isValid()) {
+        writeAsciiString(qualifiedName, "", 0);
+        return;
     }
 
-    writeString(qualifiedName, colorStr);
+    static const char hexDigits[] = "0123456789ABCDEF";
+    const int parts[] = {color.red(), color.green(), color.blue()};
+    char str[7] = {'#'};
+    for (int i = 0; i < 3; ++i) {
+        str[1 + 2 * i] = hexDigits[(parts[i] >> 4) & 0xF];
+        str[2 + 2 * i] = hexDigits[parts[i] & 0xF];
+    }
+    writeAsciiString(qualifiedName, str, 7);
 }
 
-void KdbxXmlWriter::writeTriState(const QString& qualifiedName, Group::TriState triState)
+void KdbxXmlWriter::writeTriState(const char* qualifiedName, Group::TriState triState)
 {
-    QString value;
-
     if (triState == Group::Inherit) {
-        value = "null";
+        writeAsciiString(qualifiedName, "null", 4);
     } else if (triState == Group::Enable) {
-        value = "true";
+        writeAsciiString(qualifiedName, "true", 4);
     } else {
-        value = "false";
-    }
-
-    writeString(qualifiedName, value);
-}
-
-QString KdbxXmlWriter::colorPartToString(int value)
-{
-    QString str = QString::number(value, 16).toUpper();
-    if (str.length() == 1) {
-        str.prepend("0");
+        writeAsciiString(qualifiedName, "false", 5);
     }
-
-    return str;
-}
-
-QString KdbxXmlWriter::stripInvalidXml10Chars(QString str)
-{
-    for (int i = str.size() - 1; i >= 0; i--) {
-        const QChar ch = str.at(i);
-        const ushort uc = ch.unicode();
-
-        if (ch.isLowSurrogate() && i != 0 && str.at(i - 1).isHighSurrogate()) {
-            // keep valid surrogate pair
-            i--;
-        } else if ((uc < 0x20 && uc != 0x09 && uc != 0x0A && uc != 0x0D) // control characters
-                   || (uc >= 0x7F && uc <= 0x84) // control characters, valid but discouraged by XML
-                   || (uc >= 0x86 && uc <= 0x9F) // control characters, valid but discouraged by XML
-                   || (uc > 0xFFFD) // noncharacter
-                   || ch.isLowSurrogate() // single low surrogate
-                   || ch.isHighSurrogate()) // single high surrogate
-        {
-            qWarning("Stripping invalid XML 1.0 codepoint %x", uc);
-            str.remove(i, 1);
-        }
-    }
-
-    return str;
 }
 
 void KdbxXmlWriter::raiseError(const QString& errorMessage)
@@ -19,20 +19,23 @@
 #define KEEPASSX_KDBXXMLWRITER_H
 
 #include <QColor>
+#include <QCoreApplication>
 #include <QDateTime>
 #include <QImage>
-#include <QXmlStreamWriter>
 
 #include "core/Database.h"
 #include "core/Entry.h"
 #include "core/Group.h"
 #include "core/TimeInfo.h"
+#include "format/KdbxXmlStreamWriter.h"
 
 class KeePass2RandomStream;
 class Metadata;
 
 class KdbxXmlWriter
 {
+    Q_DECLARE_TR_FUNCTIONS(KdbxXmlWriter)
+
 public:
     explicit KdbxXmlWriter(quint32 version);
 
@@ -64,27 +67,27 @@ private:
     void writeAutoTypeAssoc(const AutoTypeAssociations::Association& assoc);
     void writeEntryHistory(const Entry* entry);
 
-    void writeString(const QString& qualifiedName, const QString& string);
-    void writeNumber(const QString& qualifiedName, int number);
-    void writeBool(const QString& qualifiedName, bool b);
-    void writeDateTime(const QString& qualifiedName, const QDateTime& dateTime);
-    void writeUuid(const QString& qualifiedName, const QUuid& uuid);
-    void writeUuid(const QString& qualifiedName, const Group* group);
-    void writeUuid(const QString& qualifiedName, const Entry* entry);
-    void writeBinary(const QString& qualifiedName, const QByteArray& ba);
-    void writeColor(const QString& qualifiedName, const QColor& color);
-    void writeTriState(const QString& qualifiedName, Group::TriState triState);
-    QString colorPartToString(int value);
-    QString stripInvalidXml10Chars(QString str);
+    void writeString(const char* qualifiedName, const QString& string);
+    void writeAsciiString(const char* qualifiedName, const char* data, int size);
+    void writeNumber(const char* qualifiedName, int number);
+    void writeBool(const char* qualifiedName, bool b);
+    void writeDateTime(const char* qualifiedName, const QDateTime& dateTime);
+    void writeUuid(const char* qualifiedName, const QUuid& uuid);
+    void writeUuid(const char* qualifiedName, const Group* group);
+    void writeUuid(const char* qualifiedName, const Entry* entry);
+    void writeBinary(const char* qualifiedName, const QByteArray& ba);
+    void writeColor(const char* qualifiedName, const QColor& color);
+    void writeTriState(const char* qualifiedName, Group::TriState triState);
 
     void raiseError(const QString& errorMessage);
 
     const quint32 m_kdbxVersion;
 
-    QXmlStreamWriter m_xml;
+    KdbxXmlStreamWriter m_xml;
     QPointer<Database> m_db;
     QPointer<Metadata> m_meta;
     KeePass2RandomStream* m_randomStream = nullptr;
+    // attachment content id to binary id
     QHash<QByteArray, int> m_idMap;
     QByteArray m_headerHash;
 
@@ -46,6 +46,9 @@ namespace KeePass2
 
     const QSysInfo::Endian BYTEORDER = QSysInfo::LittleEndian;
 
+    // seconds between 0001-01-01 and 1970-01-01 UTC, KDBX 4 timestamps count from the former
+    constexpr qint64 DATETIME_EPOCH_OFFSET = Q_INT64_C(62135596800);
+
 extern const QUuid CIPHER_AES;
 extern const QUuid CIPHER_TWOFISH;
 extern const QUuid CIPHER_CHACHA20;
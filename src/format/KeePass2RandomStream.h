@@ -32,11 +32,15 @@ public:
     QByteArray randomBytes(int size, bool* ok);
     QByteArray process(const QByteArray& data, bool* ok);
     Q_REQUIRED_RESULT bool processInPlace(QByteArray& data);
+    Q_REQUIRED_RESULT bool processInPlace(char* data, int size);
     QString errorString() const;
 
 private:
     bool loadBlock();
 
+    // key stream generated per cipher call, a multiple of the 64 byte cipher block
+    static const int BufferSize = 4096;
+
     SymmetricCipher m_cipher;
     QByteArray m_buffer;
     int m_offset;
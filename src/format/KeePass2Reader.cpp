@@ -93,6 +93,9 @@ Database* KeePass2Reader::readDatabase(QIODevice* device, const CompositeKey& ke
     }
 
     m_reader->setSaveXml(m_saveXml);
+    m_reader->setPipelined(m_pipelined);
+    m_reader->setLazyAttachments(m_lazyAttachments);
+    m_reader->setKeyCache(m_keyCache);
     return m_reader->readDatabase(device, key, keepDatabase);
 }
 
@@ -116,6 +119,37 @@ void KeePass2Reader::setSaveXml(bool save)
     m_saveXml = save;
 }
 
+bool KeePass2Reader::pipelined() const
+{
+    return m_pipelined;
+}
+
+void KeePass2Reader::setPipelined(bool pipelined)
+{
+    m_pipelined = pipelined;
+}
+
+bool KeePass2Reader::lazyAttachments() const
+{
+    return m_lazyAttachments;
+}
+
+void KeePass2Reader::setLazyAttachments(bool lazy)
+{
+    m_lazyAttachments = lazy;
+}
+
+/**
+ * Reuse the transformed master key of an opened database if it matches,
+ * see KdbxReader::setKeyCache().
+ *
+ * @param db opened database, nullptr to always transform the key
+ */
+void KeePass2Reader::setKeyCache(const Database* db)
+{
+    m_keyCache = db;
+}
+
 /**
  * @return detected KDBX version
  */
@@ -44,6 +44,12 @@ public:
     bool saveXml() const;
     void setSaveXml(bool save);
 
+    bool pipelined() const;
+    void setPipelined(bool pipelined);
+    bool lazyAttachments() const;
+    void setLazyAttachments(bool lazy);
+    void setKeyCache(const Database* db);
+
     QSharedPointer<KdbxReader> reader() const;
     quint32 version() const;
 
@@ -51,6 +57,9 @@ private:
     void raiseError(const QString& errorMessage);
 
     bool m_saveXml = false;
+    bool m_pipelined = false;
+    bool m_lazyAttachments = false;
+    const Database* m_keyCache = nullptr;
     bool m_error = false;
     QString m_errorStr = "";
 
@@ -85,6 +85,7 @@ KeePass2Repair::RepairOutcome KeePass2Repair::repairDatabase(QIODevice* device,
         auto reader4 = reader.reader().staticCast<Kdbx4Reader>();
         QHash<QString, QByteArray> pool = reader4->binaryPool();
         KdbxXmlReader xmlReader(KeePass2::FILE_VERSION_4, pool);
+        xmlReader.setBinaryContentIds(reader4->binaryContentIds());
         xmlReader.readDatabase(&buffer, db.data(), &randomStream);
         hasError = xmlReader.hasError();
     }
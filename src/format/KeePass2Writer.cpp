@@ -102,6 +102,7 @@ bool KeePass2Writer::writeDatabase(QIODevice* device, Database* db)
         m_writer.reset(new Kdbx4Writer());
     }
 
+    m_writer->setPipelined(m_pipelined);
     return m_writer->writeDatabase(device, db);
 }
 
@@ -115,6 +116,16 @@ QString KeePass2Writer::errorString() const
     return m_writer ? m_writer->errorString() : m_errorStr;
 }
 
+bool KeePass2Writer::pipelined() const
+{
+    return m_pipelined;
+}
+
+void KeePass2Writer::setPipelined(bool pipelined)
+{
+    m_pipelined = pipelined;
+}
+
 /**
  * Raise an error. Use in case of an unexpected write error.
  *
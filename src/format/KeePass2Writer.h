@@ -39,13 +39,17 @@ public:
 
     bool hasError() const;
     QString errorString() const;
+    bool implicitUpgradeNeeded(Database const* db) const;
+
+    bool pipelined() const;
+    void setPipelined(bool pipelined);
 
 private:
     void raiseError(const QString& errorMessage);
-    bool implicitUpgradeNeeded(Database const* db) const;
 
     bool m_error = false;
     QString m_errorStr = "";
+    bool m_pipelined = false;
 
     QScopedPointer<KdbxWriter> m_writer;
     quint32 m_version = 0;
@@ -157,6 +157,16 @@ void DatabaseOpenWidget::clearForms()
     m_ui->checkTouchID->setChecked(false);
     m_ui->buttonTogglePassword->setChecked(false);
     m_db = nullptr;
+    m_keyCache = nullptr;
+}
+
+/**
+ * Skip the key derivation if the file turns out to be protected by the
+ * same key and KDF parameters as an already opened database.
+ */
+void DatabaseOpenWidget::setKeyCache(Database* db)
+{
+    m_keyCache = db;
 }
 
 Database* DatabaseOpenWidget::database()
@@ -179,6 +189,9 @@ void DatabaseOpenWidget::enterKey(const QString& pw, const QString& keyFile)
 void DatabaseOpenWidget::openDatabase()
 {
     KeePass2Reader reader;
+    reader.setPipelined(config()->get("UsePipelinedReader").toBool());
+    reader.setLazyAttachments(config()->get("LazyLoadAttachments").toBool());
+    reader.setKeyCache(m_keyCache);
     QSharedPointer<CompositeKey> masterKey = databaseKey();
     if (masterKey.isNull()) {
         return;
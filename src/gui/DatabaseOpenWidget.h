@@ -19,6 +19,7 @@
 #ifndef KEEPASSX_DATABASEOPENWIDGET_H
 #define KEEPASSX_DATABASEOPENWIDGET_H
 
+#include <QPointer>
 #include <QScopedPointer>
 
 #include "gui/DialogyWidget.h"
@@ -42,6 +43,7 @@ public:
     void load(const QString& filename);
     void clearForms();
     void enterKey(const QString& pw, const QString& keyFile);
+    void setKeyCache(Database* db);
     Database* database();
 
 public slots:
@@ -75,6 +77,7 @@ protected:
 
 private:
     bool m_yubiKeyBeingPolled = false;
+    QPointer<Database> m_keyCache;
     Q_DISABLE_COPY(DatabaseOpenWidget)
 };
 
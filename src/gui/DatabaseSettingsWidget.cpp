@@ -34,6 +34,7 @@
 #include "core/Metadata.h"
 #include "crypto/SymmetricCipher.h"
 #include "crypto/kdf/Argon2Kdf.h"
+#include "crypto/kdf/Argon2Tuner.h"
 
 DatabaseSettingsWidget::DatabaseSettingsWidget(QWidget* parent)
     : DialogyWidget(parent)
@@ -59,6 +60,7 @@ DatabaseSettingsWidget::DatabaseSettingsWidget(QWidget* parent)
             m_uiGeneral->historyMaxSizeSpinBox,
             SLOT(setEnabled(bool)));
     connect(m_uiEncryption->transformBenchmarkButton, SIGNAL(clicked()), SLOT(transformRoundsBenchmark()));
+    connect(m_uiEncryption->argon2TuneButton, SIGNAL(clicked()), SLOT(argon2Tune()));
     connect(m_uiEncryption->kdfComboBox, SIGNAL(currentIndexChanged(int)), SLOT(kdfChanged(int)));
 
     connect(m_uiEncryption->memorySpinBox, SIGNAL(valueChanged(int)), this, SLOT(memoryChanged(int)));
@@ -274,6 +276,41 @@ void DatabaseSettingsWidget::transformRoundsBenchmark()
     QApplication::restoreOverrideCursor();
 }
 
+/**
+ * Replace the Argon2 parameters with the strongest ones that
+ * meet a 1 second delay and the memory budget on this computer.
+ */
+void DatabaseSettingsWidget::argon2Tune()
+{
+    QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+    m_uiEncryption->argon2TuneButton->setEnabled(false);
+    m_uiEncryption->transformBenchmarkButton->setEnabled(false);
+
+    Argon2Tuner tuner(1000);
+    tuner.setMaxParallelism(static_cast<quint32>(
+        qMin(QThread::idealThreadCount(), m_uiEncryption->parallelismSpinBox->maximum())));
+    tuner.setMemoryBudget(static_cast<quint64>(m_uiEncryption->argon2MemoryBudgetSpinBox->value()) * 1024);
+    bool ok = AsyncTask::runAndWaitForFuture([&tuner]() { return tuner.tune(); });
+
+    if (ok) {
+        Argon2Tuner::Parameters parameters = tuner.recommendation().parameters;
+        m_uiEncryption->memorySpinBox->setValue(static_cast<int>(parameters.memory / 1024));
+        m_uiEncryption->parallelismSpinBox->setValue(static_cast<int>(parameters.parallelism));
+        m_uiEncryption->transformRoundsSpinBox->setValue(parameters.iterations);
+    }
+
+    m_uiEncryption->argon2TuneButton->setEnabled(true);
+    m_uiEncryption->transformBenchmarkButton->setEnabled(true);
+    QApplication::restoreOverrideCursor();
+
+    if (!ok) {
+        MessageBox::warning(this,
+                            tr("Optimization failed"),
+                            tr("No Argon2 parameters meet a 1 second delay on this computer."),
+                            QMessageBox::Ok);
+    }
+}
+
 void DatabaseSettingsWidget::truncateHistories()
 {
     const QList<Entry*> allEntries = m_db->rootGroup()->entriesRecursive(false);
@@ -293,6 +330,9 @@ void DatabaseSettingsWidget::kdfChanged(int index)
     bool parallelismEnabled = id == KeePass2::KDF_ARGON2;
     m_uiEncryption->parallelismLabel->setEnabled(parallelismEnabled);
     m_uiEncryption->parallelismSpinBox->setEnabled(parallelismEnabled);
+    m_uiEncryption->argon2MemoryBudgetLabel->setVisible(id == KeePass2::KDF_ARGON2);
+    m_uiEncryption->argon2MemoryBudgetSpinBox->setVisible(id == KeePass2::KDF_ARGON2);
+    m_uiEncryption->argon2TuneButton->setVisible(id == KeePass2::KDF_ARGON2);
 
     transformRoundsBenchmark();
 }
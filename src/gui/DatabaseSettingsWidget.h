@@ -53,6 +53,7 @@ private slots:
     void save();
     void reject();
     void transformRoundsBenchmark();
+    void argon2Tune();
     void kdfChanged(int index);
     void memoryChanged(int value);
     void parallelismChanged(int value);
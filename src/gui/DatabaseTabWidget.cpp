@@ -29,6 +29,8 @@
 #include "core/Global.h"
 #include "core/Group.h"
 #include "core/Metadata.h"
+#include "core/SaveScheduler.h"
+#include "crypto/MemoryCipher.h"
 #include "format/CsvExporter.h"
 #include "gui/Clipboard.h"
 #include "gui/DatabaseWidget.h"
@@ -45,6 +47,7 @@ DatabaseManagerStruct::DatabaseManagerStruct()
     , modified(false)
     , readOnly(false)
     , saveAttempts(0)
+    , saveScheduler(nullptr)
 {
 }
 
@@ -234,6 +237,8 @@ bool DatabaseTabWidget::closeDatabase(Database* db)
 {
     Q_ASSERT(db);
 
+    flushScheduledSave(db);
+
     const DatabaseManagerStruct& dbStruct = m_dbList.value(db);
     int index = databaseIndex(db);
     Q_ASSERT(index != -1);
@@ -292,8 +297,13 @@ void DatabaseTabWidget::deleteDatabase(Database* db)
     removeTab(index);
     toggleTabbar();
     m_dbList.remove(db);
+    if (dbStruct.saveScheduler) {
+        dbStruct.saveScheduler->cancel();
+        dbStruct.saveScheduler->deleteLater();
+    }
     delete dbStruct.dbWidget;
     delete db;
+    MemoryCipher::clearCache();
 
     if (emitDatabaseWithFileClosed) {
         emit databaseWithFileClosed(filePath);
@@ -328,46 +338,174 @@ bool DatabaseTabWidget::saveDatabase(Database* db, QString filePath)
         }
 
         dbStruct.dbWidget->blockAutoReload(true);
-        // TODO: Make this async, but lock out the database widget to prevent re-entrance
         bool useAtomicSaves = config()->get("UseAtomicSaves", true).toBool();
         QString errorMessage = db->saveToFile(filePath, useAtomicSaves, config()->get("BackupBeforeSave").toBool());
         dbStruct.dbWidget->blockAutoReload(false);
 
-        if (errorMessage.isEmpty()) {
-            // successfully saved database file
+        return processSaveResult(db, filePath, errorMessage, true);
+    } else {
+        return saveDatabaseAs(db);
+    }
+}
+
+/**
+ * Save a database on a worker thread, falls back to a regular save if
+ * the database can't be saved in the background.
+ *
+ * The result is handled by databaseSaveFinished().
+ *
+ * @return true if the save was started or succeeded
+ */
+bool DatabaseTabWidget::saveDatabaseInBackground(Database* db)
+{
+    DatabaseManagerStruct& dbStruct = m_dbList[db];
+
+    QString filePath = dbStruct.fileInfo.canonicalFilePath();
+    if (dbStruct.readOnly || filePath.isEmpty() || dbStruct.dbWidget->currentMode() == DatabaseWidget::LockedMode) {
+        return saveDatabase(db);
+    }
+
+    bool useAtomicSaves = config()->get("UseAtomicSaves", true).toBool();
+
+    // auto reload stays blocked until the last queued save has finished
+    dbStruct.dbWidget->blockAutoReload(true);
+    if (!db->saveToFileInBackground(filePath, useAtomicSaves, config()->get("BackupBeforeSave").toBool())) {
+        dbStruct.dbWidget->blockAutoReload(false);
+        return saveDatabase(db, filePath);
+    }
+
+    return true;
+}
+
+void DatabaseTabWidget::databaseSaveFinished(const QString& filePath,
+                                             const QString& errorMessage,
+                                             quint64 modificationCounter)
+{
+    Database* db = qobject_cast<Database*>(sender());
+    if (!db || !m_dbList.contains(db)) {
+        return;
+    }
+
+    if (!db->isSaving()) {
+        m_dbList[db].dbWidget->blockAutoReload(false);
+    }
+
+    // changes made while saving still have to be saved
+    processSaveResult(db, filePath, errorMessage, db->modificationCounter() == modificationCounter);
+
+    SaveScheduler* scheduler = m_dbList[db].saveScheduler;
+    if (scheduler && scheduler->isSaving() && !db->isSaving()) {
+        scheduler->saveFinished(errorMessage.isEmpty() ? QFileInfo(filePath).size() : 0);
+    }
+}
+
+/**
+ * Write a database once its save scheduler decides that the
+ * modifications collected so far are due.
+ */
+void DatabaseTabWidget::performScheduledSave()
+{
+    SaveScheduler* scheduler = qobject_cast<SaveScheduler*>(sender());
+    Database* db = nullptr;
+    for (auto it = m_dbList.constBegin(); it != m_dbList.constEnd(); ++it) {
+        if (it.value().saveScheduler == scheduler) {
+            db = it.key();
+            break;
+        }
+    }
+    if (!db) {
+        return;
+    }
+
+    const DatabaseManagerStruct& dbStruct = m_dbList[db];
+    if (dbStruct.readOnly || dbStruct.dbWidget->currentMode() == DatabaseWidget::LockedMode) {
+        scheduler->saveFinished(0);
+        return;
+    }
+
+    if (config()->get("UseBackgroundSaves").toBool()) {
+        saveDatabaseInBackground(db);
+        if (db->isSaving()) {
+            // completion is reported by databaseSaveFinished()
+            return;
+        }
+    } else {
+        saveDatabase(db);
+    }
+
+    if (scheduler->isSaving()) {
+        scheduler->saveFinished(dbStruct.modified ? 0 : QFileInfo(dbStruct.fileInfo.filePath()).size());
+    }
+}
+
+/**
+ * Write a pending scheduled save right away, e.g. before the database
+ * is closed or locked.
+ */
+void DatabaseTabWidget::flushScheduledSave(Database* db)
+{
+    SaveScheduler* scheduler = m_dbList.value(db).saveScheduler;
+    if (scheduler && scheduler->isPending()) {
+        scheduler->cancel();
+        saveDatabase(db);
+    }
+}
+
+/**
+ * Update the database state after it has been written.
+ *
+ * @param db saved database
+ * @param filePath path the database was written to
+ * @param errorMessage error of the save, empty on success
+ * @param upToDate whether the file contains all changes of the database
+ * @return true if the database was saved
+ */
+bool DatabaseTabWidget::processSaveResult(Database* db,
+                                          const QString& filePath,
+                                          const QString& errorMessage,
+                                          bool upToDate)
+{
+    DatabaseManagerStruct& dbStruct = m_dbList[db];
+
+    if (errorMessage.isEmpty()) {
+        // successfully saved database file
+        if (upToDate) {
             dbStruct.modified = false;
-            dbStruct.saveAttempts = 0;
-            dbStruct.fileInfo = QFileInfo(filePath);
             dbStruct.dbWidget->databaseSaved();
-            updateTabName(db);
-            emit messageDismissTab();
-            return true;
-        } else {
-            dbStruct.modified = true;
-            updateTabName(db);
-
-            if (++dbStruct.saveAttempts > 2 && useAtomicSaves) {
-                // Saving failed 3 times, issue a warning and attempt to resolve
-                auto choice = MessageBox::question(this,
-                                                   tr("Disable safe saves?"),
-                                                   tr("KeePassXC has failed to save the database multiple times. "
-                                                      "This is likely caused by file sync services holding a lock on "
-                                                      "the save file.\nDisable safe saves and try again?"),
-                                                   QMessageBox::Yes | QMessageBox::No,
-                                                   QMessageBox::Yes);
-                if (choice == QMessageBox::Yes) {
-                    config()->set("UseAtomicSaves", false);
-                    return saveDatabase(db, filePath);
-                }
-                // Reset save attempts without changing anything
-                dbStruct.saveAttempts = 0;
+            if (dbStruct.saveScheduler) {
+                // the file already contains everything a scheduled save would write
+                dbStruct.saveScheduler->cancel();
             }
-
-            emit messageTab(tr("Writing the database failed.").append("\n").append(errorMessage), MessageWidget::Error);
-            return false;
         }
+        dbStruct.saveAttempts = 0;
+        dbStruct.fileInfo = QFileInfo(filePath);
+        updateTabName(db);
+        emit messageDismissTab();
+        return true;
     } else {
-        return saveDatabaseAs(db);
+        bool useAtomicSaves = config()->get("UseAtomicSaves", true).toBool();
+        dbStruct.modified = true;
+        updateTabName(db);
+
+        if (++dbStruct.saveAttempts > 2 && useAtomicSaves) {
+            // Saving failed 3 times, issue a warning and attempt to resolve
+            auto choice = MessageBox::question(this,
+                                               tr("Disable safe saves?"),
+                                               tr("KeePassXC has failed to save the database multiple times. "
+                                                  "This is likely caused by file sync services holding a lock on "
+                                                  "the save file.\nDisable safe saves and try again?"),
+                                               QMessageBox::Yes | QMessageBox::No,
+                                               QMessageBox::Yes);
+            if (choice == QMessageBox::Yes) {
+                config()->set("UseAtomicSaves", false);
+                return saveDatabase(db, filePath);
+            }
+            // Reset save attempts without changing anything
+            dbStruct.saveAttempts = 0;
+        }
+
+        emit messageTab(tr("Writing the database failed.").append("\n").append(errorMessage), MessageWidget::Error);
+        return false;
     }
 }
 
@@ -434,6 +572,9 @@ bool DatabaseTabWidget::saveDatabase(int index)
         index = currentIndex();
     }
 
+    if (config()->get("UseBackgroundSaves").toBool()) {
+        return saveDatabaseInBackground(indexDatabase(index));
+    }
     return saveDatabase(indexDatabase(index));
 }
 
@@ -647,6 +788,11 @@ Database* DatabaseTabWidget::databaseFromDatabaseWidget(DatabaseWidget* dbWidget
 void DatabaseTabWidget::insertDatabase(Database* db, const DatabaseManagerStruct& dbStruct)
 {
     m_dbList.insert(db, dbStruct);
+    if (!dbStruct.saveScheduler) {
+        SaveScheduler* scheduler = new SaveScheduler(this);
+        connect(scheduler, SIGNAL(saveDue()), SLOT(performScheduledSave()));
+        m_dbList[db].saveScheduler = scheduler;
+    }
 
     addTab(dbStruct.dbWidget, "");
     toggleTabbar();
@@ -685,6 +831,18 @@ bool DatabaseTabWidget::hasLockableDatabases() const
     return false;
 }
 
+/**
+ * Save scheduler of a database, provides the autosave counters.
+ */
+const SaveScheduler* DatabaseTabWidget::saveScheduler(int index)
+{
+    if (index == -1) {
+        index = currentIndex();
+    }
+
+    return indexDatabaseManagerStruct(index).saveScheduler;
+}
+
 void DatabaseTabWidget::lockDatabases()
 {
     clipboard()->clearCopiedText();
@@ -713,6 +871,8 @@ void DatabaseTabWidget::lockDatabases()
             }
         }
 
+        flushScheduledSave(db);
+
         if (m_dbList[db].modified) {
             QMessageBox::StandardButton result =
                 MessageBox::question(this,
@@ -769,16 +929,18 @@ void DatabaseTabWidget::modified()
     Database* db = static_cast<Database*>(sender());
     DatabaseManagerStruct& dbStruct = m_dbList[db];
 
-    if (config()->get("AutoSaveAfterEveryChange").toBool() && !dbStruct.readOnly) {
-        saveDatabase(db);
-        return;
-    }
-
     if (!dbStruct.modified) {
         dbStruct.modified = true;
         dbStruct.dbWidget->databaseModified();
         updateTabName(db);
     }
+
+    if (config()->get("AutoSaveAfterEveryChange").toBool() && !dbStruct.readOnly) {
+        // bulk operations emit many modifications, write them in batches
+        dbStruct.saveScheduler->setDelay(config()->get("AutoSaveDelay").toInt());
+        dbStruct.saveScheduler->setBudget(config()->get("AutoSaveMaxPerMinute").toInt());
+        dbStruct.saveScheduler->requestSave();
+    }
 }
 
 void DatabaseTabWidget::updateLastDatabases(const QString& filename)
@@ -806,6 +968,13 @@ void DatabaseTabWidget::changeDatabase(Database* newDb, bool unsavedChanges)
     Database* oldDb = databaseFromDatabaseWidget(dbWidget);
     DatabaseManagerStruct dbStruct = m_dbList[oldDb];
     dbStruct.modified = unsavedChanges;
+    if (dbStruct.saveScheduler->isSaving()) {
+        // the old database no longer reports the completion of its save
+        dbStruct.saveScheduler->saveFinished(0);
+    }
+    if (!unsavedChanges) {
+        dbStruct.saveScheduler->cancel();
+    }
     m_dbList.remove(oldDb);
     m_dbList.insert(newDb, dbStruct);
 
@@ -831,6 +1000,9 @@ void DatabaseTabWidget::connectDatabase(Database* newDb, Database* oldDb)
 
     connect(newDb, SIGNAL(nameTextChanged()), SLOT(updateTabNameFromDbSender()));
     connect(newDb, SIGNAL(modified()), SLOT(modified()));
+    connect(newDb,
+            SIGNAL(saveFinished(QString, QString, quint64)),
+            SLOT(databaseSaveFinished(QString, QString, quint64)));
     newDb->setEmitModified(true);
 }
 
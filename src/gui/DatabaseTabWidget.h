@@ -31,6 +31,7 @@ class DatabaseWidgetStateSync;
 class DatabaseOpenWidget;
 class QFile;
 class MessageWidget;
+class SaveScheduler;
 
 struct DatabaseManagerStruct
 {
@@ -41,6 +42,7 @@ struct DatabaseManagerStruct
     bool modified;
     bool readOnly;
     int saveAttempts;
+    SaveScheduler* saveScheduler;
 };
 
 Q_DECLARE_TYPEINFO(DatabaseManagerStruct, Q_MOVABLE_TYPE);
@@ -56,6 +58,7 @@ public:
     void mergeDatabase(const QString& fileName);
     DatabaseWidget* currentDatabaseWidget();
     bool hasLockableDatabases() const;
+    const SaveScheduler* saveScheduler(int index = -1);
 
     static const int LastDatabasesCount;
 
@@ -101,9 +104,14 @@ private slots:
     void changeDatabase(Database* newDb, bool unsavedChanges);
     void emitActivateDatabaseChanged();
     void emitDatabaseUnlockedFromDbWidgetSender();
+    void databaseSaveFinished(const QString& filePath, const QString& errorMessage, quint64 modificationCounter);
+    void performScheduledSave();
 
 private:
     bool saveDatabase(Database* db, QString filePath = "");
+    bool saveDatabaseInBackground(Database* db);
+    bool processSaveResult(Database* db, const QString& filePath, const QString& errorMessage, bool upToDate);
+    void flushScheduledSave(Database* db);
     bool saveDatabaseAs(Database* db);
     bool closeDatabase(Database* db);
     void deleteDatabase(Database* db);
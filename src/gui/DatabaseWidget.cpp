@@ -30,6 +30,7 @@
 #include <QLineEdit>
 #include <QProcess>
 #include <QSplitter>
+#include <QtConcurrent>
 
 #include "autotype/AutoType.h"
 #include "core/Config.h"
@@ -38,6 +39,7 @@
 #include "core/Group.h"
 #include "core/Metadata.h"
 #include "core/Tools.h"
+#include "crypto/MemoryCipher.h"
 #include "format/KeePass2Reader.h"
 #include "gui/ChangeMasterKeyWidget.h"
 #include "gui/Clipboard.h"
@@ -223,6 +225,15 @@ DatabaseWidget::DatabaseWidget(Database* db, QWidget* parent)
 
     m_searchCaseSensitive = false;
     m_searchLimitGroup = config()->get("SearchLimitGroup", false).toBool();
+    m_searchBatchCount = 0;
+    m_searchBatchesShown = 0;
+    m_searchInProgress = false;
+    m_searchRestartPending = false;
+    m_searchGroup = nullptr;
+    m_cachedSearchCaseSensitivity = Qt::CaseInsensitive;
+    m_cachedSearchGroup = nullptr;
+    connect(&m_searchWatcher, SIGNAL(resultsReadyAt(int, int)), SLOT(searchResultsReady()));
+    connect(&m_searchWatcher, SIGNAL(finished()), SLOT(searchFinished()));
 
 #ifdef WITH_XC_SSHAGENT
     if (config()->get("SSHAgent", false).toBool()) {
@@ -234,11 +245,16 @@ DatabaseWidget::DatabaseWidget(Database* db, QWidget* parent)
     }
 #endif
 
+    // remember the state of the file to merge later changes to it three-way
+    m_db->setMergeBaseEnabled(config()->get("UseThreeWayMerge").toBool());
+    m_db->setReferenceIndexEnabled(config()->get("UseReferenceIndex").toBool());
+
     setCurrentWidget(m_mainWidget);
 }
 
 DatabaseWidget::~DatabaseWidget()
 {
+    cancelSearch();
 }
 
 DatabaseWidget::Mode DatabaseWidget::currentMode() const
@@ -396,8 +412,14 @@ void DatabaseWidget::setIconFromParent()
 
 void DatabaseWidget::replaceDatabase(Database* db)
 {
+    // pending and cached search results belong to the old database
+    cancelSearch();
+    clearSearchCache();
+
     Database* oldDb = m_db;
     m_db = db;
+    m_db->setMergeBaseEnabled(config()->get("UseThreeWayMerge").toBool());
+    m_db->setReferenceIndexEnabled(config()->get("UseReferenceIndex").toBool());
     m_groupView->changeDatabase(m_db);
     emit databaseChanged(m_db, m_databaseModified);
     delete oldDb;
@@ -1025,6 +1047,7 @@ void DatabaseWidget::switchToImportCsv(const QString& filePath)
 void DatabaseWidget::switchToOpenMergeDatabase(const QString& filePath)
 {
     m_databaseOpenMergeWidget->clearForms();
+    m_databaseOpenMergeWidget->setKeyCache(m_db);
     m_databaseOpenMergeWidget->load(filePath);
     setCurrentWidget(m_databaseOpenMergeWidget);
 }
@@ -1072,21 +1095,122 @@ void DatabaseWidget::search(const QString& searchtext)
 
     Group* searchGroup = m_searchLimitGroup ? currentGroup() : m_db->rootGroup();
 
-    QList<Entry*> searchResult = EntrySearcher().search(searchtext, searchGroup, caseSensitive);
+    // a newer query replaces the running search, the results of the old one are dropped
+    cancelSearch();
+    connect(m_db, SIGNAL(modifiedImmediate()), SLOT(searchDatabaseModified()), Qt::UniqueConnection);
+
+    // the tree and the search index are only read on this thread, the pool matches copies of the fields
+    QList<EntrySearcher::Batch> batches;
+    if (!m_cachedSearchText.isNull() && m_cachedSearchGroup == searchGroup
+        && m_cachedSearchCaseSensitivity == caseSensitive
+        && EntrySearcher::refinesSearch(searchtext, m_cachedSearchText, caseSensitive)) {
+        // only the results of the previous query can match a refined one
+        batches = EntrySearcher().prepareBatches(searchtext, m_cachedSearchResult, searchGroup, caseSensitive);
+    } else {
+        batches = EntrySearcher().prepareBatches(searchtext, searchGroup, caseSensitive);
+    }
+    m_searchGroup = searchGroup;
+    m_searchBatchCount = batches.size();
+    m_searchBatchesShown = 0;
+    m_searchResult.clear();
+    m_searchInProgress = true;
+    m_searchRestartPending = false;
 
-    m_entryView->setEntryList(searchResult);
+    m_entryView->setEntryList(QList<Entry*>());
     m_lastSearchText = searchtext;
 
+    m_searchingLabel->setText(tr("Searching..."));
+    m_searchingLabel->setVisible(true);
+
+    m_searchWatcher.setFuture(QtConcurrent::mapped(batches, EntrySearcher::BatchMatcher(searchtext, caseSensitive)));
+
+    emit searchModeActivated();
+}
+
+/**
+ * Add the results of finished batches to the entry view. Batches may finish
+ * out of order, so only the batches following the ones shown already are added.
+ */
+void DatabaseWidget::searchResultsReady()
+{
+    if (!m_searchInProgress) {
+        return;
+    }
+
+    const QFuture<QList<Entry*>> future = m_searchWatcher.future();
+    QList<Entry*> entries;
+    while (m_searchBatchesShown < m_searchBatchCount && future.isResultReadyAt(m_searchBatchesShown)) {
+        entries.append(future.resultAt(m_searchBatchesShown));
+        ++m_searchBatchesShown;
+    }
+
+    if (!entries.isEmpty()) {
+        m_entryView->appendEntryList(entries);
+        m_searchResult.append(entries);
+    }
+
+    if (m_searchBatchesShown < m_searchBatchCount) {
+        m_searchingLabel->setText(tr("Searching... %1%").arg(100 * m_searchBatchesShown / m_searchBatchCount));
+    }
+}
+
+void DatabaseWidget::searchFinished()
+{
+    if (!m_searchInProgress || m_searchWatcher.isCanceled()) {
+        return;
+    }
+
+    searchResultsReady();
+    m_searchInProgress = false;
+    m_cachedSearchText = m_lastSearchText;
+    m_cachedSearchCaseSensitivity = m_searchCaseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    m_cachedSearchGroup = m_searchGroup;
+    m_cachedSearchResult = m_searchResult;
+
     // Display a label detailing our search results
-    if (searchResult.size() > 0) {
-        m_searchingLabel->setText(tr("Search Results (%1)").arg(searchResult.size()));
+    if (m_searchResult.size() > 0) {
+        m_searchingLabel->setText(tr("Search Results (%1)").arg(m_searchResult.size()));
     } else {
         m_searchingLabel->setText(tr("No Results"));
     }
+}
 
-    m_searchingLabel->setVisible(true);
+/**
+ * Results that haven't been shown yet may refer to entries that are about
+ * to be deleted, so a running search is started over once the change is done.
+ */
+void DatabaseWidget::searchDatabaseModified()
+{
+    clearSearchCache();
 
-    emit searchModeActivated();
+    if (m_searchInProgress && !m_searchRestartPending) {
+        cancelSearch();
+        m_searchRestartPending = true;
+        QTimer::singleShot(0, this, SLOT(restartSearch()));
+    }
+}
+
+void DatabaseWidget::restartSearch()
+{
+    if (m_searchRestartPending) {
+        refreshSearch();
+    }
+}
+
+void DatabaseWidget::cancelSearch()
+{
+    m_searchInProgress = false;
+    m_searchWatcher.cancel();
+    // drops the pending result notifications of the old future
+    m_searchWatcher.setFuture(QFuture<QList<Entry*>>());
+    m_searchResult.clear();
+}
+
+void DatabaseWidget::clearSearchCache()
+{
+    m_cachedSearchText = QString();
+    m_cachedSearchGroup = nullptr;
+    m_cachedSearchResult.clear();
 }
 
 void DatabaseWidget::setSearchCaseSensitive(bool state)
@@ -1117,6 +1241,10 @@ QString DatabaseWidget::getCurrentSearch()
 
 void DatabaseWidget::endSearch()
 {
+    cancelSearch();
+    clearSearchCache();
+    m_searchRestartPending = false;
+
     if (isInSearchMode()) {
         emit listModeAboutToActivate();
 
@@ -1210,6 +1338,8 @@ void DatabaseWidget::lock()
     Database* newDb = new Database();
     newDb->metadata()->setName(m_db->metadata()->name());
     replaceDatabase(newDb);
+    // no decrypted values of a locked database must stay in memory
+    MemoryCipher::clearCache();
 }
 
 void DatabaseWidget::updateFilePath(const QString& filePath)
@@ -1278,10 +1408,17 @@ void DatabaseWidget::reloadDatabaseFile()
     }
 
     KeePass2Reader reader;
+    reader.setPipelined(config()->get("UsePipelinedReader").toBool());
+    reader.setLazyAttachments(config()->get("LazyLoadAttachments").toBool());
+    // a synced file usually keeps its KDF seed, no need to derive the key again
+    reader.setKeyCache(m_db);
     QFile file(m_filePath);
     if (file.open(QIODevice::ReadOnly)) {
         Database* db = reader.readDatabase(&file, database()->key());
         if (db != nullptr) {
+            // the file as read is the common ancestor of the next reload
+            db->setMergeBaseEnabled(config()->get("UseThreeWayMerge").toBool());
+
             if (m_databaseModified) {
                 // Ask if we want to merge changes into new database
                 QMessageBox::StandardButton mb =
@@ -1292,9 +1429,9 @@ void DatabaseWidget::reloadDatabaseFile()
                                          QMessageBox::Yes | QMessageBox::No);
 
                 if (mb == QMessageBox::Yes) {
-                    // Merge the old database into the new one
+                    // Merge the changes of the old database since it was last synced into the new one
                     m_db->setEmitModified(false);
-                    db->merge(m_db);
+                    db->merge(m_db, m_db->mergeBase());
                 } else {
                     // Since we are accepting the new file as-is, internally mark as unmodified
                     // TODO: when saving is moved out of DatabaseTabWidget, this should be replaced
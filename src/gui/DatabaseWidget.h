@@ -20,6 +20,7 @@
 #define KEEPASSX_DATABASEWIDGET_H
 
 #include <QFileSystemWatcher>
+#include <QFutureWatcher>
 #include <QScopedPointer>
 #include <QStackedWidget>
 #include <QTimer>
@@ -205,11 +206,18 @@ private slots:
     void reloadDatabaseFile();
     void restoreGroupEntryFocus(const QUuid& groupUuid, const QUuid& EntryUuid);
     void unblockAutoReload();
+    // Asynchronous search slots
+    void searchResultsReady();
+    void searchFinished();
+    void searchDatabaseModified();
+    void restartSearch();
 
 private:
     void setClipboardTextAndMinimize(const QString& text);
     void setIconFromParent();
     void replaceDatabase(Database* db);
+    void cancelSearch();
+    void clearSearchCache();
 
     Database* m_db;
     QWidget* m_mainWidget;
@@ -242,6 +250,18 @@ private:
     QString m_lastSearchText;
     bool m_searchCaseSensitive;
     bool m_searchLimitGroup;
+    QFutureWatcher<QList<Entry*>> m_searchWatcher;
+    int m_searchBatchCount;
+    int m_searchBatchesShown;
+    bool m_searchInProgress;
+    bool m_searchRestartPending;
+    const Group* m_searchGroup;
+    QList<Entry*> m_searchResult;
+    // Result of the last completed search, refined by the following queries
+    QString m_cachedSearchText;
+    Qt::CaseSensitivity m_cachedSearchCaseSensitivity;
+    const Group* m_cachedSearchGroup;
+    QList<Entry*> m_cachedSearchResult;
 
     // CSV import state
     bool m_importingCsv;
@@ -90,7 +90,7 @@ QVariant EntryAttachmentsModel::data(const QModelIndex& index, int role) const
         if (column == Columns::NameColumn) {
             return key;
         } else if (column == SizeColumn) {
-            const int attachmentSize = m_entryAttachments->value(key).size();
+            const int attachmentSize = m_entryAttachments->size(key);
             if (role == Qt::DisplayRole) {
                 return Tools::humanReadableFileSize(attachmentSize);
             }
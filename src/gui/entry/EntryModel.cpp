@@ -92,23 +92,39 @@ void EntryModel::setEntryList(const QList<Entry*>& entries)
     }
 
     for (Database* db : asConst(databases)) {
-        Q_ASSERT(db);
-        const QList<Group*> groupList = db->rootGroup()->groupsRecursive(true);
-        for (const Group* group : groupList) {
-            m_allGroups.append(group);
-        }
+        makeConnections(db);
+    }
 
-        if (db->metadata()->recycleBin()) {
-            m_allGroups.removeOne(db->metadata()->recycleBin());
-        }
+    endResetModel();
+    emit switchedToSearchMode();
+}
+
+/**
+ * Append entries to the list set with setEntryList() without resetting the model.
+ */
+void EntryModel::appendEntryList(const QList<Entry*>& entries)
+{
+    Q_ASSERT(!m_group);
+    if (m_group || entries.isEmpty()) {
+        return;
     }
 
-    for (const Group* group : asConst(m_allGroups)) {
-        makeConnections(group);
+    beginInsertRows(QModelIndex(), m_entries.size(), m_entries.size() + entries.size() - 1);
+
+    m_entries.append(entries);
+    m_orgEntries.append(entries);
+
+    QSet<Database*> databases;
+
+    for (Entry* entry : entries) {
+        databases.insert(entry->group()->database());
     }
 
-    endResetModel();
-    emit switchedToSearchMode();
+    for (Database* db : asConst(databases)) {
+        makeConnections(db);
+    }
+
+    endInsertRows();
 }
 
 int EntryModel::rowCount(const QModelIndex& parent) const
@@ -444,6 +460,26 @@ void EntryModel::severConnections()
     }
 }
 
+/**
+ * Connect to all groups of the database except the recycle bin,
+ * nothing is done if the database is connected already.
+ */
+void EntryModel::makeConnections(Database* db)
+{
+    Q_ASSERT(db);
+    if (m_allGroups.contains(db->rootGroup())) {
+        return;
+    }
+
+    const QList<Group*> groupList = db->rootGroup()->groupsRecursive(true);
+    for (const Group* group : groupList) {
+        if (group != db->metadata()->recycleBin()) {
+            m_allGroups.append(group);
+            makeConnections(group);
+        }
+    }
+}
+
 void EntryModel::makeConnections(const Group* group)
 {
     connect(group, SIGNAL(entryAboutToAdd(Entry*)), SLOT(entryAboutToAdd(Entry*)));
@@ -21,6 +21,7 @@
 #include <QAbstractTableModel>
 #include <QPixmap>
 
+class Database;
 class Entry;
 class Group;
 
@@ -61,6 +62,7 @@ public:
     QMimeData* mimeData(const QModelIndexList& indexes) const override;
 
     void setEntryList(const QList<Entry*>& entries);
+    void appendEntryList(const QList<Entry*>& entries);
 
     bool isUsernamesHidden() const;
     void setUsernamesHidden(const bool hide);
@@ -89,6 +91,7 @@ private slots:
 
 private:
     void severConnections();
+    void makeConnections(Database* db);
     void makeConnections(const Group* group);
 
     Group* m_group;
@@ -158,6 +158,15 @@ void EntryView::setEntryList(const QList<Entry*>& entries)
     setFirstEntryActive();
 }
 
+void EntryView::appendEntryList(const QList<Entry*>& entries)
+{
+    const bool wasEmpty = m_model->rowCount() == 0;
+    m_model->appendEntryList(entries);
+    if (wasEmpty) {
+        setFirstEntryActive();
+    }
+}
+
 void EntryView::setFirstEntryActive()
 {
     if (m_model->rowCount() > 0) {
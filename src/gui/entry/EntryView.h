@@ -40,6 +40,7 @@ public:
     void setCurrentEntry(Entry* entry);
     Entry* entryFromIndex(const QModelIndex& index);
     void setEntryList(const QList<Entry*>& entries);
+    void appendEntryList(const QList<Entry*>& entries);
     bool inSearchMode();
     int numberOfSelectedEntries();
     void setFirstEntryActive();
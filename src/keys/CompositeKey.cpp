@@ -183,3 +183,8 @@ void CompositeKey::addChallengeResponseKey(QSharedPointer<ChallengeResponseKey>
 {
     m_challengeResponseKeys.append(key);
 }
+
+QList<QSharedPointer<ChallengeResponseKey>> CompositeKey::challengeResponseKeys() const
+{
+    return m_challengeResponseKeys;
+}
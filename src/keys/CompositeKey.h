@@ -45,6 +45,7 @@ public:
 
     void addKey(const Key& key);
     void addChallengeResponseKey(QSharedPointer<ChallengeResponseKey> key);
+    QList<QSharedPointer<ChallengeResponseKey>> challengeResponseKeys() const;
 
 private:
     QList<Key*> m_keys;
@@ -126,19 +126,21 @@ bool HmacBlockStream::readHashedBlock()
     if (m_eof) {
         return false;
     }
-    QByteArray hmac = m_baseDevice->read(32);
-    if (hmac.size() != 32) {
+
+    char hmac[32];
+    if (m_baseDevice->read(hmac, 32) != 32) {
         m_error = true;
         setErrorString("Invalid HMAC size.");
         return false;
     }
 
-    QByteArray blockSizeBytes = m_baseDevice->read(4);
-    if (blockSizeBytes.size() != 4) {
+    char blockSizeData[4];
+    if (m_baseDevice->read(blockSizeData, 4) != 4) {
         m_error = true;
         setErrorString("Invalid block size size.");
         return false;
     }
+    const QByteArray blockSizeBytes = QByteArray::fromRawData(blockSizeData, 4);
     auto blockSize = Endian::bytesToSizedInt<qint32>(blockSizeBytes, ByteOrder);
     if (blockSize < 0) {
         m_error = true;
@@ -146,8 +148,9 @@ bool HmacBlockStream::readHashedBlock()
         return false;
     }
 
-    m_buffer = m_baseDevice->read(blockSize);
-    if (m_buffer.size() != blockSize) {
+    // the buffer keeps its allocation, blocks are read into it directly
+    m_buffer.resize(blockSize);
+    if (m_baseDevice->read(m_buffer.data(), blockSize) != blockSize) {
         m_error = true;
         setErrorString("Block too short.");
         return false;
@@ -159,7 +162,7 @@ bool HmacBlockStream::readHashedBlock()
     hasher.addData(blockSizeBytes);
     hasher.addData(m_buffer);
 
-    if (hmac != hasher.result()) {
+    if (QByteArray::fromRawData(hmac, 32) != hasher.result()) {
         m_error = true;
         setErrorString("Mismatch between hash and data.");
         return false;
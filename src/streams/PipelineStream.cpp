@@ -0,0 +1,327 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PipelineStream.h"
+
+#include <QThread>
+
+class PipelineStream::WorkerThread : public QThread
+{
+public:
+    explicit WorkerThread(PipelineStream* stream)
+        : m_stream(stream)
+    {
+    }
+
+protected:
+    void run() override
+    {
+        if (m_stream->isWritable()) {
+            m_stream->writeBehind();
+        } else {
+            m_stream->readAhead();
+        }
+    }
+
+private:
+    PipelineStream* const m_stream;
+};
+
+PipelineStream::PipelineStream(QIODevice* baseDevice)
+    : PipelineStream(baseDevice, 64 * 1024, 16)
+{
+}
+
+PipelineStream::PipelineStream(QIODevice* baseDevice, int chunkSize, int maxChunks)
+    : LayeredStream(baseDevice)
+    , m_chunkSize(chunkSize)
+    , m_maxChunks(maxChunks)
+    , m_finished(false)
+    , m_error(false)
+    , m_abort(false)
+    , m_chunkPos(0)
+{
+    Q_ASSERT(chunkSize > 0);
+    Q_ASSERT(maxChunks > 0);
+}
+
+PipelineStream::~PipelineStream()
+{
+    close();
+}
+
+bool PipelineStream::open(QIODevice::OpenMode mode)
+{
+    if (!LayeredStream::open(mode)) {
+        return false;
+    }
+
+    // a writer is started by the first write
+    if (!isWritable()) {
+        startWorker();
+    }
+    return true;
+}
+
+bool PipelineStream::reset()
+{
+    if (!isWritable()) {
+        return false;
+    }
+
+    return finishWriting();
+}
+
+void PipelineStream::close()
+{
+    if (isWritable()) {
+        finishWriting();
+    } else {
+        stopWorker();
+    }
+    LayeredStream::close();
+}
+
+void PipelineStream::startWorker()
+{
+    Q_ASSERT(!m_worker);
+
+    m_chunks.clear();
+    m_baseError.clear();
+    m_finished = false;
+    m_error = false;
+    m_abort = false;
+    m_chunk.clear();
+    m_chunkPos = 0;
+
+    m_worker.reset(new WorkerThread(this));
+    m_worker->start();
+}
+
+void PipelineStream::stopWorker()
+{
+    if (!m_worker) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_abort = true;
+        m_spaceAvailable.wakeAll();
+    }
+
+    // the worker finishes the read it is busy with before it notices the abort
+    m_worker->wait();
+    m_worker.reset();
+    m_chunks.clear();
+}
+
+bool PipelineStream::atEnd() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_chunkPos == m_chunk.size() && m_chunks.isEmpty() && (m_finished || m_error);
+}
+
+/**
+ * Worker thread: read the base device until it is exhausted, fails or
+ * the stream is closed.
+ */
+void PipelineStream::readAhead()
+{
+    while (true) {
+        QByteArray chunk(m_chunkSize, Qt::Uninitialized);
+        const qint64 readResult = m_baseDevice->read(chunk.data(), m_chunkSize);
+
+        QMutexLocker locker(&m_mutex);
+
+        if (readResult <= 0) {
+            if (readResult < 0) {
+                m_error = true;
+                m_baseError = m_baseDevice->errorString();
+            } else {
+                m_finished = true;
+            }
+            m_chunkAvailable.wakeAll();
+            return;
+        }
+
+        chunk.resize(static_cast<int>(readResult));
+
+        while (m_chunks.size() >= m_maxChunks && !m_abort) {
+            m_spaceAvailable.wait(&m_mutex);
+        }
+        if (m_abort) {
+            return;
+        }
+
+        m_chunks.enqueue(chunk);
+        m_chunkAvailable.wakeAll();
+    }
+}
+
+qint64 PipelineStream::readData(char* data, qint64 maxSize)
+{
+    qint64 bytesRemaining = maxSize;
+    qint64 offset = 0;
+
+    while (bytesRemaining > 0) {
+        if (m_chunkPos == m_chunk.size()) {
+            QMutexLocker locker(&m_mutex);
+
+            while (m_chunks.isEmpty() && !m_finished && !m_error) {
+                m_chunkAvailable.wait(&m_mutex);
+            }
+
+            if (m_chunks.isEmpty()) {
+                // hand out the data read so far before reporting an error
+                if (m_error && offset == 0) {
+                    setErrorString(m_baseError);
+                    return -1;
+                }
+                return offset;
+            }
+
+            m_chunk = m_chunks.dequeue();
+            m_chunkPos = 0;
+            m_spaceAvailable.wakeAll();
+        }
+
+        qint64 bytesToCopy = qMin(bytesRemaining, static_cast<qint64>(m_chunk.size() - m_chunkPos));
+
+        memcpy(data + offset, m_chunk.constData() + m_chunkPos, static_cast<size_t>(bytesToCopy));
+
+        offset += bytesToCopy;
+        m_chunkPos += bytesToCopy;
+        bytesRemaining -= bytesToCopy;
+    }
+
+    return maxSize;
+}
+
+/**
+ * Worker thread: write the queued chunks to the base device until the
+ * writing thread has finished or a write fails.
+ */
+void PipelineStream::writeBehind()
+{
+    while (true) {
+        QByteArray chunk;
+        {
+            QMutexLocker locker(&m_mutex);
+
+            while (m_chunks.isEmpty() && !m_finished && !m_abort) {
+                m_chunkAvailable.wait(&m_mutex);
+            }
+            if (m_abort || m_chunks.isEmpty()) {
+                return;
+            }
+
+            chunk = m_chunks.dequeue();
+            m_spaceAvailable.wakeAll();
+        }
+
+        if (m_baseDevice->write(chunk) != chunk.size()) {
+            QMutexLocker locker(&m_mutex);
+            m_error = true;
+            m_baseError = m_baseDevice->errorString();
+            m_chunks.clear();
+            m_spaceAvailable.wakeAll();
+            return;
+        }
+    }
+}
+
+qint64 PipelineStream::writeData(const char* data, qint64 maxSize)
+{
+    Q_ASSERT(maxSize >= 0);
+
+    if (!m_worker && maxSize > 0) {
+        startWorker();
+    }
+
+    qint64 bytesRemaining = maxSize;
+    qint64 offset = 0;
+
+    while (bytesRemaining > 0) {
+        if (m_chunk.isEmpty()) {
+            m_chunk.reserve(m_chunkSize);
+        }
+
+        qint64 bytesToCopy = qMin(bytesRemaining, static_cast<qint64>(m_chunkSize - m_chunk.size()));
+
+        m_chunk.append(data + offset, static_cast<int>(bytesToCopy));
+
+        offset += bytesToCopy;
+        bytesRemaining -= bytesToCopy;
+
+        if (m_chunk.size() == m_chunkSize && !enqueueChunk()) {
+            return -1;
+        }
+    }
+
+    return maxSize;
+}
+
+/**
+ * Hand the pending chunk over to the worker, waits while the queue is full.
+ */
+bool PipelineStream::enqueueChunk()
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (m_chunks.size() >= m_maxChunks && !m_error) {
+        m_spaceAvailable.wait(&m_mutex);
+    }
+
+    if (m_error) {
+        setErrorString(m_baseError);
+        return false;
+    }
+
+    m_chunks.enqueue(m_chunk);
+    m_chunk.clear();
+    m_chunkAvailable.wakeAll();
+    return true;
+}
+
+/**
+ * Queue the remaining data and wait until the worker has written everything.
+ */
+bool PipelineStream::finishWriting()
+{
+    if (!m_worker) {
+        return true;
+    }
+
+    bool ok = m_chunk.isEmpty() || enqueueChunk();
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_finished = true;
+        m_chunkAvailable.wakeAll();
+    }
+
+    m_worker->wait();
+    m_worker.reset();
+
+    if (ok && m_error) {
+        setErrorString(m_baseError);
+        ok = false;
+    }
+
+    return ok;
+}
@@ -0,0 +1,89 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSXC_PIPELINESTREAM_H
+#define KEEPASSXC_PIPELINESTREAM_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QQueue>
+#include <QScopedPointer>
+#include <QWaitCondition>
+
+#include "streams/LayeredStream.h"
+
+/**
+ * Runs the base device on a worker thread and hands data over through
+ * a bounded queue of chunks.
+ *
+ * Inserting a PipelineStream between two layers of a stream chain lets the
+ * layers below it work on their own thread. When reading, the worker reads
+ * ahead while the layers above consume the data. When writing, the worker
+ * writes behind and writes block once the queue is full. The base device
+ * must not be used by anybody else while the stream is open.
+ *
+ * A written stream is flushed by reset() or close(); reset() waits until
+ * the base device has received all data and reports its errors. The writing
+ * worker only runs between the first write and the next reset() or close().
+ */
+class PipelineStream : public LayeredStream
+{
+    Q_OBJECT
+
+public:
+    explicit PipelineStream(QIODevice* baseDevice);
+    PipelineStream(QIODevice* baseDevice, int chunkSize, int maxChunks);
+    ~PipelineStream() override;
+
+    bool open(QIODevice::OpenMode mode) override;
+    bool reset() override;
+    void close() override;
+    bool atEnd() const override;
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    class WorkerThread;
+
+    void startWorker();
+    void readAhead();
+    void writeBehind();
+    bool enqueueChunk();
+    bool finishWriting();
+    void stopWorker();
+
+    const int m_chunkSize;
+    const int m_maxChunks;
+    QScopedPointer<WorkerThread> m_worker;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_chunkAvailable;
+    QWaitCondition m_spaceAvailable;
+    QQueue<QByteArray> m_chunks;
+    QString m_baseError;
+    bool m_finished;
+    bool m_error;
+    bool m_abort;
+
+    // only used by the thread using the stream
+    QByteArray m_chunk;
+    int m_chunkPos;
+};
+
+#endif // KEEPASSXC_PIPELINESTREAM_H
@@ -17,6 +17,9 @@
 
 #include "SymmetricCipherStream.h"
 
+// multiple of the block size of all supported ciphers
+const int SymmetricCipherStream::ReadBufferSize = 64 * 1024;
+
 SymmetricCipherStream::SymmetricCipherStream(QIODevice* baseDevice,
                                              SymmetricCipher::Algorithm algo,
                                              SymmetricCipher::Mode mode,
@@ -24,7 +27,10 @@ SymmetricCipherStream::SymmetricCipherStream(QIODevice* baseDevice,
     : LayeredStream(baseDevice)
     , m_cipher(new SymmetricCipher(algo, mode, direction))
     , m_bufferPos(0)
-    , m_bufferFilling(false)
+    , m_bufferEnd(0)
+    , m_bufferDecrypted(0)
+    , m_bufferFill(0)
+    , m_readFinished(false)
     , m_error(false)
     , m_isInitialized(false)
     , m_dataWritten(false)
@@ -50,7 +56,10 @@ void SymmetricCipherStream::resetInternalState()
 {
     m_buffer.clear();
     m_bufferPos = 0;
-    m_bufferFilling = false;
+    m_bufferEnd = 0;
+    m_bufferDecrypted = 0;
+    m_bufferFill = 0;
+    m_readFinished = false;
     m_error = false;
     m_dataWritten = false;
     m_cipher->reset();
@@ -97,7 +106,7 @@ qint64 SymmetricCipherStream::readData(char* data, qint64 maxSize)
     qint64 offset = 0;
 
     while (bytesRemaining > 0) {
-        if ((m_bufferPos == m_buffer.size()) || m_bufferFilling) {
+        if (m_bufferPos == m_bufferEnd) {
             if (!readBlock()) {
                 if (m_error) {
                     return -1;
@@ -107,7 +116,7 @@ qint64 SymmetricCipherStream::readData(char* data, qint64 maxSize)
             }
         }
 
-        int bytesToCopy = qMin(bytesRemaining, static_cast<qint64>(m_buffer.size() - m_bufferPos));
+        int bytesToCopy = qMin(bytesRemaining, static_cast<qint64>(m_bufferEnd - m_bufferPos));
 
         memcpy(data + offset, m_buffer.constData() + m_bufferPos, bytesToCopy);
 
@@ -119,67 +128,88 @@ qint64 SymmetricCipherStream::readData(char* data, qint64 maxSize)
     return maxSize;
 }
 
+/**
+ * Read and decrypt as many whole blocks as fit into the buffer.
+ *
+ * The buffer is allocated once and decrypted in place. The buffer is laid out as
+ * [handed out | readable: m_bufferPos..m_bufferEnd | held back block | incomplete block],
+ * the last decrypted block is held back until it is known whether it carries the padding.
+ */
 bool SymmetricCipherStream::readBlock()
 {
-    QByteArray newData;
+    if (m_readFinished) {
+        return false;
+    }
 
-    if (m_bufferFilling) {
-        newData.resize(blockSize() - m_buffer.size());
-    } else {
-        m_buffer.clear();
-        newData.resize(blockSize());
+    if (m_buffer.size() != ReadBufferSize) {
+        m_buffer.resize(ReadBufferSize);
     }
+    char* buffer = m_buffer.data();
 
-    int readResult = m_baseDevice->read(newData.data(), newData.size());
+    // move the held back and the incomplete block to the front
+    const int keep = m_bufferFill - m_bufferEnd;
+    memmove(buffer, buffer + m_bufferEnd, static_cast<size_t>(keep));
+    m_bufferDecrypted -= m_bufferEnd;
+    m_bufferFill = keep;
+    m_bufferPos = 0;
+    m_bufferEnd = 0;
 
-    if (readResult == -1) {
-        m_error = true;
-        setErrorString(m_baseDevice->errorString());
-        return false;
-    } else {
-        m_buffer.append(newData.left(readResult));
-    }
+    bool atEnd = false;
+    while (m_bufferEnd == 0 && !atEnd) {
+        qint64 readResult = m_baseDevice->read(buffer + m_bufferFill, ReadBufferSize - m_bufferFill);
 
-    if (!m_streamCipher && m_buffer.size() != blockSize()) {
-        m_bufferFilling = true;
-        return false;
-    } else {
-        if (!m_cipher->processInPlace(m_buffer)) {
+        if (readResult == -1) {
+            m_error = true;
+            setErrorString(m_baseDevice->errorString());
+            return false;
+        }
+
+        m_bufferFill += static_cast<int>(readResult);
+        atEnd = readResult == 0 || m_baseDevice->atEnd();
+
+        int newBytes = m_bufferFill - m_bufferDecrypted;
+        if (!m_streamCipher) {
+            newBytes -= newBytes % blockSize();
+        }
+
+        if (newBytes > 0 && !m_cipher->processInPlace(buffer + m_bufferDecrypted, newBytes)) {
             m_error = true;
             setErrorString(m_cipher->errorString());
             return false;
         }
-        m_bufferPos = 0;
-        m_bufferFilling = false;
-
-        if (m_baseDevice->atEnd()) {
-            if (!m_streamCipher) {
-                // PKCS7 padding
-                quint8 padLength = m_buffer.at(m_buffer.size() - 1);
-
-                if (padLength == blockSize()) {
-                    Q_ASSERT(m_buffer == QByteArray(blockSize(), blockSize()));
-                    // full block with just padding: discard
-                    m_buffer.clear();
-                    return false;
-                } else if (padLength > blockSize()) {
-                    // invalid padding
-                    m_error = true;
-                    setErrorString("Invalid padding.");
-                    return false;
-                } else {
-                    Q_ASSERT(m_buffer.right(padLength) == QByteArray(padLength, padLength));
-                    // resize buffer to strip padding
-                    m_buffer.resize(blockSize() - padLength);
-                    return true;
-                }
-            } else {
-                return m_buffer.size() > 0;
+        m_bufferDecrypted += newBytes;
+
+        if (m_streamCipher) {
+            m_bufferEnd = m_bufferDecrypted;
+        } else if (!atEnd) {
+            m_bufferEnd = qMax(0, m_bufferDecrypted - blockSize());
+        }
+    }
+
+    if (atEnd) {
+        m_readFinished = true;
+
+        if (!m_streamCipher && m_bufferDecrypted > 0) {
+            // PKCS7 padding, an incomplete block at the end is ignored
+            quint8 padLength = buffer[m_bufferDecrypted - 1];
+
+            if (padLength > blockSize()) {
+                // invalid padding
+                m_error = true;
+                setErrorString("Invalid padding.");
+                return false;
             }
+
+            Q_ASSERT(QByteArray::fromRawData(buffer + m_bufferDecrypted - padLength, padLength)
+                     == QByteArray(padLength, padLength));
+            // a full block with just padding is discarded
+            m_bufferEnd = m_bufferDecrypted - padLength;
         } else {
-            return true;
+            m_bufferEnd = m_bufferDecrypted;
         }
     }
+
+    return m_bufferPos < m_bufferEnd;
 }
 
 qint64 SymmetricCipherStream::writeData(const char* data, qint64 maxSize)
@@ -49,10 +49,15 @@ private:
     bool writeBlock(bool lastBlock);
     int blockSize() const;
 
+    static const int ReadBufferSize;
+
     const QScopedPointer<SymmetricCipher> m_cipher;
     QByteArray m_buffer;
     int m_bufferPos;
-    bool m_bufferFilling;
+    int m_bufferEnd;
+    int m_bufferDecrypted;
+    int m_bufferFill;
+    bool m_readFinished;
     bool m_error;
     bool m_isInitialized;
     bool m_dataWritten;
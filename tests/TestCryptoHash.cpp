@@ -60,3 +60,37 @@ void TestCryptoHash::test()
              QByteArray::fromHex("0d41b612584ed39ff72944c29494573e40f4bb95283455fae2e0be1e3565aa9f48057d59e6ffd777970e2"
                                  "82871c25a549a2763e5b724794f312c97021c42f91d"));
 }
+
+void TestCryptoHash::testBackends()
+{
+    const Crypto::Backend selected = Crypto::backend();
+    const QByteArray data = QByteArray("The quick brown fox jumps over the lazy dog").repeated(100);
+
+    for (Crypto::Backend backend : Crypto::backends()) {
+        QVERIFY(Crypto::setBackend(backend));
+
+        // RFC 4231 test case 2
+        QCOMPARE(CryptoHash::hmac("what do ya want for nothing?", "Jefe", CryptoHash::Sha256),
+                 QByteArray::fromHex("5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843"));
+        QCOMPARE(CryptoHash::hmac("what do ya want for nothing?", "Jefe", CryptoHash::Sha512),
+                 QByteArray::fromHex("164b7a7bfcf819e2e395fbe73b56e0a387bd64222e831fd610270cd7ea2505549758bf75c05a994a6d0"
+                                     "34f65f8f0e6fdcaeab1a34d4a6b4b636e070a38bce737"));
+
+        // RFC 4231 test case 6, a key longer than the block size
+        CryptoHash hmac(CryptoHash::Sha256, true);
+        hmac.setKey(QByteArray(131, '\xaa'));
+        hmac.addData("Test Using Larger Than Block-Size Key - Hash Key First");
+        QCOMPARE(hmac.result(),
+                 QByteArray::fromHex("60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54"));
+
+        CryptoHash sha512(CryptoHash::Sha512);
+        for (int i = 0; i < data.size(); i += 77) {
+            sha512.addData(data.mid(i, 77));
+        }
+        QCOMPARE(sha512.result(), CryptoHash::hash(data, CryptoHash::Sha512));
+        sha512.reset();
+        QCOMPARE(sha512.result(), CryptoHash::hash(QByteArray(), CryptoHash::Sha512));
+    }
+
+    QVERIFY(Crypto::setBackend(selected));
+}
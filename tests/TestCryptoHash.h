@@ -27,6 +27,7 @@ class TestCryptoHash : public QObject
 private slots:
     void initTestCase();
     void test();
+    void testBackends();
 };
 
 #endif // KEEPASSX_TESTCRYPTOHASH_H
@@ -23,6 +23,7 @@
 #include <QTemporaryFile>
 
 #include "config-keepassx-tests.h"
+#include "core/Group.h"
 #include "core/Metadata.h"
 #include "crypto/Crypto.h"
 #include "format/KeePass2Writer.h"
@@ -109,3 +110,279 @@ void TestDatabase::testEmptyRecycleBinWithHierarchicalData()
 
     delete db;
 }
+
+void TestDatabase::testUuidIndex()
+{
+    QScopedPointer<Database> db(new Database());
+    Group* root = db->rootGroup();
+    QCOMPARE(db->resolveGroup(root->uuid()), root);
+
+    Group* group1 = new Group();
+    group1->setUuid(QUuid::createUuid());
+    group1->setParent(root);
+    Group* group2 = new Group();
+    group2->setUuid(QUuid::createUuid());
+    group2->setParent(root);
+
+    Entry* entry1 = new Entry();
+    entry1->setUuid(QUuid::createUuid());
+    entry1->setGroup(group1);
+    Entry* entry2 = new Entry();
+    entry2->setUuid(QUuid::createUuid());
+    entry2->setGroup(group2);
+
+    QCOMPARE(db->resolveGroup(group1->uuid()), group1);
+    QCOMPARE(db->resolveGroup(group2->uuid()), group2);
+    QCOMPARE(db->resolveEntry(entry1->uuid()), entry1);
+    QCOMPARE(db->resolveEntry(entry2->uuid()), entry2);
+    QVERIFY(!db->resolveEntry(QUuid::createUuid()));
+    QVERIFY(!db->resolveGroup(QUuid::createUuid()));
+
+    // moves within the database
+    entry1->setGroup(group2);
+    group2->setParent(group1);
+    QCOMPARE(db->resolveEntry(entry1->uuid()), entry1);
+    QCOMPARE(db->resolveGroup(group2->uuid()), group2);
+
+    // uuid changes
+    const QUuid oldEntryUuid = entry1->uuid();
+    entry1->setUuid(QUuid::createUuid());
+    QVERIFY(!db->resolveEntry(oldEntryUuid));
+    QCOMPARE(db->resolveEntry(entry1->uuid()), entry1);
+
+    const QUuid oldGroupUuid = group2->uuid();
+    group2->setUuid(QUuid::createUuid());
+    QVERIFY(!db->resolveGroup(oldGroupUuid));
+    QCOMPARE(db->resolveGroup(group2->uuid()), group2);
+
+    // recycle bin
+    db->metadata()->setRecycleBinEnabled(true);
+    const QUuid entry1Uuid = entry1->uuid();
+    const QUuid group2Uuid = group2->uuid();
+    const QUuid entry2Uuid = entry2->uuid();
+    db->recycleEntry(entry1);
+    db->recycleGroup(group2);
+    QVERIFY(db->metadata()->recycleBin());
+    QCOMPARE(db->resolveGroup(db->metadata()->recycleBin()->uuid()), db->metadata()->recycleBin());
+    QCOMPARE(db->resolveEntry(entry1Uuid), entry1);
+    QCOMPARE(db->resolveGroup(group2Uuid), group2);
+    QCOMPARE(db->resolveEntry(entry2Uuid), entry2);
+
+    db->emptyRecycleBin();
+    QVERIFY(!db->resolveEntry(entry1Uuid));
+    QVERIFY(!db->resolveGroup(group2Uuid));
+    QVERIFY(!db->resolveEntry(entry2Uuid));
+
+    // moves between databases
+    Entry* entry3 = new Entry();
+    entry3->setUuid(QUuid::createUuid());
+    entry3->setGroup(group1);
+    const QUuid group1Uuid = group1->uuid();
+    const QUuid entry3Uuid = entry3->uuid();
+
+    QScopedPointer<Database> otherDb(new Database());
+    group1->setParent(otherDb->rootGroup());
+    QVERIFY(!db->resolveGroup(group1Uuid));
+    QVERIFY(!db->resolveEntry(entry3Uuid));
+    QCOMPARE(otherDb->resolveGroup(group1Uuid), group1);
+    QCOMPARE(otherDb->resolveEntry(entry3Uuid), entry3);
+
+    // merge
+    db->merge(otherDb.data());
+    Group* mergedGroup = db->resolveGroup(group1Uuid);
+    Entry* mergedEntry = db->resolveEntry(entry3Uuid);
+    QVERIFY(mergedGroup);
+    QVERIFY(mergedEntry);
+    QVERIFY(mergedGroup != group1);
+    QVERIFY(mergedEntry != entry3);
+    QCOMPARE(mergedGroup->database(), db.data());
+    QCOMPARE(mergedEntry->group(), mergedGroup);
+    QCOMPARE(otherDb->resolveEntry(entry3Uuid), entry3);
+
+    // replacing the root group
+    Group* oldRoot = db->rootGroup();
+    Group* newRoot = oldRoot->clone(Entry::CloneNoFlags, Group::CloneIncludeEntries);
+    db->setRootGroup(newRoot);
+    delete oldRoot;
+    QCOMPARE(db->resolveGroup(newRoot->uuid()), newRoot);
+    mergedGroup = db->resolveGroup(group1Uuid);
+    mergedEntry = db->resolveEntry(entry3Uuid);
+    QVERIFY(mergedGroup);
+    QVERIFY(mergedEntry);
+    QCOMPARE(mergedGroup->parentGroup(), newRoot);
+    QCOMPARE(mergedEntry->group(), mergedGroup);
+}
+
+void TestDatabase::testReferenceIndex()
+{
+    QScopedPointer<Database> db(new Database());
+
+    Entry* entry1 = new Entry();
+    entry1->setUuid(QUuid::createUuid());
+    entry1->setTitle("Title");
+    entry1->setUsername("User");
+    entry1->setGroup(db->rootGroup());
+
+    QCOMPARE(db->resolveEntry("Title", EntryReferenceType::Title), entry1);
+    QCOMPARE(db->resolveEntry("User", EntryReferenceType::UserName), entry1);
+    QCOMPARE(db->resolveEntry("User", EntryReferenceType::CustomAttributes), entry1);
+    QCOMPARE(db->resolveEntry(entry1->uuid().toRfc4122().toHex(), EntryReferenceType::QUuid), entry1);
+    QVERIFY(!db->resolveEntry("User", EntryReferenceType::Title));
+
+    // the first entry in tree order is returned
+    Group* group = new Group();
+    group->setUuid(QUuid::createUuid());
+    group->setParent(db->rootGroup());
+    Entry* entry2 = new Entry();
+    entry2->setUuid(QUuid::createUuid());
+    entry2->setTitle("Title");
+    entry2->setGroup(group);
+    QCOMPARE(db->resolveEntry("Title", EntryReferenceType::Title), entry1);
+
+    // the index follows modifications of the entries
+    entry2->setTitle("Other");
+    QCOMPARE(db->resolveEntry("Other", EntryReferenceType::Title), entry2);
+    entry1->setTitle("Changed");
+    QVERIFY(!db->resolveEntry("Title", EntryReferenceType::Title));
+    QCOMPARE(db->resolveEntry("Changed", EntryReferenceType::Title), entry1);
+
+    entry2->attributes()->set("Custom", "Value");
+    QCOMPARE(db->resolveEntry("Value", EntryReferenceType::CustomAttributes), entry2);
+
+    entry1->setGroup(group);
+    entry2->setTitle("Changed");
+    QCOMPARE(db->resolveEntry("Changed", EntryReferenceType::Title), entry2);
+
+    entry2->setPassword("Secret");
+    QCOMPARE(db->resolveEntry("Secret", EntryReferenceType::Password), entry2);
+
+    // without the index references are resolved the same way
+    db->setReferenceIndexEnabled(false);
+    QCOMPARE(db->resolveEntry("Changed", EntryReferenceType::Title), entry2);
+    QCOMPARE(db->resolveEntry("Secret", EntryReferenceType::Password), entry2);
+    QCOMPARE(db->resolveEntry("Value", EntryReferenceType::CustomAttributes), entry2);
+    QVERIFY(!db->resolveEntry("Title", EntryReferenceType::Title));
+    db->setReferenceIndexEnabled(true);
+
+    delete entry2;
+    QCOMPARE(db->resolveEntry("Changed", EntryReferenceType::Title), entry1);
+    QVERIFY(!db->resolveEntry("Value", EntryReferenceType::CustomAttributes));
+    QVERIFY(!db->resolveEntry("Secret", EntryReferenceType::Password));
+}
+
+void TestDatabase::testSaveInBackground()
+{
+    CompositeKey key;
+    key.addKey(PasswordKey("test"));
+    QScopedPointer<Database> db(new Database());
+    db->setKey(key);
+    db->metadata()->setName("Snapshot");
+
+    Group* group = new Group();
+    group->setUuid(QUuid::createUuid());
+    group->setName("Group");
+    group->setParent(db->rootGroup());
+
+    Entry* entry = new Entry();
+    entry->setUuid(QUuid::createUuid());
+    entry->setTitle("Original");
+    entry->setGroup(group);
+    group->setLastTopVisibleEntry(entry);
+
+    const QDateTime locationChanged(QDate(2010, 1, 1), QTime(12, 0), Qt::UTC);
+    TimeInfo timeInfo = entry->timeInfo();
+    timeInfo.setLocationChanged(locationChanged);
+    entry->setTimeInfo(timeInfo);
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.close();
+
+    QSignalSpy spySaved(db.data(), SIGNAL(saveFinished(QString, QString, quint64)));
+    const quint64 savedCounter = db->modificationCounter();
+    QVERIFY(db->saveToFileInBackground(file.fileName()));
+    QVERIFY(db->isSaving());
+
+    // changes made while saving don't end up in the file
+    entry->setTitle("Changed");
+
+    QVERIFY(spySaved.wait());
+    QCOMPARE(spySaved.count(), 1);
+    QCOMPARE(spySaved.at(0).at(0).toString(), file.fileName());
+    QCOMPARE(spySaved.at(0).at(1).toString(), QString());
+    QCOMPARE(spySaved.at(0).at(2).value<quint64>(), savedCounter);
+    QVERIFY(db->modificationCounter() != savedCounter);
+    QVERIFY(!db->isSaving());
+
+    QScopedPointer<Database> savedDb(Database::openDatabaseFile(file.fileName(), key));
+    QVERIFY(savedDb);
+    QCOMPARE(savedDb->metadata()->name(), QString("Snapshot"));
+    Entry* savedEntry = savedDb->resolveEntry(entry->uuid());
+    QVERIFY(savedEntry);
+    QCOMPARE(savedEntry->title(), QString("Original"));
+    QCOMPARE(savedEntry->timeInfo().locationChanged(), locationChanged);
+    Group* savedGroup = savedDb->resolveGroup(group->uuid());
+    QVERIFY(savedGroup);
+    QCOMPARE(savedGroup->lastTopVisibleEntry(), savedEntry);
+
+    // the key derived for the file is taken over, so a reload can reuse it
+    QCOMPARE(db->kdf()->writeParameters(), savedDb->kdf()->writeParameters());
+    QCOMPARE(db->transformedMasterKey(), savedDb->transformedMasterKey());
+}
+
+void TestDatabase::benchmarkResolveReferences_data()
+{
+    QTest::addColumn<bool>("modify");
+    QTest::addColumn<bool>("useIndex");
+
+    QTest::newRow("Unmodified database") << false << true;
+    QTest::newRow("Modified before every lookup") << true << true;
+    QTest::newRow("Without reference index") << false << false;
+}
+
+void TestDatabase::benchmarkResolveReferences()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    QFETCH(bool, modify);
+    QFETCH(bool, useIndex);
+
+    QScopedPointer<Database> db(new Database());
+    db->setReferenceIndexEnabled(useIndex);
+    Entry* entry = nullptr;
+    for (int i = 0; i < 50; ++i) {
+        Group* group = new Group();
+        group->setUuid(QUuid::createUuid());
+        group->setName(QString("Group %1").arg(i));
+        group->setParent(db->rootGroup());
+
+        for (int j = 0; j < 1000; ++j) {
+            entry = new Entry();
+            entry->setUuid(QUuid::createUuid());
+            entry->setTitle(QString("Entry %1-%2").arg(i).arg(j));
+            entry->setUsername(QString("user%1-%2").arg(i).arg(j));
+            entry->setPassword(QString("password%1-%2").arg(i).arg(j));
+            entry->setGroup(group);
+        }
+    }
+
+    Entry* refEntry = new Entry();
+    refEntry->setUuid(QUuid::createUuid());
+    refEntry->setUsername("{REF:U@T:Entry 49-999}");
+    refEntry->setPassword("{REF:P@U:user49-999}");
+    refEntry->setGroup(db->rootGroup());
+
+    int counter = 0;
+    QBENCHMARK
+    {
+        if (modify) {
+            entry->setNotes(QString::number(counter++));
+        }
+        QCOMPARE(refEntry->resolveMultiplePlaceholders(refEntry->username()), QString("user49-999"));
+        QCOMPARE(refEntry->resolveMultiplePlaceholders(refEntry->password()), QString("password49-999"));
+    };
+}
@@ -31,6 +31,11 @@ private slots:
     void testEmptyRecycleBinOnNotCreated();
     void testEmptyRecycleBinOnEmpty();
     void testEmptyRecycleBinWithHierarchicalData();
+    void testUuidIndex();
+    void testReferenceIndex();
+    void testSaveInBackground();
+    void benchmarkResolveReferences_data();
+    void benchmarkResolveReferences();
 };
 
 #endif // KEEPASSX_TESTDATABASE_H
@@ -20,10 +20,34 @@
 
 #include "TestEntry.h"
 #include "TestGlobal.h"
+#include "core/AttachmentPool.h"
+#include "core/Global.h"
 #include "crypto/Crypto.h"
+#include "crypto/MemoryCipher.h"
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 
 QTEST_GUILESS_MAIN(TestEntry)
 
+namespace
+{
+    // bytes currently allocated on the heap, -1 if unknown
+    qint64 heapInUse()
+    {
+#if defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 33)
+        return static_cast<qint64>(mallinfo2().uordblks);
+#else
+        return static_cast<qint64>(mallinfo().uordblks);
+#endif
+#else
+        return -1;
+#endif
+    }
+} // namespace
+
 void TestEntry::initTestCase()
 {
     QVERIFY(Crypto::init());
@@ -550,3 +574,222 @@ void TestEntry::testResolveClonedEntry()
     QCOMPARE(cclone4->resolveMultiplePlaceholders(cclone4->username()), original->username());
     QCOMPARE(cclone4->resolveMultiplePlaceholders(cclone4->password()), original->password());
 }
+
+void TestEntry::testResolvedPlaceholderCache()
+{
+    Database db;
+    auto* root = db.rootGroup();
+
+    auto* target = new Entry();
+    target->setGroup(root);
+    target->setUuid(QUuid::createUuid());
+    target->setTitle("TargetTitle");
+
+    auto* entry = new Entry();
+    entry->setGroup(root);
+    entry->setUuid(QUuid::createUuid());
+    entry->setTitle(QString("{REF:T@I:%1} {S:Custom}").arg(target->uuid().toRfc4122().toHex().constData()));
+    entry->attributes()->set("Custom", "CustomValue");
+
+    QCOMPARE(entry->resolveMultiplePlaceholders(entry->title()), QString("TargetTitle CustomValue"));
+    QCOMPARE(entry->resolvePlaceholder("{S:Custom}"), QString("CustomValue"));
+    QCOMPARE(entry->resolveMultiplePlaceholders("no placeholders"), QString("no placeholders"));
+
+    // changes of the entry itself
+    entry->attributes()->set("Custom", "OtherValue");
+    QCOMPARE(entry->resolveMultiplePlaceholders(entry->title()), QString("TargetTitle OtherValue"));
+    QCOMPARE(entry->resolvePlaceholder("{S:Custom}"), QString("OtherValue"));
+
+    // changes of referenced entries
+    target->setTitle("RenamedTitle");
+    QCOMPARE(entry->resolveMultiplePlaceholders(entry->title()), QString("RenamedTitle OtherValue"));
+
+    delete target;
+    QCOMPARE(entry->resolveMultiplePlaceholders(entry->title()), QString(" OtherValue"));
+
+    // references are resolved in the database the entry belongs to
+    Database otherDb;
+    auto* otherTarget = new Entry();
+    otherTarget->setGroup(otherDb.rootGroup());
+    otherTarget->setUuid(QUuid::createUuid());
+    otherTarget->setTitle("OtherTitle");
+    entry->setTitle(QString("{REF:T@I:%1}").arg(otherTarget->uuid().toRfc4122().toHex().constData()));
+    QCOMPARE(entry->resolveMultiplePlaceholders(entry->title()), QString(""));
+
+    entry->setGroup(otherDb.rootGroup());
+    QCOMPARE(entry->resolveMultiplePlaceholders(entry->title()), QString("OtherTitle"));
+
+    // entries outside of a database don't cache anything
+    QScopedPointer<Entry> standalone(new Entry());
+    standalone->setTitle("{S:Custom}");
+    standalone->attributes()->set("Custom", "First");
+    QCOMPARE(standalone->resolveMultiplePlaceholders(standalone->title()), QString("First"));
+    standalone->attributes()->set("Custom", "Second");
+    QCOMPARE(standalone->resolveMultiplePlaceholders(standalone->title()), QString("Second"));
+}
+
+void TestEntry::testProtectedAttributes()
+{
+    QVERIFY(MemoryCipher::isEnabled());
+
+    EntryAttributes attributes;
+    attributes.set(EntryAttributes::PasswordKey, "secret", true);
+    attributes.set("PIN", "1234", true);
+    attributes.set("Plain", "text");
+    QCOMPARE(attributes.value(EntryAttributes::PasswordKey), QString("secret"));
+    QCOMPARE(attributes.value("PIN"), QString("1234"));
+    QVERIFY(attributes.isProtected("PIN"));
+    QVERIFY(attributes.containsValue("1234"));
+
+    // decrypting must not depend on the cache
+    MemoryCipher::clearCache();
+    QCOMPARE(attributes.value("PIN"), QString("1234"));
+
+    EntryAttributes plainAttributes;
+    MemoryCipher::setEnabled(false);
+    plainAttributes.set(EntryAttributes::PasswordKey, "secret", true);
+    plainAttributes.set("PIN", "1234", true);
+    plainAttributes.set("Plain", "text");
+    MemoryCipher::setEnabled(true);
+    QVERIFY(plainAttributes == attributes);
+    QCOMPARE(plainAttributes.attributesSize(), attributes.attributesSize());
+
+    // the same value encrypted twice still compares equal
+    EntryAttributes otherAttributes;
+    otherAttributes.copyDataFrom(&attributes);
+    otherAttributes.set("PIN", "4321", true);
+    QVERIFY(otherAttributes != attributes);
+    otherAttributes.set("PIN", "1234", true);
+    QVERIFY(otherAttributes == attributes);
+
+    attributes.rename("PIN", "Code");
+    QCOMPARE(attributes.value("Code"), QString("1234"));
+    QVERIFY(attributes.isProtected("Code"));
+
+    attributes.set("Code", "1234", false);
+    QVERIFY(!attributes.isProtected("Code"));
+    QCOMPARE(attributes.value("Code"), QString("1234"));
+}
+
+void TestEntry::testSharedAttachments()
+{
+    AttachmentPool* pool = AttachmentPool::instance();
+    const int count = pool->count();
+    const qint64 totalSize = pool->totalSize();
+
+    QScopedPointer<Entry> entry(new Entry());
+    entry->attachments()->set("large", QByteArray(1024 * 1024, 'L'));
+
+    // every history item references the same content
+    for (int i = 0; i < 10; ++i) {
+        entry->addHistoryItem(entry->clone(Entry::CloneNoFlags));
+        entry->setTitle(QString::number(i));
+    }
+
+    QScopedPointer<Entry> other(new Entry());
+    other->attachments()->set("copy", QByteArray(1024 * 1024, 'L'));
+    QCOMPARE(other->attachments()->contentId("copy"), entry->attachments()->contentId("large"));
+
+    QCOMPARE(pool->count(), count + 1);
+    QCOMPARE(pool->totalSize(), totalSize + 1024 * 1024);
+
+    other->attachments()->set("copy", QByteArray("small"));
+    QCOMPARE(pool->count(), count + 2);
+    QCOMPARE(other->attachments()->value("copy"), QByteArray("small"));
+
+    entry.reset();
+    other.reset();
+    QCOMPARE(pool->count(), count);
+    QCOMPARE(pool->totalSize(), totalSize);
+}
+
+void TestEntry::benchmarkProtectedAttributes_data()
+{
+    QTest::addColumn<bool>("encrypt");
+    QTest::addColumn<int>("cacheSize");
+
+    QTest::newRow("Plain text") << false << 0;
+    QTest::newRow("Encrypted, uncached") << true << 0;
+    QTest::newRow("Encrypted, cached") << true << 256;
+}
+
+void TestEntry::benchmarkProtectedAttributes()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    QFETCH(bool, encrypt);
+    QFETCH(int, cacheSize);
+
+    MemoryCipher::setEnabled(encrypt);
+    MemoryCipher::setCacheSize(cacheSize);
+
+    QList<EntryAttributes*> entries;
+    for (int i = 0; i < 1000; ++i) {
+        auto attributes = new EntryAttributes();
+        attributes->set(EntryAttributes::PasswordKey, QString("password%1").arg(i), true);
+        entries.append(attributes);
+    }
+
+    // a view repeatedly showing the same 100 passwords
+    QBENCHMARK
+    {
+        for (int i = 0; i < 1000; ++i) {
+            QVERIFY(!entries.at(i % 100)->value(EntryAttributes::PasswordKey).isEmpty());
+        }
+    }
+
+    qDeleteAll(entries);
+    MemoryCipher::setEnabled(true);
+    MemoryCipher::setCacheSize(256);
+}
+
+void TestEntry::benchmarkProtectedAttributesMemory_data()
+{
+    QTest::addColumn<bool>("encrypt");
+
+    QTest::newRow("Plain text") << false;
+    QTest::newRow("Encrypted") << true;
+}
+
+/**
+ * Heap used by 10000 protected passwords, including the cache of
+ * decrypted values after all of them have been read.
+ */
+void TestEntry::benchmarkProtectedAttributesMemory()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+    if (heapInUse() < 0) {
+        QSKIP("Heap usage can't be measured on this platform.");
+    }
+
+    QFETCH(bool, encrypt);
+
+    MemoryCipher::setEnabled(encrypt);
+    MemoryCipher::clearCache();
+
+    const qint64 heapBefore = heapInUse();
+
+    QList<EntryAttributes*> entries;
+    for (int i = 0; i < 10000; ++i) {
+        auto attributes = new EntryAttributes();
+        attributes->set(EntryAttributes::PasswordKey, QString("password-%1-abcdefghijklmnop").arg(i), true);
+        entries.append(attributes);
+    }
+    for (const EntryAttributes* attributes : asConst(entries)) {
+        QVERIFY(!attributes->value(EntryAttributes::PasswordKey).isEmpty());
+    }
+
+    QTest::setBenchmarkResult(heapInUse() - heapBefore, QTest::BytesAllocated);
+
+    qDeleteAll(entries);
+    MemoryCipher::clearCache();
+    MemoryCipher::setEnabled(true);
+}
@@ -37,6 +37,13 @@ private slots:
     void testResolveReferencePlaceholders();
     void testResolveNonIdPlaceholdersToUuid();
     void testResolveClonedEntry();
+    void testResolvedPlaceholderCache();
+    void testProtectedAttributes();
+    void testSharedAttachments();
+    void benchmarkProtectedAttributes_data();
+    void benchmarkProtectedAttributes();
+    void benchmarkProtectedAttributesMemory_data();
+    void benchmarkProtectedAttributesMemory();
 };
 
 #endif // KEEPASSX_TESTENTRY_H
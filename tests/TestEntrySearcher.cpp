@@ -18,10 +18,13 @@
 #include "TestEntrySearcher.h"
 #include "TestGlobal.h"
 
+#include "crypto/Crypto.h"
+
 QTEST_GUILESS_MAIN(TestEntrySearcher)
 
 void TestEntrySearcher::initTestCase()
 {
+    QVERIFY(Crypto::init());
     m_groupRoot = new Group();
 }
 
@@ -140,3 +143,204 @@ void TestEntrySearcher::testAllAttributesAreSearched()
         m_entrySearcher.search("testTitle testUsername testUrl testNote", m_groupRoot, Qt::CaseInsensitive);
     QCOMPARE(m_searchResult.count(), 1);
 }
+
+void TestEntrySearcher::testSearchIndex()
+{
+    QScopedPointer<Database> db(new Database());
+    Group* root = db->rootGroup();
+
+    Group* servers = new Group();
+    servers->setUuid(QUuid::createUuid());
+    servers->setName("Servers");
+    servers->setParent(root);
+
+    Group* hidden = new Group();
+    hidden->setUuid(QUuid::createUuid());
+    hidden->setName("Hidden");
+    hidden->setSearchingEnabled(Group::Disable);
+    hidden->setParent(root);
+
+    Entry* github = new Entry();
+    github->setUuid(QUuid::createUuid());
+    github->setTitle("GitHub");
+    github->setUsername("alice");
+    github->setUrl("https://github.com");
+    github->setGroup(root);
+
+    Entry* mail = new Entry();
+    mail->setUuid(QUuid::createUuid());
+    mail->setTitle("Mail server");
+    mail->setUrl("smtp://mail.example.org");
+    mail->setNotes("Ärger");
+    mail->setGroup(servers);
+
+    Entry* reference = new Entry();
+    reference->setUuid(QUuid::createUuid());
+    reference->setTitle("Reference");
+    reference->setUsername(QString("{REF:U@I:%1}").arg(QString(github->uuid().toRfc4122().toHex())));
+    reference->setGroup(servers);
+
+    Entry* backup = new Entry();
+    backup->setUuid(QUuid::createUuid());
+    backup->setTitle("GitHub backup");
+    backup->setGroup(hidden);
+
+    m_searchResult = m_entrySearcher.search("git", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << github);
+
+    m_searchResult = m_entrySearcher.search("alice", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << github << reference);
+
+    m_searchResult = m_entrySearcher.search("ALI", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << github << reference);
+
+    m_searchResult = m_entrySearcher.search("ALI", root, Qt::CaseSensitive);
+    QVERIFY(m_searchResult.isEmpty());
+
+    m_searchResult = m_entrySearcher.search("servers", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << mail << reference);
+
+    m_searchResult = m_entrySearcher.search("mail.example äRG", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << mail);
+
+    m_searchResult = m_entrySearcher.search("nomatch", root, Qt::CaseInsensitive);
+    QVERIFY(m_searchResult.isEmpty());
+
+    m_searchResult = m_entrySearcher.search("a", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << github << mail << reference);
+
+    // the index follows modifications
+    github->setTitle("GitLab");
+    m_searchResult = m_entrySearcher.search("github", root, Qt::CaseInsensitive);
+    QVERIFY(m_searchResult.isEmpty());
+    m_searchResult = m_entrySearcher.search("gitlab", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << github);
+
+    github->setUsername("bob");
+    m_searchResult = m_entrySearcher.search("bob", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << github << reference);
+
+    backup->setGroup(root);
+    m_searchResult = m_entrySearcher.search("backup", root, Qt::CaseInsensitive);
+    QCOMPARE(m_searchResult, QList<Entry*>() << backup);
+
+    delete mail;
+    m_searchResult = m_entrySearcher.search("mail", root, Qt::CaseInsensitive);
+    QVERIFY(m_searchResult.isEmpty());
+}
+
+void TestEntrySearcher::testParallelSearch()
+{
+    QScopedPointer<Database> db(new Database());
+    Group* root = db->rootGroup();
+
+    for (int i = 0; i < 20; ++i) {
+        Group* group = new Group();
+        group->setUuid(QUuid::createUuid());
+        group->setName(QString("Group %1").arg(i));
+        group->setNotes(i % 7 == 0 ? "Shared accounts" : "");
+        group->setSearchingEnabled(i % 5 == 0 ? Group::Disable : Group::Inherit);
+        group->setParent(i % 3 == 0 ? root : root->children().last());
+
+        for (int j = 0; j < 250; ++j) {
+            Entry* entry = new Entry();
+            entry->setUuid(QUuid::createUuid());
+            entry->setTitle(QString("Entry %1 %2").arg(i).arg(j));
+            entry->setUsername(j % 2 == 0 ? QString("user%1").arg(j) : QString("Admin%1").arg(i));
+            entry->setUrl(QString("https://host%1.example.com").arg(j % 13));
+            entry->setNotes(j % 11 == 0 ? "{TITLE} account" : "");
+            entry->setGroup(group);
+        }
+    }
+
+    const QStringList terms = {"",
+                               "entry",
+                               "user1",
+                               "ADMIN",
+                               "admin 1",
+                               "host1 example",
+                               "shared",
+                               "group 1",
+                               "Entry 3 account",
+                               "nomatch"};
+
+    EntrySearcher serialSearcher(EntrySearcher::SerialSearch);
+    EntrySearcher parallelSearcher(EntrySearcher::ParallelSearch);
+    for (const QString& term : terms) {
+        for (Qt::CaseSensitivity caseSensitivity : {Qt::CaseInsensitive, Qt::CaseSensitive}) {
+            const QList<Entry*> serialResult = serialSearcher.search(term, root, caseSensitivity);
+            const QList<Entry*> parallelResult = parallelSearcher.search(term, root, caseSensitivity);
+            QCOMPARE(parallelResult, serialResult);
+
+            // the batches used by the asynchronous search in DatabaseWidget
+            const QList<EntrySearcher::Batch> batches = serialSearcher.prepareBatches(term, root, caseSensitivity, 300);
+            const EntrySearcher::BatchMatcher matcher(term, caseSensitivity);
+            QList<Entry*> batchedResult;
+            for (const EntrySearcher::Batch& batch : batches) {
+                batchedResult.append(matcher(batch));
+            }
+            QCOMPARE(batchedResult, serialResult);
+        }
+    }
+}
+
+void TestEntrySearcher::testRefineSearch()
+{
+    QVERIFY(EntrySearcher::refinesSearch("goog", "goo", Qt::CaseSensitive));
+    QVERIFY(EntrySearcher::refinesSearch("google mail", "goo mai", Qt::CaseSensitive));
+    QVERIFY(EntrySearcher::refinesSearch("mail google", "goo", Qt::CaseSensitive));
+    QVERIFY(EntrySearcher::refinesSearch("GOOG", "goo", Qt::CaseInsensitive));
+    QVERIFY(EntrySearcher::refinesSearch("anything", "", Qt::CaseSensitive));
+    QVERIFY(!EntrySearcher::refinesSearch("GOOG", "goo", Qt::CaseSensitive));
+    QVERIFY(!EntrySearcher::refinesSearch("go", "goo", Qt::CaseSensitive));
+    QVERIFY(!EntrySearcher::refinesSearch("goo", "goo mail", Qt::CaseSensitive));
+
+    QScopedPointer<Database> db(new Database());
+    Group* root = db->rootGroup();
+
+    for (int i = 0; i < 12; ++i) {
+        Group* group = new Group();
+        group->setUuid(QUuid::createUuid());
+        group->setName(QString("Group %1").arg(i));
+        group->setNotes(i % 4 == 0 ? "Shared mail accounts" : "");
+        group->setSearchingEnabled(i % 5 == 1 ? Group::Disable : Group::Inherit);
+        group->setParent(i % 3 == 0 ? root : root->children().last());
+
+        for (int j = 0; j < 40; ++j) {
+            Entry* entry = new Entry();
+            entry->setUuid(QUuid::createUuid());
+            entry->setTitle(QString("Mail %1 %2").arg(i).arg(j));
+            entry->setUsername(j % 2 == 0 ? QString("google%1").arg(j) : QString("Shared%1").arg(i));
+            entry->setUrl(QString("https://mail%1.example.com").arg(j % 7));
+            entry->setNotes(j % 9 == 0 ? "{USERNAME} account" : "");
+            entry->setGroup(group);
+        }
+    }
+
+    const QList<QPair<QString, QString>> refinements = {{"goo", "goog"},
+                                                        {"goog", "google1"},
+                                                        {"mail", "mail 1"},
+                                                        {"mail 1", "mail 10 example"},
+                                                        {"shared", "shared mail"},
+                                                        {"acc", "account goo"},
+                                                        {"", "group 1"}};
+
+    EntrySearcher searcher;
+    for (const auto& refinement : refinements) {
+        for (Qt::CaseSensitivity caseSensitivity : {Qt::CaseInsensitive, Qt::CaseSensitive}) {
+            QVERIFY(EntrySearcher::refinesSearch(refinement.second, refinement.first, caseSensitivity));
+
+            const QList<Entry*> previousResult = searcher.search(refinement.first, root, caseSensitivity);
+            const QList<Entry*> expectedResult = searcher.search(refinement.second, root, caseSensitivity);
+
+            const QList<EntrySearcher::Batch> batches =
+                searcher.prepareBatches(refinement.second, previousResult, root, caseSensitivity, 50);
+            const EntrySearcher::BatchMatcher matcher(refinement.second, caseSensitivity);
+            QList<Entry*> refinedResult;
+            for (const EntrySearcher::Batch& batch : batches) {
+                refinedResult.append(matcher(batch));
+            }
+            QCOMPARE(refinedResult, expectedResult);
+        }
+    }
+}
@@ -34,6 +34,9 @@ private slots:
     void testAndConcatenationInSearch();
     void testSearch();
     void testAllAttributesAreSearched();
+    void testSearchIndex();
+    void testParallelSearch();
+    void testRefineSearch();
 
 private:
     Group* m_groupRoot;
@@ -18,8 +18,14 @@
 #include "TestKdbx4.h"
 #include "TestGlobal.h"
 
+#include <QElapsedTimer>
+
+#include "FailDevice.h"
 #include "config-keepassx-tests.h"
+#include "core/AttachmentPool.h"
+#include "core/Endian.h"
 #include "core/Metadata.h"
+#include "crypto/Random.h"
 #include "format/KdbxXmlReader.h"
 #include "format/KdbxXmlWriter.h"
 #include "format/KeePass2.h"
@@ -29,6 +35,10 @@
 #include "keys/PasswordKey.h"
 #include "mock/MockChallengeResponseKey.h"
 
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
 QTEST_GUILESS_MAIN(TestKdbx4)
 
 void TestKdbx4::initTestCaseImpl()
@@ -416,6 +426,598 @@ void TestKdbx4::testCustomData()
     QCOMPARE(newEntry->customData()->value(customDataKey2), customData2);
 }
 
+Q_DECLARE_METATYPE(Database::CompressionAlgorithm)
+void TestKdbx4::testPipelinedRead()
+{
+    QFETCH(Database::CompressionAlgorithm, compression);
+    QFETCH(bool, corrupt);
+
+    CompositeKey key;
+    key.addKey(PasswordKey("test"));
+    QScopedPointer<Database> db(new Database());
+    db->changeKdf(fastKdf(KeePass2::uuidToKdf(KeePass2::KDF_ARGON2)));
+    db->setCompressionAlgo(compression);
+    db->setKey(key);
+
+    // spread the payload over several HMAC blocks and pipeline chunks
+    for (int i = 0; i < 200; ++i) {
+        auto* entry = new Entry();
+        entry->setUuid(QUuid::createUuid());
+        entry->setTitle(QString("Entry %1").arg(i));
+        entry->setUsername(QString("user%1").arg(i));
+        entry->setPassword(QString::fromLatin1(randomGen()->randomArray(16).toHex()));
+        entry->setNotes(QString("Notes %1").arg(i).repeated(100));
+        if (i % 50 == 0) {
+            entry->attachments()->set("data.bin", randomGen()->randomArray(1024 * 1024 + i));
+        }
+        entry->setGroup(db->rootGroup());
+    }
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QBuffer::ReadWrite));
+    KeePass2Writer writer;
+    QVERIFY(writer.writeDatabase(&buffer, db.data()));
+
+    if (corrupt) {
+        // break the HMAC of the first payload block
+        QByteArray& data = buffer.buffer();
+        data[4096] = static_cast<char>(data.at(4096) ^ 0x01);
+    }
+
+    QVERIFY(buffer.seek(0));
+    KeePass2Reader serialReader;
+    serialReader.setSaveXml(true);
+    QScopedPointer<Database> serialDb(serialReader.readDatabase(&buffer, key));
+
+    QVERIFY(buffer.seek(0));
+    KeePass2Reader pipelinedReader;
+    pipelinedReader.setSaveXml(true);
+    pipelinedReader.setPipelined(true);
+    QScopedPointer<Database> pipelinedDb(pipelinedReader.readDatabase(&buffer, key));
+
+    QCOMPARE(pipelinedReader.hasError(), serialReader.hasError());
+    QCOMPARE(pipelinedReader.errorString(), serialReader.errorString());
+    QCOMPARE(pipelinedDb.isNull(), serialDb.isNull());
+    QCOMPARE(pipelinedReader.hasError(), corrupt);
+
+    if (corrupt) {
+        return;
+    }
+
+    QCOMPARE(pipelinedReader.reader()->xmlData(), serialReader.reader()->xmlData());
+    QCOMPARE(pipelinedDb->rootGroup()->entries().size(), 200);
+
+    QBuffer serialXml;
+    QBuffer pipelinedXml;
+    QVERIFY(serialXml.open(QBuffer::ReadWrite));
+    QVERIFY(pipelinedXml.open(QBuffer::ReadWrite));
+    bool hasError;
+    QString errorString;
+    writeXml(&serialXml, serialDb.data(), hasError, errorString);
+    QVERIFY2(!hasError, qPrintable(errorString));
+    writeXml(&pipelinedXml, pipelinedDb.data(), hasError, errorString);
+    QVERIFY2(!hasError, qPrintable(errorString));
+    QCOMPARE(pipelinedXml.data(), serialXml.data());
+}
+
+void TestKdbx4::testPipelinedRead_data()
+{
+    QTest::addColumn<Database::CompressionAlgorithm>("compression");
+    QTest::addColumn<bool>("corrupt");
+
+    QTest::newRow("gzip") << Database::CompressionGZip << false;
+    QTest::newRow("uncompressed") << Database::CompressionNone << false;
+    QTest::newRow("gzip corrupt") << Database::CompressionGZip << true;
+    QTest::newRow("uncompressed corrupt") << Database::CompressionNone << true;
+}
+
+void TestKdbx4::testPipelinedWrite()
+{
+    QFETCH(Database::CompressionAlgorithm, compression);
+
+    CompositeKey key;
+    key.addKey(PasswordKey("test"));
+    QScopedPointer<Database> db(new Database());
+    db->changeKdf(fastKdf(KeePass2::uuidToKdf(KeePass2::KDF_ARGON2)));
+    db->setCompressionAlgo(compression);
+    db->setKey(key);
+
+    for (int i = 0; i < 200; ++i) {
+        auto* entry = new Entry();
+        entry->setUuid(QUuid::createUuid());
+        entry->setTitle(QString("Entry %1").arg(i));
+        entry->setPassword(QString::fromLatin1(randomGen()->randomArray(16).toHex()));
+        entry->setNotes(QString("Notes %1").arg(i).repeated(100));
+        if (i % 50 == 0) {
+            entry->attachments()->set("data.bin", randomGen()->randomArray(1024 * 1024 + i));
+        }
+        entry->setGroup(db->rootGroup());
+    }
+
+    QBuffer serialBuffer;
+    QVERIFY(serialBuffer.open(QBuffer::ReadWrite));
+    KeePass2Writer serialWriter;
+    QVERIFY2(serialWriter.writeDatabase(&serialBuffer, db.data()), qPrintable(serialWriter.errorString()));
+
+    QBuffer pipelinedBuffer;
+    QVERIFY(pipelinedBuffer.open(QBuffer::ReadWrite));
+    KeePass2Writer pipelinedWriter;
+    pipelinedWriter.setPipelined(true);
+    QVERIFY2(pipelinedWriter.writeDatabase(&pipelinedBuffer, db.data()), qPrintable(pipelinedWriter.errorString()));
+
+    // the output must be readable by the regular reader and contain the same database
+    QVERIFY(serialBuffer.seek(0));
+    KeePass2Reader serialReader;
+    QScopedPointer<Database> serialDb(serialReader.readDatabase(&serialBuffer, key));
+    QVERIFY2(serialDb, qPrintable(serialReader.errorString()));
+
+    QVERIFY(pipelinedBuffer.seek(0));
+    KeePass2Reader pipelinedReader;
+    QScopedPointer<Database> pipelinedDb(pipelinedReader.readDatabase(&pipelinedBuffer, key));
+    QVERIFY2(pipelinedDb, qPrintable(pipelinedReader.errorString()));
+    QCOMPARE(pipelinedDb->compressionAlgo(), compression);
+
+    QBuffer serialXml;
+    QBuffer pipelinedXml;
+    QVERIFY(serialXml.open(QBuffer::ReadWrite));
+    QVERIFY(pipelinedXml.open(QBuffer::ReadWrite));
+    bool hasError;
+    QString errorString;
+    writeXml(&serialXml, serialDb.data(), hasError, errorString);
+    QVERIFY2(!hasError, qPrintable(errorString));
+    writeXml(&pipelinedXml, pipelinedDb.data(), hasError, errorString);
+    QVERIFY2(!hasError, qPrintable(errorString));
+    QCOMPARE(pipelinedXml.data(), serialXml.data());
+
+    // errors of the lowest stage are reported
+    FailDevice failDevice(64 * 1024);
+    QVERIFY(failDevice.open(QIODevice::WriteOnly));
+    KeePass2Writer failWriter;
+    failWriter.setPipelined(true);
+    QVERIFY(!failWriter.writeDatabase(&failDevice, db.data()));
+    QCOMPARE(failWriter.errorString(), QString("FAILDEVICE"));
+}
+
+void TestKdbx4::testPipelinedWrite_data()
+{
+    QTest::addColumn<Database::CompressionAlgorithm>("compression");
+
+    QTest::newRow("gzip") << Database::CompressionGZip;
+    QTest::newRow("uncompressed") << Database::CompressionNone;
+}
+
+void TestKdbx4::testKeyCache()
+{
+    CompositeKey key;
+    key.addKey(PasswordKey("test"));
+    QScopedPointer<Database> db(new Database());
+    db->changeKdf(fastKdf(KeePass2::uuidToKdf(KeePass2::KDF_ARGON2)));
+    db->setKey(key);
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QBuffer::ReadWrite));
+    KeePass2Writer writer;
+    QVERIFY(writer.writeDatabase(&buffer, db.data()));
+
+    // same key and KDF parameters, the cached transformed key is used
+    QVERIFY(buffer.seek(0));
+    KeePass2Reader reader;
+    reader.setKeyCache(db.data());
+    QScopedPointer<Database> cachedDb(reader.readDatabase(&buffer, key));
+    QVERIFY2(!reader.hasError(), qPrintable(reader.errorString()));
+    QVERIFY(cachedDb);
+    QCOMPARE(cachedDb->transformedMasterKey(), db->transformedMasterKey());
+
+    // prove that the key derivation is skipped: a bogus cached key breaks the read
+    QVERIFY(buffer.seek(0));
+    db->setTransformedKey(key, QByteArray(32, '\0'));
+    KeePass2Reader bogusReader;
+    bogusReader.setKeyCache(db.data());
+    QScopedPointer<Database> bogusDb(bogusReader.readDatabase(&buffer, key));
+    QVERIFY(bogusReader.hasError());
+    QVERIFY(!bogusDb);
+
+    // a different key must never match the cache
+    CompositeKey otherKey;
+    otherKey.addKey(PasswordKey("other"));
+    QVERIFY(buffer.seek(0));
+    KeePass2Reader otherReader;
+    otherReader.setKeyCache(db.data());
+    QScopedPointer<Database> otherDb(otherReader.readDatabase(&buffer, otherKey));
+    QVERIFY(otherReader.hasError());
+    QVERIFY(!otherDb);
+
+    // a new KDF seed must be transformed again
+    QVERIFY(db->setKey(key, false, true));
+    QVERIFY(buffer.seek(0));
+    KeePass2Reader reseededReader;
+    reseededReader.setKeyCache(db.data());
+    QScopedPointer<Database> reseededDb(reseededReader.readDatabase(&buffer, key));
+    QVERIFY2(!reseededReader.hasError(), qPrintable(reseededReader.errorString()));
+    QVERIFY(reseededDb);
+    QVERIFY(reseededDb->transformedMasterKey() != db->transformedMasterKey());
+}
+
+void TestKdbx4::testLazyAttachments()
+{
+    CompositeKey key;
+    key.addKey(PasswordKey("test"));
+    QScopedPointer<Database> db(new Database());
+    db->changeKdf(fastKdf(KeePass2::uuidToKdf(KeePass2::KDF_ARGON2)));
+    db->setKey(key);
+
+    const QByteArray shared = randomGen()->randomArray(256 * 1024);
+    const QByteArray single = randomGen()->randomArray(1024);
+
+    auto* entry1 = new Entry();
+    entry1->setUuid(QUuid::createUuid());
+    entry1->attachments()->set("shared.bin", shared);
+    entry1->attachments()->set("single.bin", single);
+    entry1->setGroup(db->rootGroup());
+    auto* entry2 = new Entry();
+    entry2->setUuid(QUuid::createUuid());
+    entry2->attachments()->set("copy.bin", shared);
+    entry2->setGroup(db->rootGroup());
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QBuffer::ReadWrite));
+    KeePass2Writer writer;
+    QVERIFY(writer.writeDatabase(&buffer, db.data()));
+
+    // content that is pooled already is never spilled
+    db.reset();
+    QCOMPARE(AttachmentPool::instance()->spilledSize(), qint64(0));
+
+    QVERIFY(buffer.seek(0));
+    QScopedPointer<KeePass2Reader> reader(new KeePass2Reader());
+    reader->setLazyAttachments(true);
+    QScopedPointer<Database> lazyDb(reader->readDatabase(&buffer, key));
+    QVERIFY2(!reader->hasError(), qPrintable(reader->errorString()));
+    QVERIFY(lazyDb);
+    reader.reset();
+
+    QCOMPARE(lazyDb->rootGroup()->entries().size(), 2);
+    Entry* lazyEntry1 = lazyDb->rootGroup()->entries().at(0);
+    Entry* lazyEntry2 = lazyDb->rootGroup()->entries().at(1);
+    const QByteArray sharedId = lazyEntry1->attachments()->contentId("shared.bin");
+    QVERIFY(AttachmentPool::instance()->isSpilled(sharedId));
+    QVERIFY(AttachmentPool::instance()->isSpilled(lazyEntry1->attachments()->contentId("single.bin")));
+    QCOMPARE(lazyEntry2->attachments()->contentId("copy.bin"), sharedId);
+    QCOMPARE(AttachmentPool::instance()->spilledSize(), qint64(shared.size() + single.size()));
+
+    QCOMPARE(lazyEntry1->attachments()->size("shared.bin"), shared.size());
+    QCOMPARE(lazyEntry1->attachments()->value("shared.bin"), shared);
+    QCOMPARE(lazyEntry1->attachments()->value("single.bin"), single);
+    QCOMPARE(lazyEntry2->attachments()->value("copy.bin"), shared);
+
+    // spilled attachments are written back like any other
+    QBuffer lazyBuffer;
+    QVERIFY(lazyBuffer.open(QBuffer::ReadWrite));
+    KeePass2Writer lazyWriter;
+    QVERIFY(lazyWriter.writeDatabase(&lazyBuffer, lazyDb.data()));
+    lazyDb.reset();
+    QCOMPARE(AttachmentPool::instance()->spilledSize(), qint64(0));
+
+    QVERIFY(lazyBuffer.seek(0));
+    KeePass2Reader eagerReader;
+    QScopedPointer<Database> eagerDb(eagerReader.readDatabase(&lazyBuffer, key));
+    QVERIFY2(!eagerReader.hasError(), qPrintable(eagerReader.errorString()));
+    QVERIFY(eagerDb);
+    QCOMPARE(eagerDb->rootGroup()->entries().at(0)->attachments()->value("shared.bin"), shared);
+    QCOMPARE(eagerDb->rootGroup()->entries().at(0)->attachments()->value("single.bin"), single);
+    QCOMPARE(eagerDb->rootGroup()->entries().at(1)->attachments()->value("copy.bin"), shared);
+    QVERIFY(!AttachmentPool::instance()->isSpilled(sharedId));
+}
+
+namespace
+{
+    QByteArray groupXml(const QString& uuid, const QString& dateTime, const QString& expires, const QString& usageCount)
+    {
+        return QString("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                       "<KeePassFile><Meta><Generator>KeePassXC</Generator></Meta><Root><Group>"
+                       "<UUID>%1</UUID><Name>Root</Name><Times>"
+                       "<LastModificationTime>%2</LastModificationTime>"
+                       "<Expires>%3</Expires><UsageCount>%4</UsageCount>"
+                       "</Times></Group></Root></KeePassFile>")
+            .arg(uuid, dateTime, expires, usageCount)
+            .toUtf8();
+    }
+
+    QString secsToBase64(qint64 secs)
+    {
+        return QString::fromLatin1(Endian::sizedIntToBytes(secs, KeePass2::BYTEORDER).toBase64());
+    }
+} // namespace
+
+void TestKdbx4::testXmlDateTime()
+{
+    QFETCH(QString, value);
+    QFETCH(QDateTime, expected);
+    QFETCH(bool, valid);
+
+    const QString uuid = QString::fromLatin1(QUuid::createUuid().toRfc4122().toBase64());
+    QBuffer buffer;
+    buffer.setData(groupXml(uuid, value, "False", "0"));
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    bool hasError;
+    QString errorString;
+    QScopedPointer<Database> db(readXml(&buffer, true, hasError, errorString));
+    QCOMPARE(hasError, !valid);
+    if (valid) {
+        QCOMPARE(db->rootGroup()->timeInfo().lastModificationTime(), expected);
+        QCOMPARE(db->rootGroup()->timeInfo().lastModificationTime().timeSpec(), Qt::UTC);
+    }
+}
+
+void TestKdbx4::testXmlDateTime_data()
+{
+    QTest::addColumn<QString>("value");
+    QTest::addColumn<QDateTime>("expected");
+    QTest::addColumn<bool>("valid");
+
+    const QDateTime epoch(QDate(1, 1, 1), QTime(0, 0, 0, 0), Qt::UTC);
+    const QDateTime dateTime(QDate(2018, 11, 4), QTime(13, 37, 42), Qt::UTC);
+    const QDateTime maxDateTime(QDate(9999, 12, 31), QTime(23, 59, 59), Qt::UTC);
+
+    QTest::newRow("base64") << secsToBase64(epoch.secsTo(dateTime)) << dateTime << true;
+    QTest::newRow("base64 epoch") << secsToBase64(0) << epoch << true;
+    QTest::newRow("base64 max") << secsToBase64(epoch.secsTo(maxDateTime)) << maxDateTime << true;
+    QTest::newRow("base64 beyond max") << secsToBase64(epoch.secsTo(maxDateTime) + 1)
+                                       << epoch.addSecs(epoch.secsTo(maxDateTime) + 1) << true;
+    QTest::newRow("base64 short") << QString("AQ==") << epoch.addSecs(1) << true;
+    QTest::newRow("base64 long") << QString("AQAAAAAAAAABAAAA") << epoch.addSecs(1) << true;
+    QTest::newRow("empty") << QString() << epoch << true;
+    QTest::newRow("iso") << QString("2018-11-04T13:37:42Z") << dateTime << true;
+    QTest::newRow("iso leap day") << QString("2016-02-29T23:59:59Z")
+                                  << QDateTime(QDate(2016, 2, 29), QTime(23, 59, 59), Qt::UTC) << true;
+    QTest::newRow("iso year 1") << QString("0001-01-01T00:00:00Z") << epoch << true;
+    QTest::newRow("iso milliseconds") << QString("2018-11-04T13:37:42.500Z") << dateTime.addMSecs(500) << true;
+    QTest::newRow("iso invalid day") << QString("2018-02-29T13:37:42Z") << QDateTime() << false;
+    QTest::newRow("iso invalid month") << QString("2018-13-04T13:37:42Z") << QDateTime() << false;
+    QTest::newRow("invalid") << QString("yesterday") << QDateTime() << false;
+    QTest::newRow("invalid base64") << QString("AAAAAA=AAAA=") << QDateTime() << false;
+}
+
+void TestKdbx4::testXmlValues()
+{
+    QFETCH(QString, uuidValue);
+    QFETCH(QString, boolValue);
+    QFETCH(QString, numberValue);
+    QFETCH(QUuid, uuid);
+    QFETCH(bool, expires);
+    QFETCH(int, usageCount);
+    QFETCH(bool, valid);
+
+    const QString dateTime = secsToBase64(0);
+    QBuffer buffer;
+    buffer.setData(groupXml(uuidValue, dateTime, boolValue, numberValue));
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    bool hasError;
+    QString errorString;
+    QScopedPointer<Database> db(readXml(&buffer, true, hasError, errorString));
+    QCOMPARE(hasError, !valid);
+    if (valid) {
+        QCOMPARE(db->rootGroup()->uuid(), uuid);
+        QCOMPARE(db->rootGroup()->timeInfo().expires(), expires);
+        QCOMPARE(db->rootGroup()->timeInfo().usageCount(), usageCount);
+    }
+}
+
+void TestKdbx4::testXmlValues_data()
+{
+    QTest::addColumn<QString>("uuidValue");
+    QTest::addColumn<QString>("boolValue");
+    QTest::addColumn<QString>("numberValue");
+    QTest::addColumn<QUuid>("uuid");
+    QTest::addColumn<bool>("expires");
+    QTest::addColumn<int>("usageCount");
+    QTest::addColumn<bool>("valid");
+
+    const QUuid uuid("{8a5a1d4e-3c2b-4f6a-9e8d-7c6b5a493827}");
+    const QString uuidBase64 = QString::fromLatin1(uuid.toRfc4122().toBase64());
+
+    QTest::newRow("true") << uuidBase64 << QString("True") << QString("42") << uuid << true << 42 << true;
+    QTest::newRow("false") << uuidBase64 << QString("false") << QString("+7") << uuid << false << 7 << true;
+    QTest::newRow("empty bool") << uuidBase64 << QString("") << QString("0") << uuid << false << 0 << true;
+    QTest::newRow("int max") << uuidBase64 << QString("FALSE") << QString("2147483647") << uuid << false
+                             << 2147483647 << true;
+    QTest::newRow("int min") << uuidBase64 << QString("TRUE") << QString("-2147483648") << uuid << true
+                             << (-2147483647 - 1) << true;
+    QTest::newRow("leading zeros") << uuidBase64 << QString("true") << QString("000000000017") << uuid << true << 17
+                                   << true;
+    QTest::newRow("uuid without padding") << uuidBase64.left(22) << QString("true") << QString("1") << uuid << true
+                                          << 1 << true;
+    QTest::newRow("invalid bool") << uuidBase64 << QString("yes") << QString("1") << uuid << false << 0 << false;
+    QTest::newRow("invalid number") << uuidBase64 << QString("true") << QString("1x") << uuid << false << 0 << false;
+    QTest::newRow("number overflow") << uuidBase64 << QString("true") << QString("2147483648") << uuid << false << 0
+                                     << false;
+    QTest::newRow("short uuid") << QString("AAAAAAAAAAAAAAAAAAAA") << QString("true") << QString("1") << uuid << false
+                                << 0 << false;
+}
+
+namespace
+{
+    /**
+     * Peak resident set size of the process in MiB, -1 if unknown.
+     */
+    double peakRssMiB()
+    {
+#ifdef Q_OS_UNIX
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef Q_OS_MACOS
+            return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+            return usage.ru_maxrss / 1024.0;
+#endif
+        }
+#endif
+        return -1;
+    }
+} // namespace
+
+void TestKdbx4::benchmarkReadDatabase()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    // attachment heavy database, the attachments are random and don't compress
+    CompositeKey key;
+    key.addKey(PasswordKey("test"));
+    QScopedPointer<Database> db(new Database());
+    db->changeKdf(fastKdf(KeePass2::uuidToKdf(KeePass2::KDF_ARGON2)));
+    db->setKey(key);
+
+    for (int i = 0; i < 32; ++i) {
+        auto* entry = new Entry();
+        entry->setUuid(QUuid::createUuid());
+        entry->setTitle(QString("Entry %1").arg(i));
+        entry->attachments()->set("data.bin", randomGen()->randomArray(4 * 1024 * 1024));
+        entry->setGroup(db->rootGroup());
+    }
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QBuffer::ReadWrite));
+    KeePass2Writer writer;
+    QVERIFY(writer.writeDatabase(&buffer, db.data()));
+    db.reset();
+
+    const double sizeMiB = buffer.size() / (1024.0 * 1024.0);
+    const double rssBefore = peakRssMiB();
+    qint64 elapsed = 0;
+    int rounds = 0;
+
+    QBENCHMARK
+    {
+        QVERIFY(buffer.seek(0));
+        QElapsedTimer timer;
+        timer.start();
+
+        KeePass2Reader reader;
+        QScopedPointer<Database> readDb(reader.readDatabase(&buffer, key));
+        QVERIFY(readDb);
+
+        elapsed += timer.elapsed();
+        ++rounds;
+    }
+
+    qDebug("Read %.1f MiB at %.1f MiB/s, peak RSS %.1f MiB (%.1f MiB before reading)",
+           sizeMiB,
+           sizeMiB * rounds * 1000.0 / qMax<qint64>(elapsed, 1),
+           peakRssMiB(),
+           rssBefore);
+}
+
+void TestKdbx4::benchmarkParseXml()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    QFETCH(QString, filename);
+    QFETCH(QString, password);
+    QFETCH(quint32, version);
+
+    QScopedPointer<Database> db;
+    if (filename.isEmpty()) {
+        // timestamp heavy database, every entry and history item carries seven of them
+        db.reset(new Database());
+        for (int i = 0; i < 2000; ++i) {
+            auto* entry = new Entry();
+            entry->setUuid(QUuid::createUuid());
+            entry->setTitle(QString("Entry %1").arg(i));
+            entry->setUsername(QString("user%1").arg(i));
+            entry->setUrl(QString("https://example.com/%1").arg(i));
+            for (int j = 0; j < 5; ++j) {
+                entry->addHistoryItem(entry->clone(Entry::CloneNoFlags));
+            }
+            entry->setGroup(db->rootGroup());
+        }
+    } else {
+        CompositeKey key;
+        key.addKey(PasswordKey(password));
+        KeePass2Reader reader;
+        db.reset(reader.readDatabase(QString("%1/%2").arg(KEEPASSX_TEST_DATA_DIR, filename), key));
+        QVERIFY2(db, qPrintable(reader.errorString()));
+    }
+
+    // written without a random stream, so only the parsing is measured
+    QBuffer buffer;
+    QVERIFY(buffer.open(QBuffer::ReadWrite));
+    KdbxXmlWriter writer(version);
+    writer.writeDatabase(&buffer, db.data());
+    QVERIFY2(!writer.hasError(), qPrintable(writer.errorString()));
+    db.reset();
+
+    QBENCHMARK
+    {
+        QVERIFY(buffer.seek(0));
+        KdbxXmlReader reader(version);
+        QScopedPointer<Database> readDb(reader.readDatabase(&buffer));
+        QVERIFY2(!reader.hasError(), qPrintable(reader.errorString()));
+    }
+}
+
+void TestKdbx4::benchmarkParseXml_data()
+{
+    QTest::addColumn<QString>("filename");
+    QTest::addColumn<QString>("password");
+    QTest::addColumn<quint32>("version");
+
+    QTest::newRow("Format300") << QString("Format300.kdbx") << QString("a") << KeePass2::FILE_VERSION_3_1;
+    QTest::newRow("Format400") << QString("Format400.kdbx") << QString("t") << KeePass2::FILE_VERSION_4;
+    QTest::newRow("NonAscii") << QString("NonAscii.kdbx") << QString::fromUtf8("\xce\x94\xc3\xb6\xd8\xb6")
+                              << KeePass2::FILE_VERSION_3_1;
+    QTest::newRow("Compressed") << QString("Compressed.kdbx") << QString("") << KeePass2::FILE_VERSION_3_1;
+    QTest::newRow("ProtectedStrings") << QString("ProtectedStrings.kdbx") << QString("masterpw")
+                                      << KeePass2::FILE_VERSION_3_1;
+    QTest::newRow("RecycleBinWithData") << QString("RecycleBinWithData.kdbx") << QString("123")
+                                        << KeePass2::FILE_VERSION_3_1;
+    QTest::newRow("generated KDBX 3.1") << QString() << QString() << KeePass2::FILE_VERSION_3_1;
+    QTest::newRow("generated KDBX 4") << QString() << QString() << KeePass2::FILE_VERSION_4;
+}
+
+void TestKdbx4::benchmarkWriteXml()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    QScopedPointer<Database> db(new Database());
+    for (int i = 0; i < 100000; ++i) {
+        auto* entry = new Entry();
+        entry->setUuid(QUuid::createUuid());
+        entry->setTitle(QString("Entry %1").arg(i));
+        entry->setUsername(QString("user%1").arg(i));
+        entry->setPassword(QString("password %1 & <more>").arg(i));
+        entry->setUrl(QString("https://example.com/%1").arg(i));
+        entry->setNotes(QString("Notes of entry %1\nsecond line").arg(i));
+        entry->setGroup(db->rootGroup());
+    }
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+
+    QBENCHMARK
+    {
+        QVERIFY(buffer.seek(0));
+        KdbxXmlWriter writer(KeePass2::FILE_VERSION_4);
+        writer.writeDatabase(&buffer, db.data());
+        QVERIFY2(!writer.hasError(), qPrintable(writer.errorString()));
+    }
+
+    qDebug("Wrote %.1f MiB of XML, peak RSS %.1f MiB", buffer.size() / (1024.0 * 1024.0), peakRssMiB());
+}
+
 QSharedPointer<Kdf> TestKdbx4::fastKdf(QSharedPointer<Kdf> kdf)
 {
     kdf->setRounds(1);
@@ -31,6 +31,20 @@ private slots:
     void testUpgradeMasterKeyIntegrity();
     void testUpgradeMasterKeyIntegrity_data();
     void testCustomData();
+    void testPipelinedRead();
+    void testPipelinedRead_data();
+    void testPipelinedWrite();
+    void testPipelinedWrite_data();
+    void testKeyCache();
+    void testLazyAttachments();
+    void testXmlDateTime();
+    void testXmlDateTime_data();
+    void testXmlValues();
+    void testXmlValues_data();
+    void benchmarkReadDatabase();
+    void benchmarkParseXml();
+    void benchmarkParseXml_data();
+    void benchmarkWriteXml();
 
 protected:
     void initTestCaseImpl() override;
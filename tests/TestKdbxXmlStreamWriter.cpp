@@ -0,0 +1,254 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestKdbxXmlStreamWriter.h"
+
+#include <QBuffer>
+#include <QTest>
+#include <QXmlStreamWriter>
+
+#include "FailDevice.h"
+#include "format/KdbxXmlStreamWriter.h"
+
+QTEST_GUILESS_MAIN(TestKdbxXmlStreamWriter)
+
+namespace
+{
+    // A document is a list of operations: "<Name" starts an element, "<Name/" writes an empty
+    // element, ">" ends the current element, "@Name=value" adds an attribute, "=text" writes text.
+
+    QByteArray writeReference(const QStringList& operations)
+    {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QXmlStreamWriter xml(&buffer);
+        xml.setAutoFormatting(true);
+        xml.setAutoFormattingIndent(-1);
+        xml.setCodec("UTF-8");
+
+        xml.writeStartDocument("1.0", true);
+        for (const QString& operation : operations) {
+            if (operation == ">") {
+                xml.writeEndElement();
+            } else if (operation.startsWith("<") && operation.endsWith("/")) {
+                xml.writeEmptyElement(operation.mid(1, operation.size() - 2));
+            } else if (operation.startsWith("<")) {
+                xml.writeStartElement(operation.mid(1));
+            } else if (operation.startsWith("@")) {
+                const int separator = operation.indexOf('=');
+                xml.writeAttribute(operation.mid(1, separator - 1), operation.mid(separator + 1));
+            } else {
+                xml.writeCharacters(operation.mid(1));
+            }
+        }
+        xml.writeEndDocument();
+        return buffer.data();
+    }
+
+    QByteArray write(const QStringList& operations)
+    {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        KdbxXmlStreamWriter xml;
+        xml.setDevice(&buffer);
+
+        // the writer keeps pointers to the names
+        QList<QByteArray> names;
+        xml.writeStartDocument();
+        for (const QString& operation : operations) {
+            if (operation == ">") {
+                xml.writeEndElement();
+            } else if (operation.startsWith("<") && operation.endsWith("/")) {
+                names.append(operation.mid(1, operation.size() - 2).toLatin1());
+                xml.writeEmptyElement(names.last().constData());
+            } else if (operation.startsWith("<")) {
+                names.append(operation.mid(1).toLatin1());
+                xml.writeStartElement(names.last().constData());
+            } else if (operation.startsWith("@")) {
+                const int separator = operation.indexOf('=');
+                names.append(operation.mid(1, separator - 1).toLatin1());
+                const QByteArray value = operation.mid(separator + 1).toLatin1();
+                xml.writeAttribute(names.last().constData(), value.constData());
+            } else {
+                xml.writeCharacters(operation.mid(1));
+            }
+        }
+        xml.writeEndDocument();
+        Q_ASSERT(!xml.hasError());
+        return buffer.data();
+    }
+} // namespace
+
+void TestKdbxXmlStreamWriter::testCompareWithQXmlStreamWriter()
+{
+    QFETCH(QStringList, operations);
+
+    const QByteArray expected = writeReference(operations);
+    const QByteArray xmlData = write(operations);
+    QCOMPARE(xmlData.size(), expected.size());
+    QCOMPARE(xmlData, expected);
+}
+
+void TestKdbxXmlStreamWriter::testCompareWithQXmlStreamWriter_data()
+{
+    QTest::addColumn<QStringList>("operations");
+
+    QTest::newRow("empty document") << QStringList();
+    QTest::newRow("entry") << (QStringList() << "<KeePassFile"
+                                             << "<Root"
+                                             << "<Group"
+                                             << "<UUID"
+                                             << "=3Ywc+BLVQ6mOvZGdlKD4bQ=="
+                                             << ">"
+                                             << "<Notes/"
+                                             << "<Entry"
+                                             << "<String"
+                                             << "<Key"
+                                             << "=Password"
+                                             << ">"
+                                             << "<Value"
+                                             << "@Protected=True"
+                                             << "=c2VjcmV0"
+                                             << ">"
+                                             << ">"
+                                             << "<Binary"
+                                             << "<Key"
+                                             << "=file.txt"
+                                             << ">"
+                                             << "<Value"
+                                             << "@Ref=0"
+                                             << ">"
+                                             << ">"
+                                             << "<History"
+                                             << ">"
+                                             << ">"
+                                             << ">"
+                                             << "<DeletedObjects"
+                                             << ">");
+    QTest::newRow("empty elements") << (QStringList() << "<A"
+                                                      << "<B/"
+                                                      << "<C/"
+                                                      << "@ID=1"
+                                                      << ">"
+                                                      << "<D"
+                                                      << "<E/"
+                                                      << ">");
+    QTest::newRow("unclosed elements") << (QStringList() << "<A"
+                                                         << "<B"
+                                                         << "=text"
+                                                         << ">"
+                                                         << "<C"
+                                                         << "<D/");
+    QTest::newRow("escaping") << (QStringList() << "<A"
+                                                << "<B"
+                                                << "=<tag> & \"quotes\" 'apostrophes'"
+                                                << ">"
+                                                << "<C"
+                                                << "=tab\tnewline\ncarriage return\r"
+                                                << ">"
+                                                << "<D"
+                                                << QString("=äß☺ ") + QChar(0x85) + QChar(0xD83D) + QChar(0xDE00)
+                                                << ">");
+    QString largeText = "=";
+    for (int i = 0; i < 50000; ++i) {
+        largeText.append(QString("a<%1ä").arg(i)).append(QChar(0xD83D)).append(QChar(0xDE00));
+    }
+    QTest::newRow("large text") << (QStringList() << "<A"
+                                                  << "<B"
+                                                  << largeText << ">");
+}
+
+void TestKdbxXmlStreamWriter::testInvalidCharacters()
+{
+    QString text;
+    text.append(QChar(0x02)).append("a").append(QChar(0x7F)).append(QChar(0x84)).append(QChar(0x85));
+    text.append(QChar(0x9F)).append("b").append(QChar(0xD800)).append("c").append(QChar(0xDC00));
+    text.append(QChar(0xFFFE)).append(QChar(0xFFFF)).append(QChar(0xFFFD)).append(QChar(0xD800));
+
+    QString validText;
+    validText.append("a").append(QChar(0x85)).append("b").append("c").append(QChar(0xFFFD));
+
+    const QByteArray expected = write(QStringList() << "<A"
+                                                    << "=" + validText << ">");
+    QCOMPARE(write(QStringList() << "<A"
+                                 << "=" + text << ">"),
+             expected);
+    QCOMPARE(expected, writeReference(QStringList() << "<A"
+                                                    << "=" + validText << ">"));
+}
+
+void TestKdbxXmlStreamWriter::testBase64()
+{
+    QByteArray data;
+    for (int i = 0; i < 200 * 1024; ++i) {
+        data.append(static_cast<char>((i * 7919) % 251));
+    }
+
+    for (int size : {0, 1, 2, 3, 4, 5, 200 * 1024}) {
+        // written in pieces of varying length
+        const QByteArray content = data.left(size);
+        QBuffer buffer;
+        QVERIFY(buffer.open(QIODevice::WriteOnly));
+        KdbxXmlStreamWriter xml;
+        xml.setDevice(&buffer);
+        xml.writeStartElement("A");
+        for (int pos = 0, piece = 1; pos < size; pos += piece, piece = piece % 7 + 1) {
+            xml.writeBase64(content.constData() + pos, qMin(piece, size - pos));
+        }
+        xml.writeEndElement();
+        QVERIFY(xml.flush());
+
+        QByteArray expected = "\n<A>" + content.toBase64() + "</A>";
+        if (size == 0) {
+            expected = "\n<A/>";
+        }
+        QCOMPARE(buffer.data(), expected);
+    }
+
+    char encoded[8];
+    QCOMPARE(KdbxXmlStreamWriter::encodeBase64(reinterpret_cast<const uchar*>("ab"), 2, encoded), 4);
+    QCOMPARE(QByteArray(encoded, 4), QByteArray("YWI="));
+}
+
+void TestKdbxXmlStreamWriter::testNumbers()
+{
+    char number[12];
+    for (int value : {0, 1, -1, 42, -2147483647 - 1, 2147483647, 1000000}) {
+        QCOMPARE(QByteArray(number, KdbxXmlStreamWriter::formatNumber(value, number)), QByteArray::number(value));
+    }
+}
+
+void TestKdbxXmlStreamWriter::testDeviceError()
+{
+    FailDevice device(1024);
+    QVERIFY(device.open(QIODevice::WriteOnly));
+
+    KdbxXmlStreamWriter xml;
+    xml.setDevice(&device);
+    xml.writeStartDocument();
+    xml.writeStartElement("A");
+    const QString text(100 * 1024, 'a');
+    for (int i = 0; i < 3; ++i) {
+        xml.writeStartElement("B");
+        xml.writeCharacters(text);
+        xml.writeEndElement();
+    }
+    xml.writeEndDocument();
+
+    QVERIFY(xml.hasError());
+    QVERIFY(!xml.flush());
+}
@@ -0,0 +1,364 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestKdbxXmlTokenizer.h"
+
+#include <QBuffer>
+#include <QFile>
+#include <QTest>
+#include <QXmlStreamReader>
+
+#include "config-keepassx-tests.h"
+#include "core/Database.h"
+#include "core/Entry.h"
+#include "core/Group.h"
+#include "crypto/Crypto.h"
+#include "format/KdbxXmlTokenizer.h"
+#include "format/KdbxXmlWriter.h"
+#include "format/KeePass2.h"
+
+QTEST_GUILESS_MAIN(TestKdbxXmlTokenizer)
+
+typedef KdbxXmlTokenizer::Element Element;
+
+namespace
+{
+    const QStringList ContainerElements = {"KeePassFile",
+                                           "Meta",
+                                           "MemoryProtection",
+                                           "CustomIcons",
+                                           "Icon",
+                                           "Binaries",
+                                           "CustomData",
+                                           "Item",
+                                           "Root",
+                                           "Group",
+                                           "Entry",
+                                           "String",
+                                           "Binary",
+                                           "AutoType",
+                                           "Association",
+                                           "History",
+                                           "Times",
+                                           "DeletedObjects",
+                                           "DeletedObject"};
+    const QStringList Attributes = {"Protected", "ProtectInMemory", "Ref", "ID", "Compressed"};
+
+    bool isContainer(const QString& name, const QString& parent)
+    {
+        return ContainerElements.contains(name) && !(name == "Binary" && parent == "Binaries");
+    }
+
+    // flattens a KDBX document into a list of elements and their text
+    void collect(KdbxXmlTokenizer& xml, const QString& parent, QStringList& events)
+    {
+        while (xml.readNextStartElement()) {
+            const QString name = xml.name();
+            QString event = name;
+            for (const QString& attribute : Attributes) {
+                if (xml.hasAttribute(qPrintable(attribute))) {
+                    event += QString(" %1=%2").arg(attribute, xml.attributeValue(qPrintable(attribute)).toString());
+                }
+            }
+            events.append(event);
+
+            if (isContainer(name, parent)) {
+                collect(xml, name, events);
+            } else {
+                events.append(xml.readElementText());
+            }
+        }
+    }
+
+    void collect(QXmlStreamReader& xml, const QString& parent, QStringList& events)
+    {
+        while (xml.readNextStartElement()) {
+            const QString name = xml.name().toString();
+            const QXmlStreamAttributes attributes = xml.attributes();
+            QString event = name;
+            for (const QString& attribute : Attributes) {
+                if (attributes.hasAttribute(attribute)) {
+                    event += QString(" %1=%2").arg(attribute, attributes.value(attribute).toString());
+                }
+            }
+            events.append(event);
+
+            if (isContainer(name, parent)) {
+                collect(xml, name, events);
+            } else {
+                events.append(xml.readElementText());
+            }
+        }
+    }
+
+    QStringList tokenize(const QByteArray& xmlData, bool* hasError = nullptr)
+    {
+        QBuffer buffer;
+        buffer.setData(xmlData);
+        buffer.open(QIODevice::ReadOnly);
+
+        KdbxXmlTokenizer xml;
+        xml.setDevice(&buffer);
+        QStringList events;
+        collect(xml, QString(), events);
+        if (hasError) {
+            *hasError = xml.hasError();
+        }
+        return events;
+    }
+} // namespace
+
+void TestKdbxXmlTokenizer::initTestCase()
+{
+    QVERIFY(Crypto::init());
+
+    // large enough to span several input chunks
+    Database db;
+    for (int i = 0; i < 2000; ++i) {
+        auto* entry = new Entry();
+        entry->setUuid(QUuid::createUuid());
+        entry->setTitle(QString("Entry %1 <%2> & \"more\"").arg(i).arg(i * 7));
+        entry->setUsername(QString("user%1").arg(i));
+        entry->setPassword(QString("passä☺%1").arg(i));
+        entry->setUrl(QString("https://example.com/?a=%1&b=%2").arg(i).arg(i + 1));
+        entry->setNotes(QString("Line 1\nLine 2 of entry %1").arg(i));
+        entry->setGroup(db.rootGroup());
+    }
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    KdbxXmlWriter writer(KeePass2::FILE_VERSION_4);
+    writer.writeDatabase(&buffer, &db);
+    QVERIFY(!writer.hasError());
+    m_largeXml = buffer.data();
+}
+
+void TestKdbxXmlTokenizer::testCompareWithQXmlStreamReader()
+{
+    QFETCH(QByteArray, xmlData);
+
+    QBuffer buffer;
+    buffer.setData(xmlData);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QXmlStreamReader reference(&buffer);
+    QStringList expected;
+    collect(reference, QString(), expected);
+    QVERIFY(!reference.hasError());
+
+    bool hasError;
+    const QStringList events = tokenize(xmlData, &hasError);
+    QVERIFY(!hasError);
+    QCOMPARE(events.size(), expected.size());
+    QCOMPARE(events, expected);
+}
+
+void TestKdbxXmlTokenizer::testCompareWithQXmlStreamReader_data()
+{
+    QTest::addColumn<QByteArray>("xmlData");
+
+    QFile file(QString(KEEPASSX_TEST_DATA_DIR).append("/NewDatabase.xml"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QTest::newRow("NewDatabase.xml") << file.readAll();
+    QTest::newRow("generated") << m_largeXml;
+}
+
+void TestKdbxXmlTokenizer::testCharacterData()
+{
+    const QByteArray xmlData("<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\"?>\r\n"
+                             "<!-- comment -->\n"
+                             "<KeePassFile><Meta>"
+                             "<Generator>a &amp; b &lt;c&gt; &quot;d&apos; &#65;&#x263A;</Generator>"
+                             "<DatabaseName><![CDATA[x<y&z]]> tail</DatabaseName>"
+                             "<DatabaseDescription>line1\r\nline2\rline3</DatabaseDescription>"
+                             "<DefaultUserName>\xc3\xa4<!-- ignored -->\xe2\x98\xba</DefaultUserName>"
+                             "</Meta></KeePassFile>");
+
+    QStringList expected;
+    expected << "KeePassFile"
+             << "Meta"
+             << "Generator" << QString("a & b <c> \"d' A☺") << "DatabaseName"
+             << "x<y&z tail"
+             << "DatabaseDescription"
+             << "line1\nline2\nline3"
+             << "DefaultUserName" << QString("ä☺");
+    QCOMPARE(tokenize(xmlData), expected);
+}
+
+void TestKdbxXmlTokenizer::testEmptyElements()
+{
+    QBuffer buffer;
+    buffer.setData("<KeePassFile><Meta><DatabaseName/><Generator a='1' b=\"&lt;\" /></Meta></KeePassFile>");
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    KdbxXmlTokenizer xml;
+    xml.setDevice(&buffer);
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.element(), Element::KeePassFile);
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.element(), Element::Meta);
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.element(), Element::DatabaseName);
+    QCOMPARE(xml.readElementText(), QString());
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.element(), Element::Generator);
+    QCOMPARE(xml.attributeValue("a").toString(), QString("1"));
+    QCOMPARE(xml.attributeValue("b").toString(), QString("<"));
+    QVERIFY(!xml.hasAttribute("c"));
+    QVERIFY(!xml.readNextStartElement());
+    QVERIFY(!xml.readNextStartElement());
+    QVERIFY(!xml.readNextStartElement());
+    QVERIFY(!xml.hasError());
+}
+
+void TestKdbxXmlTokenizer::testSkipUnknownElements()
+{
+    QBuffer buffer;
+    buffer.setData("<KeePassFile><Meta><Foo><Bar>x</Bar><Generator>y</Generator><Baz/></Foo>"
+                   "<Generator>z</Generator></Meta></KeePassFile>");
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    KdbxXmlTokenizer xml;
+    xml.setDevice(&buffer);
+    QVERIFY(xml.readNextStartElement());
+    QVERIFY(xml.readNextStartElement());
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.element(), Element::Unknown);
+    QCOMPARE(xml.name(), QString("Foo"));
+    xml.skipCurrentElement();
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.element(), Element::Generator);
+    QCOMPARE(xml.readElementText(), QString("z"));
+    QVERIFY(!xml.hasError());
+}
+
+void TestKdbxXmlTokenizer::testErrors()
+{
+    QFETCH(QByteArray, xmlData);
+    QFETCH(QString, errorString);
+    QFETCH(qint64, lineNumber);
+
+    QBuffer buffer;
+    buffer.setData(xmlData);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    KdbxXmlTokenizer xml;
+    xml.setDevice(&buffer);
+    QStringList events;
+    collect(xml, QString(), events);
+    // read past the root element like KdbxXmlReader
+    xml.readNextStartElement();
+    QVERIFY(xml.hasError());
+    QCOMPARE(xml.errorString(), errorString);
+    QCOMPARE(xml.lineNumber(), lineNumber);
+}
+
+void TestKdbxXmlTokenizer::testErrors_data()
+{
+    QTest::addColumn<QByteArray>("xmlData");
+    QTest::addColumn<QString>("errorString");
+    QTest::addColumn<qint64>("lineNumber");
+
+    QTest::newRow("mismatch") << QByteArray("<KeePassFile><Meta>\n<Generator>x</Name></Meta></KeePassFile>")
+                              << QString("Opening and ending tag mismatch.") << qint64(2);
+    QTest::newRow("truncated") << QByteArray("<KeePassFile>\n<Meta>\n<Generator>x")
+                               << QString("Premature end of document.") << qint64(3);
+    QTest::newRow("entity") << QByteArray("<KeePassFile><Meta><Generator>&bogus;</Generator></Meta></KeePassFile>")
+                            << QString("Entity 'bogus' not declared.") << qint64(1);
+    QTest::newRow("child in text") << QByteArray("<KeePassFile><Meta><Generator><a/></Generator></Meta></KeePassFile>")
+                                   << QString("Expected character data.") << qint64(1);
+    QTest::newRow("empty") << QByteArray() << QString("Premature end of document.") << qint64(1);
+    QTest::newRow("control character")
+        << QByteArray("<KeePassFile>\n<Meta><Generator>test\x10user</Generator></Meta></KeePassFile>")
+        << QString("Invalid XML character or encoding.") << qint64(2);
+    QTest::newRow("character reference")
+        << QByteArray("<KeePassFile><Meta><Generator>&#x10;</Generator></Meta></KeePassFile>")
+        << QString("Invalid character reference.") << qint64(1);
+    QTest::newRow("broken UTF-8")
+        << QByteArray("<KeePassFile><Meta><Generator>\xE2\x82</Generator></Meta></KeePassFile>")
+        << QString("Invalid XML character or encoding.") << qint64(1);
+    QTest::newRow("overlong UTF-8")
+        << QByteArray("<KeePassFile><Meta><Generator>\xC0\xBC</Generator></Meta></KeePassFile>")
+        << QString("Invalid XML character or encoding.") << qint64(1);
+    QTest::newRow("surrogate")
+        << QByteArray("<KeePassFile><Meta><Generator>\xED\xA0\x80</Generator></Meta></KeePassFile>")
+        << QString("Invalid XML character or encoding.") << qint64(1);
+    QTest::newRow("attribute") << QByteArray("<KeePassFile><Meta><Generator a=\"\x01\"/></Meta></KeePassFile>")
+                               << QString("Invalid XML character or encoding.") << qint64(1);
+    QTest::newRow("trailing text") << QByteArray("<KeePassFile></KeePassFile>trailing")
+                                   << QString("Extra content at end of document.") << qint64(1);
+    QTest::newRow("second root") << QByteArray("<KeePassFile></KeePassFile>\n<KeePassFile></KeePassFile>")
+                                 << QString("Extra content at end of document.") << qint64(2);
+}
+
+void TestKdbxXmlTokenizer::testFallback()
+{
+    QBuffer buffer;
+    buffer.setData("<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>"
+                   "<KeePassFile><Meta><Generator a=\"\xe4\">\xe4</Generator></Meta></KeePassFile>");
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    KdbxXmlTokenizer xml;
+    xml.setDevice(&buffer);
+    QVERIFY(xml.readNextStartElement());
+    QVERIFY(xml.usesFallback());
+    QCOMPARE(xml.element(), Element::KeePassFile);
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.element(), Element::Meta);
+    QVERIFY(xml.readNextStartElement());
+    QCOMPARE(xml.element(), Element::Generator);
+    QCOMPARE(xml.attributeValue("a").toString(), QString("ä"));
+    QCOMPARE(xml.readElementText(), QString("ä"));
+    QVERIFY(!xml.readNextStartElement());
+    QVERIFY(!xml.hasError());
+}
+
+void TestKdbxXmlTokenizer::benchmarkTokenizer()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    QBENCHMARK
+    {
+        QBuffer buffer(&m_largeXml);
+        buffer.open(QIODevice::ReadOnly);
+        KdbxXmlTokenizer xml;
+        xml.setDevice(&buffer);
+        QStringList events;
+        collect(xml, QString(), events);
+    }
+}
+
+void TestKdbxXmlTokenizer::benchmarkQXmlStreamReader()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    QBENCHMARK
+    {
+        QBuffer buffer(&m_largeXml);
+        buffer.open(QIODevice::ReadOnly);
+        QXmlStreamReader xml(&buffer);
+        QStringList events;
+        collect(xml, QString(), events);
+    }
+}
@@ -0,0 +1,44 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEEPASSX_TESTKDBXXMLTOKENIZER_H
+#define KEEPASSX_TESTKDBXXMLTOKENIZER_H
+
+#include <QObject>
+
+class TestKdbxXmlTokenizer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testCompareWithQXmlStreamReader();
+    void testCompareWithQXmlStreamReader_data();
+    void testCharacterData();
+    void testEmptyElements();
+    void testSkipUnknownElements();
+    void testErrors();
+    void testErrors_data();
+    void testFallback();
+    void benchmarkTokenizer();
+    void benchmarkQXmlStreamReader();
+
+private:
+    QByteArray m_largeXml;
+};
+
+#endif // KEEPASSX_TESTKDBXXMLTOKENIZER_H
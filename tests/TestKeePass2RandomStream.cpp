@@ -79,3 +79,50 @@ void TestKeePass2RandomStream::test()
     QCOMPARE(cipherData, cipherDataEncrypt);
     QCOMPARE(randomStreamData, cipherData);
 }
+
+void TestKeePass2RandomStream::testBufferBoundary()
+{
+    const QByteArray key = QByteArray::fromHex("000102030405060708090a0b0c0d0e0f");
+    const QByteArray keyIv = CryptoHash::hash(key, CryptoHash::Sha512);
+    const int Size = 10000;
+
+    SymmetricCipher cipher(SymmetricCipher::ChaCha20, SymmetricCipher::Stream, SymmetricCipher::Encrypt);
+    QVERIFY(cipher.init(keyIv.left(32), keyIv.mid(32, 12)));
+    QByteArray expected(Size, '\x5a');
+    QVERIFY(cipher.processInPlace(expected));
+
+    KeePass2RandomStream randomStream(KeePass2::ProtectedStreamAlgo::ChaCha20);
+    QVERIFY(randomStream.init(key));
+
+    // chunks of 33 bytes cross the key stream buffer and cipher block boundaries
+    QByteArray data(Size, '\x5a');
+    for (int offset = 0; offset < Size; offset += 33) {
+        QVERIFY(randomStream.processInPlace(data.data() + offset, qMin(33, Size - offset)));
+    }
+
+    QCOMPARE(data, expected);
+}
+
+void TestKeePass2RandomStream::benchmarkProcess()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    KeePass2RandomStream randomStream(KeePass2::ProtectedStreamAlgo::ChaCha20);
+    QVERIFY(randomStream.init(QByteArray(64, '\x42')));
+
+    // a database with 10000 protected passwords
+    const QByteArray password("correct horse battery staple");
+    QBENCHMARK
+    {
+        for (int i = 0; i < 10000; ++i) {
+            bool ok;
+            QByteArray plainText = randomStream.process(password, &ok);
+            QVERIFY(ok);
+            QCOMPARE(plainText.size(), password.size());
+        }
+    }
+}
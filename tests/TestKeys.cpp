@@ -26,7 +26,10 @@
 #include "core/Metadata.h"
 #include "crypto/Crypto.h"
 #include "crypto/CryptoHash.h"
+#include "crypto/SymmetricCipher.h"
 #include "crypto/kdf/AesKdf.h"
+#include "crypto/kdf/AesKdfKernel.h"
+#include "crypto/kdf/Argon2Tuner.h"
 #include "format/KeePass2Reader.h"
 #include "format/KeePass2Writer.h"
 #include "keys/FileKey.h"
@@ -317,3 +320,70 @@ void TestKeys::testCompositeKeyComponents()
     db2.reset(reader.readDatabase(&buffer, compositeKeyDec4));
     QVERIFY(reader.hasError());
 }
+
+void TestKeys::testAesKdfKernel()
+{
+    if (!AesKdfKernel::isSupported()) {
+        QSKIP("AES-KDF kernel is not supported on this CPU.");
+    }
+
+    QByteArray seed(32, '\0');
+    QByteArray data(32, '\0');
+    for (int i = 0; i < 32; ++i) {
+        seed[i] = static_cast<char>(i * 7 + 3);
+        data[i] = static_cast<char>(i * 13 + 1);
+    }
+
+    QByteArray kernelResult = data;
+    QVERIFY(AesKdfKernel::transform(seed, kernelResult, 3));
+    QCOMPARE(kernelResult.toHex(),
+             QByteArray("a0096d6dd7a2f90e1318cf9d15fbc112ea2615f1c6e6662e661d3d2766b4ca67"));
+
+    // must match the generic AES-256 ECB implementation
+    const quint64 rounds = 10000;
+    kernelResult = data;
+    QVERIFY(AesKdfKernel::transform(seed, kernelResult, rounds));
+
+    SymmetricCipher cipher(SymmetricCipher::Aes256, SymmetricCipher::Ecb, SymmetricCipher::Encrypt);
+    QVERIFY(cipher.init(seed, QByteArray(16, '\0')));
+    QByteArray cipherResult = data;
+    QVERIFY(cipher.processInPlace(cipherResult, rounds));
+    QCOMPARE(kernelResult, cipherResult);
+
+    QByteArray shortData(16, '\0');
+    QVERIFY(!AesKdfKernel::transform(seed, shortData, 1));
+}
+
+void TestKeys::testArgon2Tuner()
+{
+    const int targetMsec = 100;
+    Argon2Tuner tuner(targetMsec);
+    tuner.setMemoryRange(256, 4096);
+    tuner.setMaxParallelism(2);
+
+    int progress = 0;
+    tuner.setProgressCallback([&progress](const Argon2Tuner::Measurement&) { ++progress; });
+    QVERIFY(tuner.tune());
+
+    // 5 memory sizes for each of the lane counts 1 and 2, plus the verification
+    QVERIFY(tuner.measurements().size() > 10);
+    QCOMPARE(progress, tuner.measurements().size());
+
+    Argon2Tuner::Measurement recommendation = tuner.recommendation();
+    QCOMPARE(recommendation.parameters.memory, Q_UINT64_C(4096));
+    QVERIFY(recommendation.parameters.parallelism >= 1 && recommendation.parameters.parallelism <= 2);
+    QVERIFY(recommendation.parameters.iterations >= 1);
+    QVERIFY(recommendation.msec <= targetMsec || recommendation.parameters.iterations == 1);
+
+    // the peak of a run is only reported if it belongs to that run
+    for (const Argon2Tuner::Measurement& measurement : tuner.measurements()) {
+        QVERIFY(measurement.peakRss < 0 || measurement.startRss < 0 || measurement.peakRss >= measurement.startRss);
+    }
+
+    tuner.setMemoryBudget(1024);
+    QVERIFY(tuner.tune());
+    QVERIFY(tuner.recommendation().parameters.memory <= 1024);
+    for (const Argon2Tuner::Measurement& measurement : tuner.measurements()) {
+        QVERIFY(measurement.parameters.memory <= 1024);
+    }
+}
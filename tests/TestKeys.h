@@ -35,6 +35,8 @@ private slots:
     void testFileKeyHash();
     void testFileKeyError();
     void testCompositeKeyComponents();
+    void testAesKdfKernel();
+    void testArgon2Tuner();
     void benchmarkTransformKey();
 };
 
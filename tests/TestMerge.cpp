@@ -18,6 +18,8 @@
 #include "TestMerge.h"
 #include "TestGlobal.h"
 
+#include "core/MergeBase.h"
+#include "core/Merger.h"
 #include "core/Metadata.h"
 #include "crypto/Crypto.h"
 
@@ -559,6 +561,431 @@ void TestMerge::testResolveGroupConflictOlder()
     delete dbSource;
 }
 
+/**
+ * The merge reports what it changed in the destination database.
+ */
+void TestMerge::testMergeChangeList()
+{
+    Database* dbDestination = createTestDatabase();
+
+    Database* dbSource = new Database();
+    dbSource->setRootGroup(dbDestination->rootGroup()->clone(Entry::CloneNoFlags, Group::CloneIncludeEntries));
+
+    QVERIFY(dbDestination->merge(dbSource).isEmpty());
+
+    QTest::qSleep(1);
+    Group* group3 = new Group();
+    group3->setName("group3");
+    group3->setUuid(QUuid::createUuid());
+    group3->setParent(dbSource->rootGroup());
+
+    Entry* entry1 = dbSource->rootGroup()->findEntry("entry1");
+    QVERIFY(entry1 != nullptr);
+    entry1->setGroup(dbSource->rootGroup()->findChildByName("group2"));
+
+    Entry* entry2 = dbSource->rootGroup()->findEntry("entry2");
+    QVERIFY(entry2 != nullptr);
+    entry2->beginUpdate();
+    entry2->setPassword("password");
+    entry2->endUpdate();
+
+    const Merger::ChangeList changes = dbDestination->merge(dbSource);
+
+    QCOMPARE(changes.size(), 3);
+    QCOMPARE(changes.at(0).type, Merger::Updated);
+    QCOMPARE(changes.at(0).isGroup, false);
+    QCOMPARE(changes.at(0).uuid, entry2->uuid());
+    QCOMPARE(changes.at(0).name, QString("entry2"));
+    QCOMPARE(changes.at(1).type, Merger::Moved);
+    QCOMPARE(changes.at(1).uuid, entry1->uuid());
+    QCOMPARE(changes.at(2).type, Merger::Added);
+    QCOMPARE(changes.at(2).isGroup, true);
+    QCOMPARE(changes.at(2).uuid, group3->uuid());
+    QCOMPARE(Merger::describe(changes.at(2)), QString("Added group \"group3\""));
+
+    QVERIFY(dbDestination->merge(dbSource).isEmpty());
+
+    // one entry modified in both databases
+    QTest::qSleep(1);
+    entry2->beginUpdate();
+    entry2->setPassword("password1");
+    entry2->endUpdate();
+    dbDestination->rootGroup()->setMergeMode(Group::KeepExisting);
+
+    const Merger::ChangeList conflicts = dbDestination->merge(dbSource);
+
+    QCOMPARE(conflicts.size(), 1);
+    QCOMPARE(conflicts.at(0).type, Merger::Conflict);
+    QCOMPARE(conflicts.at(0).uuid, entry2->uuid());
+    QCOMPARE(dbDestination->rootGroup()->findEntry("entry2")->password(), QString("password"));
+
+    delete dbDestination;
+    delete dbSource;
+}
+
+/**
+ * An entry deleted in the source database after its last
+ * modification is deleted in the destination database.
+ */
+void TestMerge::testDeletedEntry()
+{
+    Database* dbDestination = createTestDatabase();
+
+    Database* dbSource = new Database();
+    dbSource->setRootGroup(dbDestination->rootGroup()->clone(Entry::CloneNoFlags, Group::CloneIncludeEntries));
+
+    Entry* entry1 = dbSource->rootGroup()->findEntry("entry1");
+    QVERIFY(entry1 != nullptr);
+    QUuid entry1Uuid = entry1->uuid();
+
+    QTest::qSleep(1);
+    delete entry1;
+    QCOMPARE(dbSource->deletedObjects().size(), 1);
+
+    const Merger::ChangeList changes = dbDestination->merge(dbSource);
+
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.at(0).type, Merger::Deleted);
+    QCOMPARE(changes.at(0).isGroup, false);
+    QCOMPARE(changes.at(0).uuid, entry1Uuid);
+
+    QVERIFY(dbDestination->rootGroup()->findEntry("entry1") == nullptr);
+    QCOMPARE(dbDestination->rootGroup()->entriesRecursive().size(), 1);
+    QCOMPARE(dbDestination->deletedObjects().size(), 1);
+    QCOMPARE(dbDestination->deletedObjects().at(0).uuid, entry1Uuid);
+    QCOMPARE(dbDestination->deletedObjects().at(0).deletionTime, dbSource->deletedObjects().at(0).deletionTime);
+
+    // merging again changes nothing
+    QVERIFY(dbDestination->merge(dbSource).isEmpty());
+    QCOMPARE(dbDestination->deletedObjects().size(), 1);
+
+    delete dbDestination;
+    delete dbSource;
+}
+
+/**
+ * A group deleted in the source database is only deleted in the
+ * destination database if it has no contents left.
+ */
+void TestMerge::testDeletedGroup()
+{
+    Database* dbDestination = createTestDatabase();
+
+    Database* dbSource = new Database();
+    dbSource->setRootGroup(dbDestination->rootGroup()->clone(Entry::CloneNoFlags, Group::CloneIncludeEntries));
+
+    QTest::qSleep(1);
+    delete dbSource->rootGroup()->findChildByName("group1");
+    delete dbSource->rootGroup()->findChildByName("group2");
+    QCOMPARE(dbSource->deletedObjects().size(), 4);
+
+    // an entry added in the destination database after the deletion keeps group2 alive
+    QTest::qSleep(1);
+    Entry* entry3 = new Entry();
+    entry3->setUuid(QUuid::createUuid());
+    entry3->setTitle("entry3");
+    entry3->setGroup(dbDestination->rootGroup()->findChildByName("group2"));
+
+    dbDestination->merge(dbSource);
+
+    QVERIFY(dbDestination->rootGroup()->findChildByName("group1") == nullptr);
+    QVERIFY(dbDestination->rootGroup()->findChildByName("group2") != nullptr);
+    QCOMPARE(dbDestination->rootGroup()->entriesRecursive().size(), 1);
+    QCOMPARE(dbDestination->deletedObjects().size(), 4);
+
+    delete dbDestination;
+    delete dbSource;
+}
+
+/**
+ * An entry deleted in the destination database is not brought
+ * back by a source database still containing the old version.
+ */
+void TestMerge::testDeletedInDestination()
+{
+    Database* dbDestination = createTestDatabase();
+
+    Database* dbSource = new Database();
+    dbSource->setRootGroup(dbDestination->rootGroup()->clone(Entry::CloneNoFlags, Group::CloneIncludeEntries));
+
+    QTest::qSleep(1);
+    delete dbDestination->rootGroup()->findEntry("entry1");
+    delete dbDestination->rootGroup()->findChildByName("group2");
+
+    QVERIFY(dbDestination->merge(dbSource).isEmpty());
+
+    QVERIFY(dbDestination->rootGroup()->findEntry("entry1") == nullptr);
+    QVERIFY(dbDestination->rootGroup()->findChildByName("group2") == nullptr);
+    QCOMPARE(dbDestination->rootGroup()->entriesRecursive().size(), 1);
+    QCOMPARE(dbDestination->deletedObjects().size(), 2);
+
+    delete dbDestination;
+    delete dbSource;
+}
+
+/**
+ * An entry modified after its deletion in the other database survives.
+ */
+void TestMerge::testUpdatedAfterDeletion()
+{
+    Database* dbDestination = createTestDatabase();
+
+    Database* dbSource = new Database();
+    dbSource->setRootGroup(dbDestination->rootGroup()->clone(Entry::CloneNoFlags, Group::CloneIncludeEntries));
+
+    QTest::qSleep(1);
+    delete dbDestination->rootGroup()->findEntry("entry1");
+
+    QTest::qSleep(1);
+    Entry* entry1 = dbSource->rootGroup()->findEntry("entry1");
+    QVERIFY(entry1 != nullptr);
+    entry1->beginUpdate();
+    entry1->setPassword("password");
+    entry1->endUpdate();
+
+    const Merger::ChangeList changes = dbDestination->merge(dbSource);
+
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.at(0).type, Merger::Added);
+    entry1 = dbDestination->rootGroup()->findEntry("entry1");
+    QVERIFY(entry1 != nullptr);
+    QCOMPARE(entry1->password(), QString("password"));
+
+    // the other way around
+    QTest::qSleep(1);
+    Entry* entry2 = dbSource->rootGroup()->findEntry("entry2");
+    QVERIFY(entry2 != nullptr);
+    delete entry2;
+
+    QTest::qSleep(1);
+    entry2 = dbDestination->rootGroup()->findEntry("entry2");
+    QVERIFY(entry2 != nullptr);
+    entry2->beginUpdate();
+    entry2->setPassword("password");
+    entry2->endUpdate();
+
+    QVERIFY(dbDestination->merge(dbSource).isEmpty());
+    QVERIFY(dbDestination->rootGroup()->findEntry("entry2") != nullptr);
+
+    delete dbDestination;
+    delete dbSource;
+}
+
+/**
+ * Concurrent edits to different fields of the same entry are merged
+ * into one entry, even if conflicts are resolved by keeping both.
+ */
+void TestMerge::testThreeWayDifferentFields()
+{
+    Database* dbDestination = createTestDatabase();
+    dbDestination->rootGroup()->setMergeMode(Group::KeepBoth);
+
+    Database* dbSource = new Database();
+    dbSource->setRootGroup(dbDestination->rootGroup()->clone(Entry::CloneNoFlags, Group::CloneIncludeEntries));
+    MergeBase base(dbSource);
+
+    QTest::qSleep(1);
+    Entry* destinationEntry1 = dbDestination->rootGroup()->findEntry("entry1");
+    destinationEntry1->setUsername("remote");
+
+    QTest::qSleep(1);
+    Entry* sourceEntry1 = dbSource->rootGroup()->findEntry("entry1");
+    sourceEntry1->setPassword("local");
+    sourceEntry1->attributes()->set("custom", "value", true);
+
+    const Merger::ChangeList changes = dbDestination->merge(dbSource, &base);
+
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.at(0).type, Merger::Updated);
+    QCOMPARE(changes.at(0).uuid, destinationEntry1->uuid());
+
+    QCOMPARE(dbDestination->rootGroup()->entriesRecursive().size(), 2);
+    QCOMPARE(destinationEntry1->username(), QString("remote"));
+    QCOMPARE(destinationEntry1->password(), QString("local"));
+    QCOMPARE(destinationEntry1->attributes()->value("custom"), QString("value"));
+    QVERIFY(destinationEntry1->attributes()->isProtected("custom"));
+
+    delete dbDestination;
+    delete dbSource;
+}
+
+/**
+ * A field changed on both sides is taken from the newer entry.
+ */
+void TestMerge::testThreeWayConflict()
+{
+    Database* dbDestination = createTestDatabase();
+
+    Database* dbSource = new Database();
+    dbSource->setRootGroup(dbDestination->rootGroup()->clone(Entry::CloneNoFlags, Group::CloneIncludeEntries));
+    MergeBase base(dbSource);
+
+    QTest::qSleep(1);
+    Entry* destinationEntry1 = dbDestination->rootGroup()->findEntry("entry1");
+    destinationEntry1->setUsername("remote");
+    destinationEntry1->setNotes("remote");
+
+    QTest::qSleep(1);
+    Entry* sourceEntry1 = dbSource->rootGroup()->findEntry("entry1");
+    sourceEntry1->setNotes("local");
+
+    const Merger::ChangeList changes = dbDestination->merge(dbSource, &base);
+
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.at(0).type, Merger::Conflict);
+    QCOMPARE(dbDestination->rootGroup()->entriesRecursive().size(), 2);
+    QCOMPARE(destinationEntry1->username(), QString("remote"));
+    QCOMPARE(destinationEntry1->notes(), QString("local"));
+
+    delete dbDestination;
+    delete dbSource;
+}
+
+/**
+ * Deletions on either side are detected against the base, even without
+ * deleted objects.
+ */
+void TestMerge::testThreeWayDeletions()
+{
+    Database* dbDestination = createTestDatabase();
+
+    Database* dbSource = new Database();
+    dbSource->setRootGroup(dbDestination->rootGroup()->clone(Entry::CloneNoFlags, Group::CloneIncludeEntries));
+    MergeBase base(dbSource);
+
+    Entry* entry2 = dbSource->rootGroup()->findEntry("entry2");
+    QUuid entry2Uuid = entry2->uuid();
+    delete dbDestination->rootGroup()->findEntry("entry1");
+    delete entry2;
+    dbDestination->setDeletedObjects(QList<DeletedObject>());
+    dbSource->setDeletedObjects(QList<DeletedObject>());
+
+    const Merger::ChangeList changes = dbDestination->merge(dbSource, &base);
+
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.at(0).type, Merger::Deleted);
+    QCOMPARE(changes.at(0).uuid, entry2Uuid);
+    QVERIFY(dbDestination->rootGroup()->entriesRecursive().isEmpty());
+
+    delete dbDestination;
+    delete dbSource;
+}
+
+/**
+ * Entries read back from a file only keep whole seconds of their times,
+ * their fields tell whether they have been modified.
+ */
+void TestMerge::testMergeBaseTruncatedTimes()
+{
+    Database* db = createTestDatabase();
+    MergeBase base(db);
+
+    Entry* entry1 = db->rootGroup()->findEntry("entry1");
+    QVERIFY(base.isUnchanged(entry1));
+
+    TimeInfo timeInfo = entry1->timeInfo();
+    const qint64 lastModificationTime = timeInfo.lastModificationTime().toMSecsSinceEpoch();
+    const qint64 locationChanged = timeInfo.locationChanged().toMSecsSinceEpoch();
+    timeInfo.setLastModificationTime(
+        QDateTime::fromMSecsSinceEpoch(lastModificationTime - lastModificationTime % 1000, Qt::UTC));
+    timeInfo.setLocationChanged(QDateTime::fromMSecsSinceEpoch(locationChanged - locationChanged % 1000, Qt::UTC));
+    entry1->setTimeInfo(timeInfo);
+    QVERIFY(base.isUnchanged(entry1));
+
+    entry1->setNotes("modified");
+    QVERIFY(!base.isUnchanged(entry1));
+    QVERIFY(!base.hasSameContent(entry1));
+    QVERIFY(base.hasSameContent(db->rootGroup()->findEntry("entry2")));
+
+    delete db;
+}
+
+/**
+ * A base updated from a previous one describes the same state as a new base,
+ * even though the fields of unmodified items are not hashed again.
+ */
+void TestMerge::testMergeBaseUpdate()
+{
+    Database* db = createTestDatabase();
+    QScopedPointer<MergeBase> previous(new MergeBase(db));
+
+    Group* group2 = db->rootGroup()->findChildByName("group2");
+    Entry* entry1 = db->rootGroup()->findEntry("entry1");
+    Entry* entry2 = db->rootGroup()->findEntry("entry2");
+    QTest::qSleep(1);
+    entry1->setNotes("modified");
+    entry2->setGroup(group2);
+    Entry* entry3 = new Entry();
+    entry3->setUuid(QUuid::createUuid());
+    entry3->setTitle("entry3");
+    entry3->setGroup(group2);
+    QVERIFY(!previous->hasSameContent(entry1));
+
+    MergeBase updated(db, previous.data());
+    MergeBase rebuilt(db);
+    previous.reset();
+
+    QCOMPARE(updated.entryUuids().toSet(), rebuilt.entryUuids().toSet());
+    QCOMPARE(updated.groupUuids().toSet(), rebuilt.groupUuids().toSet());
+    for (const Entry* entry : db->rootGroup()->entriesRecursive()) {
+        QVERIFY(updated.isUnchanged(entry));
+        QCOMPARE(updated.entryParent(entry->uuid()), rebuilt.entryParent(entry->uuid()));
+
+        const MergeBase::FieldList fields = updated.fields(entry);
+        const QVector<MergeBase::Digest> digests = updated.digests(entry);
+        QCOMPARE(digests.size(), fields.size());
+        for (int i = 0; i < fields.size(); ++i) {
+            QCOMPARE(digests.at(i).id, fields.at(i).id);
+            QCOMPARE(digests.at(i).digest, fields.at(i).digest);
+        }
+    }
+    for (const Group* group : db->rootGroup()->groupsRecursive(true)) {
+        QVERIFY(updated.isUnchanged(group));
+        QCOMPARE(updated.groupParent(group->uuid()), rebuilt.groupParent(group->uuid()));
+    }
+
+    delete db;
+}
+
+void TestMerge::benchmarkMerge()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    QScopedPointer<Database> dbSource(new Database());
+    for (int i = 0; i < 50; ++i) {
+        Group* group = new Group();
+        group->setUuid(QUuid::createUuid());
+        group->setName(QString("Group %1").arg(i));
+        group->setParent(dbSource->rootGroup());
+
+        for (int j = 0; j < 1000; ++j) {
+            Entry* entry = new Entry();
+            entry->setUuid(QUuid::createUuid());
+            entry->setTitle(QString("Entry %1-%2").arg(i).arg(j));
+            entry->setGroup(group);
+        }
+    }
+
+    QScopedPointer<Database> dbDestination(new Database());
+    dbDestination->setRootGroup(dbSource->rootGroup()->clone(Entry::CloneNoFlags, Group::CloneIncludeEntries));
+
+    // touch every tenth entry so the merge has something to update
+    QTest::qSleep(1);
+    const QList<Entry*> entries = dbSource->rootGroup()->entriesRecursive();
+    for (int i = 0; i < entries.size(); i += 10) {
+        entries.at(i)->setNotes("updated");
+    }
+
+    QBENCHMARK_ONCE
+    {
+        QCOMPARE(dbDestination->merge(dbSource.data()).size(), entries.size() / 10);
+    }
+}
+
 Database* TestMerge::createTestDatabase()
 {
     Database* db = new Database();
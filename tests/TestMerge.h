@@ -42,6 +42,17 @@ private slots:
     void testUpdateGroupLocation();
     void testMergeAndSync();
     void testMergeCustomIcons();
+    void testMergeChangeList();
+    void testDeletedEntry();
+    void testDeletedGroup();
+    void testDeletedInDestination();
+    void testUpdatedAfterDeletion();
+    void testThreeWayDifferentFields();
+    void testThreeWayConflict();
+    void testThreeWayDeletions();
+    void testMergeBaseTruncatedTimes();
+    void testMergeBaseUpdate();
+    void benchmarkMerge();
 
 private:
     Database* createTestDatabase();
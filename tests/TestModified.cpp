@@ -406,35 +406,31 @@ void TestModified::testHistoryItems()
     entry2->endUpdate();
     QCOMPARE(entry2->historyItems().size(), 2);
 
+    // both history items share the attachment, it is only counted once
     entry2->beginUpdate();
     entry2->attachments()->remove(key);
     entry2->endUpdate();
     QCOMPARE(entry2->attachments()->attachmentsSize(), 0);
-    QCOMPARE(entry2->historyItems().size(), 1);
+    QCOMPARE(entry2->historyItems().size(), 3);
 
+    // attachments still used by the entry don't count towards the history size
     entry2->beginUpdate();
     entry2->attachments()->set("test2", QByteArray(6000, 'a'));
     entry2->endUpdate();
     QCOMPARE(entry2->attachments()->attachmentsSize(), 6000 + key.size() + 1);
-    QCOMPARE(entry2->historyItems().size(), 2);
+    QCOMPARE(entry2->historyItems().size(), 4);
 
     entry2->beginUpdate();
     entry2->attachments()->set("test3", QByteArray(6000, 'b'));
     entry2->endUpdate();
     QCOMPARE(entry2->attachments()->attachmentsSize(), 12000 + (key.size() + 1) * 2);
-    QCOMPARE(entry2->historyItems().size(), 2);
+    QCOMPARE(entry2->historyItems().size(), 5);
 
     entry2->beginUpdate();
-    entry2->attachments()->set("test4", QByteArray(6000, 'c'));
+    entry2->attachments()->remove(QStringList() << "test2" << "test3");
     entry2->endUpdate();
-    QCOMPARE(entry2->attachments()->attachmentsSize(), 18000 + (key.size() + 1) * 3);
+    QCOMPARE(entry2->attachments()->attachmentsSize(), 0);
     QCOMPARE(entry2->historyItems().size(), 3);
-
-    entry2->beginUpdate();
-    entry2->attachments()->set("test5", QByteArray(6000, 'd'));
-    entry2->endUpdate();
-    QCOMPARE(entry2->attachments()->attachmentsSize(), 24000 + (key.size() + 1) * 4);
-    QCOMPARE(entry2->historyItems().size(), 1);
 }
 
 void TestModified::testHistoryMaxSize()
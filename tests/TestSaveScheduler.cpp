@@ -0,0 +1,116 @@
+/*
+ *  Copyright (C) 2018 KeePassXC Team <team@keepassxc.org>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 or (at your option)
+ *  version 3 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TestSaveScheduler.h"
+
+#include <QSignalSpy>
+#include <QTest>
+
+#include "core/SaveScheduler.h"
+
+QTEST_GUILESS_MAIN(TestSaveScheduler)
+
+void TestSaveScheduler::testCoalesce()
+{
+    SaveScheduler scheduler;
+    scheduler.setDelay(50);
+    QSignalSpy spyDue(&scheduler, SIGNAL(saveDue()));
+
+    for (int i = 0; i < 10; ++i) {
+        scheduler.requestSave();
+    }
+    QVERIFY(scheduler.isPending());
+    QCOMPARE(spyDue.count(), 0);
+
+    QTRY_COMPARE(spyDue.count(), 1);
+    QVERIFY(!scheduler.isPending());
+    QVERIFY(scheduler.isSaving());
+    scheduler.saveFinished(1024);
+
+    QTest::qWait(100);
+    QCOMPARE(spyDue.count(), 1);
+    QCOMPARE(scheduler.savesRequested(), quint64(10));
+    QCOMPARE(scheduler.savesCoalesced(), quint64(9));
+    QCOMPARE(scheduler.savesPerformed(), quint64(1));
+    QCOMPARE(scheduler.bytesWritten(), quint64(1024));
+}
+
+void TestSaveScheduler::testRequestWhileSaving()
+{
+    SaveScheduler scheduler;
+    scheduler.setDelay(10);
+    QSignalSpy spyDue(&scheduler, SIGNAL(saveDue()));
+
+    scheduler.requestSave();
+    QTRY_COMPARE(spyDue.count(), 1);
+
+    // a save must never be started while the previous one is running
+    scheduler.requestSave();
+    scheduler.requestSave();
+    QTest::qWait(50);
+    QCOMPARE(spyDue.count(), 1);
+    QVERIFY(scheduler.isPending());
+
+    scheduler.saveFinished(100);
+    QTRY_COMPARE(spyDue.count(), 2);
+    scheduler.saveFinished(200);
+
+    QCOMPARE(scheduler.savesRequested(), quint64(3));
+    QCOMPARE(scheduler.savesCoalesced(), quint64(1));
+    QCOMPARE(scheduler.savesPerformed(), quint64(2));
+    QCOMPARE(scheduler.bytesWritten(), quint64(300));
+}
+
+void TestSaveScheduler::testBudget()
+{
+    SaveScheduler scheduler;
+    scheduler.setDelay(0);
+    scheduler.setBudget(2, 500);
+    QSignalSpy spyDue(&scheduler, SIGNAL(saveDue()));
+
+    for (int i = 0; i < 2; ++i) {
+        scheduler.requestSave();
+        QTRY_COMPARE(spyDue.count(), i + 1);
+        scheduler.saveFinished(0);
+    }
+
+    // the third save is deferred until the first one leaves the interval, not dropped
+    scheduler.requestSave();
+    QTest::qWait(200);
+    QCOMPARE(spyDue.count(), 2);
+    QVERIFY(scheduler.isPending());
+
+    QTRY_COMPARE(spyDue.count(), 3);
+    scheduler.saveFinished(0);
+    QCOMPARE(scheduler.savesPerformed(), quint64(3));
+}
+
+void TestSaveScheduler::testCancel()
+{
+    SaveScheduler scheduler;
+    scheduler.setDelay(10);
+    QSignalSpy spyDue(&scheduler, SIGNAL(saveDue()));
+
+    scheduler.requestSave();
+    scheduler.cancel();
+    QVERIFY(!scheduler.isPending());
+
+    QTest::qWait(50);
+    QCOMPARE(spyDue.count(), 0);
+    QCOMPARE(scheduler.savesRequested(), quint64(1));
+    QCOMPARE(scheduler.savesPerformed(), quint64(0));
+}
@@ -26,6 +26,9 @@
 #include "streams/SymmetricCipherStream.h"
 
 QTEST_GUILESS_MAIN(TestSymmetricCipher)
+Q_DECLARE_METATYPE(Crypto::Backend)
+Q_DECLARE_METATYPE(SymmetricCipher::Algorithm)
+Q_DECLARE_METATYPE(SymmetricCipher::Mode)
 
 void TestSymmetricCipher::initTestCase()
 {
@@ -490,3 +493,102 @@ void TestSymmetricCipher::testStreamReset()
     writer.close();
     QCOMPARE(buffer.buffer().size(), 16);
 }
+
+void TestSymmetricCipher::testStreamBackends_data()
+{
+    QTest::addColumn<SymmetricCipher::Algorithm>("algorithm");
+    QTest::addColumn<QByteArray>("iv");
+
+    QTest::newRow("Salsa20") << SymmetricCipher::Salsa20 << QByteArray::fromHex("e830094b97205d2a");
+    QTest::newRow("ChaCha20") << SymmetricCipher::ChaCha20 << QByteArray::fromHex("0001020304050607");
+    QTest::newRow("ChaCha20 (96 bit nonce)")
+        << SymmetricCipher::ChaCha20 << QByteArray::fromHex("000000090000004a00000000");
+}
+
+void TestSymmetricCipher::testStreamBackends()
+{
+    QFETCH(SymmetricCipher::Algorithm, algorithm);
+    QFETCH(QByteArray, iv);
+
+    const Crypto::Backend selected = Crypto::backend();
+    const QByteArray key = QByteArray::fromHex("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f");
+    QByteArray plainText;
+    for (int i = 0; i < 5000; ++i) {
+        plainText.append(static_cast<char>(i * 7));
+    }
+
+    QByteArray expected;
+    for (Crypto::Backend backend : Crypto::backends()) {
+        QVERIFY(Crypto::setBackend(backend));
+
+        SymmetricCipher cipher(algorithm, SymmetricCipher::Stream, SymmetricCipher::Encrypt);
+        QVERIFY(cipher.init(key, iv));
+
+        // odd chunk sizes make the key stream cross block boundaries
+        QByteArray cipherText = plainText;
+        int chunk = 1;
+        for (int offset = 0; offset < cipherText.size(); offset += chunk, chunk = chunk * 3 % 131 + 1) {
+            QVERIFY(cipher.processInPlace(cipherText.data() + offset, qMin(chunk, cipherText.size() - offset)));
+        }
+
+        if (expected.isEmpty()) {
+            expected = cipherText;
+        }
+        QCOMPARE(cipherText, expected);
+
+        QVERIFY(cipher.reset());
+        bool ok;
+        QCOMPARE(cipher.process(cipherText, &ok), plainText);
+        QVERIFY(ok);
+    }
+
+    QVERIFY(Crypto::setBackend(selected));
+}
+
+void TestSymmetricCipher::benchmarkCipher_data()
+{
+    QTest::addColumn<Crypto::Backend>("backend");
+    QTest::addColumn<SymmetricCipher::Algorithm>("algorithm");
+    QTest::addColumn<SymmetricCipher::Mode>("mode");
+
+    for (Crypto::Backend backend : Crypto::backends()) {
+        const QString name = Crypto::backendName(backend);
+        QTest::newRow(qPrintable(name + " AES-256 ECB")) << backend << SymmetricCipher::Aes256 << SymmetricCipher::Ecb;
+        QTest::newRow(qPrintable(name + " AES-256 CBC")) << backend << SymmetricCipher::Aes256 << SymmetricCipher::Cbc;
+        QTest::newRow(qPrintable(name + " AES-256 CTR")) << backend << SymmetricCipher::Aes256 << SymmetricCipher::Ctr;
+        QTest::newRow(qPrintable(name + " Twofish ECB")) << backend << SymmetricCipher::Twofish << SymmetricCipher::Ecb;
+        QTest::newRow(qPrintable(name + " Twofish CBC")) << backend << SymmetricCipher::Twofish << SymmetricCipher::Cbc;
+        QTest::newRow(qPrintable(name + " Twofish CTR")) << backend << SymmetricCipher::Twofish << SymmetricCipher::Ctr;
+        QTest::newRow(qPrintable(name + " Salsa20")) << backend << SymmetricCipher::Salsa20 << SymmetricCipher::Stream;
+        QTest::newRow(qPrintable(name + " ChaCha20")) << backend << SymmetricCipher::ChaCha20 << SymmetricCipher::Stream;
+    }
+}
+
+void TestSymmetricCipher::benchmarkCipher()
+{
+    QByteArray env = qgetenv("BENCHMARK");
+
+    if (env.isEmpty() || env == "0" || env == "no") {
+        QSKIP("Benchmark skipped. Set env variable BENCHMARK=1 to enable.");
+    }
+
+    QFETCH(Crypto::Backend, backend);
+    QFETCH(SymmetricCipher::Algorithm, algorithm);
+    QFETCH(SymmetricCipher::Mode, mode);
+
+    const Crypto::Backend selected = Crypto::backend();
+    QVERIFY(Crypto::setBackend(backend));
+
+    SymmetricCipher cipher(algorithm, mode, SymmetricCipher::Encrypt);
+    QVERIFY(Crypto::setBackend(selected));
+
+    const QByteArray key(32, '\x42');
+    const QByteArray iv(algorithm == SymmetricCipher::Salsa20 || algorithm == SymmetricCipher::ChaCha20 ? 8 : 16, '\x17');
+    QVERIFY(cipher.init(key, iv));
+
+    QByteArray data(1024 * 1024, '\x55');
+    QBENCHMARK
+    {
+        QVERIFY(cipher.processInPlace(data));
+    }
+}
@@ -39,6 +39,10 @@ private slots:
     void testChaCha20();
     void testPadding();
     void testStreamReset();
+    void testStreamBackends_data();
+    void testStreamBackends();
+    void benchmarkCipher_data();
+    void benchmarkCipher();
 };
 
 #endif // KEEPASSX_TESTSYMMETRICCIPHER_H
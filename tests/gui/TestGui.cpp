@@ -426,6 +426,7 @@ void TestGui::testSearchEditEntry()
     QTest::mouseClick(searchTextEdit, Qt::LeftButton);
     QTest::keyClicks(searchTextEdit, "Doggy");
     QTRY_VERIFY(m_dbWidget->isInSearchMode());
+    QTRY_COMPARE(m_dbWidget->entryView()->model()->rowCount(), 1);
 
     // Goto "Doggy"'s edit view
     QTest::keyClick(searchTextEdit, Qt::Key_Return);